@@ -0,0 +1,78 @@
+#include <benchmark/benchmark.h>
+#include "server/command_handler.h"
+#include "protocol/parser.h"
+#include "storage/hashtable.h"
+#include <string>
+#include <vector>
+
+using namespace cacheforge;
+
+namespace {
+
+constexpr int64_t kKeys = 100'000;
+
+std::vector<std::string> set_lines() {
+    std::vector<std::string> lines;
+    lines.reserve(kKeys);
+    for (int64_t i = 0; i < kKeys; ++i) {
+        lines.push_back("SET key:" + std::to_string(i) + " " + std::string(32, 'v'));
+    }
+    return lines;
+}
+
+}  // namespace
+
+// Loading 100k SETs, as keys/sec: one text line at a time through
+// execute() the way a pipelined client's commands run, versus one
+// BULKLOAD payload of pre-encoded frames, which skips the text parse, the
+// per-command reply and the per-command shard locking
+static void BM_LoadPerCommand(benchmark::State& state) {
+    auto lines = set_lines();
+    Parser parser;
+    for (auto _ : state) {
+        state.PauseTiming();
+        HashTable table(kKeys * 2);
+        CommandHandler handler(table);
+        ClientState client;
+        state.ResumeTiming();
+        for (const auto& line : lines) {
+            benchmark::DoNotOptimize(handler.execute(*parser.parse_text(line), client));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kKeys);
+}
+BENCHMARK(BM_LoadPerCommand)->Unit(benchmark::kMillisecond);
+
+static void BM_LoadBulk(benchmark::State& state) {
+    Parser parser;
+    std::string frames;
+    for (const auto& line : set_lines()) frames += Parser::serialize_raw(*parser.parse_text(line));
+    for (auto _ : state) {
+        state.PauseTiming();
+        HashTable table(kKeys * 2);
+        CommandHandler handler(table);
+        ClientState client;
+        state.ResumeTiming();
+        benchmark::DoNotOptimize(handler.bulk_load(frames, client));
+    }
+    state.SetItemsProcessed(state.iterations() * kKeys);
+}
+BENCHMARK(BM_LoadBulk)->Unit(benchmark::kMillisecond);
+
+// Serializing the same dataset back out with BULKDUMP, one shard per call
+static void BM_BulkDump(benchmark::State& state) {
+    HashTable table(kKeys * 2);
+    CommandHandler handler(table);
+    ClientState client;
+    Parser parser;
+    std::string frames;
+    for (const auto& line : set_lines()) frames += Parser::serialize_raw(*parser.parse_text(line));
+    handler.bulk_load(frames, client);
+    for (auto _ : state) {
+        for (size_t shard = 0; shard < HashTable::kShardCount; ++shard) {
+            benchmark::DoNotOptimize(handler.execute({"BULKDUMP", {std::to_string(shard)}}, client));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kKeys);
+}
+BENCHMARK(BM_BulkDump)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,87 @@
+#include <benchmark/benchmark.h>
+#include "utils/lz4.h"
+#include "storage/hashtable.h"
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace cacheforge;
+
+namespace {
+
+// JSON documents like our API payloads: repetitive keys, varying values
+std::string json_payload(size_t size, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    std::string s = "[";
+    while (s.size() < size) {
+        s += "{\"id\":" + std::to_string(rng() % 1000000) + ",\"name\":\"user-" +
+             std::to_string(rng() % 5000) + "\",\"score\":" + std::to_string(rng() % 100) +
+             ",\"active\":" + (rng() % 2 ? "true" : "false") + ",\"tags\":[\"cache\",\"forge\"]},";
+    }
+    s.resize(size);
+    return s;
+}
+
+}  // namespace
+
+// Raw codec throughput on one payload; arg is the payload size
+static void BM_Lz4Compress(benchmark::State& state) {
+    auto input = json_payload(static_cast<size_t>(state.range(0)), 1);
+    size_t compressed = 0;
+    for (auto _ : state) {
+        auto block = lz4::compress(input);
+        compressed = block.size();
+        benchmark::DoNotOptimize(block);
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+    state.counters["ratio"] = static_cast<double>(input.size()) / static_cast<double>(compressed);
+}
+BENCHMARK(BM_Lz4Compress)->Arg(1024)->Arg(16384);
+
+static void BM_Lz4Decompress(benchmark::State& state) {
+    auto input = json_payload(static_cast<size_t>(state.range(0)), 1);
+    auto block = lz4::compress(input);
+    std::string out(input.size(), '\0');
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(lz4::decompress(block, out.data(), out.size()));
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Lz4Decompress)->Arg(1024)->Arg(16384);
+
+// SET and GET of 4KB JSON values with compression off (arg 0) or on above
+// 1KB (arg 1); reports the table's memory per value, so the memory saved
+// and the CPU paid for it can be read side by side
+static void BM_CompressedTableSet(benchmark::State& state) {
+    constexpr size_t kKeys = 2000;
+    std::vector<std::string> payloads;
+    for (size_t i = 0; i < 64; ++i) payloads.push_back(json_payload(4096, i));
+    HashTable table(kKeys * 2);
+    table.set_compression(state.range(0) ? 1024 : 0);
+    size_t i = 0;
+    for (auto _ : state) {
+        table.set("doc:" + std::to_string(i % kKeys), Value(payloads[i % payloads.size()]));
+        ++i;
+    }
+    state.SetBytesProcessed(state.iterations() * 4096);
+    state.counters["bytes_per_value"] =
+        static_cast<double>(table.memory_usage_estimate()) / static_cast<double>(table.size());
+}
+BENCHMARK(BM_CompressedTableSet)->Arg(0)->Arg(1);
+
+static void BM_CompressedTableGet(benchmark::State& state) {
+    constexpr size_t kKeys = 2000;
+    HashTable table(kKeys * 2);
+    table.set_compression(state.range(0) ? 1024 : 0);
+    for (size_t i = 0; i < kKeys; ++i) {
+        table.set("doc:" + std::to_string(i), Value(json_payload(4096, i)));
+    }
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(table.get("doc:" + std::to_string(i++ % kKeys)));
+    }
+    state.SetBytesProcessed(state.iterations() * 4096);
+    state.counters["bytes_per_value"] =
+        static_cast<double>(table.memory_usage_estimate()) / static_cast<double>(table.size());
+}
+BENCHMARK(BM_CompressedTableGet)->Arg(0)->Arg(1);
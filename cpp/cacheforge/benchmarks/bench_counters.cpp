@@ -0,0 +1,72 @@
+#include <benchmark/benchmark.h>
+#include "server/command_handler.h"
+#include "storage/hashtable.h"
+
+using namespace cacheforge;
+
+namespace {
+
+HashTable* g_table = nullptr;
+CommandHandler* g_handler = nullptr;
+
+void setup_shared(int64_t counters) {
+    g_table = new HashTable(1024);
+    g_handler = new CommandHandler(*g_table);
+    for (int64_t i = 0; i < counters; ++i) {
+        g_table->set("counter:" + std::to_string(i), Value(int64_t(0)));
+    }
+}
+
+void teardown_shared() {
+    delete g_handler;
+    delete g_table;
+    g_handler = nullptr;
+    g_table = nullptr;
+}
+
+}  // namespace
+
+// All threads increment one key: measures lock contention on the hot path
+static void BM_IncrHotCounter(benchmark::State& state) {
+    if (state.thread_index() == 0) setup_shared(1);
+
+    Command cmd{"INCR", {"counter:0"}};
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(g_handler->execute(cmd));
+    }
+    state.SetItemsProcessed(state.iterations());
+
+    if (state.thread_index() == 0) teardown_shared();
+}
+BENCHMARK(BM_IncrHotCounter)->Threads(1)->Threads(8)->Threads(32)->UseRealTime();
+
+// Threads spread increments over 1M distinct counters
+static void BM_IncrDistinctCounters(benchmark::State& state) {
+    constexpr int64_t kCounters = 1'000'000;
+    if (state.thread_index() == 0) setup_shared(kCounters);
+
+    Command cmd{"INCR", {""}};
+    uint64_t x = 0x9E3779B97F4A7C15ULL * (state.thread_index() + 1);
+    for (auto _ : state) {
+        x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+        cmd.args[0] = "counter:" + std::to_string(x % kCounters);
+        benchmark::DoNotOptimize(g_handler->execute(cmd));
+    }
+    state.SetItemsProcessed(state.iterations());
+
+    if (state.thread_index() == 0) teardown_shared();
+}
+BENCHMARK(BM_IncrDistinctCounters)->Threads(1)->Threads(32)->UseRealTime();
+
+// Client-side alternative the commands replace: GET, parse, SET (racy)
+static void BM_GetSetCounter(benchmark::State& state) {
+    HashTable ht(1024);
+    ht.set("counter", Value("0"));
+    for (auto _ : state) {
+        auto v = ht.get("counter");
+        int64_t n = std::stoll(v->as_string());
+        ht.set("counter", Value(std::to_string(n + 1)));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GetSetCounter);
@@ -0,0 +1,115 @@
+#include <benchmark/benchmark.h>
+#include "server/command_handler.h"
+#include "storage/hashtable.h"
+#include "data/sorted_set.h"
+
+using namespace cacheforge;
+
+namespace {
+
+// Builds {"field0":"value-0000",...} the way clients serialize small objects
+std::string make_json_blob(int fields) {
+    std::string blob = "{";
+    for (int i = 0; i < fields; ++i) {
+        if (i) blob += ",";
+        blob += "\"field" + std::to_string(i) + "\":\"value-0000\"";
+    }
+    return blob + "}";
+}
+
+}  // namespace
+
+// Updating one field of an object stored as a hash: HSET mutates in place
+static void BM_HashFieldUpdate(benchmark::State& state) {
+    const int fields = static_cast<int>(state.range(0));
+    HashTable ht(1024);
+    CommandHandler handler(ht);
+    for (int i = 0; i < fields; ++i) {
+        handler.execute({"HSET", {"obj", "field" + std::to_string(i), "value-0000"}});
+    }
+
+    Command cmd{"HSET", {"obj", "field" + std::to_string(fields / 2), ""}};
+    int64_t n = 0;
+    for (auto _ : state) {
+        cmd.args[2] = "value-" + std::to_string(n++ % 10000);
+        benchmark::DoNotOptimize(handler.execute(cmd));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_HashFieldUpdate)->Arg(8)->Arg(64)->Arg(512);
+
+// The same update when the object is a JSON string: GET, patch, SET the blob
+static void BM_JsonBlobRewrite(benchmark::State& state) {
+    const int fields = static_cast<int>(state.range(0));
+    HashTable ht(1024);
+    CommandHandler handler(ht);
+    ht.set("obj", Value(make_json_blob(fields)));
+
+    const std::string needle = "\"field" + std::to_string(fields / 2) + "\":\"";
+    int64_t n = 0;
+    for (auto _ : state) {
+        auto blob = ht.get("obj")->as_string();
+        auto pos = blob.find(needle) + needle.size();
+        auto end = blob.find('"', pos);
+        blob.replace(pos, end - pos, "value-" + std::to_string(n++ % 10000));
+        benchmark::DoNotOptimize(handler.execute({"SET", {"obj", std::move(blob)}}));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_JsonBlobRewrite)->Arg(8)->Arg(64)->Arg(512);
+
+static void BM_HashFieldRead(benchmark::State& state) {
+    const int fields = static_cast<int>(state.range(0));
+    HashTable ht(1024);
+    CommandHandler handler(ht);
+    for (int i = 0; i < fields; ++i) {
+        handler.execute({"HSET", {"obj", "field" + std::to_string(i), "value-0000"}});
+    }
+    Command cmd{"HGET", {"obj", "field" + std::to_string(fields / 2)}};
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(handler.execute(cmd));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_HashFieldRead)->Arg(8)->Arg(64)->Arg(512);
+
+static void BM_SortedSetAdd(benchmark::State& state) {
+    const int64_t size = state.range(0);
+    SortedSet z;
+    for (int64_t i = 0; i < size; ++i) z.add("m" + std::to_string(i), static_cast<double>(i));
+
+    int64_t n = 0;
+    for (auto _ : state) {
+        // Re-score an existing member: delete + reinsert in the ordered index
+        z.add("m" + std::to_string(n % size), static_cast<double>((n * 31) % size));
+        n++;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SortedSetAdd)->Arg(64)->Arg(100000);
+
+static void BM_SortedSetRank(benchmark::State& state) {
+    const int64_t size = state.range(0);
+    SortedSet z;
+    for (int64_t i = 0; i < size; ++i) z.add("m" + std::to_string(i), static_cast<double>(i));
+
+    int64_t n = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(z.rank("m" + std::to_string(n++ % size)));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SortedSetRank)->Arg(64)->Arg(100000);
+
+static void BM_SortedSetRangeByScore(benchmark::State& state) {
+    const int64_t size = state.range(0);
+    SortedSet z;
+    for (int64_t i = 0; i < size; ++i) z.add("m" + std::to_string(i), static_cast<double>(i));
+
+    for (auto _ : state) {
+        double lo = static_cast<double>(size / 2);
+        benchmark::DoNotOptimize(z.range_by_score({lo, lo + 10.0}));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SortedSetRangeByScore)->Arg(64)->Arg(100000);
@@ -0,0 +1,103 @@
+#include <benchmark/benchmark.h>
+#include "storage/eviction.h"
+#include "storage/expiry.h"
+#include <string>
+#include <vector>
+
+using namespace cacheforge;
+
+namespace {
+
+std::vector<std::string> make_keys(size_t n) {
+    std::vector<std::string> keys;
+    keys.reserve(n);
+    for (size_t i = 0; i < n; ++i) keys.push_back("key:" + std::to_string(i));
+    return keys;
+}
+
+EvictionManager* g_eviction = nullptr;
+ExpiryManager* g_expiry = nullptr;
+
+}  // namespace
+
+static void BM_EvictionRecordAccess(benchmark::State& state) {
+    const size_t n = 1 << 16;
+    static std::vector<std::string> keys = make_keys(n);
+    if (state.thread_index() == 0) {
+        g_eviction = new EvictionManager(n);
+        for (const auto& key : keys) g_eviction->record_insert(key, 64);
+    }
+
+    size_t i = static_cast<size_t>(state.thread_index()) * 7919;
+    for (auto _ : state) {
+        g_eviction->record_access(keys[i++ % n]);
+    }
+    state.SetItemsProcessed(state.iterations());
+
+    if (state.thread_index() == 0) {
+        delete g_eviction;
+        g_eviction = nullptr;
+    }
+}
+BENCHMARK(BM_EvictionRecordAccess)->Threads(1)->Threads(4)->UseRealTime();
+
+// Insert-then-evict steady state of a full LRU
+static void BM_EvictionInsertEvict(benchmark::State& state) {
+    const size_t n = 1 << 14;
+    auto keys = make_keys(n * 4);
+    EvictionManager eviction(n);
+    for (size_t i = 0; i < n; ++i) eviction.record_insert(keys[i], 64);
+
+    size_t i = n;
+    for (auto _ : state) {
+        eviction.record_insert(keys[i++ % keys.size()], 64);
+        benchmark::DoNotOptimize(eviction.evict_one());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_EvictionInsertEvict);
+
+static void BM_ExpirySchedule(benchmark::State& state) {
+    const size_t n = 1 << 16;
+    static std::vector<std::string> keys = make_keys(n);
+    if (state.thread_index() == 0) g_expiry = new ExpiryManager();
+
+    size_t i = static_cast<size_t>(state.thread_index()) * 7919;
+    for (auto _ : state) {
+        g_expiry->set_expiry(keys[i++ % n], std::chrono::seconds(3600));
+    }
+    state.SetItemsProcessed(state.iterations());
+
+    if (state.thread_index() == 0) {
+        delete g_expiry;
+        g_expiry = nullptr;
+    }
+}
+BENCHMARK(BM_ExpirySchedule)->Threads(1)->Threads(4)->UseRealTime();
+
+static void BM_ExpiryCheck(benchmark::State& state) {
+    const size_t n = 1 << 16;
+    auto keys = make_keys(n);
+    ExpiryManager expiry;
+    for (size_t i = 0; i < n; i += 2) expiry.set_expiry(keys[i], std::chrono::seconds(3600));
+
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(expiry.is_expired(keys[i++ % n]));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ExpiryCheck);
+
+// Full scan cost paid by the active-expiry thread
+static void BM_ExpiryScan(benchmark::State& state) {
+    auto keys = make_keys(static_cast<size_t>(state.range(0)));
+    ExpiryManager expiry;
+    for (const auto& key : keys) expiry.set_expiry(key, std::chrono::seconds(3600));
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(expiry.get_expired_keys());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ExpiryScan)->Arg(1 << 10)->Arg(1 << 16);
@@ -0,0 +1,59 @@
+#include <benchmark/benchmark.h>
+#include "utils/hash.h"
+#include "storage/hashtable.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace cacheforge;
+
+namespace {
+
+std::vector<std::string> make_keys(size_t length, size_t count) {
+    std::vector<std::string> keys;
+    keys.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        std::string key = "key:" + std::to_string(i) + ":";
+        while (key.size() < length) key += static_cast<char>('a' + (i + key.size()) % 26);
+        key.resize(length);
+        keys.push_back(std::move(key));
+    }
+    return keys;
+}
+
+}  // namespace
+
+// Hash throughput by key length, against the standard library's hash the
+// table used before
+static void BM_HashStd(benchmark::State& state) {
+    auto keys = make_keys(static_cast<size_t>(state.range(0)), 1024);
+    std::hash<std::string> hasher;
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(hasher(keys[i++ & 1023]));
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_HashStd)->Arg(8)->Arg(32)->Arg(128)->Arg(1024);
+
+static void BM_HashSeeded(benchmark::State& state) {
+    auto keys = make_keys(static_cast<size_t>(state.range(0)), 1024);
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(hashing::hash(keys[i++ & 1023]));
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_HashSeeded)->Arg(8)->Arg(32)->Arg(128)->Arg(1024);
+
+// End to end: a read hashes its key once for both the shard and the bucket
+static void BM_HashTableGetByKeyLength(benchmark::State& state) {
+    HashTable table(1 << 20);
+    auto keys = make_keys(static_cast<size_t>(state.range(0)), 65536);
+    for (const auto& key : keys) table.set(key, Value("value"));
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(table.get(keys[i++ & 65535]));
+    }
+}
+BENCHMARK(BM_HashTableGetByKeyLength)->Arg(16)->Arg(128);
@@ -0,0 +1,107 @@
+#include <benchmark/benchmark.h>
+#include "storage/hashtable.h"
+#include <string>
+#include <vector>
+
+using namespace cacheforge;
+
+namespace {
+
+std::vector<std::string> make_keys(size_t n) {
+    std::vector<std::string> keys;
+    keys.reserve(n);
+    for (size_t i = 0; i < n; ++i) keys.push_back("key:" + std::to_string(i));
+    return keys;
+}
+
+HashTable* g_table = nullptr;
+std::vector<std::string>* g_keys = nullptr;
+
+void setup_shared(size_t n) {
+    g_keys = new std::vector<std::string>(make_keys(n));
+    g_table = new HashTable(n * 2);
+    for (const auto& key : *g_keys) g_table->set(key, Value("value"));
+}
+
+void teardown_shared() {
+    delete g_table;
+    delete g_keys;
+    g_table = nullptr;
+    g_keys = nullptr;
+}
+
+}  // namespace
+
+static void BM_HashTableSet(benchmark::State& state) {
+    const size_t n = static_cast<size_t>(state.range(0));
+    auto keys = make_keys(n);
+    HashTable table(n * 2);
+    size_t i = 0;
+    for (auto _ : state) {
+        table.set(keys[i++ % n], Value("value"));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_HashTableSet)->Arg(1 << 10)->Arg(1 << 16);
+
+static void BM_HashTableGet(benchmark::State& state) {
+    const size_t n = static_cast<size_t>(state.range(0));
+    if (state.thread_index() == 0) setup_shared(n);
+
+    size_t i = static_cast<size_t>(state.thread_index()) * 7919;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(g_table->get((*g_keys)[i++ % n]));
+    }
+    state.SetItemsProcessed(state.iterations());
+
+    if (state.thread_index() == 0) teardown_shared();
+}
+BENCHMARK(BM_HashTableGet)->Arg(1 << 16)->Threads(1)->Threads(4)->Threads(16)->UseRealTime();
+
+// 90% reads, 10% writes from every thread: exercises the reader/writer lock
+static void BM_HashTableMixed(benchmark::State& state) {
+    const size_t n = 1 << 16;
+    if (state.thread_index() == 0) setup_shared(n);
+
+    size_t i = static_cast<size_t>(state.thread_index()) * 7919;
+    for (auto _ : state) {
+        const auto& key = (*g_keys)[i % n];
+        if (i++ % 10 == 0) {
+            g_table->set(key, Value("updated"));
+        } else {
+            benchmark::DoNotOptimize(g_table->get(key));
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+
+    if (state.thread_index() == 0) teardown_shared();
+}
+BENCHMARK(BM_HashTableMixed)->Threads(1)->Threads(4)->Threads(16)->UseRealTime();
+
+// The open-addressing probe table is unsynchronized, so it is only measured
+// single-threaded
+static void BM_HashTableProbeSet(benchmark::State& state) {
+    const size_t n = static_cast<size_t>(state.range(0));
+    auto keys = make_keys(n);
+    HashTable table(n);
+    size_t i = 0;
+    for (auto _ : state) {
+        table.set_with_probe(keys[i++ % n], Value("value"));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_HashTableProbeSet)->Arg(1 << 10)->Arg(1 << 16);
+
+static void BM_HashTableProbeGet(benchmark::State& state) {
+    const size_t n = static_cast<size_t>(state.range(0));
+    auto keys = make_keys(n);
+    HashTable table(n);
+    for (const auto& key : keys) table.set_with_probe(key, Value("value"));
+
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(table.get_with_probe(keys[i++ % n]));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_HashTableProbeGet)->Arg(1 << 10)->Arg(1 << 16);
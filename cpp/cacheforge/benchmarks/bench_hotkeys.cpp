@@ -0,0 +1,63 @@
+#include <benchmark/benchmark.h>
+#include "server/command_handler.h"
+#include "storage/hashtable.h"
+#include "storage/hotkeys.h"
+
+using namespace cacheforge;
+
+namespace {
+
+constexpr int kKeys = 10000;
+
+HashTable* g_table = nullptr;
+CommandHandler* g_handler = nullptr;
+
+void setup_shared(bool tracking) {
+    g_table = new HashTable(kKeys * 2);
+    g_handler = new CommandHandler(*g_table);
+    g_handler->hotkeys().set_enabled(tracking);
+    for (int i = 0; i < kKeys; ++i) {
+        g_table->set("key:" + std::to_string(i), Value("value"));
+    }
+}
+
+void teardown_shared() {
+    delete g_handler;
+    delete g_table;
+    g_handler = nullptr;
+    g_table = nullptr;
+}
+
+}  // namespace
+
+// GET throughput with hot-key tracking off (arg 0) vs on (arg 1); the
+// difference is the per-access cost of the tracker
+static void BM_GetHotKeyTracking(benchmark::State& state) {
+    if (state.thread_index() == 0) setup_shared(state.range(0) != 0);
+
+    Command cmd{"GET", {""}};
+    uint64_t x = 0x9E3779B97F4A7C15ULL * (state.thread_index() + 1);
+    for (auto _ : state) {
+        x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+        cmd.args[0] = "key:" + std::to_string(x % kKeys);
+        benchmark::DoNotOptimize(g_handler->execute(cmd));
+    }
+    state.SetItemsProcessed(state.iterations());
+
+    if (state.thread_index() == 0) teardown_shared();
+}
+BENCHMARK(BM_GetHotKeyTracking)->Arg(0)->Arg(1)->Threads(1)->Threads(8)->UseRealTime();
+
+// Raw tracker cost per access at different sample rates
+static void BM_HotKeyRecord(benchmark::State& state) {
+    HotKeyTracker tracker(16, static_cast<uint32_t>(state.range(0)));
+    std::vector<std::string> keys;
+    for (int i = 0; i < 1024; ++i) keys.push_back("key:" + std::to_string(i));
+
+    size_t i = 0;
+    for (auto _ : state) {
+        tracker.record(keys[i++ & 1023]);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_HotKeyRecord)->Arg(1)->Arg(16)->Arg(128);
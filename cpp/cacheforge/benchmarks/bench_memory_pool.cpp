@@ -0,0 +1,51 @@
+#include <benchmark/benchmark.h>
+#include "utils/memory_pool.h"
+#include <cstdlib>
+#include <vector>
+
+using namespace cacheforge;
+
+// Allocation sizes stay within the initial capacity: growing the pool
+// relocates its storage and is not what these measure
+
+static void BM_MemoryPoolAllocFree(benchmark::State& state) {
+    static MemoryPool* pool = nullptr;
+    if (state.thread_index() == 0) pool = new MemoryPool(64, 1 << 16);
+
+    for (auto _ : state) {
+        void* p = pool->allocate();
+        benchmark::DoNotOptimize(p);
+        pool->deallocate(p);
+    }
+    state.SetItemsProcessed(state.iterations());
+
+    if (state.thread_index() == 0) {
+        delete pool;
+        pool = nullptr;
+    }
+}
+BENCHMARK(BM_MemoryPoolAllocFree)->Threads(1)->Threads(4)->UseRealTime();
+
+static void BM_MemoryPoolBatch(benchmark::State& state) {
+    const size_t batch = static_cast<size_t>(state.range(0));
+    MemoryPool pool(64, batch);
+    std::vector<void*> ptrs(batch);
+    for (auto _ : state) {
+        for (auto& p : ptrs) p = pool.allocate();
+        for (auto* p : ptrs) pool.deallocate(p);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_MemoryPoolBatch)->Arg(64)->Arg(4096);
+
+// Baseline for the pool numbers above
+static void BM_MallocBatch(benchmark::State& state) {
+    const size_t batch = static_cast<size_t>(state.range(0));
+    std::vector<void*> ptrs(batch);
+    for (auto _ : state) {
+        for (auto& p : ptrs) p = std::malloc(64);
+        for (auto* p : ptrs) std::free(p);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_MallocBatch)->Arg(64)->Arg(4096);
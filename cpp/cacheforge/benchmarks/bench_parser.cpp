@@ -0,0 +1,67 @@
+#include <benchmark/benchmark.h>
+#include "protocol/parser.h"
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace cacheforge;
+
+namespace {
+
+// Binary frame: <cmd_len:4><cmd><argc:4>[<arg_len:4><arg>]...
+std::vector<uint8_t> encode_raw(const std::string& name, const std::vector<std::string>& args) {
+    std::vector<uint8_t> out;
+    auto put_u32 = [&out](uint32_t v) {
+        uint8_t buf[4];
+        std::memcpy(buf, &v, 4);
+        out.insert(out.end(), buf, buf + 4);
+    };
+    put_u32(static_cast<uint32_t>(name.size()));
+    out.insert(out.end(), name.begin(), name.end());
+    put_u32(static_cast<uint32_t>(args.size()));
+    for (const auto& arg : args) {
+        put_u32(static_cast<uint32_t>(arg.size()));
+        out.insert(out.end(), arg.begin(), arg.end());
+    }
+    return out;
+}
+
+}  // namespace
+
+static void BM_ParseText(benchmark::State& state) {
+    Parser parser;
+    std::string line = "SET user:1000:session " + std::string(state.range(0), 'x');
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(parser.parse_text(line));
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(line.size()));
+}
+BENCHMARK(BM_ParseText)->Arg(16)->Arg(1024);
+
+static void BM_ParseRaw(benchmark::State& state) {
+    Parser parser;
+    auto frame = encode_raw("SET", {"user:1000:session", std::string(state.range(0), 'x')});
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(parser.parse_raw(frame.data(), frame.size()));
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(frame.size()));
+}
+BENCHMARK(BM_ParseRaw)->Arg(16)->Arg(1024)->Threads(1)->Threads(4);
+
+static void BM_SerializeString(benchmark::State& state) {
+    std::string value(state.range(0), 'x');
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(Parser::serialize_string(value));
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SerializeString)->Arg(16)->Arg(1024);
+
+static void BM_SerializeArray(benchmark::State& state) {
+    std::vector<std::string> items(state.range(0), "member");
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(Parser::serialize_array(items));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SerializeArray)->Arg(10)->Arg(1000);
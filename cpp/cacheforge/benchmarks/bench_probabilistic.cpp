@@ -0,0 +1,98 @@
+#include <benchmark/benchmark.h>
+#include "data/value.h"
+#include "data/hyperloglog.h"
+#include "data/bloom_filter.h"
+#include <cmath>
+#include <string>
+#include <vector>
+
+using namespace cacheforge;
+
+namespace {
+
+std::string visitor(int64_t i) { return "visitor:" + std::to_string(i); }
+
+}  // namespace
+
+// Unique visitors counted the current way: the raw IDs kept as a list
+// value. Exact, but memory grows with every visitor. Reported per run:
+// bytes = the value's memory_size(), error_pct = 0
+static void BM_UniqueVisitorsList(benchmark::State& state) {
+    const int64_t n = state.range(0);
+    size_t bytes = 0;
+    for (auto _ : state) {
+        std::vector<std::string> ids;
+        for (int64_t i = 0; i < n; ++i) ids.push_back(visitor(i));
+        Value list(std::move(ids));
+        bytes = list.memory_size();
+        benchmark::DoNotOptimize(list.as_list().size());
+    }
+    state.counters["bytes"] = static_cast<double>(bytes);
+    state.counters["error_pct"] = 0;
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_UniqueVisitorsList)->Arg(1000)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMillisecond);
+
+// The same visitors as PFADD would count them: at most 16 KB whatever n,
+// with the estimate's relative error alongside
+static void BM_UniqueVisitorsHll(benchmark::State& state) {
+    const int64_t n = state.range(0);
+    size_t bytes = 0;
+    uint64_t estimate = 0;
+    for (auto _ : state) {
+        Value v(HyperLogLog{});
+        auto& hll = v.as_hyperloglog();
+        for (int64_t i = 0; i < n; ++i) hll.add(visitor(i));
+        estimate = hll.count();
+        bytes = v.memory_size();
+    }
+    state.counters["bytes"] = static_cast<double>(bytes);
+    state.counters["error_pct"] =
+        100.0 * std::abs(static_cast<double>(estimate) - static_cast<double>(n)) / static_cast<double>(n);
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_UniqueVisitorsHll)->Arg(1000)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMillisecond);
+
+// PFCOUNT on a dense HyperLogLog: one pass over the 16K registers
+static void BM_HllCount(benchmark::State& state) {
+    HyperLogLog hll;
+    for (int64_t i = 0; i < 100000; ++i) hll.add(visitor(i));
+    for (auto _ : state) benchmark::DoNotOptimize(hll.count());
+}
+BENCHMARK(BM_HllCount);
+
+// PFMERGE of two dense HyperLogLogs: a byte-wise max over 16 KB
+static void BM_HllMergeDense(benchmark::State& state) {
+    HyperLogLog a;
+    HyperLogLog b;
+    for (int64_t i = 0; i < 100000; ++i) {
+        a.add(visitor(i));
+        b.add(visitor(i + 50000));
+    }
+    for (auto _ : state) {
+        HyperLogLog merged = a;
+        merged.merge(b);
+        benchmark::DoNotOptimize(merged);
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(HyperLogLog::kRegisters));
+}
+BENCHMARK(BM_HllMergeDense);
+
+// Membership of n IDs at a 1% error rate, with the false-positive rate
+// measured on as many IDs that were never added
+static void BM_BloomAddExists(benchmark::State& state) {
+    const int64_t n = state.range(0);
+    size_t bytes = 0;
+    int64_t false_positives = 0;
+    for (auto _ : state) {
+        BloomFilter bloom(0.01, static_cast<uint64_t>(n));
+        for (int64_t i = 0; i < n; ++i) bloom.add(visitor(i));
+        false_positives = 0;
+        for (int64_t i = 0; i < n; ++i) false_positives += bloom.contains(visitor(n + i));
+        bytes = bloom.memory_size();
+    }
+    state.counters["bytes"] = static_cast<double>(bytes);
+    state.counters["fp_pct"] = 100.0 * static_cast<double>(false_positives) / static_cast<double>(n);
+    state.SetItemsProcessed(state.iterations() * n * 2);
+}
+BENCHMARK(BM_BloomAddExists)->Arg(1000)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,108 @@
+#include <benchmark/benchmark.h>
+#include "server/pubsub.h"
+#include "server/keyspace_events.h"
+#include <deque>
+#include <string>
+#include <vector>
+
+using namespace cacheforge;
+
+// PUBLISH fan-out to N subscribers of one channel. Each subscriber has a
+// queue standing in for its connection's write queue; "shared" hands every
+// queue the same buffer, "copy" gives each its own string as a per-client
+// serialization would. Arg 0 is the subscriber count, arg 1 the payload.
+static void BM_PubSubFanoutShared(benchmark::State& state) {
+    const auto subscribers = static_cast<uint64_t>(state.range(0));
+    PubSub ps;
+    for (uint64_t id = 0; id < subscribers; ++id) ps.subscribe(id, "events");
+    std::vector<std::deque<PubSub::Message>> queues(subscribers);
+    std::string payload(static_cast<size_t>(state.range(1)), 'x');
+    auto deliver = [&](uint64_t id, const PubSub::Message& m) { queues[id].push_back(m); };
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(ps.publish("events", payload, deliver));
+        state.PauseTiming();
+        for (auto& q : queues) q.clear();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(subscribers));
+}
+BENCHMARK(BM_PubSubFanoutShared)->Args({10000, 64})->Args({10000, 4096})->Unit(benchmark::kMicrosecond);
+
+static void BM_PubSubFanoutCopy(benchmark::State& state) {
+    const auto subscribers = static_cast<uint64_t>(state.range(0));
+    PubSub ps;
+    for (uint64_t id = 0; id < subscribers; ++id) ps.subscribe(id, "events");
+    std::vector<std::deque<std::string>> queues(subscribers);
+    std::string payload(static_cast<size_t>(state.range(1)), 'x');
+    auto deliver = [&](uint64_t id, const PubSub::Message& m) { queues[id].push_back(*m); };
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(ps.publish("events", payload, deliver));
+        state.PauseTiming();
+        for (auto& q : queues) q.clear();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(subscribers));
+}
+BENCHMARK(BM_PubSubFanoutCopy)->Args({10000, 64})->Args({10000, 4096})->Unit(benchmark::kMicrosecond);
+
+// Publishing with many pattern subscriptions: the trie only glob-matches
+// patterns whose literal prefix the channel starts with
+static void BM_PubSubPatternMatch(benchmark::State& state) {
+    PubSub ps;
+    const int patterns = static_cast<int>(state.range(0));
+    for (int i = 0; i < patterns; ++i) {
+        ps.psubscribe(static_cast<uint64_t>(i), "tenant:" + std::to_string(i) + ":*");
+    }
+    std::vector<std::string> channels;
+    for (int i = 0; i < 1024; ++i) channels.push_back("tenant:" + std::to_string(i % patterns) + ":orders");
+
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(ps.publish(channels[i++ & 1023], "payload", nullptr));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PubSubPatternMatch)->Arg(100)->Arg(10000);
+
+// What a write pays to report a keyspace event to one __keyspace@0__:*
+// subscriber: appending to its thread's buffer for the publisher thread,
+// versus publishing inline as a synchronous callback under the write's
+// locks would. The buffered run reports events dropped while the
+// publisher lagged.
+static void BM_KeyspaceEventBuffered(benchmark::State& state) {
+    static PubSub* ps;
+    static KeyspaceEvents* bus;
+    if (state.thread_index() == 0) {
+        ps = new PubSub;
+        ps->psubscribe(1, "__keyspace@0__:*");
+        bus = new KeyspaceEvents;
+        bus->set_publisher([](const std::string& channel, const std::string& message) {
+            ps->publish(channel, message, [](uint64_t, const PubSub::Message&) {});
+        });
+        bus->set_classes(KeyspaceEvents::parse_classes("KA"));
+        bus->start();
+    }
+    std::string key = "user:" + std::to_string(state.thread_index()) + ":1234";
+    for (auto _ : state) bus->notify(KeyspaceEvents::kString, "set", key);
+    state.SetItemsProcessed(state.iterations());
+    if (state.thread_index() == 0) {
+        bus->stop();
+        state.counters["dropped"] = static_cast<double>(bus->dropped());
+        delete bus;
+        delete ps;
+    }
+}
+BENCHMARK(BM_KeyspaceEventBuffered)->Threads(1)->Threads(4);
+
+static void BM_KeyspaceEventInline(benchmark::State& state) {
+    static PubSub ps;
+    if (state.thread_index() == 0) ps.psubscribe(1, "__keyspace@0__:*");
+    std::string key = "user:" + std::to_string(state.thread_index()) + ":1234";
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(ps.publish("__keyspace@0__:" + key, "set", [](uint64_t, const PubSub::Message&) {}));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_KeyspaceEventInline)->Threads(1)->Threads(4);
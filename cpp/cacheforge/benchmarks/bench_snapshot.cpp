@@ -0,0 +1,52 @@
+#include <benchmark/benchmark.h>
+#include "persistence/snapshot.h"
+#include <filesystem>
+#include <string>
+#include <vector>
+
+using namespace cacheforge;
+
+namespace {
+
+std::vector<SnapshotEntry> make_entries(size_t n) {
+    std::vector<SnapshotEntry> entries;
+    entries.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        entries.push_back({"key:" + std::to_string(i), Value(std::string(100, 'v')), -1});
+    }
+    return entries;
+}
+
+std::string bench_dir() {
+    return (std::filesystem::temp_directory_path() / "cacheforge_bench_snapshot").string();
+}
+
+}  // namespace
+
+static void BM_SnapshotSave(benchmark::State& state) {
+    auto entries = make_entries(static_cast<size_t>(state.range(0)));
+    std::filesystem::remove_all(bench_dir());
+    SnapshotManager snapshots(bench_dir());
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(snapshots.save_snapshot(entries));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    std::filesystem::remove_all(bench_dir());
+}
+BENCHMARK(BM_SnapshotSave)->Arg(1000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+static void BM_SnapshotLoad(benchmark::State& state) {
+    std::filesystem::remove_all(bench_dir());
+    SnapshotManager snapshots(bench_dir());
+    snapshots.save_snapshot(make_entries(static_cast<size_t>(state.range(0))));
+
+    for (auto _ : state) {
+        std::vector<SnapshotEntry> loaded;
+        snapshots.load_snapshot(loaded);
+        benchmark::DoNotOptimize(loaded.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    std::filesystem::remove_all(bench_dir());
+}
+BENCHMARK(BM_SnapshotLoad)->Arg(1000)->Arg(100000)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,82 @@
+#include <benchmark/benchmark.h>
+#include "server/command_handler.h"
+#include "server/stats.h"
+#include "server/slowlog.h"
+#include "storage/hashtable.h"
+
+using namespace cacheforge;
+
+namespace {
+
+constexpr int kKeys = 10000;
+
+HashTable* g_table = nullptr;
+CommandHandler* g_handler = nullptr;
+
+void setup_shared(bool stats) {
+    g_table = new HashTable(kKeys * 2);
+    g_handler = new CommandHandler(*g_table);
+    g_handler->stats().set_enabled(stats);
+    g_handler->hotkeys().set_enabled(false);
+    for (int i = 0; i < kKeys; ++i) {
+        g_table->set("key:" + std::to_string(i), Value("value"));
+    }
+}
+
+void teardown_shared() {
+    delete g_handler;
+    delete g_table;
+    g_handler = nullptr;
+    g_table = nullptr;
+}
+
+}  // namespace
+
+// GET throughput with latency timing off (arg 0) vs on (arg 1) at the
+// default sample rate. Counters are always on; the difference is the cost
+// of the sampled clock reads and histogram updates
+static void BM_GetStatsOverhead(benchmark::State& state) {
+    if (state.thread_index() == 0) setup_shared(state.range(0) != 0);
+
+    Command cmd{"GET", {""}};
+    uint64_t x = 0x9E3779B97F4A7C15ULL * (state.thread_index() + 1);
+    for (auto _ : state) {
+        x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+        cmd.args[0] = "key:" + std::to_string(x % kKeys);
+        benchmark::DoNotOptimize(g_handler->execute(cmd));
+    }
+    state.SetItemsProcessed(state.iterations());
+
+    if (state.thread_index() == 0) teardown_shared();
+}
+BENCHMARK(BM_GetStatsOverhead)->Arg(0)->Arg(1)->Threads(1)->Threads(8)->UseRealTime();
+
+static void BM_StatsRecordCommand(benchmark::State& state) {
+    Stats stats;
+    size_t index = stats.register_command("GET");
+    uint64_t ns = 0;
+    for (auto _ : state) {
+        stats.record_call(index);
+        stats.record_latency(index, ns++ & 0xFFFF);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_StatsRecordCommand)->Threads(1)->Threads(8);
+
+// Cost of logging one slow command into the ring buffer
+static void BM_SlowLogRecord(benchmark::State& state) {
+    static SlowLog* log = nullptr;
+    if (state.thread_index() == 0) log = new SlowLog(128, 0);
+
+    std::vector<std::string> args{"key:12345", std::string(64, 'v')};
+    for (auto _ : state) {
+        log->record("SET", args, "127.0.0.1:50000", 12000);
+    }
+    state.SetItemsProcessed(state.iterations());
+
+    if (state.thread_index() == 0) {
+        delete log;
+        log = nullptr;
+    }
+}
+BENCHMARK(BM_SlowLogRecord)->Threads(1)->Threads(8);
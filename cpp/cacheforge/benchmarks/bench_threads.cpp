@@ -0,0 +1,65 @@
+#include <benchmark/benchmark.h>
+#include "server/command_handler.h"
+#include "storage/hashtable.h"
+#include "utils/cpu.h"
+#include <string>
+#include <vector>
+
+using namespace cacheforge;
+
+namespace {
+
+constexpr int64_t kKeys = 100'000;
+
+HashTable* g_table = nullptr;
+CommandHandler* g_handler = nullptr;
+
+void setup_shared() {
+    g_table = new HashTable(kKeys * 2);
+    g_handler = new CommandHandler(*g_table);
+    for (int64_t i = 0; i < kKeys; ++i) {
+        g_table->set("key:" + std::to_string(i), Value(std::string("value")));
+    }
+}
+
+void teardown_shared() {
+    delete g_handler;
+    delete g_table;
+    g_handler = nullptr;
+    g_table = nullptr;
+}
+
+}  // namespace
+
+// Mixed GET/SET from as many threads as cpu::default_threads() would run
+// and from 4x that, each either floating or pinned to one allowed CPU the
+// way Server pins network workers. Oversubscribing a CPU quota shows up as
+// lower throughput per thread; pinning pays off on multi-socket hosts
+// where a floating thread loses its caches to migrations
+static void BM_MixedOpsThreads(benchmark::State& state) {
+    if (state.thread_index() == 0) setup_shared();
+    bool pinned = state.range(0) != 0;
+    auto before = cpu::allowed();
+    if (pinned && !before.empty()) {
+        cpu::pin_thread({before[static_cast<size_t>(state.thread_index()) % before.size()]});
+    }
+
+    Command get{"GET", {""}};
+    Command set{"SET", {"", "value"}};
+    uint64_t x = 0x9E3779B97F4A7C15ULL * (state.thread_index() + 1);
+    for (auto _ : state) {
+        x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+        auto& cmd = x % 10 == 0 ? set : get;
+        cmd.args[0] = "key:" + std::to_string(x % kKeys);
+        benchmark::DoNotOptimize(g_handler->execute(cmd));
+    }
+    state.SetItemsProcessed(state.iterations());
+
+    if (pinned) cpu::pin_thread(before);
+    if (state.thread_index() == 0) teardown_shared();
+}
+BENCHMARK(BM_MixedOpsThreads)
+    ->ArgName("pinned")->Arg(0)->Arg(1)
+    ->Threads(static_cast<int>(cpu::default_threads()))
+    ->Threads(static_cast<int>(cpu::default_threads() * 4))
+    ->UseRealTime();
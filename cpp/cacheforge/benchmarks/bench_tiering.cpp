@@ -0,0 +1,93 @@
+#include <benchmark/benchmark.h>
+#include "storage/tiering.h"
+#include "storage/hashtable.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+using namespace cacheforge;
+
+namespace {
+
+constexpr size_t kKeys = 40000;
+constexpr size_t kValueBytes = 1024;
+constexpr size_t kBudget = kKeys * kValueBytes / 10;  // dataset is 10x the budget
+
+struct Dataset {
+    std::string dir;
+    HashTable table{kKeys * 2};
+    std::unique_ptr<TieredStorage> tiers;
+    std::vector<std::string> keys;
+    ~Dataset() {
+        tiers.reset();
+        if (!dir.empty()) std::filesystem::remove_all(dir);
+    }
+};
+
+// Loads kKeys values once; with `tiered` only a tenth stays resident
+Dataset& dataset(bool tiered) {
+    static std::unique_ptr<Dataset> sets[2];
+    auto& slot = sets[tiered ? 1 : 0];
+    if (slot) return *slot;
+    slot = std::make_unique<Dataset>();
+    if (tiered) {
+        slot->dir = (std::filesystem::temp_directory_path() /
+                     ("cacheforge_bench_tiering_" + std::to_string(::getpid()))).string();
+        TieringOptions options;
+        options.dir = slot->dir;
+        options.memory_budget = kBudget;
+        options.promote_after = 2;
+        slot->tiers = std::make_unique<TieredStorage>(slot->table, options);
+    }
+    for (size_t i = 0; i < kKeys; ++i) {
+        slot->keys.push_back("key:" + std::to_string(i));
+        slot->table.set(slot->keys.back(), Value(std::string(kValueBytes, 'a' + i % 26)));
+        if (slot->tiers) slot->tiers->on_write(slot->keys.back());
+    }
+    return *slot;
+}
+
+}  // namespace
+
+// GET latency over the dataset. Arg 0 selects tiered storage, arg 1 the
+// access pattern: 0 = uniform (90% of reads are cold), 1 = skewed (90% of
+// reads go to 5% of the keys, which promotion keeps resident). Reports the
+// resident dataset bytes and the p99 of individually timed GETs.
+static void BM_TieredGet(benchmark::State& state) {
+    auto& data = dataset(state.range(0) != 0);
+    const bool skewed = state.range(1) != 0;
+    std::mt19937_64 rng(42);
+    std::uniform_int_distribution<size_t> any(0, kKeys - 1);
+    std::uniform_int_distribution<size_t> hot(0, kKeys / 20 - 1);
+    std::uniform_int_distribution<int> coin(0, 9);
+    std::vector<uint64_t> samples;
+    samples.reserve(1 << 20);
+
+    for (auto _ : state) {
+        size_t i = skewed && coin(rng) != 0 ? hot(rng) : any(rng);
+        const auto& key = data.keys[i];
+        auto start = std::chrono::steady_clock::now();
+        benchmark::DoNotOptimize(data.table.get(key));
+        if (data.tiers) data.tiers->on_read(key);
+        samples.push_back(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count()));
+    }
+
+    std::sort(samples.begin(), samples.end());
+    if (!samples.empty()) {
+        state.counters["p99_ns"] = static_cast<double>(samples[samples.size() * 99 / 100]);
+    }
+    state.counters["resident_MB"] = static_cast<double>(data.table.memory_usage_estimate()) / (1024 * 1024);
+    state.counters["cold_keys"] = static_cast<double>(data.table.cold_count());
+}
+BENCHMARK(BM_TieredGet)
+    ->ArgNames({"tiered", "skewed"})
+    ->Args({0, 0})
+    ->Args({1, 0})
+    ->Args({0, 1})
+    ->Args({1, 1});
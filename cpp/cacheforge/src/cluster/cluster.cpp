@@ -0,0 +1,277 @@
+#include "cluster/cluster.h"
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+
+namespace cacheforge {
+
+namespace {
+
+// CRC16-CCITT (XMODEM): polynomial 0x1021, initial value 0, as Redis
+// Cluster uses, so clients' slot computations agree with ours
+constexpr std::array<uint16_t, 256> make_crc16_table() {
+    std::array<uint16_t, 256> table{};
+    for (uint16_t i = 0; i < 256; ++i) {
+        uint16_t crc = static_cast<uint16_t>(i << 8);
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = static_cast<uint16_t>((crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1);
+        }
+        table[i] = crc;
+    }
+    return table;
+}
+
+constexpr auto kCrc16Table = make_crc16_table();
+
+uint16_t crc16(std::string_view data) {
+    uint16_t crc = 0;
+    for (unsigned char c : data) {
+        crc = static_cast<uint16_t>((crc << 8) ^ kCrc16Table[((crc >> 8) ^ c) & 0xff]);
+    }
+    return crc;
+}
+
+uint16_t parse_slot(const std::string& text) {
+    size_t used = 0;
+    unsigned long slot = 0;
+    try {
+        slot = std::stoul(text, &used);
+    } catch (const std::exception&) {
+        used = 0;
+    }
+    if (used != text.size() || text.empty() || slot >= ClusterState::kSlots) {
+        throw std::runtime_error("cluster: bad slot '" + text + "'");
+    }
+    return static_cast<uint16_t>(slot);
+}
+
+// Set in the type byte of a RESTORE payload for a compressed value
+constexpr uint8_t kCompressedBit = 0x80;
+
+int hex_digit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+}  // namespace
+
+uint16_t key_slot(std::string_view key) {
+    auto open = key.find('{');
+    if (open != std::string_view::npos) {
+        auto close = key.find('}', open + 1);
+        if (close != std::string_view::npos && close > open + 1) {
+            key = key.substr(open + 1, close - open - 1);
+        }
+    }
+    return crc16(key) & (ClusterState::kSlots - 1);
+}
+
+std::string dump_value(const Value& value) {
+    static constexpr char kDigits[] = "0123456789abcdef";
+    std::string bytes = value.encode();
+    auto type = static_cast<uint8_t>(value.type());
+    if (value.is_compressed()) type |= kCompressedBit;
+
+    std::string payload;
+    payload.reserve(2 * (bytes.size() + 1));
+    payload += kDigits[type >> 4];
+    payload += kDigits[type & 0xf];
+    for (unsigned char c : bytes) {
+        payload += kDigits[c >> 4];
+        payload += kDigits[c & 0xf];
+    }
+    return payload;
+}
+
+Value restore_value(const std::string& payload) {
+    if (payload.size() < 2 || payload.size() % 2 != 0) {
+        throw std::runtime_error("DUMP payload version or checksum are wrong");
+    }
+    std::string bytes(payload.size() / 2, '\0');
+    for (size_t i = 0; i < bytes.size(); ++i) {
+        int hi = hex_digit(payload[2 * i]);
+        int lo = hex_digit(payload[2 * i + 1]);
+        if (hi < 0 || lo < 0) throw std::runtime_error("DUMP payload version or checksum are wrong");
+        bytes[i] = static_cast<char>(hi << 4 | lo);
+    }
+    auto type = static_cast<uint8_t>(bytes[0]);
+    bool compressed = (type & kCompressedBit) != 0;
+    type &= ~kCompressedBit;
+    if (type > static_cast<uint8_t>(Value::Type::Bloom)) {
+        throw std::runtime_error("Bad data format");
+    }
+    Value value = Value::decode(static_cast<Value::Type>(type), bytes.substr(1), compressed);
+    // The payload comes from a client: a corrupt block must fail here,
+    // not on every later read of the key
+    if (value.is_compressed()) {
+        try {
+            value.decompressed();
+        } catch (const std::runtime_error&) {
+            throw std::runtime_error("Bad data format");
+        }
+    }
+    return value;
+}
+
+ClusterState::ClusterState(const std::string& topology, const std::string& self) : self_(self) {
+    owner_.fill(kNone);
+    migrating_.fill(kNone);
+    importing_.fill(kNone);
+
+    // Nodes separated by spaces or semicolons, each node=range[,range...]
+    std::string spec = topology;
+    for (auto& c : spec) {
+        if (c == ';') c = ' ';
+    }
+    std::istringstream in(spec);
+    std::string item;
+    while (in >> item) {
+        auto eq = item.find('=');
+        std::string node = item.substr(0, eq);
+        if (node.empty() || node.find(':') == std::string::npos) {
+            throw std::runtime_error("cluster: bad node '" + item + "', expected host:port=ranges");
+        }
+        if (node_index(node) != kNone) throw std::runtime_error("cluster: node " + node + " listed twice");
+        auto index = static_cast<int16_t>(nodes_.size());
+        nodes_.push_back(node);
+        if (eq == std::string::npos) continue;  // a node that owns nothing yet
+
+        std::istringstream ranges(item.substr(eq + 1));
+        std::string range;
+        while (std::getline(ranges, range, ',')) {
+            auto dash = range.find('-');
+            uint16_t first = parse_slot(range.substr(0, dash));
+            uint16_t last = dash == std::string::npos ? first : parse_slot(range.substr(dash + 1));
+            if (last < first) throw std::runtime_error("cluster: empty range " + range);
+            for (size_t slot = first; slot <= last; ++slot) {
+                if (owner_[slot] != kNone) {
+                    throw std::runtime_error("cluster: slot " + std::to_string(slot) + " owned twice");
+                }
+                owner_[slot] = index;
+            }
+        }
+    }
+    self_index_ = node_index(self_);
+    if (self_index_ == kNone) throw std::runtime_error("cluster: " + self_ + " is not in the topology");
+}
+
+int16_t ClusterState::node_index(const std::string& node) const {
+    for (size_t i = 0; i < nodes_.size(); ++i) {
+        if (nodes_[i] == node) return static_cast<int16_t>(i);
+    }
+    return kNone;
+}
+
+std::optional<std::string> ClusterState::route(
+    const std::vector<std::string>& keys, bool asking,
+    const std::function<bool(const std::string&)>& exists) const {
+    if (keys.empty()) return std::nullopt;
+    uint16_t slot = key_slot(keys[0]);
+    for (size_t i = 1; i < keys.size(); ++i) {
+        if (key_slot(keys[i]) != slot) {
+            return std::string("-CROSSSLOT Keys in request don't hash to the same slot\r\n");
+        }
+    }
+
+    std::shared_lock lock(mutex_);
+    int16_t owner = owner_[slot];
+    if (owner == kNone) return std::string("-CLUSTERDOWN Hash slot not served\r\n");
+    auto redirect = [&](const char* kind, int16_t node) {
+        return "-" + std::string(kind) + " " + std::to_string(slot) + " " + nodes_[node] + "\r\n";
+    };
+
+    if (owner != self_index_) {
+        if (asking && importing_[slot] != kNone) return std::nullopt;
+        return redirect("MOVED", owner);
+    }
+    if (migrating_[slot] == kNone) return std::nullopt;
+    // Migrating out: keys still here are served here, keys already moved
+    // (or never created) belong to the target
+    size_t missing = 0;
+    for (const auto& key : keys) {
+        if (!exists(key)) ++missing;
+    }
+    if (missing == 0) return std::nullopt;
+    if (missing == keys.size()) return redirect("ASK", migrating_[slot]);
+    return std::string("-TRYAGAIN Multiple keys request during rehashing of slot\r\n");
+}
+
+void ClusterState::set_migrating(uint16_t slot, const std::string& node) {
+    int16_t index = node_index(node);
+    if (index == kNone) throw std::runtime_error("unknown node " + node);
+    std::unique_lock drained(commands_);
+    std::unique_lock lock(mutex_);
+    if (owner_[slot] != self_index_) throw std::runtime_error("I'm not the owner of hash slot " + std::to_string(slot));
+    migrating_[slot] = index;
+}
+
+void ClusterState::set_importing(uint16_t slot, const std::string& node) {
+    int16_t index = node_index(node);
+    if (index == kNone) throw std::runtime_error("unknown node " + node);
+    std::unique_lock lock(mutex_);
+    if (owner_[slot] == self_index_) throw std::runtime_error("I'm already the owner of hash slot " + std::to_string(slot));
+    importing_[slot] = index;
+}
+
+void ClusterState::set_owner(uint16_t slot, const std::string& node) {
+    int16_t index = node_index(node);
+    if (index == kNone) throw std::runtime_error("unknown node " + node);
+    std::unique_lock lock(mutex_);
+    owner_[slot] = index;
+    migrating_[slot] = kNone;
+    importing_[slot] = kNone;
+}
+
+void ClusterState::set_stable(uint16_t slot) {
+    std::unique_lock lock(mutex_);
+    migrating_[slot] = kNone;
+    importing_[slot] = kNone;
+}
+
+std::optional<std::string> ClusterState::owner(uint16_t slot) const {
+    std::shared_lock lock(mutex_);
+    if (owner_[slot] == kNone) return std::nullopt;
+    return nodes_[owner_[slot]];
+}
+
+std::optional<std::string> ClusterState::migrating_to(uint16_t slot) const {
+    std::shared_lock lock(mutex_);
+    if (migrating_[slot] == kNone) return std::nullopt;
+    return nodes_[migrating_[slot]];
+}
+
+bool ClusterState::owns(uint16_t slot) const {
+    std::shared_lock lock(mutex_);
+    return owner_[slot] == self_index_;
+}
+
+size_t ClusterState::owned_slots() const {
+    std::shared_lock lock(mutex_);
+    size_t count = 0;
+    for (int16_t owner : owner_) {
+        if (owner == self_index_) ++count;
+    }
+    return count;
+}
+
+std::vector<ClusterState::SlotRange> ClusterState::ranges() const {
+    std::shared_lock lock(mutex_);
+    std::vector<SlotRange> result;
+    for (size_t slot = 0; slot < kSlots;) {
+        size_t end = slot;
+        while (end + 1 < kSlots && owner_[end + 1] == owner_[slot]) ++end;
+        if (owner_[slot] != kNone) {
+            result.push_back({static_cast<uint16_t>(slot), static_cast<uint16_t>(end), nodes_[owner_[slot]]});
+        }
+        slot = end + 1;
+    }
+    return result;
+}
+
+std::vector<std::string> ClusterState::nodes() const {
+    return nodes_;
+}
+
+}  // namespace cacheforge
@@ -0,0 +1,100 @@
+#pragma once
+#ifndef CACHEFORGE_CLUSTER_H
+#define CACHEFORGE_CLUSTER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <optional>
+#include <functional>
+#include <shared_mutex>
+#include <cstdint>
+#include <cstddef>
+#include "data/value.h"
+
+namespace cacheforge {
+
+// Hash slot of a key, as in Redis Cluster: CRC16 (XMODEM) of the key
+// modulo 16384. If the key contains a non-empty {tag}, only the tag is
+// hashed, so keys sharing a tag share a slot.
+uint16_t key_slot(std::string_view key);
+
+// Payload of RESTORE, which carries a value between nodes: the type with
+// the compressed flag, then Value::encode(), hex-encoded because requests
+// are whitespace-separated text. A compressed value travels compressed.
+std::string dump_value(const Value& value);
+// Throws std::runtime_error on a malformed payload, including a compressed
+// value that does not decompress
+Value restore_value(const std::string& payload);
+
+// Slot ownership for one node of a statically configured cluster. The
+// topology lists every node with the slot ranges it owns at startup, e.g.
+// "127.0.0.1:7000=0-8191 127.0.0.1:7001=8192-16383"; there is no gossip,
+// so changes made here by slot migration are only known to the two nodes
+// involved. Other nodes keep redirecting to the old owner, which redirects
+// again. Nodes are named by their host:port address.
+class ClusterState {
+public:
+    static constexpr size_t kSlots = 16384;
+
+    struct SlotRange {
+        uint16_t first;
+        uint16_t last;
+        std::string node;
+    };
+
+    // Throws std::runtime_error on a malformed topology, a slot owned
+    // twice, or `self` missing from it. Slots owned by no node are
+    // reported as CLUSTERDOWN.
+    ClusterState(const std::string& topology, const std::string& self);
+
+    const std::string& self() const { return self_; }
+
+    // Checks that a command on `keys` may run here. Returns nullopt if it
+    // may, else the error reply: CROSSSLOT when the keys span slots, MOVED
+    // to the slot's owner, ASK to a migration target for keys this node no
+    // longer has (`exists` says which it has), or CLUSTERDOWN. `asking` is
+    // set for the command right after ASKING, which an importing node
+    // accepts for a slot it does not own yet.
+    std::optional<std::string> route(const std::vector<std::string>& keys, bool asking,
+                                     const std::function<bool(const std::string&)>& exists) const;
+
+    // Held shared by a command on keys from routing until it finishes.
+    // set_migrating() waits for every holder, so once it returns no command
+    // routed before the migration began is still running.
+    std::shared_lock<std::shared_mutex> pin_command() const { return std::shared_lock(commands_); }
+
+    // CLUSTER SETSLOT. Node names must appear in the topology; these throw
+    // std::runtime_error otherwise.
+    void set_migrating(uint16_t slot, const std::string& node);
+    void set_importing(uint16_t slot, const std::string& node);
+    void set_owner(uint16_t slot, const std::string& node);
+    void set_stable(uint16_t slot);
+
+    std::optional<std::string> owner(uint16_t slot) const;
+    std::optional<std::string> migrating_to(uint16_t slot) const;
+    bool owns(uint16_t slot) const;
+    size_t owned_slots() const;
+    // Contiguous runs of slots with the same owner, in slot order
+    std::vector<SlotRange> ranges() const;
+    std::vector<std::string> nodes() const;
+
+private:
+    static constexpr int16_t kNone = -1;
+
+    std::string self_;
+    int16_t self_index_ = kNone;
+    std::vector<std::string> nodes_;
+    mutable std::shared_mutex mutex_;
+    mutable std::shared_mutex commands_;  // see pin_command()
+    std::array<int16_t, kSlots> owner_;
+    std::array<int16_t, kSlots> migrating_;  // target while this node migrates the slot out
+    std::array<int16_t, kSlots> importing_;  // source while this node imports the slot
+
+    int16_t node_index(const std::string& node) const;
+};
+
+}  // namespace cacheforge
+
+#endif  // CACHEFORGE_CLUSTER_H
@@ -0,0 +1,237 @@
+#include "cluster/migrator.h"
+#include "protocol/parser.h"
+#include <boost/asio.hpp>
+#include <spdlog/spdlog.h>
+#include <poll.h>
+#include <cerrno>
+#include <algorithm>
+#include <chrono>
+#include <optional>
+#include <stdexcept>
+
+namespace cacheforge {
+
+namespace {
+
+using Deadline = std::chrono::steady_clock::time_point;
+
+// Request/reply connection to the target node. Every exchange has a
+// deadline, past which it throws: a target that stops answering must not
+// stall the migration, let alone the shards it may be holding.
+class NodeLink {
+public:
+    NodeLink(const std::string& node, std::chrono::milliseconds timeout) : socket_(io_), timeout_(timeout) {
+        auto colon = node.rfind(':');
+        if (colon == std::string::npos) throw std::runtime_error("bad node address " + node);
+        boost::asio::ip::tcp::resolver resolver(io_);
+        boost::asio::connect(socket_, resolver.resolve(node.substr(0, colon), node.substr(colon + 1)));
+        socket_.set_option(boost::asio::ip::tcp::no_delay(true));
+        socket_.non_blocking(true);
+    }
+
+    Deadline deadline() const { return std::chrono::steady_clock::now() + timeout_; }
+
+    void send(const std::string& data, Deadline deadline) {
+        size_t sent = 0;
+        while (sent < data.size()) {
+            boost::system::error_code ec;
+            sent += socket_.write_some(boost::asio::buffer(data.data() + sent, data.size() - sent), ec);
+            if (ec == boost::asio::error::would_block) {
+                wait(POLLOUT, deadline);
+            } else if (ec) {
+                throw boost::system::system_error(ec);
+            }
+        }
+    }
+
+    // Waits until one complete reply is buffered and returns it
+    std::string read_reply(Deadline deadline) {
+        for (;;) {
+            size_t n = Parser::reply_length(buffer_.data(), buffer_.size());
+            if (n > 0) {
+                std::string reply = buffer_.substr(0, n);
+                buffer_.erase(0, n);
+                return reply;
+            }
+            char chunk[16384];
+            boost::system::error_code ec;
+            size_t got = socket_.read_some(boost::asio::buffer(chunk), ec);
+            if (ec == boost::asio::error::would_block) {
+                wait(POLLIN, deadline);
+            } else if (ec) {
+                throw boost::system::system_error(ec);
+            }
+            buffer_.append(chunk, got);
+        }
+    }
+
+    // Sends one command and throws if the reply is an error
+    void call(const Command& cmd) {
+        auto until = deadline();
+        send(Parser::serialize_command(cmd), until);
+        std::string reply = read_reply(until);
+        if (!reply.empty() && reply[0] == '-') {
+            throw std::runtime_error(cmd.name + " failed on target: " + reply.substr(1, reply.size() - 3));
+        }
+    }
+
+private:
+    boost::asio::io_context io_;
+    boost::asio::ip::tcp::socket socket_;
+    std::chrono::milliseconds timeout_;
+    std::string buffer_;
+
+    void wait(short events, Deadline deadline) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        pollfd pfd{socket_.native_handle(), events, 0};
+        int ready = left.count() > 0 ? ::poll(&pfd, 1, static_cast<int>(left.count())) : 0;
+        if (ready == 0) throw std::runtime_error("target did not answer within " + std::to_string(timeout_.count()) + "ms");
+        if (ready < 0 && errno != EINTR) throw std::runtime_error("poll failed on the link to the target");
+    }
+};
+
+// Copies `keys` to the target in one pipeline and drops each copied key
+// that was not written meanwhile; returns how many were dropped. With
+// `hold_shards` the keys' shards stay locked for the round trip, so none
+// can change in flight; that is the fallback for keys written too often
+// to ever get through otherwise. The round trip has one deadline, so the
+// shards are never held for longer than the link's timeout.
+size_t ship(HashTable& table, NodeLink& link, const std::vector<std::string>& keys, bool hold_shards) {
+    std::optional<HashTable::ShardLockSet> held;
+    if (hold_shards) held.emplace(table.lock_shards(keys));
+
+    std::vector<std::pair<const std::string*, uint64_t>> sent;
+    std::string batch;
+    size_t moved = 0;
+    auto now = Clock::now();
+    for (const auto& key : keys) {
+        uint64_t version = table.version(key);
+        auto value = table.get_raw(key);
+        if (!value) continue;
+        int64_t ttl_ms = 0;
+        if (auto deadline = table.expiry(key)) {
+            ttl_ms = std::chrono::duration_cast<std::chrono::milliseconds>(*deadline - now).count();
+            // Already due: nothing to copy
+            if (ttl_ms <= 0) {
+                if (table.remove_if_version(key, version)) ++moved;
+                continue;
+            }
+        }
+        batch += "ASKING\r\n";
+        batch += Parser::serialize_command(
+            {"RESTORE", {key, std::to_string(ttl_ms), dump_value(*value), "REPLACE"}});
+        sent.emplace_back(&key, version);
+    }
+    if (sent.empty()) return moved;
+
+    auto deadline = link.deadline();
+    link.send(batch, deadline);
+    for (const auto& [key, version] : sent) {
+        link.read_reply(deadline);  // ASKING
+        std::string reply = link.read_reply(deadline);
+        if (reply[0] == '-') {
+            throw std::runtime_error("RESTORE of " + *key + " failed on target: " +
+                                     reply.substr(1, reply.size() - 3));
+        }
+    }
+    for (const auto& [key, version] : sent) {
+        if (table.remove_if_version(*key, version)) ++moved;
+    }
+    return moved;
+}
+
+}  // namespace
+
+SlotMigrator::SlotMigrator(HashTable& table, ClusterState& cluster, size_t batch_keys,
+                           std::chrono::milliseconds reply_timeout)
+    : table_(table), cluster_(cluster), batch_keys_(batch_keys), reply_timeout_(reply_timeout) {}
+
+SlotMigrator::~SlotMigrator() {
+    stop();
+}
+
+void SlotMigrator::start(uint16_t slot, const std::string& target) {
+    std::lock_guard lock(mutex_);
+    if (status_.running) {
+        throw std::runtime_error("slot " + std::to_string(status_.slot) + " is already migrating");
+    }
+    if (!cluster_.owns(slot)) throw std::runtime_error("I'm not the owner of hash slot " + std::to_string(slot));
+    if (target == cluster_.self()) throw std::runtime_error("can't migrate a slot to myself");
+    auto nodes = cluster_.nodes();
+    if (std::find(nodes.begin(), nodes.end(), target) == nodes.end()) {
+        throw std::runtime_error("unknown node " + target);
+    }
+    if (thread_.joinable()) thread_.join();  // the previous, finished migration
+
+    status_ = Status{true, slot, target, 0, {}};
+    stopping_.store(false);
+    thread_ = std::thread([this, slot, target]() { run(slot, target); });
+}
+
+void SlotMigrator::stop() {
+    stopping_.store(true);
+    if (thread_.joinable()) thread_.join();
+}
+
+SlotMigrator::Status SlotMigrator::status() const {
+    std::lock_guard lock(mutex_);
+    return status_;
+}
+
+void SlotMigrator::run(uint16_t slot, std::string target) {
+    std::vector<std::string> keys;
+    auto ship_keys = [&](NodeLink& link) {
+        size_t moved = ship(table_, link, keys, false);
+        if (moved == 0) moved = ship(table_, link, keys, true);
+        keys.clear();
+        std::lock_guard lock(mutex_);
+        status_.keys_moved += moved;
+    };
+    // Each pass walks the table once with a cursor per shard, shipping the
+    // slot's keys a batch at a time as they turn up; keys written in flight
+    // stay behind for the next pass
+    auto drain = [&](NodeLink& link) {
+        for (;;) {
+            bool found = false;
+            for (size_t shard = 0; shard < HashTable::kShardCount; ++shard) {
+                size_t cursor = 0;
+                do {
+                    if (stopping_.load()) throw std::runtime_error("migration interrupted");
+                    cursor = table_.scan_shard(shard, cursor, batch_keys_,
+                                               [&](const std::string& key, const Value&, std::optional<TimePoint>) {
+                        if (key_slot(key) == slot) keys.push_back(key);
+                    });
+                    if (keys.empty()) continue;
+                    found = true;
+                    // A key can turn up twice in one pass
+                    std::sort(keys.begin(), keys.end());
+                    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+                    if (keys.size() >= batch_keys_) ship_keys(link);
+                } while (cursor != 0);
+            }
+            if (!keys.empty()) ship_keys(link);
+            if (!found) return;
+        }
+    };
+
+    spdlog::info("Migrating slot {} to {}", slot, target);
+    try {
+        NodeLink link(target, reply_timeout_);
+        link.call({"CLUSTER", {"SETSLOT", std::to_string(slot), "IMPORTING", cluster_.self()}});
+        cluster_.set_migrating(slot, target);
+        drain(link);
+        link.call({"CLUSTER", {"SETSLOT", std::to_string(slot), "NODE", target}});
+        cluster_.set_owner(slot, target);
+    } catch (const std::exception& e) {
+        spdlog::error("Migration of slot {} to {} stopped: {}", slot, target, e.what());
+        std::lock_guard lock(mutex_);
+        status_.error = e.what();
+        status_.running = false;
+        return;
+    }
+    std::lock_guard lock(mutex_);
+    spdlog::info("Slot {} migrated to {} ({} keys)", slot, target, status_.keys_moved);
+    status_.running = false;
+}
+
+}  // namespace cacheforge
@@ -0,0 +1,82 @@
+#pragma once
+#ifndef CACHEFORGE_MIGRATOR_H
+#define CACHEFORGE_MIGRATOR_H
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include "cluster/cluster.h"
+#include "storage/hashtable.h"
+
+namespace cacheforge {
+
+// Moves one hash slot at a time to another node on a background thread,
+// so the source keeps serving the slot while its keys stream out:
+//
+//   1. the target is told CLUSTER SETSLOT <slot> IMPORTING <self> and the
+//      slot is marked migrating here; from then on, commands on keys this
+//      node no longer has are sent to the target with -ASK
+//   2. each pass walks the table once (HashTable::scan_shard) and copies
+//      the slot's keys in pipelined batches of RESTORE, each preceded by
+//      ASKING; a copied key is dropped here only if it was not written
+//      while in flight (HashTable::remove_if_version), and one that was is
+//      sent again in the next pass
+//   3. once a pass finds the slot empty, both nodes record the target as
+//      owner and later commands get -MOVED
+//
+// Commands on keys of a migrating slot hold their keys' shards until they
+// finish (see CommandHandler::execute), so a key is never dropped between
+// a command finding it here and writing it, and a pass that finds the slot
+// empty has seen every such write. Other nodes learn of the new owner only
+// through the redirections; there is no gossip.
+class SlotMigrator {
+public:
+    struct Status {
+        bool running = false;
+        int slot = -1;  // the slot being (or last) migrated
+        std::string target;
+        size_t keys_moved = 0;
+        std::string error;  // why the last migration stopped, empty if it did not fail
+    };
+
+    // How long the target may take to answer one batch before the
+    // migration is abandoned with an error
+    static constexpr std::chrono::milliseconds kDefaultReplyTimeout{5000};
+
+    SlotMigrator(HashTable& table, ClusterState& cluster, size_t batch_keys = 128,
+                 std::chrono::milliseconds reply_timeout = kDefaultReplyTimeout);
+    ~SlotMigrator();
+
+    SlotMigrator(const SlotMigrator&) = delete;
+    SlotMigrator& operator=(const SlotMigrator&) = delete;
+
+    // Starts moving `slot` to `target` (host:port). Throws
+    // std::runtime_error if a migration is already running, the slot is
+    // not owned here, or the target is unknown.
+    void start(uint16_t slot, const std::string& target);
+    // Interrupts a running migration after its current batch and waits for
+    // it; the slot stays marked migrating
+    void stop();
+    Status status() const;
+
+private:
+    HashTable& table_;
+    ClusterState& cluster_;
+    size_t batch_keys_;
+    std::chrono::milliseconds reply_timeout_;
+    std::thread thread_;
+    std::atomic<bool> stopping_{false};
+    mutable std::mutex mutex_;
+    Status status_;
+
+    void run(uint16_t slot, std::string target);
+};
+
+}  // namespace cacheforge
+
+#endif  // CACHEFORGE_MIGRATOR_H
@@ -58,6 +58,38 @@ Config Config::from_env() {
         cfg.snapshot_dir = snap;
     }
 
+    if (const char* tiered = std::getenv("CACHEFORGE_TIERED_DIR")) {
+        cfg.tiered_storage_dir = tiered;
+    }
+
+    if (const char* workers = std::getenv("CACHEFORGE_WORKER_THREADS")) {
+        try {
+            cfg.worker_threads = std::stoul(workers);
+        } catch (const std::exception&) {
+            // keep the default
+        }
+    }
+
+    if (const char* cpus = std::getenv("CACHEFORGE_WORKER_CPUS")) {
+        cfg.worker_cpus = cpus;
+    }
+
+    if (const char* topology = std::getenv("CACHEFORGE_CLUSTER_TOPOLOGY")) {
+        cfg.cluster_topology = topology;
+    }
+
+    if (const char* self = std::getenv("CACHEFORGE_CLUSTER_SELF")) {
+        cfg.cluster_self = self;
+    }
+
+    if (const char* events = std::getenv("CACHEFORGE_NOTIFY_KEYSPACE_EVENTS")) {
+        cfg.notify_keyspace_events = events;
+    }
+
+    if (const char* defrag = std::getenv("CACHEFORGE_ACTIVE_DEFRAG")) {
+        cfg.active_defrag = std::string(defrag) == "1" || std::string(defrag) == "yes";
+    }
+
     return cfg;
 }
 
@@ -15,15 +15,89 @@ struct Config {
     uint16_t port = 6380;
     size_t max_memory_bytes = 256 * 1024 * 1024;  // 256MB
     size_t max_connections = 1024;
+    // Output buffer limits per client, see ClientLimits; 0 disables each
+    size_t client_output_buffer_hard_limit = 256 * 1024 * 1024;
+    size_t client_output_buffer_soft_limit = 64 * 1024 * 1024;
+    std::chrono::seconds client_output_buffer_soft_seconds{60};
+    size_t client_output_pause_bytes = 1024 * 1024;  // stop running commands above this
+    std::chrono::seconds client_idle_timeout{0};  // 0 = never close idle clients
+    // Unprocessed input held per client, BULKLOAD payloads included; a
+    // client over it is disconnected. 0 disables the limit
+    size_t client_query_buffer_limit = 1024 * 1024 * 1024;
+    // Strings and binaries at least this large are stored LZ4-compressed
+    // when that saves space; 0 disables compression
+    size_t value_compression_min_bytes = 0;
+    // Seed of the key hash; 0 picks a random one per process. A fixed seed
+    // makes key placement reproducible across runs, at the cost of letting
+    // clients who learn it craft colliding keys. The seed is process-wide:
+    // main() applies it before the server exists, and a Server refuses a
+    // seed other than the one the process already uses
+    uint64_t hash_seed = 0;
     int eviction_policy = 0;  // 0=LRU, 1=LFU, 2=random
     std::chrono::seconds default_ttl{0};  // 0 = no expiry
     std::string log_level = "info";
     std::string snapshot_dir = "/tmp/cacheforge";
+    // Tiered storage: when set, values beyond max_memory_bytes are demoted
+    // to a memory-mapped log in this directory instead of staying resident
+    std::string tiered_storage_dir;
+    size_t tiered_segment_bytes = 64 * 1024 * 1024;
+    uint32_t tiered_promote_after = 2;  // cold reads before a value returns to memory
+    double tiered_compact_dead_ratio = 0.5;
+    // Cluster mode: the static slot map, "host:port=first-last[,...]" per
+    // node separated by spaces, and this node's own host:port in it
+    // (default 127.0.0.1:<port>). An empty topology runs a standalone
+    // server that owns every key.
+    std::string cluster_topology;
+    std::string cluster_self;
     int snapshot_interval_secs = 300;
+    // Threads and where they run. 0 network workers means one per CPU the
+    // process may use, capped by its cgroup CPU quota (one per listed CPU
+    // when worker_cpus is set). CPU lists use the cpuset syntax, e.g.
+    // "0-3,8"; empty leaves a thread unpinned. Each network worker gets one
+    // CPU of worker_cpus, round-robin; the expiry thread and the snapshot
+    // loader threads may use any CPU of their list.
+    size_t worker_threads = 0;
+    std::string worker_cpus;
+    std::string expiry_cpus;
+    std::string persistence_cpus;
+    // Warm restart: load the latest snapshot from snapshot_dir on start,
+    // with this many threads (0 = one per usable CPU). Connections are
+    // accepted only once the load is done, unless serve_reads_while_loading
+    // is set; then reads of keys already loaded are served and other
+    // commands on keys get -LOADING until it finishes.
+    bool load_snapshot_on_start = false;
+    size_t snapshot_load_threads = 0;
+    bool serve_reads_while_loading = false;
     std::string replication_host;
     uint16_t replication_port = 0;
     std::string database_url;
     std::string redis_url;
+    size_t tracking_table_max_keys = 1000000;  // CLIENT TRACKING key budget
+    bool hotkeys_enabled = true;
+    uint32_t hotkeys_sample_rate = 16;  // 1 in N accesses reaches the sketch
+    size_t hotkeys_top_k = 16;
+    std::chrono::seconds hotkeys_decay_interval{60};  // 0 = never decay
+    uint32_t stats_latency_sample_rate = 8;  // 1 in N commands feeds the histograms
+    // Every command is timed while the slow log or the latency monitor is
+    // on, whatever the sample rate
+    int64_t slowlog_log_slower_than_us = 10000;  // negative disables
+    uint64_t latency_monitor_threshold_us = 0;  // 0 disables
+    // Keyspace notifications, as Redis' notify-keyspace-events letters:
+    // K/E pick the __keyspace@0__/__keyevent@0__ channels and g$hzxb (A
+    // for all) the event classes; empty disables them. Each thread that
+    // raises events buffers up to keyspace_events_buffer of them for the
+    // publisher; when it lags further behind, events are dropped
+    std::string notify_keyspace_events;
+    size_t keyspace_events_buffer = 4096;
+    // Active defragmentation: when RSS passes start_ratio times the dataset
+    // and exceeds it by ignore_bytes, a background thread moves values off
+    // sparse allocator pages, using at most cpu_percent of one CPU, until
+    // the ratio is down to stop_ratio
+    bool active_defrag = false;
+    double active_defrag_start_ratio = 1.3;
+    double active_defrag_stop_ratio = 1.1;
+    size_t active_defrag_ignore_bytes = 64 * 1024 * 1024;
+    uint32_t active_defrag_cpu_percent = 10;
 
     
     // NOTE: CACHEFORGE_PORT env var is parsed without error handling
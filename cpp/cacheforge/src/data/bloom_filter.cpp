@@ -0,0 +1,166 @@
+#include "data/bloom_filter.h"
+#include "utils/hash.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numbers>
+#include <stdexcept>
+
+namespace cacheforge {
+
+namespace {
+
+// Fixed seeds: filters are persisted and must answer the same in every
+// process
+constexpr uint64_t kSeed1 = 0x2545f4914f6cdd1dull;
+constexpr uint64_t kSeed2 = 0x9e3779b97f4a7c15ull;
+
+// Positions h1 + i * h2 (Kirsch and Mitzenmacher), mapped onto the layer
+// with a multiply instead of a modulo
+uint64_t bit_position(uint64_t h1, uint64_t h2, uint32_t i, uint64_t nbits) {
+    uint64_t h = h1 + i * h2;
+    return static_cast<uint64_t>((static_cast<__uint128_t>(h) * nbits) >> 64);
+}
+
+[[noreturn]] void malformed() {
+    throw std::runtime_error("Malformed Bloom filter encoding");
+}
+
+template <typename T>
+void put_scalar(std::string& out, T v) {
+    out.append(reinterpret_cast<const char*>(&v), sizeof(v));
+}
+
+template <typename T>
+T get_scalar(const std::string& bytes, size_t& offset) {
+    if (sizeof(T) > bytes.size() - offset) malformed();
+    T v;
+    std::memcpy(&v, bytes.data() + offset, sizeof(T));
+    offset += sizeof(T);
+    return v;
+}
+
+}  // namespace
+
+BloomFilter::BloomFilter(double error_rate, uint64_t capacity) : error_rate_(error_rate) {
+    if (!(error_rate > 0.0 && error_rate < 1.0)) {
+        throw std::runtime_error("error rate must be between 0 and 1, exclusive");
+    }
+    if (capacity == 0) throw std::runtime_error("capacity must be positive");
+    layers_.push_back(make_layer(capacity, error_rate / 2));
+}
+
+BloomFilter::Layer BloomFilter::make_layer(uint64_t capacity, double error_rate) {
+    // Optimal sizing for n items at rate p: m = -n ln p / (ln 2)^2 bits and
+    // k = log2(1/p) hash functions
+    double bits = std::ceil(-static_cast<double>(capacity) * std::log(error_rate) /
+                            (std::numbers::ln2 * std::numbers::ln2));
+    if (bits > static_cast<double>(kMaxLayerBits)) {
+        throw std::runtime_error("Bloom filter layer would exceed " + std::to_string(kMaxLayerBits) + " bits");
+    }
+    Layer layer;
+    layer.capacity = capacity;
+    layer.hashes = static_cast<uint32_t>(std::max(1.0, std::ceil(-std::log2(error_rate))));
+    layer.bits.assign((static_cast<uint64_t>(bits) + 63) / 64, 0);
+    return layer;
+}
+
+bool BloomFilter::add(std::string_view item) {
+    if (contains(item)) return false;
+    if (layers_.back().count >= layers_.back().capacity) {
+        const auto& last = layers_.back();
+        double rate = error_rate_ / std::pow(2.0, static_cast<double>(layers_.size() + 1));
+        layers_.push_back(make_layer(last.capacity * 2, rate));
+    }
+    auto& layer = layers_.back();
+    uint64_t h1 = hashing::hash_bytes(item.data(), item.size(), kSeed1);
+    uint64_t h2 = hashing::hash_bytes(item.data(), item.size(), kSeed2);
+    uint64_t nbits = layer.bits.size() * 64;
+    for (uint32_t i = 0; i < layer.hashes; ++i) {
+        uint64_t pos = bit_position(h1, h2, i, nbits);
+        layer.bits[pos / 64] |= uint64_t{1} << (pos % 64);
+    }
+    ++layer.count;
+    return true;
+}
+
+bool BloomFilter::contains(std::string_view item) const {
+    uint64_t h1 = hashing::hash_bytes(item.data(), item.size(), kSeed1);
+    uint64_t h2 = hashing::hash_bytes(item.data(), item.size(), kSeed2);
+    // Newest first: that layer is the largest and takes recent items
+    for (auto layer = layers_.rbegin(); layer != layers_.rend(); ++layer) {
+        uint64_t nbits = layer->bits.size() * 64;
+        bool all = true;
+        for (uint32_t i = 0; i < layer->hashes && all; ++i) {
+            uint64_t pos = bit_position(h1, h2, i, nbits);
+            all = (layer->bits[pos / 64] >> (pos % 64)) & 1;
+        }
+        if (all) return true;
+    }
+    return false;
+}
+
+uint64_t BloomFilter::capacity() const {
+    uint64_t total = 0;
+    for (const auto& layer : layers_) total += layer.capacity;
+    return total;
+}
+
+uint64_t BloomFilter::size() const {
+    uint64_t total = 0;
+    for (const auto& layer : layers_) total += layer.count;
+    return total;
+}
+
+size_t BloomFilter::memory_size() const {
+    size_t total = layers_.capacity() * sizeof(Layer);
+    for (const auto& layer : layers_) total += layer.bits.capacity() * sizeof(uint64_t);
+    return total;
+}
+
+// [double error rate][uint32 layers] then per layer:
+// [uint64 capacity][uint64 count][uint32 hashes][uint64 words][uint64 word]...
+std::string BloomFilter::encode() const {
+    std::string out;
+    put_scalar<double>(out, error_rate_);
+    put_scalar<uint32_t>(out, static_cast<uint32_t>(layers_.size()));
+    for (const auto& layer : layers_) {
+        put_scalar<uint64_t>(out, layer.capacity);
+        put_scalar<uint64_t>(out, layer.count);
+        put_scalar<uint32_t>(out, layer.hashes);
+        put_scalar<uint64_t>(out, layer.bits.size());
+        out.append(reinterpret_cast<const char*>(layer.bits.data()), layer.bits.size() * sizeof(uint64_t));
+    }
+    return out;
+}
+
+BloomFilter BloomFilter::decode(const std::string& bytes) {
+    BloomFilter filter{Empty{}};
+    size_t offset = 0;
+    filter.error_rate_ = get_scalar<double>(bytes, offset);
+    auto count = get_scalar<uint32_t>(bytes, offset);
+    if (!(filter.error_rate_ > 0.0 && filter.error_rate_ < 1.0) || count == 0 || count > 64) malformed();
+    for (uint32_t i = 0; i < count; ++i) {
+        Layer layer;
+        layer.capacity = get_scalar<uint64_t>(bytes, offset);
+        layer.count = get_scalar<uint64_t>(bytes, offset);
+        layer.hashes = get_scalar<uint32_t>(bytes, offset);
+        auto words = get_scalar<uint64_t>(bytes, offset);
+        if (layer.capacity == 0 || layer.count > layer.capacity || layer.hashes == 0 || layer.hashes > 64 ||
+            words == 0 || words > kMaxLayerBits / 64 || words * sizeof(uint64_t) > bytes.size() - offset) {
+            malformed();
+        }
+        layer.bits.resize(words);
+        std::memcpy(layer.bits.data(), bytes.data() + offset, words * sizeof(uint64_t));
+        offset += words * sizeof(uint64_t);
+        filter.layers_.push_back(std::move(layer));
+    }
+    if (offset != bytes.size()) malformed();
+    return filter;
+}
+
+bool BloomFilter::operator==(const BloomFilter& other) const {
+    return error_rate_ == other.error_rate_ && layers_ == other.layers_;
+}
+
+}  // namespace cacheforge
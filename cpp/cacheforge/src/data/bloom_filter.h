@@ -0,0 +1,69 @@
+#pragma once
+#ifndef CACHEFORGE_BLOOM_FILTER_H
+#define CACHEFORGE_BLOOM_FILTER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace cacheforge {
+
+// Set membership with no false negatives and a bounded false-positive
+// rate (BF.ADD/BF.EXISTS). Scalable (Almeida et al., 2007): when the newest
+// layer has taken its capacity of items, a layer with twice the capacity
+// and half the error rate is added. The first layer gets half the
+// configured rate, so the rates of all layers together stay below it
+// however far the filter grows.
+class BloomFilter {
+public:
+    static constexpr double kDefaultErrorRate = 0.01;
+    static constexpr uint64_t kDefaultCapacity = 100;
+    // Largest layer: 2^32 bits (512 MB)
+    static constexpr uint64_t kMaxLayerBits = uint64_t{1} << 32;
+
+    // Throws std::runtime_error unless 0 < error_rate < 1 and the first
+    // layer fits in kMaxLayerBits
+    explicit BloomFilter(double error_rate = kDefaultErrorRate, uint64_t capacity = kDefaultCapacity);
+
+    // Returns true if the item was added, false if it may already be there
+    // (which is then not counted). Throws std::runtime_error if a new layer
+    // would exceed kMaxLayerBits.
+    bool add(std::string_view item);
+    bool contains(std::string_view item) const;
+
+    double error_rate() const { return error_rate_; }
+    uint64_t capacity() const;
+    uint64_t size() const;  // items added
+    size_t layers() const { return layers_.size(); }
+    size_t memory_size() const;
+
+    // decode() throws std::runtime_error on malformed input
+    std::string encode() const;
+    static BloomFilter decode(const std::string& bytes);
+
+    bool operator==(const BloomFilter& other) const;
+
+private:
+    struct Layer {
+        uint64_t capacity = 0;
+        uint64_t count = 0;
+        uint32_t hashes = 0;
+        std::vector<uint64_t> bits;
+
+        bool operator==(const Layer& other) const = default;
+    };
+
+    double error_rate_;
+    std::vector<Layer> layers_;
+
+    // Empty, for decode() to fill in
+    struct Empty {};
+    explicit BloomFilter(Empty) : error_rate_(0.0) {}
+    static Layer make_layer(uint64_t capacity, double error_rate);
+};
+
+}  // namespace cacheforge
+
+#endif  // CACHEFORGE_BLOOM_FILTER_H
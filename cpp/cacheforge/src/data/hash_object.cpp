@@ -0,0 +1,142 @@
+#include "data/hash_object.h"
+#include <algorithm>
+#include <charconv>
+#include <stdexcept>
+
+namespace cacheforge {
+
+HashObject::HashObject(const HashObject& other)
+    : compact_(other.compact_),
+      table_(other.table_ ? std::make_unique<std::unordered_map<std::string, std::string>>(*other.table_)
+                          : nullptr) {}
+
+HashObject& HashObject::operator=(const HashObject& other) {
+    if (this != &other) {
+        HashObject copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+size_t HashObject::size() const {
+    return table_ ? table_->size() : compact_.size();
+}
+
+bool HashObject::set(const std::string& field, std::string value) {
+    if (!table_) {
+        for (auto& [f, v] : compact_) {
+            if (f == field) {
+                v = std::move(value);
+                if (v.size() > kMaxCompactItemSize) convert_to_table();
+                return false;
+            }
+        }
+        bool fits = compact_.size() < kMaxCompactEntries &&
+                    field.size() <= kMaxCompactItemSize &&
+                    value.size() <= kMaxCompactItemSize;
+        if (fits) {
+            compact_.emplace_back(field, std::move(value));
+            return true;
+        }
+        convert_to_table();
+    }
+
+    auto [it, inserted] = table_->insert_or_assign(field, std::move(value));
+    return inserted;
+}
+
+std::optional<std::string> HashObject::get(const std::string& field) const {
+    if (!table_) {
+        for (const auto& [f, v] : compact_) {
+            if (f == field) return v;
+        }
+        return std::nullopt;
+    }
+    auto it = table_->find(field);
+    if (it == table_->end()) return std::nullopt;
+    return it->second;
+}
+
+bool HashObject::remove(const std::string& field) {
+    if (!table_) {
+        auto it = std::find_if(compact_.begin(), compact_.end(),
+                               [&field](const auto& p) { return p.first == field; });
+        if (it == compact_.end()) return false;
+        // Order is not observable, so swap-and-pop keeps removal O(1)
+        *it = std::move(compact_.back());
+        compact_.pop_back();
+        return true;
+    }
+    return table_->erase(field) > 0;
+}
+
+bool HashObject::contains(const std::string& field) const {
+    if (!table_) {
+        return std::any_of(compact_.begin(), compact_.end(),
+                           [&field](const auto& p) { return p.first == field; });
+    }
+    return table_->count(field) > 0;
+}
+
+int64_t HashObject::increment(const std::string& field, int64_t delta) {
+    int64_t current = 0;
+    if (auto existing = get(field)) {
+        const char* begin = existing->data();
+        const char* end = begin + existing->size();
+        auto [ptr, ec] = std::from_chars(begin, end, current);
+        if (ec != std::errc() || ptr != end || existing->empty()) {
+            throw std::runtime_error("hash value is not an integer");
+        }
+    }
+
+    int64_t result;
+    if (__builtin_add_overflow(current, delta, &result)) {
+        throw std::runtime_error("increment or decrement would overflow");
+    }
+    set(field, std::to_string(result));
+    return result;
+}
+
+std::vector<std::pair<std::string, std::string>> HashObject::items() const {
+    if (!table_) return compact_;
+    return {table_->begin(), table_->end()};
+}
+
+size_t HashObject::memory_size() const {
+    size_t total = 0;
+    if (!table_) {
+        total += compact_.capacity() * sizeof(std::pair<std::string, std::string>);
+        for (const auto& [f, v] : compact_) {
+            total += f.size() + v.size();
+        }
+        return total;
+    }
+    // Node overhead: two strings plus the bucket pointer and cached hash
+    constexpr size_t kNodeOverhead = 2 * sizeof(std::string) + 2 * sizeof(void*);
+    total += sizeof(*table_) + table_->bucket_count() * sizeof(void*);
+    for (const auto& [f, v] : *table_) {
+        total += kNodeOverhead + f.size() + v.size();
+    }
+    return total;
+}
+
+bool HashObject::operator==(const HashObject& other) const {
+    if (size() != other.size()) return false;
+    for (const auto& [f, v] : items()) {
+        auto theirs = other.get(f);
+        if (!theirs || *theirs != v) return false;
+    }
+    return true;
+}
+
+void HashObject::convert_to_table() {
+    table_ = std::make_unique<std::unordered_map<std::string, std::string>>();
+    table_->reserve(compact_.size() * 2);
+    for (auto& [f, v] : compact_) {
+        table_->emplace(std::move(f), std::move(v));
+    }
+    compact_.clear();
+    compact_.shrink_to_fit();
+}
+
+}  // namespace cacheforge
@@ -0,0 +1,62 @@
+#pragma once
+#ifndef CACHEFORGE_HASH_OBJECT_H
+#define CACHEFORGE_HASH_OBJECT_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <optional>
+#include <cstdint>
+#include <utility>
+#include <memory>
+
+namespace cacheforge {
+
+// Field -> value map stored under a single cache key.
+// Small hashes use a compact encoding (a flat vector of pairs scanned
+// linearly, one allocation for the whole object); they are converted to a
+// hash table once they exceed kMaxCompactEntries or hold a long field/value.
+class HashObject {
+public:
+    enum class Encoding { Compact, Table };
+
+    static constexpr size_t kMaxCompactEntries = 64;
+    static constexpr size_t kMaxCompactItemSize = 64;
+
+    HashObject() = default;
+    HashObject(const HashObject& other);
+    HashObject& operator=(const HashObject& other);
+    HashObject(HashObject&&) noexcept = default;
+    HashObject& operator=(HashObject&&) noexcept = default;
+
+    Encoding encoding() const { return table_ ? Encoding::Table : Encoding::Compact; }
+    size_t size() const;
+    bool empty() const { return size() == 0; }
+
+    // Returns true if the field was newly created, false if it was updated
+    bool set(const std::string& field, std::string value);
+    std::optional<std::string> get(const std::string& field) const;
+    bool remove(const std::string& field);
+    bool contains(const std::string& field) const;
+
+    // Adds delta to an integer field (missing fields count as 0).
+    // Throws std::runtime_error if the field is not an integer or on overflow.
+    int64_t increment(const std::string& field, int64_t delta);
+
+    std::vector<std::pair<std::string, std::string>> items() const;
+    size_t memory_size() const;
+
+    bool operator==(const HashObject& other) const;
+
+private:
+    // The table is heap-allocated so a compact hash only costs a vector plus
+    // one pointer inside Value
+    std::vector<std::pair<std::string, std::string>> compact_;
+    std::unique_ptr<std::unordered_map<std::string, std::string>> table_;
+
+    void convert_to_table();
+};
+
+}  // namespace cacheforge
+
+#endif  // CACHEFORGE_HASH_OBJECT_H
@@ -0,0 +1,211 @@
+#include "data/hyperloglog.h"
+#include "utils/hash.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <numbers>
+#include <stdexcept>
+
+namespace cacheforge {
+
+namespace {
+
+// Fixed rather than the per-process key seed: registers are persisted and
+// merged across servers, so an element must land in the same register
+// everywhere
+constexpr uint64_t kHashSeed = 0x5f3759df9e3779b9ull;
+
+// Hash bits left after the register index; register values run 0..kQ + 1
+constexpr int kQ = 64 - HyperLogLog::kPrecision;
+
+uint32_t sparse_index(uint32_t entry) { return entry >> 8; }
+uint8_t sparse_value(uint32_t entry) { return static_cast<uint8_t>(entry & 0xff); }
+
+// Ertl's improved raw estimator ("New cardinality estimation algorithms for
+// HyperLogLog sketches", 2017), as Redis uses it: accurate from 0 to
+// billions without the bias tables or linear-counting switch of the
+// original paper
+double sigma(double x) {
+    if (x == 1.0) return INFINITY;
+    double y = 1.0;
+    double z = x;
+    double previous;
+    do {
+        x *= x;
+        previous = z;
+        z += x * y;
+        y += y;
+    } while (previous != z);
+    return z;
+}
+
+double tau(double x) {
+    if (x == 0.0 || x == 1.0) return 0.0;
+    double y = 1.0;
+    double z = 1.0 - x;
+    double previous;
+    do {
+        x = std::sqrt(x);
+        previous = z;
+        y *= 0.5;
+        z -= (1.0 - x) * (1.0 - x) * y;
+    } while (previous != z);
+    return z / 3.0;
+}
+
+[[noreturn]] void malformed() {
+    throw std::runtime_error("Malformed HyperLogLog encoding");
+}
+
+}  // namespace
+
+HyperLogLog::HyperLogLog(const HyperLogLog& other) : sparse_(other.sparse_) {
+    if (other.dense_) {
+        dense_ = std::make_unique<uint8_t[]>(kRegisters);
+        std::memcpy(dense_.get(), other.dense_.get(), kRegisters);
+    }
+}
+
+HyperLogLog& HyperLogLog::operator=(const HyperLogLog& other) {
+    if (this != &other) {
+        HyperLogLog copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+bool HyperLogLog::add(std::string_view element) {
+    uint64_t hash = hashing::hash_bytes(element.data(), element.size(), kHashSeed);
+    size_t index = hash & (kRegisters - 1);
+    // The sentinel bit caps the run so an all-zero remainder still ends
+    uint64_t rest = (hash >> kPrecision) | (uint64_t{1} << kQ);
+    return set_register(index, static_cast<uint8_t>(std::countr_zero(rest) + 1));
+}
+
+bool HyperLogLog::set_register(size_t index, uint8_t value) {
+    if (dense_) {
+        if (dense_[index] >= value) return false;
+        dense_[index] = value;
+        return true;
+    }
+    auto it = std::lower_bound(sparse_.begin(), sparse_.end(), index,
+                               [](uint32_t entry, size_t i) { return sparse_index(entry) < i; });
+    if (it != sparse_.end() && sparse_index(*it) == index) {
+        if (sparse_value(*it) >= value) return false;
+        *it = static_cast<uint32_t>(index << 8 | value);
+        return true;
+    }
+    sparse_.insert(it, static_cast<uint32_t>(index << 8 | value));
+    if (sparse_.size() > kMaxSparseEntries) convert_to_dense();
+    return true;
+}
+
+void HyperLogLog::convert_to_dense() {
+    dense_ = std::make_unique<uint8_t[]>(kRegisters);  // zeroed
+    for (uint32_t entry : sparse_) dense_[sparse_index(entry)] = sparse_value(entry);
+    sparse_.clear();
+    sparse_.shrink_to_fit();
+}
+
+uint64_t HyperLogLog::count() const {
+    std::array<uint32_t, kQ + 2> histogram{};
+    if (dense_) {
+        for (size_t i = 0; i < kRegisters; ++i) histogram[dense_[i]]++;
+    } else {
+        histogram[0] = static_cast<uint32_t>(kRegisters - sparse_.size());
+        for (uint32_t entry : sparse_) histogram[sparse_value(entry)]++;
+    }
+
+    const double m = static_cast<double>(kRegisters);
+    double z = m * tau((m - histogram[kQ + 1]) / m);
+    for (int k = kQ; k >= 1; --k) {
+        z += histogram[k];
+        z *= 0.5;
+    }
+    z += m * sigma(histogram[0] / m);
+    constexpr double kAlphaInf = 0.5 / std::numbers::ln2;
+    return static_cast<uint64_t>(std::llround(kAlphaInf * m * m / z));
+}
+
+void HyperLogLog::merge(const HyperLogLog& other) {
+    if (!other.dense_) {
+        for (uint32_t entry : other.sparse_) set_register(sparse_index(entry), sparse_value(entry));
+        return;
+    }
+    if (!dense_) convert_to_dense();
+    // A plain byte-wise max over two arrays: vectorized to pmaxub/umax
+    uint8_t* dst = dense_.get();
+    const uint8_t* src = other.dense_.get();
+    for (size_t i = 0; i < kRegisters; ++i) dst[i] = std::max(dst[i], src[i]);
+}
+
+size_t HyperLogLog::memory_size() const {
+    return sparse_.capacity() * sizeof(uint32_t) + (dense_ ? kRegisters : 0);
+}
+
+// [uint8 encoding] then, sparse: [uint32 count][uint32 entry]...;
+// dense: kRegisters register bytes
+std::string HyperLogLog::encode() const {
+    std::string out;
+    if (dense_) {
+        out.reserve(1 + kRegisters);
+        out.push_back(static_cast<char>(Encoding::Dense));
+        out.append(reinterpret_cast<const char*>(dense_.get()), kRegisters);
+        return out;
+    }
+    auto count = static_cast<uint32_t>(sparse_.size());
+    out.reserve(1 + sizeof(count) + sparse_.size() * sizeof(uint32_t));
+    out.push_back(static_cast<char>(Encoding::Sparse));
+    out.append(reinterpret_cast<const char*>(&count), sizeof(count));
+    out.append(reinterpret_cast<const char*>(sparse_.data()), sparse_.size() * sizeof(uint32_t));
+    return out;
+}
+
+HyperLogLog HyperLogLog::decode(const std::string& bytes) {
+    if (bytes.empty()) malformed();
+    HyperLogLog hll;
+    const char* data = bytes.data() + 1;
+    size_t size = bytes.size() - 1;
+    if (bytes[0] == static_cast<char>(Encoding::Dense)) {
+        if (size != kRegisters) malformed();
+        hll.dense_ = std::make_unique<uint8_t[]>(kRegisters);
+        std::memcpy(hll.dense_.get(), data, kRegisters);
+        for (size_t i = 0; i < kRegisters; ++i) {
+            if (hll.dense_[i] > kQ + 1) malformed();
+        }
+        return hll;
+    }
+    if (bytes[0] != static_cast<char>(Encoding::Sparse) || size < sizeof(uint32_t)) malformed();
+    uint32_t count;
+    std::memcpy(&count, data, sizeof(count));
+    if (count > kMaxSparseEntries || size != sizeof(count) + size_t{count} * sizeof(uint32_t)) malformed();
+    hll.sparse_.resize(count);
+    std::memcpy(hll.sparse_.data(), data + sizeof(count), size_t{count} * sizeof(uint32_t));
+    for (size_t i = 0; i < hll.sparse_.size(); ++i) {
+        uint32_t entry = hll.sparse_[i];
+        if (sparse_index(entry) >= kRegisters || sparse_value(entry) == 0 || sparse_value(entry) > kQ + 1 ||
+            (i > 0 && sparse_index(hll.sparse_[i - 1]) >= sparse_index(entry))) {
+            malformed();
+        }
+    }
+    return hll;
+}
+
+bool HyperLogLog::operator==(const HyperLogLog& other) const {
+    if (!dense_ && !other.dense_) return sparse_ == other.sparse_;
+    // Compare register values whatever the encodings
+    auto registers = [](const HyperLogLog& h) {
+        std::vector<uint8_t> r(kRegisters);
+        if (h.dense_) {
+            std::memcpy(r.data(), h.dense_.get(), kRegisters);
+        } else {
+            for (uint32_t entry : h.sparse_) r[sparse_index(entry)] = sparse_value(entry);
+        }
+        return r;
+    };
+    return registers(*this) == registers(other);
+}
+
+}  // namespace cacheforge
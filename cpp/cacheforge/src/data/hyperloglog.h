@@ -0,0 +1,65 @@
+#pragma once
+#ifndef CACHEFORGE_HYPERLOGLOG_H
+#define CACHEFORGE_HYPERLOGLOG_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+
+namespace cacheforge {
+
+// Cardinality estimate of the elements added (PFADD/PFCOUNT), with a
+// standard error of 1.04 / sqrt(2^14) = 0.81% in at most 16 KB.
+// 2^14 registers each hold the longest run of trailing zero bits seen in
+// the hashes routed to them. A new HyperLogLog is sparse: a sorted vector
+// of (register, value) pairs for the non-zero registers only, so a few
+// hundred elements take a few hundred bytes. Past kMaxSparseEntries it
+// converts to dense: one byte per register, so merging is a byte-wise max
+// that compilers vectorize.
+class HyperLogLog {
+public:
+    enum class Encoding { Sparse, Dense };
+
+    static constexpr int kPrecision = 14;
+    static constexpr size_t kRegisters = size_t{1} << kPrecision;
+    static constexpr size_t kMaxSparseEntries = 2048;
+
+    HyperLogLog() = default;
+    HyperLogLog(const HyperLogLog& other);
+    HyperLogLog& operator=(const HyperLogLog& other);
+    HyperLogLog(HyperLogLog&&) noexcept = default;
+    HyperLogLog& operator=(HyperLogLog&&) noexcept = default;
+
+    Encoding encoding() const { return dense_ ? Encoding::Dense : Encoding::Sparse; }
+
+    // Returns true if a register changed, i.e. the estimate may have moved
+    bool add(std::string_view element);
+    uint64_t count() const;
+    // Register-wise max with `other`: afterwards this estimates the union
+    void merge(const HyperLogLog& other);
+
+    size_t memory_size() const;
+
+    // Register values, sparse or dense as currently held; decode() throws
+    // std::runtime_error on malformed input
+    std::string encode() const;
+    static HyperLogLog decode(const std::string& bytes);
+
+    bool operator==(const HyperLogLog& other) const;
+
+private:
+    // Sparse: register index << 8 | value, sorted by index
+    std::vector<uint32_t> sparse_;
+    // Dense: kRegisters bytes, behind a pointer so a sparse HLL stays small
+    std::unique_ptr<uint8_t[]> dense_;
+
+    bool set_register(size_t index, uint8_t value);
+    void convert_to_dense();
+};
+
+}  // namespace cacheforge
+
+#endif  // CACHEFORGE_HYPERLOGLOG_H
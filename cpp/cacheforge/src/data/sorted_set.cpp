@@ -0,0 +1,344 @@
+#include "data/sorted_set.h"
+#include <algorithm>
+#include <random>
+#include <unordered_map>
+
+namespace cacheforge {
+
+// Skiplist with per-level spans (for O(log n) rank) plus a member -> score
+// dictionary for O(1) score lookup, as in Redis' zset encoding
+class SortedSet::SkipList {
+public:
+    static constexpr int kMaxLevel = 32;
+
+    struct Node;
+    struct Level {
+        Node* forward = nullptr;
+        size_t span = 0;
+    };
+    struct Node {
+        std::string member;
+        double score;
+        Node* backward = nullptr;
+        std::vector<Level> levels;
+    };
+
+    SkipList() : header_(new Node{"", 0.0, nullptr, std::vector<Level>(kMaxLevel)}) {}
+
+    ~SkipList() {
+        Node* n = header_;
+        while (n) {
+            Node* next = n->levels[0].forward;
+            delete n;
+            n = next;
+        }
+    }
+
+    SkipList(const SkipList& other) : SkipList() {
+        dict_.reserve(other.dict_.size());
+        for (const Node* n = other.first(); n; n = n->levels[0].forward) {
+            add(n->member, n->score);
+        }
+    }
+
+    SkipList& operator=(const SkipList&) = delete;
+
+    size_t size() const { return length_; }
+    const Node* first() const { return header_->levels[0].forward; }
+
+    bool add(const std::string& member, double score) {
+        auto it = dict_.find(member);
+        if (it != dict_.end()) {
+            if (it->second == score) return false;
+            erase_node(member, it->second);
+            insert_node(member, score);
+            it->second = score;
+            return false;
+        }
+        insert_node(member, score);
+        dict_.emplace(member, score);
+        return true;
+    }
+
+    bool remove(const std::string& member) {
+        auto it = dict_.find(member);
+        if (it == dict_.end()) return false;
+        erase_node(member, it->second);
+        dict_.erase(it);
+        return true;
+    }
+
+    std::optional<double> score(const std::string& member) const {
+        auto it = dict_.find(member);
+        if (it == dict_.end()) return std::nullopt;
+        return it->second;
+    }
+
+    // Accumulate spans along the search path; the header sits at rank 0
+    size_t rank(const std::string& member, double score) const {
+        size_t traversed = 0;
+        const Node* x = header_;
+        for (int i = level_ - 1; i >= 0; --i) {
+            while (x->levels[i].forward && less(x->levels[i].forward, score, member)) {
+                traversed += x->levels[i].span;
+                x = x->levels[i].forward;
+            }
+        }
+        return traversed;
+    }
+
+    const Node* first_in_range(const ScoreRange& range) const {
+        const Node* x = header_;
+        for (int i = level_ - 1; i >= 0; --i) {
+            while (x->levels[i].forward) {
+                double s = x->levels[i].forward->score;
+                bool below_min = range.min_exclusive ? s <= range.min : s < range.min;
+                if (!below_min) break;
+                x = x->levels[i].forward;
+            }
+        }
+        return x->levels[0].forward;
+    }
+
+    size_t memory_size() const {
+        size_t total = 0;
+        for (const Node* n = header_; n; n = n->levels[0].forward) {
+            total += sizeof(Node) + n->levels.capacity() * sizeof(Level) + n->member.size();
+        }
+        constexpr size_t kDictNodeOverhead = sizeof(std::string) + sizeof(double) + 2 * sizeof(void*);
+        total += sizeof(SkipList) + dict_.bucket_count() * sizeof(void*);
+        for (const auto& [m, s] : dict_) total += kDictNodeOverhead + m.size();
+        return total;
+    }
+
+private:
+    Node* header_;
+    Node* tail_ = nullptr;
+    int level_ = 1;
+    size_t length_ = 0;
+    std::unordered_map<std::string, double> dict_;
+
+    static bool less(const Node* node, double score, const std::string& member) {
+        return node->score < score || (node->score == score && node->member < member);
+    }
+
+    static int random_level() {
+        // Each extra level is taken with probability 1/4
+        thread_local std::mt19937 rng{std::random_device{}()};
+        int lvl = 1;
+        while (lvl < kMaxLevel && (rng() & 0x3) == 0) {
+            lvl++;
+        }
+        return lvl;
+    }
+
+    void insert_node(const std::string& member, double score) {
+        Node* update[kMaxLevel];
+        size_t rank[kMaxLevel];
+
+        Node* x = header_;
+        for (int i = level_ - 1; i >= 0; --i) {
+            rank[i] = (i == level_ - 1) ? 0 : rank[i + 1];
+            while (x->levels[i].forward && less(x->levels[i].forward, score, member)) {
+                rank[i] += x->levels[i].span;
+                x = x->levels[i].forward;
+            }
+            update[i] = x;
+        }
+
+        int lvl = random_level();
+        if (lvl > level_) {
+            for (int i = level_; i < lvl; ++i) {
+                rank[i] = 0;
+                update[i] = header_;
+                update[i]->levels[i].span = length_;
+            }
+            level_ = lvl;
+        }
+
+        x = new Node{member, score, nullptr, std::vector<Level>(lvl)};
+        for (int i = 0; i < lvl; ++i) {
+            x->levels[i].forward = update[i]->levels[i].forward;
+            update[i]->levels[i].forward = x;
+            x->levels[i].span = update[i]->levels[i].span - (rank[0] - rank[i]);
+            update[i]->levels[i].span = (rank[0] - rank[i]) + 1;
+        }
+        for (int i = lvl; i < level_; ++i) {
+            update[i]->levels[i].span++;
+        }
+
+        x->backward = (update[0] == header_) ? nullptr : update[0];
+        if (x->levels[0].forward) {
+            x->levels[0].forward->backward = x;
+        } else {
+            tail_ = x;
+        }
+        length_++;
+    }
+
+    void erase_node(const std::string& member, double score) {
+        Node* update[kMaxLevel];
+
+        Node* x = header_;
+        for (int i = level_ - 1; i >= 0; --i) {
+            while (x->levels[i].forward && less(x->levels[i].forward, score, member)) {
+                x = x->levels[i].forward;
+            }
+            update[i] = x;
+        }
+
+        x = x->levels[0].forward;
+        if (!x || x->score != score || x->member != member) return;
+
+        for (int i = 0; i < level_; ++i) {
+            if (update[i]->levels[i].forward == x) {
+                update[i]->levels[i].span += x->levels[i].span - 1;
+                update[i]->levels[i].forward = x->levels[i].forward;
+            } else {
+                update[i]->levels[i].span -= 1;
+            }
+        }
+        if (x->levels[0].forward) {
+            x->levels[0].forward->backward = x->backward;
+        } else {
+            tail_ = x->backward;
+        }
+        while (level_ > 1 && !header_->levels[level_ - 1].forward) {
+            level_--;
+        }
+        length_--;
+        delete x;
+    }
+};
+
+SortedSet::SortedSet() = default;
+SortedSet::~SortedSet() = default;
+SortedSet::SortedSet(SortedSet&& other) noexcept = default;
+SortedSet& SortedSet::operator=(SortedSet&& other) noexcept = default;
+
+SortedSet::SortedSet(const SortedSet& other)
+    : compact_(other.compact_),
+      list_(other.list_ ? std::make_unique<SkipList>(*other.list_) : nullptr) {}
+
+SortedSet& SortedSet::operator=(const SortedSet& other) {
+    if (this != &other) {
+        SortedSet copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+size_t SortedSet::size() const {
+    return list_ ? list_->size() : compact_.size();
+}
+
+bool SortedSet::add(const std::string& member, double score) {
+    if (!list_) {
+        auto existing = std::find_if(compact_.begin(), compact_.end(),
+                                     [&member](const auto& p) { return p.second == member; });
+        bool is_new = existing == compact_.end();
+        if (!is_new) {
+            if (existing->first == score) return false;
+            compact_.erase(existing);
+        }
+
+        if (compact_.size() < kMaxCompactEntries && member.size() <= kMaxCompactMemberSize) {
+            auto pos = std::lower_bound(compact_.begin(), compact_.end(), std::make_pair(score, member));
+            compact_.emplace(pos, score, member);
+            return is_new;
+        }
+        convert_to_skiplist();
+        list_->add(member, score);
+        return is_new;
+    }
+    return list_->add(member, score);
+}
+
+bool SortedSet::remove(const std::string& member) {
+    if (list_) return list_->remove(member);
+
+    auto it = std::find_if(compact_.begin(), compact_.end(),
+                           [&member](const auto& p) { return p.second == member; });
+    if (it == compact_.end()) return false;
+    compact_.erase(it);
+    return true;
+}
+
+std::optional<double> SortedSet::score(const std::string& member) const {
+    if (list_) return list_->score(member);
+
+    for (const auto& [s, m] : compact_) {
+        if (m == member) return s;
+    }
+    return std::nullopt;
+}
+
+std::optional<size_t> SortedSet::rank(const std::string& member) const {
+    auto s = score(member);
+    if (!s) return std::nullopt;
+    if (list_) return list_->rank(member, *s);
+
+    auto pos = std::lower_bound(compact_.begin(), compact_.end(), std::make_pair(*s, member));
+    return static_cast<size_t>(pos - compact_.begin());
+}
+
+std::vector<std::pair<std::string, double>> SortedSet::range_by_score(
+    const ScoreRange& range, size_t offset, size_t limit) const {
+    std::vector<std::pair<std::string, double>> result;
+    if (range.min > range.max) return result;
+
+    if (!list_) {
+        for (const auto& [s, m] : compact_) {
+            if (s > range.max) break;
+            if (!range.contains(s)) continue;
+            if (offset > 0) { --offset; continue; }
+            if (result.size() >= limit) break;
+            result.emplace_back(m, s);
+        }
+        return result;
+    }
+
+    for (const auto* n = list_->first_in_range(range); n && range.contains(n->score);
+         n = n->levels[0].forward) {
+        if (offset > 0) { --offset; continue; }
+        if (result.size() >= limit) break;
+        result.emplace_back(n->member, n->score);
+    }
+    return result;
+}
+
+std::vector<std::pair<std::string, double>> SortedSet::items() const {
+    std::vector<std::pair<std::string, double>> result;
+    result.reserve(size());
+    if (!list_) {
+        for (const auto& [s, m] : compact_) result.emplace_back(m, s);
+        return result;
+    }
+    for (const auto* n = list_->first(); n; n = n->levels[0].forward) {
+        result.emplace_back(n->member, n->score);
+    }
+    return result;
+}
+
+size_t SortedSet::memory_size() const {
+    if (list_) return list_->memory_size();
+
+    size_t total = compact_.capacity() * sizeof(std::pair<double, std::string>);
+    for (const auto& [s, m] : compact_) total += m.size();
+    return total;
+}
+
+bool SortedSet::operator==(const SortedSet& other) const {
+    return items() == other.items();
+}
+
+void SortedSet::convert_to_skiplist() {
+    list_ = std::make_unique<SkipList>();
+    for (const auto& [s, m] : compact_) {
+        list_->add(m, s);
+    }
+    compact_.clear();
+    compact_.shrink_to_fit();
+}
+
+}  // namespace cacheforge
@@ -0,0 +1,80 @@
+#pragma once
+#ifndef CACHEFORGE_SORTED_SET_H
+#define CACHEFORGE_SORTED_SET_H
+
+#include <string>
+#include <vector>
+#include <optional>
+#include <cstdint>
+#include <utility>
+#include <memory>
+
+namespace cacheforge {
+
+// Inclusive/exclusive score interval used by range queries (ZRANGEBYSCORE)
+struct ScoreRange {
+    double min;
+    double max;
+    bool min_exclusive = false;
+    bool max_exclusive = false;
+
+    bool contains(double score) const {
+        bool above_min = min_exclusive ? score > min : score >= min;
+        bool below_max = max_exclusive ? score < max : score <= max;
+        return above_min && below_max;
+    }
+};
+
+// Members ordered by (score, member).
+// Small sets are kept as a sorted flat vector (binary search, no per-member
+// allocation). Larger sets convert to a skiplist with rank spans plus a
+// member -> score dictionary, giving O(log n) insert, rank and range start.
+class SortedSet {
+public:
+    enum class Encoding { Compact, SkipList };
+
+    static constexpr size_t kMaxCompactEntries = 128;
+    static constexpr size_t kMaxCompactMemberSize = 64;
+
+    SortedSet();
+    ~SortedSet();
+    SortedSet(const SortedSet& other);
+    SortedSet& operator=(const SortedSet& other);
+    SortedSet(SortedSet&& other) noexcept;
+    SortedSet& operator=(SortedSet&& other) noexcept;
+
+    Encoding encoding() const { return list_ ? Encoding::SkipList : Encoding::Compact; }
+    size_t size() const;
+    bool empty() const { return size() == 0; }
+
+    // Returns true if the member was newly added, false if its score changed
+    bool add(const std::string& member, double score);
+    bool remove(const std::string& member);
+    std::optional<double> score(const std::string& member) const;
+
+    // 0-based position in ascending score order
+    std::optional<size_t> rank(const std::string& member) const;
+
+    std::vector<std::pair<std::string, double>> range_by_score(
+        const ScoreRange& range, size_t offset = 0, size_t limit = SIZE_MAX) const;
+
+    std::vector<std::pair<std::string, double>> items() const;
+    size_t memory_size() const;
+
+    bool operator==(const SortedSet& other) const;
+
+private:
+    // Skiplist state lives behind a pointer so an empty or compact set only
+    // costs a vector plus one pointer inside Value
+    class SkipList;
+
+    // Compact encoding: sorted by (score, member)
+    std::vector<std::pair<double, std::string>> compact_;
+    std::unique_ptr<SkipList> list_;
+
+    void convert_to_skiplist();
+};
+
+}  // namespace cacheforge
+
+#endif  // CACHEFORGE_SORTED_SET_H
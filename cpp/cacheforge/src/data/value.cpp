@@ -1,10 +1,14 @@
 #include "data/value.h"
+#include "utils/lz4.h"
+#include <charconv>
+#include <cmath>
 #include <cstring>
 #include <stdexcept>
 
 namespace cacheforge {
 
 size_t Value::memory_size() const {
+    if (is_compressed()) return sizeof(Value) + std::get<Packed>(data_).bytes.size();
     switch (type_) {
         case Type::String:
             return sizeof(Value) + std::get<std::string>(data_).size();
@@ -19,6 +23,14 @@ size_t Value::memory_size() const {
         }
         case Type::Binary:
             return sizeof(Value) + std::get<std::vector<uint8_t>>(data_).size();
+        case Type::Hash:
+            return sizeof(Value) + std::get<HashObject>(data_).memory_size();
+        case Type::SortedSet:
+            return sizeof(Value) + std::get<SortedSet>(data_).memory_size();
+        case Type::HyperLogLog:
+            return sizeof(Value) + std::get<HyperLogLog>(data_).memory_size();
+        case Type::Bloom:
+            return sizeof(Value) + std::get<BloomFilter>(data_).memory_size();
     }
     return sizeof(Value);
 }
@@ -59,6 +71,62 @@ const std::vector<uint8_t>& Value::as_binary() const {
     return std::get<std::vector<uint8_t>>(data_);
 }
 
+const HashObject& Value::as_hash() const {
+    if (type_ != Type::Hash) {
+        throw std::runtime_error("Value is not a hash");
+    }
+    return std::get<HashObject>(data_);
+}
+
+HashObject& Value::as_hash() {
+    if (type_ != Type::Hash) {
+        throw std::runtime_error("Value is not a hash");
+    }
+    return std::get<HashObject>(data_);
+}
+
+const SortedSet& Value::as_sorted_set() const {
+    if (type_ != Type::SortedSet) {
+        throw std::runtime_error("Value is not a sorted set");
+    }
+    return std::get<SortedSet>(data_);
+}
+
+SortedSet& Value::as_sorted_set() {
+    if (type_ != Type::SortedSet) {
+        throw std::runtime_error("Value is not a sorted set");
+    }
+    return std::get<SortedSet>(data_);
+}
+
+const HyperLogLog& Value::as_hyperloglog() const {
+    if (type_ != Type::HyperLogLog) {
+        throw std::runtime_error("Value is not a HyperLogLog");
+    }
+    return std::get<HyperLogLog>(data_);
+}
+
+HyperLogLog& Value::as_hyperloglog() {
+    if (type_ != Type::HyperLogLog) {
+        throw std::runtime_error("Value is not a HyperLogLog");
+    }
+    return std::get<HyperLogLog>(data_);
+}
+
+const BloomFilter& Value::as_bloom() const {
+    if (type_ != Type::Bloom) {
+        throw std::runtime_error("Value is not a Bloom filter");
+    }
+    return std::get<BloomFilter>(data_);
+}
+
+BloomFilter& Value::as_bloom() {
+    if (type_ != Type::Bloom) {
+        throw std::runtime_error("Value is not a Bloom filter");
+    }
+    return std::get<BloomFilter>(data_);
+}
+
 int64_t Value::fast_integer_parse() const {
     if (type_ != Type::String) {
         throw std::runtime_error("Value is not a string");
@@ -73,12 +141,267 @@ int64_t Value::fast_integer_parse() const {
     return *ptr;
 }
 
+std::optional<int64_t> Value::to_integer() const {
+    if (type_ == Type::Integer) return std::get<int64_t>(data_);
+    if (type_ != Type::String) return std::nullopt;
+
+    const auto& str = std::get<std::string>(data_);
+    int64_t result = 0;
+    const char* end = str.data() + str.size();
+    auto [ptr, ec] = std::from_chars(str.data(), end, result);
+    if (str.empty() || ec != std::errc() || ptr != end) return std::nullopt;
+    return result;
+}
+
+std::optional<double> Value::to_double() const {
+    if (type_ == Type::Integer) return static_cast<double>(std::get<int64_t>(data_));
+    if (type_ != Type::String) return std::nullopt;
+
+    const auto& str = std::get<std::string>(data_);
+    double result = 0;
+    const char* end = str.data() + str.size();
+    auto [ptr, ec] = std::from_chars(str.data(), end, result);
+    if (str.empty() || ec != std::errc() || ptr != end || !std::isfinite(result)) return std::nullopt;
+    return result;
+}
+
 bool Value::operator==(const Value& other) const {
     if (type_ != other.type_) return false;
     return data_ == other.data_;
 }
 
 
+namespace {
+
+// Encoding helpers: fixed-width native-endian integers followed by raw bytes,
+// matching the layout SnapshotWriter uses for the surrounding record
+template <typename T>
+void put_scalar(std::string& out, T v) {
+    out.append(reinterpret_cast<const char*>(&v), sizeof(v));
+}
+
+void put_bytes(std::string& out, const std::string& bytes) {
+    put_scalar<uint32_t>(out, static_cast<uint32_t>(bytes.size()));
+    out.append(bytes);
+}
+
+class ByteReader {
+public:
+    explicit ByteReader(const std::string& bytes) : bytes_(bytes) {}
+
+    template <typename T>
+    T scalar() {
+        require(sizeof(T));
+        T v;
+        std::memcpy(&v, bytes_.data() + offset_, sizeof(T));
+        offset_ += sizeof(T);
+        return v;
+    }
+
+    std::string bytes() {
+        auto len = scalar<uint32_t>();
+        require(len);
+        std::string out = bytes_.substr(offset_, len);
+        offset_ += len;
+        return out;
+    }
+
+private:
+    const std::string& bytes_;
+    size_t offset_ = 0;
+
+    void require(size_t n) const {
+        if (n > bytes_.size() - offset_) {
+            throw std::runtime_error("Truncated value encoding");
+        }
+    }
+};
+
+}  // namespace
+
+std::string Value::encode() const {
+    if (is_compressed()) return std::get<Packed>(data_).bytes;
+    std::string out;
+    switch (type_) {
+        case Type::String:
+            return std::get<std::string>(data_);
+        case Type::Integer:
+            put_scalar<int64_t>(out, std::get<int64_t>(data_));
+            return out;
+        case Type::List: {
+            const auto& list = std::get<std::vector<std::string>>(data_);
+            put_scalar<uint32_t>(out, static_cast<uint32_t>(list.size()));
+            for (const auto& item : list) put_bytes(out, item);
+            return out;
+        }
+        case Type::Binary: {
+            const auto& bin = std::get<std::vector<uint8_t>>(data_);
+            return std::string(bin.begin(), bin.end());
+        }
+        case Type::Hash: {
+            auto items = std::get<HashObject>(data_).items();
+            put_scalar<uint32_t>(out, static_cast<uint32_t>(items.size()));
+            for (const auto& [field, value] : items) {
+                put_bytes(out, field);
+                put_bytes(out, value);
+            }
+            return out;
+        }
+        case Type::SortedSet: {
+            auto items = std::get<SortedSet>(data_).items();
+            put_scalar<uint32_t>(out, static_cast<uint32_t>(items.size()));
+            for (const auto& [member, score] : items) {
+                put_scalar<double>(out, score);
+                put_bytes(out, member);
+            }
+            return out;
+        }
+        case Type::HyperLogLog:
+            return std::get<HyperLogLog>(data_).encode();
+        case Type::Bloom:
+            return std::get<BloomFilter>(data_).encode();
+    }
+    return out;
+}
+
+Value Value::decode(Type type, const std::string& bytes, bool compressed) {
+    if (compressed) {
+        if ((type != Type::String && type != Type::Binary) || bytes.size() < sizeof(uint32_t)) {
+            throw std::runtime_error("Malformed compressed value");
+        }
+        // An LZ4 block expands at most 255-fold; a larger declared size
+        // would only make decompressed() allocate it before failing
+        constexpr size_t kMaxRatio = 255;
+        size_t size = ByteReader(bytes).scalar<uint32_t>();
+        if (size > (bytes.size() - sizeof(uint32_t)) * kMaxRatio || size > kMaxDecodedBytes) {
+            throw std::runtime_error("Malformed compressed value");
+        }
+        Value v;
+        v.type_ = type;
+        v.data_ = Packed{bytes};
+        return v;
+    }
+    switch (type) {
+        case Type::String:
+            return Value(bytes);
+        case Type::Integer:
+            return Value(ByteReader(bytes).scalar<int64_t>());
+        case Type::List: {
+            ByteReader reader(bytes);
+            auto count = reader.scalar<uint32_t>();
+            std::vector<std::string> list;
+            for (uint32_t i = 0; i < count; ++i) list.push_back(reader.bytes());
+            return Value(std::move(list));
+        }
+        case Type::Binary:
+            return Value(std::vector<uint8_t>(bytes.begin(), bytes.end()));
+        case Type::Hash: {
+            ByteReader reader(bytes);
+            auto count = reader.scalar<uint32_t>();
+            HashObject hash;
+            for (uint32_t i = 0; i < count; ++i) {
+                auto field = reader.bytes();
+                hash.set(field, reader.bytes());
+            }
+            return Value(std::move(hash));
+        }
+        case Type::SortedSet: {
+            ByteReader reader(bytes);
+            auto count = reader.scalar<uint32_t>();
+            SortedSet zset;
+            for (uint32_t i = 0; i < count; ++i) {
+                auto score = reader.scalar<double>();
+                zset.add(reader.bytes(), score);
+            }
+            return Value(std::move(zset));
+        }
+        case Type::HyperLogLog:
+            return Value(HyperLogLog::decode(bytes));
+        case Type::Bloom:
+            return Value(BloomFilter::decode(bytes));
+    }
+    throw std::runtime_error("Unknown value type");
+}
+
+std::optional<Value> Value::compressed(size_t min_bytes) const {
+    if (is_compressed()) return std::nullopt;
+    std::string_view raw;
+    if (type_ == Type::String) {
+        raw = std::get<std::string>(data_);
+    } else if (type_ == Type::Binary) {
+        const auto& bin = std::get<std::vector<uint8_t>>(data_);
+        raw = std::string_view(reinterpret_cast<const char*>(bin.data()), bin.size());
+    } else {
+        return std::nullopt;
+    }
+    if (raw.size() < min_bytes || raw.size() > UINT32_MAX) return std::nullopt;
+
+    std::string block = lz4::compress(raw);
+    // Not worth a decompression on every read
+    if (block.size() + sizeof(uint32_t) > raw.size() - raw.size() / 8) return std::nullopt;
+
+    Packed packed;
+    packed.bytes.reserve(sizeof(uint32_t) + block.size());
+    put_scalar<uint32_t>(packed.bytes, static_cast<uint32_t>(raw.size()));
+    packed.bytes.append(block);
+    Value v;
+    v.type_ = type_;
+    v.data_ = std::move(packed);
+    return v;
+}
+
+Value Value::decompressed() const {
+    if (!is_compressed()) return *this;
+    const auto& bytes = std::get<Packed>(data_).bytes;
+    uint32_t size = ByteReader(bytes).scalar<uint32_t>();
+    std::string_view block(bytes.data() + sizeof(uint32_t), bytes.size() - sizeof(uint32_t));
+    if (type_ == Type::Binary) {
+        std::vector<uint8_t> out(size);
+        if (!lz4::decompress(block, reinterpret_cast<char*>(out.data()), size)) {
+            throw std::runtime_error("Corrupt compressed value");
+        }
+        return Value(std::move(out));
+    }
+    std::string out(size, '\0');
+    if (!lz4::decompress(block, out.data(), size)) {
+        throw std::runtime_error("Corrupt compressed value");
+    }
+    return Value(std::move(out));
+}
+
+std::pair<const void*, size_t> Value::heap_block() const {
+    // A short string's characters sit inside the object itself
+    auto outside = [this](const void* p) {
+        auto* c = static_cast<const char*>(p);
+        auto* self = reinterpret_cast<const char*>(this);
+        return c < self || c >= self + sizeof(Value);
+    };
+    if (const auto* packed = std::get_if<Packed>(&data_)) {
+        if (outside(packed->bytes.data())) return {packed->bytes.data(), packed->bytes.capacity() + 1};
+        return {nullptr, 0};
+    }
+    switch (type_) {
+        case Type::String: {
+            const auto& s = std::get<std::string>(data_);
+            if (outside(s.data())) return {s.data(), s.capacity() + 1};
+            break;
+        }
+        case Type::List: {
+            const auto& list = std::get<std::vector<std::string>>(data_);
+            if (list.capacity()) return {list.data(), list.capacity() * sizeof(std::string)};
+            break;
+        }
+        case Type::Binary: {
+            const auto& bytes = std::get<std::vector<uint8_t>>(data_);
+            if (bytes.capacity()) return {bytes.data(), bytes.capacity()};
+            break;
+        }
+        default:
+            break;
+    }
+    return {nullptr, 0};
+}
+
 Value make_moved_value(const Value& v) {
     return std::move(v);
 }
@@ -4,22 +4,33 @@
 
 #include <string>
 #include <variant>
+#include <utility>
 #include <vector>
 #include <cstdint>
 #include <memory>
+#include <optional>
+#include "data/hash_object.h"
+#include "data/sorted_set.h"
+#include "data/hyperloglog.h"
+#include "data/bloom_filter.h"
 
 namespace cacheforge {
 
-// Value type for cache entries - supports string, integer, list, and binary
+// Value type for cache entries - supports string, integer, list, binary,
+// hash, sorted set, HyperLogLog and Bloom filter
 class Value {
 public:
-    enum class Type { String, Integer, List, Binary };
+    enum class Type { String, Integer, List, Binary, Hash, SortedSet, HyperLogLog, Bloom };
 
     Value() : type_(Type::String), data_("") {}
     explicit Value(const std::string& str) : type_(Type::String), data_(str) {}
     explicit Value(int64_t num) : type_(Type::Integer), data_(num) {}
     explicit Value(std::vector<std::string> list) : type_(Type::List), data_(std::move(list)) {}
     explicit Value(std::vector<uint8_t> binary) : type_(Type::Binary), data_(std::move(binary)) {}
+    explicit Value(HashObject hash) : type_(Type::Hash), data_(std::move(hash)) {}
+    explicit Value(SortedSet zset) : type_(Type::SortedSet), data_(std::move(zset)) {}
+    explicit Value(HyperLogLog hll) : type_(Type::HyperLogLog), data_(std::move(hll)) {}
+    explicit Value(BloomFilter bloom) : type_(Type::Bloom), data_(std::move(bloom)) {}
 
     Type type() const { return type_; }
     size_t memory_size() const;
@@ -30,15 +41,60 @@ public:
     int64_t as_integer() const;
     const std::vector<std::string>& as_list() const;
     const std::vector<uint8_t>& as_binary() const;
+    const HashObject& as_hash() const;
+    HashObject& as_hash();
+    const SortedSet& as_sorted_set() const;
+    SortedSet& as_sorted_set();
+    const HyperLogLog& as_hyperloglog() const;
+    HyperLogLog& as_hyperloglog();
+    const BloomFilter& as_bloom() const;
+    BloomFilter& as_bloom();
 
     
     int64_t fast_integer_parse() const;
 
+    // Numeric view used by INCR/DECR: integers as-is, strings parsed as
+    // base-10 with std::from_chars (no locale, no partial matches)
+    std::optional<int64_t> to_integer() const;
+    std::optional<double> to_double() const;
+
     bool operator==(const Value& other) const;
 
+    // Type-specific byte encoding used by snapshots; decode() throws
+    // std::runtime_error on truncated or malformed input. A compressed
+    // value encodes to its compressed bytes, so pass `compressed` back to
+    // decode() to get the same compressed value. Its declared raw size must
+    // be within what LZ4 can expand the block to and at most
+    // kMaxDecodedBytes; the block itself is only checked when decompressed.
+    static constexpr size_t kMaxDecodedBytes = 512 * 1024 * 1024;
+    std::string encode() const;
+    static Value decode(Type type, const std::string& bytes, bool compressed = false);
+
+    // Compression of large strings and binaries. compressed() returns the
+    // LZ4-compressed form of a String or Binary of at least `min_bytes`
+    // that shrinks by an eighth or more, and nullopt otherwise. A
+    // compressed value keeps its type and reports its compressed size from
+    // memory_size(), but its contents can only be read after
+    // decompressed(); HashTable does that on every read.
+    bool is_compressed() const { return std::holds_alternative<Packed>(data_); }
+    std::optional<Value> compressed(size_t min_bytes) const;
+    Value decompressed() const;
+
+    // The value's own allocation when it has exactly one (a string past
+    // the inline buffer, a binary, a list's array, compressed bytes), as
+    // address and capacity; {nullptr, 0} otherwise. For defragmentation.
+    std::pair<const void*, size_t> heap_block() const;
+
 private:
+    // [uint32 raw size][LZ4 block]
+    struct Packed {
+        std::string bytes;
+        bool operator==(const Packed& other) const { return bytes == other.bytes; }
+    };
+
     Type type_;
-    std::variant<std::string, int64_t, std::vector<std::string>, std::vector<uint8_t>> data_;
+    std::variant<std::string, int64_t, std::vector<std::string>, std::vector<uint8_t>,
+                 HashObject, SortedSet, HyperLogLog, BloomFilter, Packed> data_;
 };
 
 
@@ -3,6 +3,7 @@
 
 #include "config/config.h"
 #include "server/server.h"
+#include "utils/hash.h"
 #include <spdlog/spdlog.h>
 #include <csignal>
 #include <iostream>
@@ -23,11 +24,15 @@ void signal_handler(int signum) {
 
 int main(int argc, char* argv[]) {
     try {
+        // Everything set through CACHEFORGE_* variables takes effect here
         auto& config = cacheforge::get_config();
+        config = cacheforge::Config::from_env();
 
         spdlog::set_level(spdlog::level::from_str(config.log_level));
         spdlog::info("Starting CacheForge v1.0.0");
 
+        // Process-wide, so set once before any table holds a key
+        if (config.hash_seed != 0) cacheforge::hashing::set_seed(config.hash_seed);
         cacheforge::Server server(config);
         g_server = &server;
 
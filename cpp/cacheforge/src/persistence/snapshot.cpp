@@ -1,11 +1,43 @@
 #include "persistence/snapshot.h"
+#include "storage/hashtable.h"
+#include "storage/expiry.h"
+#include "utils/cpu.h"
 #include <spdlog/spdlog.h>
 #include <filesystem>
 #include <chrono>
 #include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <thread>
 
 namespace cacheforge {
 
+namespace {
+// Set in a record's type field when the value bytes are LZ4-compressed;
+// they are written and read back without recompressing
+constexpr int32_t kCompressedFlag = 0x100;
+
+// A record as framed by the reading thread, decoded later by a worker
+struct RawRecord {
+    std::string key;
+    int32_t type;
+    std::string bytes;
+    int64_t ttl_remaining;
+};
+
+// Records bound for one load worker. The reader stops queueing at
+// kMaxQueuedBatches so a slow worker bounds memory instead of the file size
+struct LoadLane {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<std::vector<RawRecord>> batches;
+    bool closed = false;
+};
+
+constexpr size_t kLoadBatchRecords = 256;
+constexpr size_t kMaxQueuedBatches = 16;
+}  // namespace
+
 SnapshotManager::SnapshotManager(const std::string& snapshot_dir)
     : snapshot_dir_(snapshot_dir) {
     std::filesystem::create_directories(snapshot_dir_);
@@ -57,7 +89,18 @@ bool SnapshotManager::load_snapshot(std::vector<SnapshotEntry>& entries) {
         file.read(reinterpret_cast<char*>(&value_len), sizeof(value_len));
         std::string value_str(value_len, '\0');
         file.read(value_str.data(), value_len);
-        entry.value = Value(value_str);
+        bool compressed = (type & kCompressedFlag) != 0;
+        type &= ~kCompressedFlag;
+        if (type < 0 || type > static_cast<int32_t>(Value::Type::Bloom)) {
+            spdlog::error("Snapshot load stopped: unknown value type {} for key", type);
+            break;
+        }
+        try {
+            entry.value = Value::decode(static_cast<Value::Type>(type), value_str, compressed);
+        } catch (const std::exception& e) {
+            spdlog::error("Snapshot load stopped: {}", e.what());
+            break;
+        }
 
         file.read(reinterpret_cast<char*>(&entry.ttl_remaining), sizeof(entry.ttl_remaining));
 
@@ -67,6 +110,154 @@ bool SnapshotManager::load_snapshot(std::vector<SnapshotEntry>& entries) {
     return true;
 }
 
+bool SnapshotManager::load_into(HashTable& table, ExpiryManager* expiry, LoadProgress* progress,
+                                size_t threads) {
+    std::lock_guard lock(mutex_);
+    auto path = latest_snapshot_path();
+    if (path.empty()) return false;
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return false;
+
+    LoadProgress local;
+    if (!progress) progress = &local;
+    progress->total_bytes.store(std::filesystem::file_size(path));
+    progress->loaded_bytes.store(0);
+    progress->loaded_keys.store(0);
+    progress->expired_keys.store(0);
+    progress->loading.store(true);
+
+    // Snapshots store each TTL as it stood when the snapshot was saved
+    auto down_for = std::chrono::system_clock::now() - saved_at(path);
+    if (threads == 0) threads = cpu::default_threads();
+    std::vector<LoadLane> lanes(threads);
+    std::atomic<bool> failed{false};
+
+    // Decodes a record and stores it; false stops the load
+    auto insert = [&](RawRecord& record) {
+        std::chrono::nanoseconds ttl{0};
+        if (record.ttl_remaining > 0) {
+            ttl = std::chrono::seconds(record.ttl_remaining) - down_for;
+            if (ttl <= std::chrono::nanoseconds::zero()) {
+                progress->expired_keys.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        Value value;
+        try {
+            value = Value::decode(static_cast<Value::Type>(record.type & ~kCompressedFlag),
+                                  record.bytes, (record.type & kCompressedFlag) != 0);
+        } catch (const std::exception& e) {
+            spdlog::error("Snapshot load stopped: {}", e.what());
+            return false;
+        }
+        table.set(record.key, std::move(value));
+        if (expiry && ttl > std::chrono::nanoseconds::zero()) {
+            expiry->set_expiry(record.key, std::chrono::ceil<std::chrono::seconds>(ttl));
+        }
+        progress->loaded_keys.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    };
+    auto work = [&](LoadLane& lane) {
+        for (;;) {
+            std::vector<RawRecord> batch;
+            {
+                std::unique_lock lane_lock(lane.mutex);
+                lane.cv.wait(lane_lock, [&lane] { return lane.closed || !lane.batches.empty(); });
+                if (lane.batches.empty()) return;
+                batch = std::move(lane.batches.front());
+                lane.batches.pop_front();
+            }
+            lane.cv.notify_all();
+            for (auto& record : batch) {
+                if (failed.load(std::memory_order_relaxed)) break;
+                if (!insert(record)) failed.store(true);
+            }
+        }
+    };
+    // With one thread the reader inserts as it goes; a handoff would only
+    // add latency
+    std::vector<std::thread> workers;
+    if (threads > 1) {
+        for (auto& lane : lanes) workers.emplace_back(work, std::ref(lane));
+    }
+
+    auto hand_over = [&](size_t index, std::vector<RawRecord>& pending) {
+        auto& lane = lanes[index];
+        {
+            std::unique_lock lane_lock(lane.mutex);
+            lane.cv.wait(lane_lock, [&] { return lane.batches.size() < kMaxQueuedBatches; });
+            lane.batches.push_back(std::move(pending));
+        }
+        lane.cv.notify_all();
+        pending.clear();
+    };
+
+    // Framing only: lengths and raw bytes. Decoding, the expensive part for
+    // hashes and sorted sets, happens on the workers
+    std::vector<std::vector<RawRecord>> pending(threads);
+    uint64_t offset = 0;
+    auto last_report = std::chrono::steady_clock::now();
+    while (!failed.load(std::memory_order_relaxed) && !progress->cancelled.load(std::memory_order_relaxed)) {
+        RawRecord record;
+        size_t key_len;
+        if (!file.read(reinterpret_cast<char*>(&key_len), sizeof(key_len))) break;
+        if (key_len > progress->total_bytes.load()) {
+            spdlog::error("Snapshot load stopped: bad key length at offset {}", offset);
+            break;
+        }
+        record.key.resize(key_len);
+        file.read(record.key.data(), key_len);
+        file.read(reinterpret_cast<char*>(&record.type), sizeof(record.type));
+        size_t value_len = 0;
+        file.read(reinterpret_cast<char*>(&value_len), sizeof(value_len));
+        int32_t type = record.type & ~kCompressedFlag;
+        if (!file || type < 0 || type > static_cast<int32_t>(Value::Type::Bloom) ||
+            value_len > progress->total_bytes.load()) {
+            spdlog::error("Snapshot load stopped: bad record at offset {}", offset);
+            break;
+        }
+        record.bytes.resize(value_len);
+        file.read(record.bytes.data(), value_len);
+        file.read(reinterpret_cast<char*>(&record.ttl_remaining), sizeof(record.ttl_remaining));
+        if (!file) {
+            spdlog::error("Snapshot load stopped: truncated record at offset {}", offset);
+            break;
+        }
+        offset += 2 * sizeof(size_t) + sizeof(int32_t) + sizeof(int64_t) + key_len + value_len;
+        progress->loaded_bytes.store(offset, std::memory_order_relaxed);
+
+        if (threads == 1) {
+            if (!insert(record)) failed.store(true);
+        } else {
+            size_t index = table.shard_of(record.key) % threads;
+            pending[index].push_back(std::move(record));
+            if (pending[index].size() >= kLoadBatchRecords) hand_over(index, pending[index]);
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_report >= std::chrono::seconds(1)) {
+            last_report = now;
+            spdlog::info("Loading snapshot: {}% ({} keys)",
+                         offset * 100 / std::max<uint64_t>(1, progress->total_bytes.load()),
+                         progress->loaded_keys.load());
+        }
+    }
+    for (size_t i = 0; i < threads; ++i) {
+        if (!pending[i].empty()) hand_over(i, pending[i]);
+        {
+            std::lock_guard lane_lock(lanes[i].mutex);
+            lanes[i].closed = true;
+        }
+        lanes[i].cv.notify_all();
+    }
+    for (auto& worker : workers) worker.join();
+
+    progress->loading.store(false);
+    spdlog::info("Loaded {} keys from {} ({} already expired)", progress->loaded_keys.load(), path,
+                 progress->expired_keys.load());
+    return true;
+}
+
 void SnapshotManager::add_entry(const SnapshotEntry& entry) {
     std::lock_guard lock(mutex_);
     pending_entries_.push_back(entry);
@@ -124,6 +315,25 @@ std::string SnapshotManager::generate_snapshot_path() const {
     return snapshot_dir_ + "/snapshot_" + std::to_string(epoch) + ".rdb";
 }
 
+std::chrono::system_clock::time_point SnapshotManager::saved_at(const std::string& path) {
+    // generate_snapshot_path() names files snapshot_<epoch seconds>.rdb
+    auto stem = std::filesystem::path(path).stem().string();
+    const std::string prefix = "snapshot_";
+    if (stem.rfind(prefix, 0) == 0) {
+        try {
+            size_t used = 0;
+            long long epoch = std::stoll(stem.substr(prefix.size()), &used);
+            if (used == stem.size() - prefix.size()) {
+                return std::chrono::system_clock::time_point(std::chrono::seconds(epoch));
+            }
+        } catch (const std::exception&) {
+        }
+    }
+    auto age = std::filesystem::file_time_type::clock::now() - std::filesystem::last_write_time(path);
+    return std::chrono::system_clock::now() -
+           std::chrono::duration_cast<std::chrono::system_clock::duration>(age);
+}
+
 // SnapshotWriter implementation
 SnapshotManager::SnapshotWriter::SnapshotWriter(const std::string& path)
     : file_(path, std::ios::binary) {
@@ -145,9 +355,10 @@ void SnapshotManager::SnapshotWriter::write_entry(const SnapshotEntry& entry) {
     file_.write(entry.key.data(), key_len);
 
     int32_t type = static_cast<int32_t>(entry.value.type());
+    if (entry.value.is_compressed()) type |= kCompressedFlag;
     file_.write(reinterpret_cast<const char*>(&type), sizeof(type));
 
-    std::string value_str = entry.value.as_string();
+    std::string value_str = entry.value.encode();
     size_t value_len = value_str.size();
     file_.write(reinterpret_cast<const char*>(&value_len), sizeof(value_len));
     file_.write(value_str.data(), value_len);
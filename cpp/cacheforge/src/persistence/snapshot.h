@@ -8,16 +8,33 @@
 #include <mutex>
 #include <fstream>
 #include <functional>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include "data/value.h"
 
 namespace cacheforge {
 
+class HashTable;
+class ExpiryManager;
+
 struct SnapshotEntry {
     std::string key;
     Value value;
     int64_t ttl_remaining;
 };
 
+// Progress of SnapshotManager::load_into(), updated while it runs so other
+// threads can report it and cancel the load
+struct LoadProgress {
+    std::atomic<bool> loading{false};
+    std::atomic<bool> cancelled{false};
+    std::atomic<uint64_t> total_bytes{0};
+    std::atomic<uint64_t> loaded_bytes{0};
+    std::atomic<uint64_t> loaded_keys{0};
+    std::atomic<uint64_t> expired_keys{0};  // TTL ran out while the server was down
+};
+
 class SnapshotManager {
 public:
     explicit SnapshotManager(const std::string& snapshot_dir);
@@ -26,6 +43,17 @@ public:
     bool save_snapshot(const std::vector<SnapshotEntry>& entries);
     bool load_snapshot(std::vector<SnapshotEntry>& entries);
 
+    // Loads the latest snapshot straight into `table` without building an
+    // intermediate vector. One thread reads and frames records and hands
+    // them to `threads` workers (0 = one per usable CPU), each owning a
+    // disjoint set of table shards, which decode and insert them; with one
+    // thread the reader inserts them itself. TTLs count from the time the
+    // snapshot was saved, so keys that expired while the server was down
+    // are skipped. Returns false if there is no snapshot; a corrupt record
+    // stops the load, keeping what came before it.
+    bool load_into(HashTable& table, ExpiryManager* expiry, LoadProgress* progress = nullptr,
+                   size_t threads = 0);
+
     void add_entry(const SnapshotEntry& entry);
 
     std::string latest_snapshot_path() const;
@@ -49,6 +77,9 @@ private:
     std::vector<SnapshotEntry> pending_entries_;
 
     std::string generate_snapshot_path() const;
+    // When the snapshot at `path` was written, from its name or, failing
+    // that, its modification time
+    static std::chrono::system_clock::time_point saved_at(const std::string& path);
 };
 
 }  // namespace cacheforge
@@ -2,6 +2,8 @@
 #include <sstream>
 #include <cstring>
 #include <algorithm>
+#include <charconv>
+#include <stdexcept>
 
 namespace cacheforge {
 
@@ -95,4 +97,145 @@ std::string Parser::serialize_array(const std::vector<std::string>& items) {
     return result;
 }
 
+std::string Parser::serialize_nullable_array(const std::vector<std::optional<std::string>>& items) {
+    std::string result = "*" + std::to_string(items.size()) + "\r\n";
+    for (const auto& item : items) {
+        result += item ? serialize_string(*item) : serialize_null();
+    }
+    return result;
+}
+
+std::string Parser::serialize_array_header(size_t count) {
+    return "*" + std::to_string(count) + "\r\n";
+}
+
+std::string Parser::serialize_push(const std::string& kind, const std::vector<std::string>& items) {
+    return serialize_push_header(2) + serialize_string(kind) + serialize_array(items);
+}
+
+std::string Parser::serialize_push_header(size_t count) {
+    return ">" + std::to_string(count) + "\r\n";
+}
+
+std::string Parser::serialize_command(const Command& cmd) {
+    std::string line = cmd.name;
+    for (const auto& arg : cmd.args) {
+        line += ' ';
+        line += arg;
+    }
+    line += "\r\n";
+    return line;
+}
+
+namespace {
+
+// Returns the offset just past the reply starting at `pos`, or npos if the
+// buffer ends first
+size_t skip_reply(const char* data, size_t length, size_t pos) {
+    constexpr size_t kIncomplete = std::string::npos;
+    if (pos >= length) return kIncomplete;
+
+    const char* begin = data + pos;
+    const char* end = data + length;
+    const char* cr = std::find(begin, end, '\r');
+    if (cr == end || cr + 1 == end) return kIncomplete;
+    if (cr[1] != '\n') throw std::runtime_error("malformed reply: missing LF");
+    size_t line_end = static_cast<size_t>(cr - data) + 2;
+
+    auto read_count = [&]() {
+        int64_t n = 0;
+        auto [ptr, ec] = std::from_chars(begin + 1, cr, n);
+        if (ec != std::errc() || ptr != cr) throw std::runtime_error("malformed reply length");
+        return n;
+    };
+
+    switch (*begin) {
+        case '+':
+        case '-':
+        case ':':
+            return line_end;
+        case '$': {
+            int64_t n = read_count();
+            if (n < 0) return line_end;
+            size_t total = line_end + static_cast<size_t>(n) + 2;
+            return total <= length ? total : kIncomplete;
+        }
+        case '*':
+        case '>': {
+            int64_t n = read_count();
+            size_t next = line_end;
+            for (int64_t i = 0; i < n; ++i) {
+                next = skip_reply(data, length, next);
+                if (next == kIncomplete) return kIncomplete;
+            }
+            return next;
+        }
+        default:
+            throw std::runtime_error(std::string("malformed reply type '") + *begin + "'");
+    }
+}
+
+}  // namespace
+
+size_t Parser::reply_length(const char* data, size_t length) {
+    size_t end = skip_reply(data, length, 0);
+    return end == std::string::npos ? 0 : end;
+}
+
+namespace {
+
+void append_u32(std::string& out, size_t value) {
+    auto v = static_cast<uint32_t>(value);
+    out.append(reinterpret_cast<const char*>(&v), sizeof(v));
+}
+
+}  // namespace
+
+std::string Parser::serialize_raw(const Command& cmd) {
+    size_t size = 8 + cmd.name.size();
+    for (const auto& arg : cmd.args) size += 4 + arg.size();
+    std::string frame;
+    frame.reserve(size);
+    append_u32(frame, cmd.name.size());
+    frame += cmd.name;
+    append_u32(frame, cmd.args.size());
+    for (const auto& arg : cmd.args) {
+        append_u32(frame, arg.size());
+        frame += arg;
+    }
+    return frame;
+}
+
+size_t Parser::raw_frame_length(const uint8_t* data, size_t length, size_t max_frame) {
+    // Each length is checked against the frame budget before it is used,
+    // so a corrupt one fails here instead of waiting for gigabytes of input
+    size_t offset = 0;
+    auto read_u32 = [&](size_t& value) {
+        if (offset + 4 > length) return false;
+        uint32_t v;
+        std::memcpy(&v, data + offset, 4);
+        offset += 4;
+        value = v;
+        return true;
+    };
+    auto skip = [&](size_t bytes) {
+        if (bytes > max_frame - std::min(offset, max_frame)) {
+            throw std::runtime_error("binary frame longer than " + std::to_string(max_frame) + " bytes");
+        }
+        offset += bytes;
+        return offset <= length;
+    };
+
+    size_t cmd_len = 0;
+    size_t argc = 0;
+    if (!read_u32(cmd_len) || !skip(cmd_len) || !read_u32(argc)) return 0;
+    // Every argument takes at least its 4-byte length
+    if (argc > max_frame / 4) throw std::runtime_error("binary frame has too many arguments");
+    for (size_t i = 0; i < argc; ++i) {
+        size_t arg_len = 0;
+        if (!read_u32(arg_len) || !skip(arg_len)) return 0;
+    }
+    return offset;
+}
+
 }  // namespace cacheforge
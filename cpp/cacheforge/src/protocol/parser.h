@@ -35,6 +35,30 @@ public:
     static std::string serialize_integer(int64_t value);
     static std::string serialize_null();
     static std::string serialize_array(const std::vector<std::string>& items);
+    // Array whose missing elements are sent as nulls (e.g. HMGET)
+    static std::string serialize_nullable_array(const std::vector<std::optional<std::string>>& items);
+    // Header for a nested array; the caller appends `count` serialized elements
+    static std::string serialize_array_header(size_t count);
+    // Out-of-band push message: >2\r\n<kind><array of items>
+    static std::string serialize_push(const std::string& kind, const std::vector<std::string>& items);
+    // Header for a push frame of `count` elements appended by the caller
+    static std::string serialize_push_header(size_t count);
+
+    // Client side: a request line in the text form parse_text() accepts
+    static std::string serialize_command(const Command& cmd);
+    // Client side: byte length of the first complete reply in data, or 0 if
+    // more input is needed. Throws std::runtime_error on malformed replies.
+    static size_t reply_length(const char* data, size_t length);
+
+    // Binary frames as parse_raw() reads them, streamed back to back by
+    // BULKLOAD: <cmd_len:4><cmd><argc:4>[<arg_len:4><arg>]..., lengths in
+    // host byte order
+    static constexpr size_t kMaxRawFrame = 512 * 1024 * 1024;
+    static std::string serialize_raw(const Command& cmd);
+    // Byte length of the first complete frame in data, or 0 if more input
+    // is needed. Throws std::runtime_error on a frame longer than
+    // `max_frame`, which can't be resynchronized with.
+    static size_t raw_frame_length(const uint8_t* data, size_t length, size_t max_frame = kMaxRawFrame);
 
 private:
     // Reads a length-prefixed string: <4-byte-length><data>
@@ -1,4 +1,5 @@
 #include "replication/replicator.h"
+#include "utils/cpu.h"
 #include <spdlog/spdlog.h>
 #include <limits>
 
@@ -25,7 +26,12 @@ uint64_t Replicator::next_sequence() {
 
 void Replicator::start() {
     running_.store(true);
-    worker_ = std::thread(&Replicator::run_loop, this);
+    worker_ = std::thread([this]() {
+        if (!cpus_.empty() && !cpu::pin_thread(cpus_)) {
+            spdlog::warn("Could not pin the replication thread to its CPUs");
+        }
+        run_loop();
+    });
 }
 
 void Replicator::stop() {
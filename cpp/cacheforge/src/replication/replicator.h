@@ -32,6 +32,8 @@ public:
 
     void start();
     void stop();
+    // CPUs the replication thread is pinned to when it starts; empty = any
+    void set_cpus(std::vector<int> cpus) { cpus_ = std::move(cpus); }
     bool is_connected() const { return connected_.load(); }
 
     size_t pending_count() const;
@@ -43,6 +45,7 @@ private:
     std::atomic<bool> connected_{false};
     std::atomic<bool> running_{false};
     std::thread worker_;
+    std::vector<int> cpus_;
 
     mutable std::mutex queue_mutex_;
     std::queue<ReplicationEvent> event_queue_;
@@ -0,0 +1,1679 @@
+#include "server/command_handler.h"
+#include <algorithm>
+#include <sstream>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <optional>
+#include <shared_mutex>
+#include <stdexcept>
+
+namespace cacheforge {
+
+namespace {
+
+// Upper bound keeps steady_clock deadlines far from overflow
+constexpr int64_t kMaxTtlSeconds = 100LL * 365 * 24 * 3600;
+
+const char* const kWrongType = "WRONGTYPE Operation against a key holding the wrong kind of value";
+
+std::string wrong_args(const std::string& name) {
+    return Parser::serialize_error("wrong number of arguments for '" + name + "' command");
+}
+
+std::optional<int64_t> parse_int(const std::string& s) {
+    int64_t v = 0;
+    auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), v);
+    if (ec != std::errc() || ptr != s.data() + s.size() || s.empty()) return std::nullopt;
+    return v;
+}
+
+std::optional<double> parse_double(const std::string& s) {
+    if (s == "+inf" || s == "inf") return HUGE_VAL;
+    if (s == "-inf") return -HUGE_VAL;
+    double v = 0;
+    auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), v);
+    if (ec != std::errc() || ptr != s.data() + s.size() || s.empty() || std::isnan(v)) {
+        return std::nullopt;
+    }
+    return v;
+}
+
+// Score bound with optional '(' prefix for an exclusive bound
+std::optional<double> parse_bound(const std::string& s, bool& exclusive) {
+    exclusive = !s.empty() && s[0] == '(';
+    return parse_double(exclusive ? s.substr(1) : s);
+}
+
+// Confirmation frame for (P)SUBSCRIBE and (P)UNSUBSCRIBE; a missing name is
+// sent as null, as when unsubscribing from nothing
+std::string subscription_reply(const char* kind, const std::optional<std::string>& name,
+                               size_t count) {
+    return Parser::serialize_push_header(3) + Parser::serialize_string(kind) +
+           (name ? Parser::serialize_string(*name) : Parser::serialize_null()) +
+           Parser::serialize_integer(static_cast<int64_t>(count));
+}
+
+std::string format_score(double score) {
+    if (std::isinf(score)) return score > 0 ? "inf" : "-inf";
+    char buf[32];
+    auto [ptr, ec] = std::to_chars(buf, buf + sizeof(buf), score);
+    return std::string(buf, ptr);
+}
+
+// Keys of the command this thread is running, hashed once by execute() or
+// bulk_load() before the handler is called
+thread_local const std::vector<HashedKey>* t_hashed = nullptr;
+
+// args[i] of a command with keys, which start at args[0]. Handlers take
+// the key's hash from here instead of computing it again; args that are
+// not the running command's own get hashed now.
+HashedKey key_arg(const std::vector<std::string>& args, size_t i) {
+    if (t_hashed && i < t_hashed->size() && (*t_hashed)[i].key.data() == args[i].data()) {
+        return (*t_hashed)[i];
+    }
+    return HashedKey(args[i]);
+}
+
+}  // namespace
+
+CommandHandler::CommandHandler(HashTable& table, ExpiryManager* expiry)
+    : table_(table), expiry_(expiry) {
+    commands_ = {
+        {"PING", {&CommandHandler::cmd_ping, 0, -1, 0, 0}},
+        {"GET", {&CommandHandler::cmd_get, kRead, 0, 0, 1}},
+        {"SET", {&CommandHandler::cmd_set, kWrite, 0, 0, 1, KeyspaceEvents::kString}},
+        {"DEL", {&CommandHandler::cmd_del, kWrite, 0, -1, 1}},
+        {"KEYS", {&CommandHandler::cmd_keys, kTouchesTable, -1, 0, 0}},
+        {"EXPIRE", {&CommandHandler::cmd_expire, kWrite, 0, 0, 1, KeyspaceEvents::kGeneric}},
+        {"TTL", {&CommandHandler::cmd_ttl, kRead, 0, 0, 1}},
+        {"INCR", {&CommandHandler::cmd_incr, kWrite, 0, 0, 1, KeyspaceEvents::kString}},
+        {"DECR", {&CommandHandler::cmd_decr, kWrite, 0, 0, 1, KeyspaceEvents::kString}},
+        {"INCRBY", {&CommandHandler::cmd_incrby, kWrite, 0, 0, 1, KeyspaceEvents::kString}},
+        {"DECRBY", {&CommandHandler::cmd_decrby, kWrite, 0, 0, 1, KeyspaceEvents::kString}},
+        {"INCRBYFLOAT", {&CommandHandler::cmd_incrbyfloat, kWrite, 0, 0, 1, KeyspaceEvents::kString}},
+        {"HSET", {&CommandHandler::cmd_hset, kWrite, 0, 0, 1, KeyspaceEvents::kHash}},
+        {"HGET", {&CommandHandler::cmd_hget, kRead, 0, 0, 1}},
+        {"HMGET", {&CommandHandler::cmd_hmget, kRead, 0, 0, 1}},
+        {"HINCRBY", {&CommandHandler::cmd_hincrby, kWrite, 0, 0, 1, KeyspaceEvents::kHash}},
+        {"ZADD", {&CommandHandler::cmd_zadd, kWrite, 0, 0, 1, KeyspaceEvents::kZset}},
+        {"ZRANGEBYSCORE", {&CommandHandler::cmd_zrangebyscore, kRead, 0, 0, 1}},
+        {"ZRANK", {&CommandHandler::cmd_zrank, kRead, 0, 0, 1}},
+        {"PFADD", {&CommandHandler::cmd_pfadd, kWrite, 0, 0, 1, KeyspaceEvents::kString}},
+        {"PFCOUNT", {&CommandHandler::cmd_pfcount, kRead, 0, -1, 1}},
+        {"PFMERGE", {&CommandHandler::cmd_pfmerge, kWrite, 0, -1, 1, KeyspaceEvents::kString}},
+        {"BF.RESERVE", {&CommandHandler::cmd_bf_reserve, kWrite, 0, 0, 1, KeyspaceEvents::kBloom}},
+        {"BF.ADD", {&CommandHandler::cmd_bf_add, kWrite, 0, 0, 1, KeyspaceEvents::kBloom}},
+        {"BF.MADD", {&CommandHandler::cmd_bf_madd, kWrite, 0, 0, 1, KeyspaceEvents::kBloom}},
+        {"BF.EXISTS", {&CommandHandler::cmd_bf_exists, kRead, 0, 0, 1}},
+        {"BF.MEXISTS", {&CommandHandler::cmd_bf_mexists, kRead, 0, 0, 1}},
+        {"BF.INFO", {&CommandHandler::cmd_bf_info, kRead, 0, 0, 1}},
+        {"CLIENT", {&CommandHandler::cmd_client, 0, -1, 0, 0}},
+        {"MULTI", {&CommandHandler::cmd_multi, 0, -1, 0, 0}},
+        {"EXEC", {&CommandHandler::cmd_exec, 0, -1, 0, 0}},
+        {"DISCARD", {&CommandHandler::cmd_discard, 0, -1, 0, 0}},
+        {"WATCH", {&CommandHandler::cmd_watch, 0, 0, -1, 1}},
+        {"UNWATCH", {&CommandHandler::cmd_unwatch, 0, -1, 0, 0}},
+        {"SUBSCRIBE", {&CommandHandler::cmd_subscribe, 0, -1, 0, 0}},
+        {"UNSUBSCRIBE", {&CommandHandler::cmd_unsubscribe, 0, -1, 0, 0}},
+        {"PSUBSCRIBE", {&CommandHandler::cmd_psubscribe, 0, -1, 0, 0}},
+        {"PUNSUBSCRIBE", {&CommandHandler::cmd_punsubscribe, 0, -1, 0, 0}},
+        {"PUBLISH", {&CommandHandler::cmd_publish, 0, -1, 0, 0}},
+        {"PUBSUB", {&CommandHandler::cmd_pubsub, 0, -1, 0, 0}},
+        {"ASKING", {&CommandHandler::cmd_asking, 0, -1, 0, 0}},
+        {"CLUSTER", {&CommandHandler::cmd_cluster, kTouchesTable, -1, 0, 0}},
+        {"RESTORE", {&CommandHandler::cmd_restore, kWrite, 0, 0, 1, KeyspaceEvents::kGeneric}},
+        {"BULKDUMP", {&CommandHandler::cmd_bulkdump, kTouchesTable, -1, 0, 0}},
+        {"HOTKEYS", {&CommandHandler::cmd_hotkeys, 0, -1, 0, 0}},
+        {"INFO", {&CommandHandler::cmd_info, kTouchesTable, -1, 0, 0}},
+        {"SLOWLOG", {&CommandHandler::cmd_slowlog, 0, -1, 0, 0}},
+        {"LATENCY", {&CommandHandler::cmd_latency, 0, -1, 0, 0}},
+        {"PROFILE", {&CommandHandler::cmd_profile, kTouchesTable, -1, 0, 0}},
+    };
+    for (auto& [name, spec] : commands_) {
+        spec.stat_index = stats_.register_command(name);
+    }
+    keyspace_events_.set_publisher([this](const std::string& channel, const std::string& message) {
+        if (push_callback_) pubsub_.publish(channel, message, push_callback_);
+    });
+}
+
+std::string CommandHandler::execute(const Command& cmd) {
+    ClientState anonymous;
+    return execute(cmd, anonymous);
+}
+
+std::string CommandHandler::execute(const Command& cmd, ClientState& client) {
+    std::string name = cmd.name;
+    std::transform(name.begin(), name.end(), name.begin(), ::toupper);
+
+    auto it = commands_.find(name);
+    if (it == commands_.end()) {
+        if (client.in_multi) client.multi_error = true;
+        return Parser::serialize_error("unknown command '" + cmd.name + "'");
+    }
+    const auto& spec = it->second;
+    auto keys = command_keys(spec, cmd.args);
+    // Hashed once here for routing, locking, lazy expiry, tracking, tiering
+    // and the handler itself (see key_arg)
+    auto hashed = hash_keys(spec, cmd.args);
+    std::shared_lock<std::shared_mutex> pinned;
+    std::optional<HashTable::ShardLockSet> migrating;
+    if (cluster_) {
+        // ASKING covers exactly one command
+        bool asking = client.asking;
+        client.asking = false;
+        // Inside EXEC the shards are already held, which keeps the migrator
+        // out just as well
+        if (!keys.empty() && !table_.holding_shards()) {
+            pinned = cluster_->pin_command();
+            // While the slot migrates, its keys' shards stay locked until the
+            // command is done, so the migrator can't drop a key between the
+            // check below and the command's write
+            if (cluster_->migrating_to(key_slot(keys[0]))) migrating.emplace(table_.lock_shards(hashed));
+        }
+        auto redirect = cluster_->route(keys, asking, [this](const std::string& key) {
+            return table_.contains(key);
+        });
+        if (redirect) {
+            if (client.in_multi) client.multi_error = true;
+            return *redirect;
+        }
+    }
+    if (load_progress_ && !keys.empty() && load_progress_->loading.load(std::memory_order_acquire)) {
+        // A missing key may simply not be loaded yet, and a write could be
+        // overwritten by the snapshot's copy
+        bool loaded = !(spec.flags & kWrite) &&
+                      std::all_of(hashed.begin(), hashed.end(),
+                                  [this](const HashedKey& hk) { return table_.contains(hk); });
+        if (!loaded) {
+            if (client.in_multi) client.multi_error = true;
+            return "-LOADING CacheForge is loading the dataset in memory\r\n";
+        }
+    }
+    if (client.in_multi && spec.fn != &CommandHandler::cmd_exec &&
+        spec.fn != &CommandHandler::cmd_discard && spec.fn != &CommandHandler::cmd_multi &&
+        spec.fn != &CommandHandler::cmd_watch) {
+        // SETSLOT MIGRATING waits for every command on keys to finish, and
+        // one blocked on a shard that EXEC holds never would
+        if (spec.fn == &CommandHandler::cmd_cluster && !cmd.args.empty()) {
+            std::string sub = cmd.args[0];
+            std::transform(sub.begin(), sub.end(), sub.begin(), ::toupper);
+            if (sub == "SETSLOT" || sub == "MIGRATE") {
+                client.multi_error = true;
+                return Parser::serialize_error("CLUSTER " + sub + " is not allowed in a transaction");
+            }
+        }
+        client.queued.push_back(cmd);
+        return "+QUEUED\r\n";
+    }
+
+    for (const auto& hk : hashed) {
+        hotkeys_.record(hk);
+        expire_if_needed(hk);
+        // Register the read before executing it: a write racing with this
+        // command then still produces an invalidation for this client
+        if ((spec.flags & kRead) && client.tracking) {
+            tracking_.track(hk, client.id);
+        }
+    }
+
+    stats_.record_call(spec.stat_index);
+    // The histograms are fed a sample; the slow log and the latency monitor
+    // must see every command, or they would miss most slow ones
+    const bool sampled = stats_.sample_latency();
+    const bool timed = sampled || slowlog_.threshold_us() >= 0 || latency_.threshold_us() > 0;
+    auto started = timed ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{};
+
+    const uint64_t dirty = client.dirty;
+    std::string reply;
+    // EXEC runs its commands through here, so keep the outer command's keys
+    const auto* outer = std::exchange(t_hashed, &hashed);
+    try {
+        reply = (this->*(spec.fn))(cmd.args, client);
+    } catch (const std::exception& e) {
+        reply = Parser::serialize_error(e.what());
+    }
+    t_hashed = outer;
+    migrating.reset();
+    if (pinned) pinned.unlock();
+
+    if (timed) {
+        auto elapsed = std::chrono::steady_clock::now() - started;
+        auto ns = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        if (sampled) stats_.record_latency(spec.stat_index, ns);
+        if (slowlog_.is_slow(ns / 1000)) {
+            slowlog_.record(name, cmd.args, client.addr, ns / 1000);
+        }
+        latency_.record("command", ns / 1000);
+    }
+
+    // A write that was refused or changed nothing leaves cached copies valid
+    if ((spec.flags & kWrite) && client.dirty != dirty) {
+        for (const auto& hk : hashed) tracking_.invalidate(hk);
+        notify_write(spec, name, keys);
+    }
+    if (tiering_) {
+        for (size_t i = 0; i < keys.size(); ++i) {
+            if (spec.flags & kWrite) {
+                tiering_->on_write(keys[i]);
+            } else if (spec.flags & kRead) {
+                tiering_->on_read(hashed[i]);
+            }
+        }
+    }
+    return reply;
+}
+
+// For writes whose handler bumped ClientState::dirty. Only the first key: the
+// other keys of a multi-key write are read (the sources of PFMERGE), and DEL
+// reports each key it removes itself
+void CommandHandler::notify_write(const CommandSpec& spec, const std::string& name,
+                                  const std::vector<std::string>& keys) {
+    if (keys.empty() || !keyspace_events_.wants(spec.events)) return;
+    std::string event = name;
+    std::transform(event.begin(), event.end(), event.begin(), ::tolower);
+    keyspace_events_.notify(spec.events, event, keys[0]);
+}
+
+void CommandHandler::invalidate_key(const std::string& key) {
+    tracking_.invalidate(key);
+}
+
+void CommandHandler::flush_invalidations() {
+    if (!push_callback_) return;
+    for (const auto& [client_id, keys] : tracking_.drain()) {
+        push_callback_(client_id, std::make_shared<const std::string>(
+                                      Parser::serialize_push("invalidate", keys)));
+    }
+}
+
+void CommandHandler::set_push_callback(PushCallback cb) {
+    push_callback_ = std::move(cb);
+}
+
+std::vector<std::string> CommandHandler::command_keys(const CommandSpec& spec, const Args& args) const {
+    std::vector<std::string> keys;
+    if (spec.first_key < 0) return keys;
+    int last = spec.last_key < 0 ? static_cast<int>(args.size()) + spec.last_key : spec.last_key;
+    for (int i = spec.first_key; i <= last && i < static_cast<int>(args.size()); i += spec.key_step) {
+        keys.push_back(args[i]);
+    }
+    return keys;
+}
+
+std::vector<HashedKey> CommandHandler::hash_keys(const CommandSpec& spec, const Args& args) const {
+    std::vector<HashedKey> hashed;
+    if (spec.first_key < 0) return hashed;
+    int last = spec.last_key < 0 ? static_cast<int>(args.size()) + spec.last_key : spec.last_key;
+    for (int i = spec.first_key; i <= last && i < static_cast<int>(args.size()); i += spec.key_step) {
+        hashed.emplace_back(args[i]);
+    }
+    return hashed;
+}
+
+bool CommandHandler::lookup(const HashedKey& hk, const std::function<void(const Value&)>& fn) {
+    bool found = table_.view(hk, fn);
+    stats_.add(found ? Stats::kKeyspaceHits : Stats::kKeyspaceMisses);
+    return found;
+}
+
+// Lazy expiry: a key whose deadline has passed is removed before any
+// command sees it, even if the background expiry thread has not run yet
+void CommandHandler::expire_if_needed(const HashedKey& hk) {
+    if (!expiry_) return;
+    bool removed;
+    if (expiry_->bound_to(table_)) {
+        // Checked and removed in one locked step, so a key another client
+        // rewrote since its deadline passed is left alone
+        removed = table_.remove_if_expired(hk, Clock::now());
+        if (!removed) return;
+    } else {
+        if (!expiry_->is_expired(hk)) return;
+        expiry_->remove_expiry(hk);
+        removed = table_.remove(hk);
+    }
+    if (removed) {
+        stats_.add(Stats::kExpiredKeys);
+        keyspace_events_.notify(KeyspaceEvents::kExpired, "expired", std::string(hk.key));
+    }
+    tracking_.invalidate(hk);
+}
+
+void CommandHandler::store_with_ttl(const HashedKey& key, Value value,
+                                    std::optional<std::chrono::milliseconds> ttl) {
+    if (expiry_ && expiry_->bound_to(table_)) {
+        std::optional<TimePoint> deadline;
+        if (ttl) deadline = Clock::now() + *ttl;
+        table_.set_with_expiry(key, std::move(value), deadline);
+        return;
+    }
+    table_.set(key, std::move(value));
+    if (expiry_) {
+        if (ttl) {
+            // Standalone deadlines are kept to the second; round up so a
+            // key never expires early
+            expiry_->set_expiry(key, std::chrono::ceil<std::chrono::seconds>(*ttl));
+        } else {
+            expiry_->remove_expiry(key);
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Strings
+// ---------------------------------------------------------------------------
+
+std::string CommandHandler::cmd_ping(const Args& args, ClientState& /*client*/) {
+    if (args.empty()) return "+PONG\r\n";
+    return Parser::serialize_string(args[0]);
+}
+
+std::string CommandHandler::cmd_get(const Args& args, ClientState& /*client*/) {
+    if (args.size() != 1) return wrong_args("get");
+
+    std::string reply = Parser::serialize_null();
+    lookup(key_arg(args, 0), [&reply](const Value& v) {
+        if (v.type() == Value::Type::Integer) {
+            reply = Parser::serialize_string(std::to_string(v.as_integer()));
+            return;
+        }
+        if (v.type() != Value::Type::String) {
+            reply = Parser::serialize_error(kWrongType);
+            return;
+        }
+        reply = Parser::serialize_string(v.as_string());
+    });
+    return reply;
+}
+
+std::string CommandHandler::cmd_set(const Args& args, ClientState& client) {
+    // SET key value [EX seconds]
+    if (args.size() != 2 && args.size() != 4) return wrong_args("set");
+
+    std::optional<int64_t> ttl;
+    if (args.size() == 4) {
+        std::string opt = args[2];
+        std::transform(opt.begin(), opt.end(), opt.begin(), ::toupper);
+        if (opt != "EX") return Parser::serialize_error("syntax error");
+        ttl = parse_int(args[3]);
+        if (!ttl || *ttl <= 0 || *ttl > kMaxTtlSeconds) {
+            return Parser::serialize_error("invalid expire time in 'set' command");
+        }
+    }
+
+    std::optional<std::chrono::milliseconds> expire_in;
+    if (ttl) expire_in = std::chrono::seconds(*ttl);
+    store_with_ttl(key_arg(args, 0), Value(args[1]), expire_in);
+    client.dirty++;
+    return Parser::serialize_ok();
+}
+
+std::string CommandHandler::cmd_del(const Args& args, ClientState& client) {
+    if (args.empty()) return wrong_args("del");
+    int64_t removed = 0;
+    for (size_t i = 0; i < args.size(); ++i) {
+        HashedKey key = key_arg(args, i);
+        if (table_.remove(key)) {
+            removed++;
+            client.dirty++;
+            keyspace_events_.notify(KeyspaceEvents::kGeneric, "del", args[i]);
+        }
+        if (expiry_) expiry_->remove_expiry(key);
+    }
+    return Parser::serialize_integer(removed);
+}
+
+std::string CommandHandler::cmd_keys(const Args& args, ClientState& /*client*/) {
+    if (args.size() != 1) return wrong_args("keys");
+    return Parser::serialize_array(table_.keys(args[0]));
+}
+
+// ---------------------------------------------------------------------------
+// Expiry
+// ---------------------------------------------------------------------------
+
+std::string CommandHandler::cmd_expire(const Args& args, ClientState& client) {
+    if (args.size() != 2) return wrong_args("expire");
+    auto ttl = parse_int(args[1]);
+    if (!ttl || *ttl <= 0 || *ttl > kMaxTtlSeconds) {
+        return Parser::serialize_error("invalid expire time in 'expire' command");
+    }
+    HashedKey key = key_arg(args, 0);
+    if (!expiry_ || !table_.contains(key)) return Parser::serialize_integer(0);
+    expiry_->set_expiry(key, std::chrono::seconds(*ttl));
+    client.dirty++;
+    return Parser::serialize_integer(1);
+}
+
+std::string CommandHandler::cmd_ttl(const Args& args, ClientState& /*client*/) {
+    if (args.size() != 1) return wrong_args("ttl");
+    HashedKey key = key_arg(args, 0);
+    if (!table_.contains(key)) return Parser::serialize_integer(-2);
+    if (!expiry_) return Parser::serialize_integer(-1);
+    return Parser::serialize_integer(expiry_->get_ttl(key).count());
+}
+
+// ---------------------------------------------------------------------------
+// Counters
+// ---------------------------------------------------------------------------
+
+std::string CommandHandler::cmd_incr(const Args& args, ClientState& client) {
+    if (args.size() != 1) return wrong_args("incr");
+    return incr_by(key_arg(args, 0), 1, client);
+}
+
+std::string CommandHandler::cmd_decr(const Args& args, ClientState& client) {
+    if (args.size() != 1) return wrong_args("decr");
+    return incr_by(key_arg(args, 0), -1, client);
+}
+
+std::string CommandHandler::cmd_incrby(const Args& args, ClientState& client) {
+    if (args.size() != 2) return wrong_args("incrby");
+    auto delta = parse_int(args[1]);
+    if (!delta) return Parser::serialize_error("value is not an integer or out of range");
+    return incr_by(key_arg(args, 0), *delta, client);
+}
+
+std::string CommandHandler::cmd_decrby(const Args& args, ClientState& client) {
+    if (args.size() != 2) return wrong_args("decrby");
+    auto delta = parse_int(args[1]);
+    if (!delta || *delta == INT64_MIN) {
+        return Parser::serialize_error("value is not an integer or out of range");
+    }
+    return incr_by(key_arg(args, 0), -*delta, client);
+}
+
+// The counter is updated in place under the table's write lock, so
+// concurrent INCRs on the same key never lose updates. A numeric string is
+// converted to an Integer value on first use so later increments skip parsing.
+std::string CommandHandler::incr_by(const HashedKey& key, int64_t delta, ClientState& client) {
+    std::string reply;
+    bool modified = table_.update(key, [&](Value& v, bool created) {
+        if (created) v = Value(int64_t(0));
+
+        auto current = v.to_integer();
+        if (!current) {
+            reply = v.type() == Value::Type::String || v.type() == Value::Type::Integer
+                        ? Parser::serialize_error("value is not an integer or out of range")
+                        : Parser::serialize_error(kWrongType);
+            return false;
+        }
+
+        int64_t result;
+        if (__builtin_add_overflow(*current, delta, &result)) {
+            reply = Parser::serialize_error("increment or decrement would overflow");
+            return false;
+        }
+        v = Value(result);
+        reply = Parser::serialize_integer(result);
+        return true;
+    });
+    if (modified) client.dirty++;
+    return reply;
+}
+
+std::string CommandHandler::cmd_incrbyfloat(const Args& args, ClientState& client) {
+    if (args.size() != 2) return wrong_args("incrbyfloat");
+    auto delta = parse_double(args[1]);
+    if (!delta || std::isinf(*delta)) return Parser::serialize_error("value is not a valid float");
+
+    std::string reply;
+    bool modified = table_.update(key_arg(args, 0), [&](Value& v, bool created) {
+        if (created) v = Value(int64_t(0));
+
+        auto current = v.to_double();
+        if (!current) {
+            reply = v.type() == Value::Type::String
+                        ? Parser::serialize_error("value is not a valid float")
+                        : Parser::serialize_error(kWrongType);
+            return false;
+        }
+
+        double result = *current + *delta;
+        if (!std::isfinite(result)) {
+            reply = Parser::serialize_error("increment would produce NaN or Infinity");
+            return false;
+        }
+        // Floats are stored as their string form, like Redis
+        std::string formatted = format_score(result);
+        v = Value(formatted);
+        reply = Parser::serialize_string(formatted);
+        return true;
+    });
+    if (modified) client.dirty++;
+    return reply;
+}
+
+// ---------------------------------------------------------------------------
+// Hashes
+// ---------------------------------------------------------------------------
+
+std::string CommandHandler::cmd_hset(const Args& args, ClientState& client) {
+    if (args.size() < 3 || args.size() % 2 == 0) return wrong_args("hset");
+
+    std::string reply;
+    bool modified = table_.update(key_arg(args, 0), [&](Value& v, bool created) {
+        if (created) v = Value(HashObject{});
+        if (v.type() != Value::Type::Hash) {
+            reply = Parser::serialize_error(kWrongType);
+            return false;
+        }
+        auto& hash = v.as_hash();
+        int64_t added = 0;
+        for (size_t i = 1; i < args.size(); i += 2) {
+            if (hash.set(args[i], args[i + 1])) added++;
+        }
+        reply = Parser::serialize_integer(added);
+        return true;
+    });
+    if (modified) client.dirty++;
+    return reply;
+}
+
+std::string CommandHandler::cmd_hget(const Args& args, ClientState& /*client*/) {
+    if (args.size() != 2) return wrong_args("hget");
+
+    std::string reply = Parser::serialize_null();
+    lookup(key_arg(args, 0), [&](const Value& v) {
+        if (v.type() != Value::Type::Hash) {
+            reply = Parser::serialize_error(kWrongType);
+            return;
+        }
+        if (auto field = v.as_hash().get(args[1])) {
+            reply = Parser::serialize_string(*field);
+        }
+    });
+    return reply;
+}
+
+std::string CommandHandler::cmd_hmget(const Args& args, ClientState& /*client*/) {
+    if (args.size() < 2) return wrong_args("hmget");
+
+    std::vector<std::optional<std::string>> fields(args.size() - 1);
+    std::string error;
+    lookup(key_arg(args, 0), [&](const Value& v) {
+        if (v.type() != Value::Type::Hash) {
+            error = Parser::serialize_error(kWrongType);
+            return;
+        }
+        const auto& hash = v.as_hash();
+        for (size_t i = 1; i < args.size(); ++i) {
+            fields[i - 1] = hash.get(args[i]);
+        }
+    });
+    if (!error.empty()) return error;
+    return Parser::serialize_nullable_array(fields);
+}
+
+std::string CommandHandler::cmd_hincrby(const Args& args, ClientState& client) {
+    if (args.size() != 3) return wrong_args("hincrby");
+    auto delta = parse_int(args[2]);
+    if (!delta) return Parser::serialize_error("value is not an integer or out of range");
+
+    std::string reply;
+    bool modified = table_.update(key_arg(args, 0), [&](Value& v, bool created) {
+        if (created) v = Value(HashObject{});
+        if (v.type() != Value::Type::Hash) {
+            reply = Parser::serialize_error(kWrongType);
+            return false;
+        }
+        reply = Parser::serialize_integer(v.as_hash().increment(args[1], *delta));
+        return true;
+    });
+    if (modified) client.dirty++;
+    return reply;
+}
+
+// ---------------------------------------------------------------------------
+// Sorted sets
+// ---------------------------------------------------------------------------
+
+std::string CommandHandler::cmd_zadd(const Args& args, ClientState& client) {
+    if (args.size() < 3 || args.size() % 2 == 0) return wrong_args("zadd");
+
+    // Validate every score before touching the set so a bad pair is atomic
+    std::vector<double> scores;
+    for (size_t i = 1; i < args.size(); i += 2) {
+        auto score = parse_double(args[i]);
+        if (!score) return Parser::serialize_error("value is not a valid float");
+        scores.push_back(*score);
+    }
+
+    std::string reply;
+    bool modified = table_.update(key_arg(args, 0), [&](Value& v, bool created) {
+        if (created) v = Value(SortedSet{});
+        if (v.type() != Value::Type::SortedSet) {
+            reply = Parser::serialize_error(kWrongType);
+            return false;
+        }
+        auto& zset = v.as_sorted_set();
+        int64_t added = 0;
+        for (size_t i = 1; i < args.size(); i += 2) {
+            if (zset.add(args[i + 1], scores[i / 2])) added++;
+        }
+        reply = Parser::serialize_integer(added);
+        return true;
+    });
+    if (modified) client.dirty++;
+    return reply;
+}
+
+std::string CommandHandler::cmd_zrangebyscore(const Args& args, ClientState& /*client*/) {
+    // ZRANGEBYSCORE key min max [WITHSCORES] [LIMIT offset count]
+    if (args.size() < 3) return wrong_args("zrangebyscore");
+
+    ScoreRange range{};
+    auto min = parse_bound(args[1], range.min_exclusive);
+    auto max = parse_bound(args[2], range.max_exclusive);
+    if (!min || !max) return Parser::serialize_error("min or max is not a float");
+    range.min = *min;
+    range.max = *max;
+
+    bool with_scores = false;
+    size_t offset = 0;
+    size_t limit = SIZE_MAX;
+    for (size_t i = 3; i < args.size(); ++i) {
+        std::string opt = args[i];
+        std::transform(opt.begin(), opt.end(), opt.begin(), ::toupper);
+        if (opt == "WITHSCORES") {
+            with_scores = true;
+        } else if (opt == "LIMIT" && i + 2 < args.size()) {
+            auto off = parse_int(args[i + 1]);
+            auto count = parse_int(args[i + 2]);
+            if (!off || !count || *off < 0) {
+                return Parser::serialize_error("value is not an integer or out of range");
+            }
+            offset = static_cast<size_t>(*off);
+            limit = *count < 0 ? SIZE_MAX : static_cast<size_t>(*count);
+            i += 2;
+        } else {
+            return Parser::serialize_error("syntax error");
+        }
+    }
+
+    std::vector<std::string> items;
+    std::string error;
+    lookup(key_arg(args, 0), [&](const Value& v) {
+        if (v.type() != Value::Type::SortedSet) {
+            error = Parser::serialize_error(kWrongType);
+            return;
+        }
+        for (const auto& [member, score] : v.as_sorted_set().range_by_score(range, offset, limit)) {
+            items.push_back(member);
+            if (with_scores) items.push_back(format_score(score));
+        }
+    });
+    if (!error.empty()) return error;
+    return Parser::serialize_array(items);
+}
+
+std::string CommandHandler::cmd_zrank(const Args& args, ClientState& /*client*/) {
+    if (args.size() != 2) return wrong_args("zrank");
+
+    std::string reply = Parser::serialize_null();
+    lookup(key_arg(args, 0), [&](const Value& v) {
+        if (v.type() != Value::Type::SortedSet) {
+            reply = Parser::serialize_error(kWrongType);
+            return;
+        }
+        if (auto rank = v.as_sorted_set().rank(args[1])) {
+            reply = Parser::serialize_integer(static_cast<int64_t>(*rank));
+        }
+    });
+    return reply;
+}
+
+// ---------------------------------------------------------------------------
+// HyperLogLog and Bloom filters
+// ---------------------------------------------------------------------------
+
+std::string CommandHandler::cmd_pfadd(const Args& args, ClientState& client) {
+    // PFADD key [element ...] -> 1 if the estimate may have changed
+    if (args.empty()) return wrong_args("pfadd");
+
+    std::string reply;
+    bool modified = table_.update(key_arg(args, 0), [&](Value& v, bool created) {
+        if (created) v = Value(HyperLogLog{});
+        if (v.type() != Value::Type::HyperLogLog) {
+            reply = Parser::serialize_error(kWrongType);
+            return false;
+        }
+        auto& hll = v.as_hyperloglog();
+        bool changed = created;
+        for (size_t i = 1; i < args.size(); ++i) {
+            if (hll.add(args[i])) changed = true;
+        }
+        reply = Parser::serialize_integer(changed ? 1 : 0);
+        return changed;
+    });
+    if (modified) client.dirty++;
+    return reply;
+}
+
+std::string CommandHandler::cmd_pfcount(const Args& args, ClientState& /*client*/) {
+    // PFCOUNT key [key ...] -> estimated size of the union
+    if (args.empty()) return wrong_args("pfcount");
+
+    std::string error;
+    auto check = [&](const Value& v) {
+        if (v.type() == Value::Type::HyperLogLog) return true;
+        error = Parser::serialize_error(kWrongType);
+        return false;
+    };
+    if (args.size() == 1) {
+        uint64_t count = 0;
+        lookup(key_arg(args, 0), [&](const Value& v) {
+            if (check(v)) count = v.as_hyperloglog().count();
+        });
+        if (!error.empty()) return error;
+        return Parser::serialize_integer(static_cast<int64_t>(count));
+    }
+    HyperLogLog merged;
+    for (size_t i = 0; i < args.size(); ++i) {
+        lookup(key_arg(args, i), [&](const Value& v) {
+            if (check(v)) merged.merge(v.as_hyperloglog());
+        });
+        if (!error.empty()) return error;
+    }
+    return Parser::serialize_integer(static_cast<int64_t>(merged.count()));
+}
+
+std::string CommandHandler::cmd_pfmerge(const Args& args, ClientState& client) {
+    // PFMERGE destkey [sourcekey ...]; the destination's own registers
+    // count as one of the sources
+    if (args.empty()) return wrong_args("pfmerge");
+
+    HyperLogLog merged;
+    std::string error;
+    for (size_t i = 1; i < args.size(); ++i) {
+        lookup(key_arg(args, i), [&](const Value& v) {
+            if (v.type() != Value::Type::HyperLogLog) {
+                error = Parser::serialize_error(kWrongType);
+                return;
+            }
+            merged.merge(v.as_hyperloglog());
+        });
+        if (!error.empty()) return error;
+    }
+    std::string reply = Parser::serialize_ok();
+    bool modified = table_.update(key_arg(args, 0), [&](Value& v, bool created) {
+        if (created) {
+            v = Value(std::move(merged));
+        } else if (v.type() != Value::Type::HyperLogLog) {
+            reply = Parser::serialize_error(kWrongType);
+            return false;
+        } else {
+            v.as_hyperloglog().merge(merged);
+        }
+        return true;
+    });
+    if (modified) client.dirty++;
+    return reply;
+}
+
+namespace {
+
+// BF.* replies as RedisBloom gives them: 1 for added/present, 0 otherwise
+std::string serialize_flags(const std::vector<bool>& flags) {
+    std::string reply = Parser::serialize_array_header(flags.size());
+    for (bool flag : flags) reply += Parser::serialize_integer(flag ? 1 : 0);
+    return reply;
+}
+
+}  // namespace
+
+std::string CommandHandler::cmd_bf_reserve(const Args& args, ClientState& client) {
+    // BF.RESERVE key error_rate capacity
+    if (args.size() != 3) return wrong_args("bf.reserve");
+    auto error_rate = parse_double(args[1]);
+    if (!error_rate || *error_rate <= 0 || *error_rate >= 1) {
+        return Parser::serialize_error("error rate must be between 0 and 1, exclusive");
+    }
+    auto capacity = parse_int(args[2]);
+    if (!capacity || *capacity <= 0) return Parser::serialize_error("capacity must be a positive integer");
+
+    std::string reply = Parser::serialize_ok();
+    bool modified = table_.update(key_arg(args, 0), [&](Value& v, bool created) {
+        if (!created) {
+            reply = Parser::serialize_error("item exists");
+            return false;
+        }
+        v = Value(BloomFilter(*error_rate, static_cast<uint64_t>(*capacity)));
+        return true;
+    });
+    if (modified) client.dirty++;
+    return reply;
+}
+
+std::string CommandHandler::cmd_bf_add(const Args& args, ClientState& client) {
+    // BF.ADD key item; a missing key gets a filter with the default error
+    // rate and capacity
+    if (args.size() != 2) return wrong_args("bf.add");
+    auto reply = cmd_bf_madd(args, client);
+    if (reply[0] == '-') return reply;
+    return reply.substr(reply.find("\r\n") + 2);  // the one element
+}
+
+std::string CommandHandler::cmd_bf_madd(const Args& args, ClientState& client) {
+    // BF.MADD key item [item ...]
+    if (args.size() < 2) return wrong_args("bf.madd");
+
+    std::string reply;
+    bool modified = table_.update(key_arg(args, 0), [&](Value& v, bool created) {
+        if (created) v = Value(BloomFilter{});
+        if (v.type() != Value::Type::Bloom) {
+            reply = Parser::serialize_error(kWrongType);
+            return false;
+        }
+        auto& bloom = v.as_bloom();
+        std::vector<bool> added;
+        for (size_t i = 1; i < args.size(); ++i) added.push_back(bloom.add(args[i]));
+        reply = serialize_flags(added);
+        return created || std::find(added.begin(), added.end(), true) != added.end();
+    });
+    if (modified) client.dirty++;
+    return reply;
+}
+
+std::string CommandHandler::cmd_bf_exists(const Args& args, ClientState& client) {
+    // BF.EXISTS key item
+    if (args.size() != 2) return wrong_args("bf.exists");
+    auto reply = cmd_bf_mexists(args, client);
+    if (reply[0] == '-') return reply;
+    return reply.substr(reply.find("\r\n") + 2);
+}
+
+std::string CommandHandler::cmd_bf_mexists(const Args& args, ClientState& /*client*/) {
+    // BF.MEXISTS key item [item ...]; every item is absent from a missing key
+    if (args.size() < 2) return wrong_args("bf.mexists");
+
+    std::vector<bool> present(args.size() - 1, false);
+    std::string error;
+    lookup(key_arg(args, 0), [&](const Value& v) {
+        if (v.type() != Value::Type::Bloom) {
+            error = Parser::serialize_error(kWrongType);
+            return;
+        }
+        for (size_t i = 1; i < args.size(); ++i) present[i - 1] = v.as_bloom().contains(args[i]);
+    });
+    if (!error.empty()) return error;
+    return serialize_flags(present);
+}
+
+std::string CommandHandler::cmd_bf_info(const Args& args, ClientState& /*client*/) {
+    // BF.INFO key -> Capacity, Size (bytes), Number of filters, Number of
+    // items inserted, Error rate
+    if (args.size() != 1) return wrong_args("bf.info");
+
+    std::string reply;
+    bool found = lookup(key_arg(args, 0), [&](const Value& v) {
+        if (v.type() != Value::Type::Bloom) {
+            reply = Parser::serialize_error(kWrongType);
+            return;
+        }
+        const auto& bloom = v.as_bloom();
+        reply = Parser::serialize_array_header(10) +
+                Parser::serialize_string("Capacity") +
+                Parser::serialize_integer(static_cast<int64_t>(bloom.capacity())) +
+                Parser::serialize_string("Size") +
+                Parser::serialize_integer(static_cast<int64_t>(bloom.memory_size())) +
+                Parser::serialize_string("Number of filters") +
+                Parser::serialize_integer(static_cast<int64_t>(bloom.layers())) +
+                Parser::serialize_string("Number of items inserted") +
+                Parser::serialize_integer(static_cast<int64_t>(bloom.size())) +
+                Parser::serialize_string("Error rate") +
+                Parser::serialize_string(format_score(bloom.error_rate()));
+    });
+    if (!found) return Parser::serialize_error("not found");
+    return reply;
+}
+
+// ---------------------------------------------------------------------------
+// Connection
+// ---------------------------------------------------------------------------
+
+std::string CommandHandler::cmd_client(const Args& args, ClientState& client) {
+    if (args.empty()) return wrong_args("client");
+    std::string sub = args[0];
+    std::transform(sub.begin(), sub.end(), sub.begin(), ::toupper);
+
+    if (sub == "ID" && args.size() == 1) {
+        return Parser::serialize_integer(static_cast<int64_t>(client.id));
+    }
+    if (sub == "TRACKING" && args.size() == 2) {
+        std::string mode = args[1];
+        std::transform(mode.begin(), mode.end(), mode.begin(), ::toupper);
+        if (mode == "ON") {
+            if (!client.tracking) tracking_.add_client();
+            client.tracking = true;
+        } else if (mode == "OFF") {
+            if (client.tracking) tracking_.forget_client(client.id);
+            client.tracking = false;
+        } else {
+            return Parser::serialize_error("syntax error");
+        }
+        return Parser::serialize_ok();
+    }
+    return Parser::serialize_error("unknown subcommand or wrong number of arguments for 'client'");
+}
+
+// ---------------------------------------------------------------------------
+// Transactions
+// ---------------------------------------------------------------------------
+
+std::string CommandHandler::cmd_multi(const Args& /*args*/, ClientState& client) {
+    if (client.in_multi) return Parser::serialize_error("MULTI calls can not be nested");
+    client.in_multi = true;
+    return Parser::serialize_ok();
+}
+
+// Runs the queued commands with the shards of every key they (or WATCH)
+// touch locked, so no other client observes or changes those keys midway.
+// Commands that read the table beyond their keys (kTouchesTable) lock all
+// of it; ones that never touch it, like PING or PUBLISH, lock nothing.
+std::string CommandHandler::cmd_exec(const Args& /*args*/, ClientState& client) {
+    if (!client.in_multi) return Parser::serialize_error("EXEC without MULTI");
+
+    std::vector<Command> queued = std::move(client.queued);
+    auto watched = std::move(client.watched);
+    bool aborted = client.multi_error;
+    client.in_multi = false;
+    client.multi_error = false;
+    client.queued.clear();
+    client.watched.clear();
+    if (aborted) {
+        return Parser::serialize_error("EXECABORT Transaction discarded because of previous errors.");
+    }
+
+    std::vector<std::string> lock_keys;
+    bool lock_all = false;
+    for (const auto& [key, version] : watched) lock_keys.push_back(key);
+    for (const auto& cmd : queued) {
+        std::string name = cmd.name;
+        std::transform(name.begin(), name.end(), name.begin(), ::toupper);
+        const auto& spec = commands_.at(name);
+        if (spec.flags & kTouchesTable) {
+            lock_all = true;
+            break;
+        }
+        for (auto& key : command_keys(spec, cmd.args)) lock_keys.push_back(std::move(key));
+    }
+
+    auto locked = table_.lock_shards(lock_keys, lock_all);
+    for (const auto& [key, version] : watched) {
+        if (table_.version(key) != version) return "*-1\r\n";
+    }
+
+    std::string reply = Parser::serialize_array_header(queued.size());
+    for (const auto& cmd : queued) {
+        reply += execute(cmd, client);
+    }
+    return reply;
+}
+
+std::string CommandHandler::cmd_discard(const Args& /*args*/, ClientState& client) {
+    if (!client.in_multi) return Parser::serialize_error("DISCARD without MULTI");
+    client.in_multi = false;
+    client.multi_error = false;
+    client.queued.clear();
+    client.watched.clear();
+    return Parser::serialize_ok();
+}
+
+std::string CommandHandler::cmd_watch(const Args& args, ClientState& client) {
+    if (args.empty()) return wrong_args("watch");
+    if (client.in_multi) return Parser::serialize_error("WATCH inside MULTI is not allowed");
+    for (size_t i = 0; i < args.size(); ++i) {
+        client.watched.emplace_back(args[i], table_.version(key_arg(args, i)));
+    }
+    return Parser::serialize_ok();
+}
+
+std::string CommandHandler::cmd_unwatch(const Args& /*args*/, ClientState& client) {
+    client.watched.clear();
+    return Parser::serialize_ok();
+}
+
+// ---------------------------------------------------------------------------
+// Pub/sub
+// ---------------------------------------------------------------------------
+
+std::string CommandHandler::cmd_subscribe(const Args& args, ClientState& client) {
+    if (args.empty()) return wrong_args("subscribe");
+    std::string reply;
+    for (const auto& channel : args) {
+        client.subscriptions = pubsub_.subscribe(client.id, channel);
+        reply += subscription_reply("subscribe", channel, client.subscriptions);
+    }
+    return reply;
+}
+
+std::string CommandHandler::cmd_unsubscribe(const Args& args, ClientState& client) {
+    auto channels = args.empty() ? pubsub_.channels_of(client.id) : args;
+    if (channels.empty()) return subscription_reply("unsubscribe", std::nullopt, client.subscriptions);
+    std::string reply;
+    for (const auto& channel : channels) {
+        client.subscriptions = pubsub_.unsubscribe(client.id, channel);
+        reply += subscription_reply("unsubscribe", channel, client.subscriptions);
+    }
+    return reply;
+}
+
+std::string CommandHandler::cmd_psubscribe(const Args& args, ClientState& client) {
+    if (args.empty()) return wrong_args("psubscribe");
+    std::string reply;
+    for (const auto& pattern : args) {
+        client.subscriptions = pubsub_.psubscribe(client.id, pattern);
+        reply += subscription_reply("psubscribe", pattern, client.subscriptions);
+    }
+    return reply;
+}
+
+std::string CommandHandler::cmd_punsubscribe(const Args& args, ClientState& client) {
+    auto patterns = args.empty() ? pubsub_.patterns_of(client.id) : args;
+    if (patterns.empty()) return subscription_reply("punsubscribe", std::nullopt, client.subscriptions);
+    std::string reply;
+    for (const auto& pattern : patterns) {
+        client.subscriptions = pubsub_.punsubscribe(client.id, pattern);
+        reply += subscription_reply("punsubscribe", pattern, client.subscriptions);
+    }
+    return reply;
+}
+
+std::string CommandHandler::cmd_publish(const Args& args, ClientState& /*client*/) {
+    if (args.size() != 2) return wrong_args("publish");
+    size_t receivers = pubsub_.publish(args[0], args[1], push_callback_);
+    return Parser::serialize_integer(static_cast<int64_t>(receivers));
+}
+
+std::string CommandHandler::cmd_pubsub(const Args& args, ClientState& /*client*/) {
+    if (args.empty()) return wrong_args("pubsub");
+    std::string sub = args[0];
+    std::transform(sub.begin(), sub.end(), sub.begin(), ::toupper);
+
+    if (sub == "CHANNELS" && args.size() <= 2) {
+        return Parser::serialize_array(pubsub_.active_channels(args.size() == 2 ? args[1] : ""));
+    }
+    if (sub == "NUMSUB") {
+        std::string reply = Parser::serialize_array_header(2 * (args.size() - 1));
+        for (size_t i = 1; i < args.size(); ++i) {
+            reply += Parser::serialize_string(args[i]);
+            reply += Parser::serialize_integer(static_cast<int64_t>(pubsub_.num_subscribers(args[i])));
+        }
+        return reply;
+    }
+    if (sub == "NUMPAT" && args.size() == 1) {
+        return Parser::serialize_integer(static_cast<int64_t>(pubsub_.num_patterns()));
+    }
+    return Parser::serialize_error("unknown subcommand or wrong number of arguments for 'pubsub'");
+}
+
+// ---------------------------------------------------------------------------
+// Cluster
+// ---------------------------------------------------------------------------
+
+std::string CommandHandler::cmd_asking(const Args& args, ClientState& client) {
+    if (!args.empty()) return wrong_args("asking");
+    if (!cluster_) return Parser::serialize_error("This instance has cluster support disabled");
+    client.asking = true;
+    return Parser::serialize_ok();
+}
+
+std::string CommandHandler::cmd_cluster(const Args& args, ClientState& /*client*/) {
+    // CLUSTER KEYSLOT key | INFO | SLOTS | NODES | COUNTKEYSINSLOT slot |
+    //   GETKEYSINSLOT slot count | SETSLOT slot IMPORTING|MIGRATING|NODE node |
+    //   SETSLOT slot STABLE | MIGRATE slot node
+    if (args.empty()) return wrong_args("cluster");
+    std::string sub = args[0];
+    std::transform(sub.begin(), sub.end(), sub.begin(), ::toupper);
+
+    if (sub == "KEYSLOT" && args.size() == 2) {
+        return Parser::serialize_integer(key_slot(args[1]));
+    }
+    if (!cluster_) return Parser::serialize_error("This instance has cluster support disabled");
+
+    std::optional<uint16_t> slot;
+    if (args.size() >= 2) {
+        auto n = parse_int(args[1]);
+        if (n && *n >= 0 && *n < static_cast<int64_t>(ClusterState::kSlots)) {
+            slot = static_cast<uint16_t>(*n);
+        }
+    }
+    auto in_slot = [&slot](const std::string& key) { return key_slot(key) == *slot; };
+
+    if (sub == "INFO" && args.size() == 1) {
+        size_t assigned = 0;
+        for (const auto& range : cluster_->ranges()) assigned += range.last - range.first + 1;
+        std::ostringstream out;
+        out << "cluster_enabled:1\r\n"
+            << "cluster_state:" << (assigned == ClusterState::kSlots ? "ok" : "fail") << "\r\n"
+            << "cluster_slots_assigned:" << assigned << "\r\n"
+            << "cluster_known_nodes:" << cluster_->nodes().size() << "\r\n"
+            << "cluster_my_slots:" << cluster_->owned_slots() << "\r\n";
+        if (migrator_) {
+            auto status = migrator_->status();
+            out << "cluster_migrating:" << (status.running ? 1 : 0) << "\r\n"
+                << "cluster_migration_slot:" << status.slot << "\r\n"
+                << "cluster_migration_target:" << status.target << "\r\n"
+                << "cluster_migration_keys_moved:" << status.keys_moved << "\r\n"
+                << "cluster_migration_error:" << status.error << "\r\n";
+        }
+        return Parser::serialize_string(out.str());
+    }
+    if (sub == "SLOTS" && args.size() == 1) {
+        auto ranges = cluster_->ranges();
+        std::string reply = Parser::serialize_array_header(ranges.size());
+        for (const auto& range : ranges) {
+            auto colon = range.node.rfind(':');
+            auto port = parse_int(range.node.substr(colon + 1));
+            reply += Parser::serialize_array_header(3);
+            reply += Parser::serialize_integer(range.first);
+            reply += Parser::serialize_integer(range.last);
+            reply += Parser::serialize_array_header(2);
+            reply += Parser::serialize_string(range.node.substr(0, colon));
+            reply += Parser::serialize_integer(port.value_or(0));
+        }
+        return reply;
+    }
+    if (sub == "NODES" && args.size() == 1) {
+        // One line per node: address, flags, then its slot ranges
+        auto ranges = cluster_->ranges();
+        std::ostringstream out;
+        for (const auto& node : cluster_->nodes()) {
+            out << node << (node == cluster_->self() ? " myself,master" : " master");
+            for (const auto& range : ranges) {
+                if (range.node != node) continue;
+                out << ' ' << range.first;
+                if (range.last != range.first) out << '-' << range.last;
+            }
+            out << "\n";
+        }
+        return Parser::serialize_string(out.str());
+    }
+    if (sub == "COUNTKEYSINSLOT" && args.size() == 2) {
+        if (!slot) return Parser::serialize_error("Invalid slot");
+        return Parser::serialize_integer(static_cast<int64_t>(table_.keys_if(in_slot).size()));
+    }
+    if (sub == "GETKEYSINSLOT" && args.size() == 3) {
+        auto count = parse_int(args[2]);
+        if (!slot) return Parser::serialize_error("Invalid slot");
+        if (!count || *count < 0) return Parser::serialize_error("Invalid number of keys");
+        return Parser::serialize_array(table_.keys_if(in_slot, static_cast<size_t>(*count)));
+    }
+    if (sub == "SETSLOT" && (args.size() == 3 || args.size() == 4)) {
+        if (!slot) return Parser::serialize_error("Invalid slot");
+        std::string action = args[2];
+        std::transform(action.begin(), action.end(), action.begin(), ::toupper);
+        if (action == "STABLE" && args.size() == 3) {
+            cluster_->set_stable(*slot);
+        } else if (action == "IMPORTING" && args.size() == 4) {
+            cluster_->set_importing(*slot, args[3]);
+        } else if (action == "MIGRATING" && args.size() == 4) {
+            cluster_->set_migrating(*slot, args[3]);
+        } else if (action == "NODE" && args.size() == 4) {
+            cluster_->set_owner(*slot, args[3]);
+        } else {
+            return Parser::serialize_error("Invalid CLUSTER SETSLOT action or number of arguments");
+        }
+        return Parser::serialize_ok();
+    }
+    if (sub == "MIGRATE" && args.size() == 3) {
+        if (!slot) return Parser::serialize_error("Invalid slot");
+        if (!migrator_) return Parser::serialize_error("slot migration is not available");
+        // Returns at once; progress shows in CLUSTER INFO
+        migrator_->start(*slot, args[2]);
+        return Parser::serialize_ok();
+    }
+    return Parser::serialize_error("unknown subcommand or wrong number of arguments for 'cluster'");
+}
+
+std::string CommandHandler::cmd_restore(const Args& args, ClientState& client) {
+    // RESTORE key ttl-ms payload [REPLACE]; payload as from dump_value()
+    if (args.size() != 3 && args.size() != 4) return wrong_args("restore");
+    auto ttl = parse_int(args[1]);
+    if (!ttl || *ttl < 0 || *ttl / 1000 > kMaxTtlSeconds) {
+        return Parser::serialize_error("Invalid TTL value, must be >= 0");
+    }
+    bool replace = false;
+    if (args.size() == 4) {
+        std::string opt = args[3];
+        std::transform(opt.begin(), opt.end(), opt.begin(), ::toupper);
+        if (opt != "REPLACE") return Parser::serialize_error("syntax error");
+        replace = true;
+    }
+    HashedKey key = key_arg(args, 0);
+    if (!replace && table_.contains(key)) {
+        return "-BUSYKEY Target key name already exists.\r\n";
+    }
+
+    std::optional<std::chrono::milliseconds> expire_in;
+    if (*ttl > 0) expire_in = std::chrono::milliseconds(*ttl);
+    store_with_ttl(key, restore_value(args[2]), expire_in);
+    client.dirty++;
+    return Parser::serialize_ok();
+}
+
+// ---------------------------------------------------------------------------
+// Bulk loading and export
+// ---------------------------------------------------------------------------
+
+std::string CommandHandler::bulk_load(std::string_view frames, ClientState& client) {
+    if (client.in_multi) {
+        client.multi_error = true;
+        return Parser::serialize_error("BULKLOAD is not allowed in a transaction");
+    }
+    if (load_progress_ && load_progress_->loading.load(std::memory_order_acquire)) {
+        return "-LOADING CacheForge is loading the dataset in memory\r\n";
+    }
+
+    struct Pending {
+        Command cmd;
+        const CommandSpec* spec;
+        std::vector<std::string> keys;
+        std::vector<HashedKey> hashed;  // views into cmd.args
+        bool modified = false;
+    };
+    Parser parser;
+    int64_t applied = 0;
+    int64_t failed = 0;
+    std::optional<std::string> first_error;
+    auto fail = [&](std::string error) {
+        ++failed;
+        if (!first_error) first_error = std::move(error);
+    };
+
+    const auto* data = reinterpret_cast<const uint8_t*>(frames.data());
+    size_t offset = 0;
+    std::vector<Pending> batch;
+    batch.reserve(kBulkBatch);
+    while (offset < frames.size()) {
+        // Decode a batch, then run it with every shard it touches held, so
+        // each command skips its own lock round trip
+        batch.clear();
+        std::vector<HashedKey> lock_keys;
+        while (batch.size() < kBulkBatch && offset < frames.size()) {
+            size_t remaining = frames.size() - offset;
+            size_t length = 0;
+            try {
+                length = Parser::raw_frame_length(data + offset, remaining, remaining);
+            } catch (const std::runtime_error&) {
+            }
+            if (length == 0) {
+                fail("truncated frame at byte " + std::to_string(offset));
+                offset = frames.size();
+                break;
+            }
+            auto cmd = parser.parse_raw(data + offset, length);
+            offset += length;
+            std::transform(cmd->name.begin(), cmd->name.end(), cmd->name.begin(), ::toupper);
+            auto it = commands_.find(cmd->name);
+            if (it == commands_.end() || !(it->second.flags & kWrite) || it->second.first_key < 0) {
+                fail("BULKLOAD accepts write commands only, got '" + cmd->name + "'");
+                continue;
+            }
+            auto keys = command_keys(it->second, cmd->args);
+            // Hashed once moved into place: batch never reallocates, so the
+            // views stay valid until the batch is cleared
+            auto& pending = batch.emplace_back(Pending{std::move(*cmd), &it->second, std::move(keys), {}});
+            pending.hashed = hash_keys(*pending.spec, pending.cmd.args);
+            lock_keys.insert(lock_keys.end(), pending.hashed.begin(), pending.hashed.end());
+        }
+        if (batch.empty()) continue;
+
+        {
+            std::shared_lock<std::shared_mutex> pinned;
+            if (cluster_) pinned = cluster_->pin_command();
+            auto locked = table_.lock_shards(lock_keys);
+            for (auto& pending : batch) {
+                if (cluster_) {
+                    auto redirect = cluster_->route(pending.keys, false, [this](const std::string& key) {
+                        return table_.contains(key);
+                    });
+                    if (redirect) {
+                        fail(redirect->substr(1, redirect->size() - 3));
+                        pending.spec = nullptr;
+                        continue;
+                    }
+                }
+                for (const auto& hk : pending.hashed) expire_if_needed(hk);
+                stats_.record_call(pending.spec->stat_index);
+                const uint64_t dirty = client.dirty;
+                std::string reply;
+                t_hashed = &pending.hashed;
+                try {
+                    reply = (this->*(pending.spec->fn))(pending.cmd.args, client);
+                } catch (const std::exception& e) {
+                    reply = Parser::serialize_error(e.what());
+                }
+                t_hashed = nullptr;
+                pending.modified = client.dirty != dirty;
+                if (!reply.empty() && reply[0] == '-') {
+                    fail(reply.substr(1, reply.size() - 3));
+                } else {
+                    ++applied;
+                    if (pending.modified) notify_write(*pending.spec, pending.cmd.name, pending.keys);
+                }
+            }
+        }
+        for (const auto& pending : batch) {
+            if (!pending.spec) continue;
+            for (size_t i = 0; i < pending.keys.size(); ++i) {
+                if (pending.modified) tracking_.invalidate(pending.hashed[i]);
+                if (tiering_) tiering_->on_write(pending.keys[i]);
+            }
+        }
+    }
+
+    return Parser::serialize_array_header(3) + Parser::serialize_integer(applied) +
+           Parser::serialize_integer(failed) +
+           (first_error ? Parser::serialize_string(*first_error) : Parser::serialize_null());
+}
+
+std::string CommandHandler::cmd_bulkdump(const Args& args, ClientState& /*client*/) {
+    // BULKDUMP cursor [COUNT n] -> [next cursor, frames]. The frames are
+    // RESTORE commands for about n keys that BULKLOAD takes back, and the
+    // next cursor is 0 once every shard is done, as with SCAN. The cursor
+    // holds a shard index and a bucket cursor within it (see Dict::scan), so
+    // no call holds a shard's lock for more than kBulkBatch keys however
+    // big the shard; a key that moves buckets while the dump runs may come
+    // out twice, which REPLACE makes harmless. TTLs come from the table,
+    // where a bound ExpiryManager keeps them
+    if (args.size() != 1 && args.size() != 3) return wrong_args("bulkdump");
+    auto cursor = parse_int(args[0]);
+    if (!cursor || *cursor < 0) return Parser::serialize_error("invalid cursor");
+    size_t count = kDumpCount;
+    if (args.size() == 3) {
+        std::string opt = args[1];
+        std::transform(opt.begin(), opt.end(), opt.begin(), ::toupper);
+        auto n = parse_int(args[2]);
+        if (opt != "COUNT") return Parser::serialize_error("syntax error");
+        if (!n || *n < 1) return Parser::serialize_error("value is not an integer or out of range");
+        count = static_cast<size_t>(*n);
+    }
+
+    size_t shard = static_cast<size_t>(*cursor) % HashTable::kShardCount;
+    size_t bucket = static_cast<size_t>(*cursor) / HashTable::kShardCount;
+    size_t visited = 0;
+    std::string frames;
+    auto now = Clock::now();
+    auto dump = [&](const std::string& key, const Value& value, std::optional<TimePoint> deadline) {
+        ++visited;
+        int64_t ttl_ms = 0;
+        if (deadline) {
+            ttl_ms = std::chrono::duration_cast<std::chrono::milliseconds>(*deadline - now).count();
+            if (ttl_ms <= 0) return;  // due; the expiry thread will remove it
+        }
+        frames += Parser::serialize_raw({"RESTORE", {key, std::to_string(ttl_ms), dump_value(value), "REPLACE"}});
+    };
+    while (visited < count && shard < HashTable::kShardCount) {
+        bucket = table_.scan_shard(shard, bucket, std::min(count - visited, kBulkBatch), dump);
+        if (bucket == 0) ++shard;
+    }
+    int64_t next = shard == HashTable::kShardCount
+                       ? 0
+                       : static_cast<int64_t>(bucket * HashTable::kShardCount + shard);
+    return Parser::serialize_array_header(2) + Parser::serialize_string(std::to_string(next)) +
+           Parser::serialize_string(frames);
+}
+
+// ---------------------------------------------------------------------------
+// Introspection
+// ---------------------------------------------------------------------------
+
+std::string CommandHandler::cmd_hotkeys(const Args& args, ClientState& /*client*/) {
+    // HOTKEYS [count] -> flat array of key, estimated-accesses pairs
+    if (args.size() > 1) return wrong_args("hotkeys");
+    int64_t count = 10;
+    if (args.size() == 1) {
+        auto n = parse_int(args[0]);
+        if (!n || *n < 0) return Parser::serialize_error("value is not an integer or out of range");
+        count = *n;
+    }
+    if (!hotkeys_.enabled()) return Parser::serialize_error("hot-key tracking is disabled");
+
+    std::vector<std::string> reply;
+    for (const auto& [key, hits] : hotkeys_.top(static_cast<size_t>(count))) {
+        reply.push_back(key);
+        reply.push_back(std::to_string(hits));
+    }
+    return Parser::serialize_array(reply);
+}
+
+std::string CommandHandler::cmd_info(const Args& args, ClientState& /*client*/) {
+    // INFO [section]; sections match case-insensitively, default is all
+    if (args.size() > 1) return wrong_args("info");
+    std::string section = args.empty() ? "all" : args[0];
+    std::transform(section.begin(), section.end(), section.begin(), ::tolower);
+    auto want = [&section](const char* name) { return section == "all" || section == name; };
+
+    auto snap = stats_.snapshot();
+    const auto& c = snap.counters;
+    std::ostringstream out;
+
+    if (want("server")) {
+        out << "# Server\r\n"
+            << "uptime_in_seconds:" << snap.uptime.count() << "\r\n\r\n";
+    }
+    if (want("clients")) {
+        out << "# Clients\r\n"
+            << "connected_clients:" << c[Stats::kConnectionsReceived] - c[Stats::kConnectionsClosed] << "\r\n"
+            << "tracking_clients:" << tracking_.clients() << "\r\n"
+            << "tracking_total_keys:" << tracking_.tracked_keys() << "\r\n\r\n";
+    }
+    if (want("memory")) {
+        size_t dataset = table_.memory_usage_estimate();
+        size_t rss = Defragmenter::resident_bytes();
+        out << "# Memory\r\n"
+            << "used_memory_dataset:" << dataset << "\r\n"
+            << "used_memory_rss:" << rss << "\r\n"
+            << "mem_fragmentation_ratio:"
+            << (dataset ? static_cast<double>(rss) / static_cast<double>(dataset) : 0.0) << "\r\n"
+            << "compressed_keys:" << table_.compressed_count() << "\r\n"
+            << "active_defrag_running:" << (defrag_ && defrag_->active() ? 1 : 0) << "\r\n"
+            << "active_defrag_hits:" << (defrag_ ? defrag_->relocated() : 0) << "\r\n"
+            << "active_defrag_passes:" << (defrag_ ? defrag_->passes() : 0) << "\r\n\r\n";
+    }
+    if (want("tiered") && tiering_) {
+        const auto& log = tiering_->log();
+        out << "# Tiered\r\n"
+            << "tiered_resident_bytes:" << tiering_->resident_bytes() << "\r\n"
+            << "tiered_memory_budget:" << tiering_->memory_budget() << "\r\n"
+            << "tiered_cold_keys:" << table_.cold_count() << "\r\n"
+            << "tiered_demotions:" << tiering_->demotions() << "\r\n"
+            << "tiered_promotions:" << table_.promotions() << "\r\n"
+            << "tiered_log_file_bytes:" << log.file_bytes() << "\r\n"
+            << "tiered_log_live_bytes:" << log.live_bytes() << "\r\n"
+            << "tiered_log_segments:" << log.segment_count() << "\r\n"
+            << "tiered_compactions:" << tiering_->compactions() << "\r\n\r\n";
+    }
+    if (want("persistence")) {
+        bool loading = load_progress_ && load_progress_->loading.load();
+        out << "# Persistence\r\n"
+            << "loading:" << (loading ? 1 : 0) << "\r\n";
+        if (load_progress_) {
+            uint64_t total = load_progress_->total_bytes.load();
+            uint64_t loaded = load_progress_->loaded_bytes.load();
+            out << "loading_total_bytes:" << total << "\r\n"
+                << "loading_loaded_bytes:" << loaded << "\r\n"
+                << "loading_loaded_perc:" << (total ? 100.0 * loaded / total : 0.0) << "\r\n"
+                << "loading_loaded_keys:" << load_progress_->loaded_keys.load() << "\r\n"
+                << "loading_expired_keys:" << load_progress_->expired_keys.load() << "\r\n";
+        }
+        out << "\r\n";
+    }
+    if (want("stats")) {
+        uint64_t total = 0;
+        for (const auto& cmd : snap.commands) total += cmd.calls;
+        out << "# Stats\r\n"
+            << "total_connections_received:" << c[Stats::kConnectionsReceived] << "\r\n"
+            << "rejected_connections:" << c[Stats::kRejectedConnections] << "\r\n"
+            << "client_output_buffer_limit_disconnections:" << c[Stats::kOutputLimitDisconnects] << "\r\n"
+            << "client_query_buffer_limit_disconnections:" << c[Stats::kQueryLimitDisconnects] << "\r\n"
+            << "client_idle_disconnections:" << c[Stats::kIdleDisconnects] << "\r\n"
+            << "total_commands_processed:" << total << "\r\n"
+            << "total_net_input_bytes:" << c[Stats::kNetInputBytes] << "\r\n"
+            << "total_net_output_bytes:" << c[Stats::kNetOutputBytes] << "\r\n"
+            << "keyspace_hits:" << c[Stats::kKeyspaceHits] << "\r\n"
+            << "keyspace_misses:" << c[Stats::kKeyspaceMisses] << "\r\n"
+            << "expired_keys:" << c[Stats::kExpiredKeys] << "\r\n"
+            << "evicted_keys:" << c[Stats::kEvictedKeys] << "\r\n"
+            << "pubsub_channels:" << pubsub_.active_channels().size() << "\r\n"
+            << "pubsub_patterns:" << pubsub_.num_patterns() << "\r\n"
+            << "notify_keyspace_events:" << KeyspaceEvents::format_classes(keyspace_events_.classes()) << "\r\n"
+            << "keyspace_events_emitted:" << keyspace_events_.emitted() << "\r\n"
+            << "keyspace_events_dropped:" << keyspace_events_.dropped() << "\r\n\r\n";
+    }
+    if (want("commandstats")) {
+        out << "# Commandstats\r\n";
+        for (const auto& cmd : snap.commands) {
+            std::string lower = cmd.name;
+            std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+            out << "cmdstat_" << lower << ":calls=" << cmd.calls
+                << ",usec=" << cmd.total_ns / 1000
+                << ",usec_per_call=" << (cmd.total_ns / 1000.0) / static_cast<double>(cmd.calls) << "\r\n";
+        }
+        out << "\r\n";
+    }
+    if (want("latencystats")) {
+        out << "# Latencystats\r\n";
+        for (const auto& cmd : snap.commands) {
+            std::string lower = cmd.name;
+            std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+            out << "latency_percentiles_usec_" << lower
+                << ":p50=" << cmd.latency.percentile(50) / 1000.0
+                << ",p99=" << cmd.latency.percentile(99) / 1000.0
+                << ",p99.9=" << cmd.latency.percentile(99.9) / 1000.0 << "\r\n";
+        }
+        out << "\r\n";
+    }
+    if (want("hotkeys") && hotkeys_.enabled()) {
+        out << "# Hotkeys\r\n";
+        for (const auto& [key, hits] : hotkeys_.top(10)) {
+            out << "hotkey:" << key << "=" << hits << "\r\n";
+        }
+        out << "\r\n";
+    }
+    if (want("keyspace")) {
+        out << "# Keyspace\r\n"
+            << "keys:" << table_.size() << "\r\n"
+            << "expires:" << table_.expiry_count() << "\r\n";
+    }
+    return Parser::serialize_string(out.str());
+}
+
+std::string CommandHandler::cmd_slowlog(const Args& args, ClientState& /*client*/) {
+    // SLOWLOG GET [count] | LEN | RESET
+    if (args.empty()) return wrong_args("slowlog");
+    std::string sub = args[0];
+    std::transform(sub.begin(), sub.end(), sub.begin(), ::toupper);
+
+    if (sub == "LEN" && args.size() == 1) {
+        return Parser::serialize_integer(static_cast<int64_t>(slowlog_.size()));
+    }
+    if (sub == "RESET" && args.size() == 1) {
+        slowlog_.reset();
+        return Parser::serialize_ok();
+    }
+    if (sub == "GET" && args.size() <= 2) {
+        size_t count = 10;
+        if (args.size() == 2) {
+            auto n = parse_int(args[1]);
+            if (!n || *n < -1) return Parser::serialize_error("value is out of range");
+            count = *n < 0 ? slowlog_.capacity() : static_cast<size_t>(*n);
+        }
+        auto entries = slowlog_.entries(count);
+        std::string reply = Parser::serialize_array_header(entries.size());
+        for (const auto& e : entries) {
+            reply += Parser::serialize_array_header(5);
+            reply += Parser::serialize_integer(static_cast<int64_t>(e.id));
+            reply += Parser::serialize_integer(e.timestamp);
+            reply += Parser::serialize_integer(static_cast<int64_t>(e.duration_us));
+            reply += Parser::serialize_array(e.args);
+            reply += Parser::serialize_string(e.client);
+        }
+        return reply;
+    }
+    return Parser::serialize_error("unknown subcommand or wrong number of arguments for 'slowlog'");
+}
+
+std::string CommandHandler::cmd_latency(const Args& args, ClientState& /*client*/) {
+    // LATENCY LATEST | HISTORY event | RESET [event ...]
+    if (args.empty()) return wrong_args("latency");
+    std::string sub = args[0];
+    std::transform(sub.begin(), sub.end(), sub.begin(), ::toupper);
+
+    if (sub == "LATEST" && args.size() == 1) {
+        auto events = latency_.latest();
+        std::string reply = Parser::serialize_array_header(events.size());
+        for (const auto& e : events) {
+            reply += Parser::serialize_array_header(4);
+            reply += Parser::serialize_string(e.event);
+            reply += Parser::serialize_integer(e.latest.timestamp);
+            reply += Parser::serialize_integer(static_cast<int64_t>(e.latest.duration_us));
+            reply += Parser::serialize_integer(static_cast<int64_t>(e.max_us));
+        }
+        return reply;
+    }
+    if (sub == "HISTORY" && args.size() == 2) {
+        auto samples = latency_.history(args[1]);
+        std::string reply = Parser::serialize_array_header(samples.size());
+        for (const auto& sample : samples) {
+            reply += Parser::serialize_array_header(2);
+            reply += Parser::serialize_integer(sample.timestamp);
+            reply += Parser::serialize_integer(static_cast<int64_t>(sample.duration_us));
+        }
+        return reply;
+    }
+    if (sub == "RESET") {
+        Args events(args.begin() + 1, args.end());
+        return Parser::serialize_integer(static_cast<int64_t>(latency_.reset(events)));
+    }
+    return Parser::serialize_error("unknown subcommand or wrong number of arguments for 'latency'");
+}
+
+std::string CommandHandler::cmd_profile(const Args& args, ClientState& /*client*/) {
+    // PROFILE CPU START [hz] | CPU STOP | CPU STATUS | HEAP; the profiles
+    // go to files and the replies name them
+    if (args.empty()) return wrong_args("profile");
+    if (!profiler_) return Parser::serialize_error("profiling is not available");
+    std::string sub = args[0];
+    std::transform(sub.begin(), sub.end(), sub.begin(), ::toupper);
+    std::string action = args.size() > 1 ? args[1] : "";
+    std::transform(action.begin(), action.end(), action.begin(), ::toupper);
+
+    try {
+        if (sub == "CPU" && action == "START" && args.size() <= 3) {
+            int64_t hz = 99;
+            if (args.size() == 3) {
+                auto n = parse_int(args[2]);
+                if (!n) return Parser::serialize_error("value is not an integer or out of range");
+                hz = *n;
+            }
+            if (hz < 1 || hz > 1000) return Parser::serialize_error("sampling rate must be between 1 and 1000 Hz");
+            profiler_->start_cpu(static_cast<int>(hz));
+            return Parser::serialize_ok();
+        }
+        if (sub == "CPU" && action == "STOP" && args.size() == 2) {
+            return Parser::serialize_string(profiler_->stop_cpu());
+        }
+        if (sub == "CPU" && action == "STATUS" && args.size() == 2) {
+            auto status = profiler_->cpu_status();
+            std::ostringstream out;
+            out << "running:" << (status.running ? 1 : 0) << "\r\n"
+                << "hz:" << status.hz << "\r\n"
+                << "samples:" << status.samples << "\r\n"
+                << "dropped:" << status.dropped << "\r\n";
+            return Parser::serialize_string(out.str());
+        }
+        if (sub == "HEAP" && args.size() == 1) {
+            return Parser::serialize_string(profiler_->write_heap(table_));
+        }
+    } catch (const std::runtime_error& e) {
+        return Parser::serialize_error(e.what());
+    }
+    return Parser::serialize_error("unknown subcommand or wrong number of arguments for 'profile'");
+}
+
+}  // namespace cacheforge
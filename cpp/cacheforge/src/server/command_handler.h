@@ -0,0 +1,239 @@
+#pragma once
+#ifndef CACHEFORGE_COMMAND_HANDLER_H
+#define CACHEFORGE_COMMAND_HANDLER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <cstdint>
+#include "protocol/parser.h"
+#include "storage/hashtable.h"
+#include "storage/expiry.h"
+#include "storage/hotkeys.h"
+#include "storage/tiering.h"
+#include "storage/defrag.h"
+#include "server/tracking.h"
+#include "server/pubsub.h"
+#include "server/keyspace_events.h"
+#include "server/stats.h"
+#include "server/slowlog.h"
+#include "server/latency_monitor.h"
+#include "server/profiler.h"
+#include "cluster/cluster.h"
+#include "cluster/migrator.h"
+#include "persistence/snapshot.h"
+
+namespace cacheforge {
+
+// Per-connection state that persists across commands
+struct ClientState {
+    uint64_t id = 0;
+    bool tracking = false;
+    size_t subscriptions = 0;  // channels + patterns
+    std::string addr;  // peer address, reported by SLOWLOG
+    bool asking = false;  // ASKING: the next command may use an importing slot
+    // Bumped by write handlers for each change they make, so a write that
+    // was refused or found nothing to do raises no keyspace event and
+    // invalidates no client's cached copy
+    uint64_t dirty = 0;
+
+    // MULTI/EXEC: commands are queued until EXEC, which aborts if any
+    // watched key's version changed since WATCH
+    bool in_multi = false;
+    bool multi_error = false;  // a command failed to queue; EXEC discards
+    std::vector<Command> queued;
+    std::vector<std::pair<std::string, uint64_t>> watched;
+};
+
+// Executes parsed commands against the storage engine and returns the
+// serialized reply. Handlers are looked up by upper-cased command name.
+class CommandHandler {
+public:
+    // Delivers an out-of-band push message (invalidations, pub/sub) to a
+    // client; one buffer may be shared by many recipients
+    using PushCallback = std::function<void(uint64_t client_id,
+                                            const std::shared_ptr<const std::string>& message)>;
+
+    explicit CommandHandler(HashTable& table, ExpiryManager* expiry = nullptr);
+
+    std::string execute(const Command& cmd);
+    std::string execute(const Command& cmd, ClientState& client);
+
+    // BULKLOAD: applies a payload of back-to-back binary frames (see
+    // Parser::serialize_raw) holding write commands, kBulkBatch at a time
+    // with the batch's shards locked once and without building a reply per
+    // command. Returns one reply: [applied, failed, first error or null].
+    // A truncated frame ends the payload and counts as a failure.
+    static constexpr size_t kBulkBatch = 256;
+    // Keys per BULKDUMP page unless the call gives a COUNT
+    static constexpr size_t kDumpCount = 1000;
+    std::string bulk_load(std::string_view frames, ClientState& client);
+
+    // Notifies tracking clients that a key changed outside a command
+    // (eviction, active expiry)
+    void invalidate_key(const std::string& key);
+
+    // Sends batched invalidations queued since the last flush, one push
+    // message per client
+    void flush_invalidations();
+    void set_push_callback(PushCallback cb);
+    // Reports the keys of every command to tiered storage; nullptr = off
+    void set_tiering(TieredStorage* tiering) { tiering_ = tiering; }
+    // Reported under INFO memory; nullptr = active defrag off
+    void set_defragmenter(Defragmenter* defrag) { defrag_ = defrag; }
+    // Backs the PROFILE admin command; nullptr = profiling unavailable
+    void set_profiler(Profiler* profiler) { profiler_ = profiler; }
+    // While `progress` reports a load in progress, commands on keys not yet
+    // loaded and all writes to keys get -LOADING; nullptr = never loading
+    void set_load_progress(const LoadProgress* progress) { load_progress_ = progress; }
+    // Cluster mode: commands on keys of slots owned elsewhere are
+    // redirected, and CLUSTER MIGRATE uses `migrator`; nullptr = standalone
+    void set_cluster(ClusterState* cluster, SlotMigrator* migrator = nullptr) {
+        cluster_ = cluster;
+        migrator_ = migrator;
+    }
+    TrackingTable& tracking() { return tracking_; }
+    PubSub& pubsub() { return pubsub_; }
+    KeyspaceEvents& keyspace_events() { return keyspace_events_; }
+    HotKeyTracker& hotkeys() { return hotkeys_; }
+    Stats& stats() { return stats_; }
+    SlowLog& slowlog() { return slowlog_; }
+    LatencyMonitor& latency_monitor() { return latency_; }
+
+private:
+    using Args = std::vector<std::string>;
+    using Handler = std::string (CommandHandler::*)(const Args& args, ClientState& client);
+
+    // Command table entry; keys are args[first_key..last_key] stepping by
+    // key_step (last_key < 0 counts from the end), first_key < 0 for none.
+    // A write with an event class reports the command's name as a keyspace
+    // event on its first key when it succeeds
+    struct CommandSpec {
+        Handler fn;
+        int flags;
+        int first_key;
+        int last_key;
+        int key_step;
+        int events = 0;  // KeyspaceEvents class
+        size_t stat_index = 0;
+    };
+    static constexpr int kRead = 1 << 0;
+    static constexpr int kWrite = 1 << 1;
+    // Reads the table beyond any declared keys (KEYS, INFO, CLUSTER
+    // COUNTKEYSINSLOT), so EXEC must hold every shard to run it
+    static constexpr int kTouchesTable = 1 << 2;
+
+    HashTable& table_;
+    ExpiryManager* expiry_;
+    TrackingTable tracking_;
+    PubSub pubsub_;
+    HotKeyTracker hotkeys_;
+    Stats stats_;
+    SlowLog slowlog_;
+    LatencyMonitor latency_;
+    PushCallback push_callback_;
+    // After pubsub_ and push_callback_, which its publisher thread uses
+    KeyspaceEvents keyspace_events_;
+    TieredStorage* tiering_ = nullptr;
+    Defragmenter* defrag_ = nullptr;
+    Profiler* profiler_ = nullptr;
+    ClusterState* cluster_ = nullptr;
+    SlotMigrator* migrator_ = nullptr;
+    const LoadProgress* load_progress_ = nullptr;
+    std::unordered_map<std::string, CommandSpec> commands_;
+
+    std::vector<std::string> command_keys(const CommandSpec& spec, const Args& args) const;
+    // The same keys, hashed; each views its string in `args`
+    std::vector<HashedKey> hash_keys(const CommandSpec& spec, const Args& args) const;
+    void expire_if_needed(const std::string& key) { expire_if_needed(HashedKey(key)); }
+    void expire_if_needed(const HashedKey& hk);
+    // Writes the value and makes `ttl` its deadline, or drops the deadline
+    // when empty; with the expiry manager bound to the table both happen
+    // under one shard lock
+    void store_with_ttl(const HashedKey& key, Value value, std::optional<std::chrono::milliseconds> ttl);
+    void notify_write(const CommandSpec& spec, const std::string& name, const std::vector<std::string>& keys);
+    // HashTable::view that also counts keyspace hits and misses
+    bool lookup(const HashedKey& hk, const std::function<void(const Value&)>& fn);
+
+    // Strings
+    std::string cmd_ping(const Args& args, ClientState& client);
+    std::string cmd_get(const Args& args, ClientState& client);
+    std::string cmd_set(const Args& args, ClientState& client);
+    std::string cmd_del(const Args& args, ClientState& client);
+    std::string cmd_keys(const Args& args, ClientState& client);
+
+    // Expiry
+    std::string cmd_expire(const Args& args, ClientState& client);
+    std::string cmd_ttl(const Args& args, ClientState& client);
+
+    // Counters
+    std::string cmd_incr(const Args& args, ClientState& client);
+    std::string cmd_decr(const Args& args, ClientState& client);
+    std::string cmd_incrby(const Args& args, ClientState& client);
+    std::string cmd_decrby(const Args& args, ClientState& client);
+    std::string cmd_incrbyfloat(const Args& args, ClientState& client);
+    std::string incr_by(const HashedKey& key, int64_t delta, ClientState& client);
+
+    // Hashes
+    std::string cmd_hset(const Args& args, ClientState& client);
+    std::string cmd_hget(const Args& args, ClientState& client);
+    std::string cmd_hmget(const Args& args, ClientState& client);
+    std::string cmd_hincrby(const Args& args, ClientState& client);
+
+    // Sorted sets
+    std::string cmd_zadd(const Args& args, ClientState& client);
+    std::string cmd_zrangebyscore(const Args& args, ClientState& client);
+    std::string cmd_zrank(const Args& args, ClientState& client);
+
+    // HyperLogLog and Bloom filters
+    std::string cmd_pfadd(const Args& args, ClientState& client);
+    std::string cmd_pfcount(const Args& args, ClientState& client);
+    std::string cmd_pfmerge(const Args& args, ClientState& client);
+    std::string cmd_bf_reserve(const Args& args, ClientState& client);
+    std::string cmd_bf_add(const Args& args, ClientState& client);
+    std::string cmd_bf_madd(const Args& args, ClientState& client);
+    std::string cmd_bf_exists(const Args& args, ClientState& client);
+    std::string cmd_bf_mexists(const Args& args, ClientState& client);
+    std::string cmd_bf_info(const Args& args, ClientState& client);
+
+    // Connection
+    std::string cmd_client(const Args& args, ClientState& client);
+
+    // Transactions
+    std::string cmd_multi(const Args& args, ClientState& client);
+    std::string cmd_exec(const Args& args, ClientState& client);
+    std::string cmd_discard(const Args& args, ClientState& client);
+    std::string cmd_watch(const Args& args, ClientState& client);
+    std::string cmd_unwatch(const Args& args, ClientState& client);
+
+    // Pub/sub
+    std::string cmd_subscribe(const Args& args, ClientState& client);
+    std::string cmd_unsubscribe(const Args& args, ClientState& client);
+    std::string cmd_psubscribe(const Args& args, ClientState& client);
+    std::string cmd_punsubscribe(const Args& args, ClientState& client);
+    std::string cmd_publish(const Args& args, ClientState& client);
+    std::string cmd_pubsub(const Args& args, ClientState& client);
+
+    // Cluster
+    std::string cmd_asking(const Args& args, ClientState& client);
+    std::string cmd_cluster(const Args& args, ClientState& client);
+    std::string cmd_restore(const Args& args, ClientState& client);
+
+    // Bulk export
+    std::string cmd_bulkdump(const Args& args, ClientState& client);
+
+    // Introspection
+    std::string cmd_hotkeys(const Args& args, ClientState& client);
+    std::string cmd_info(const Args& args, ClientState& client);
+    std::string cmd_slowlog(const Args& args, ClientState& client);
+    std::string cmd_latency(const Args& args, ClientState& client);
+    std::string cmd_profile(const Args& args, ClientState& client);
+};
+
+}  // namespace cacheforge
+
+#endif  // CACHEFORGE_COMMAND_HANDLER_H
@@ -1,11 +1,24 @@
 #include "server/connection.h"
+#include "protocol/parser.h"
 #include <spdlog/spdlog.h>
+#include <charconv>
+#include <optional>
 
 namespace cacheforge {
 
-Connection::Connection(boost::asio::ip::tcp::socket socket)
+Connection::Connection(boost::asio::ip::tcp::socket socket, CommandHandler* handler, uint64_t id)
     : socket_(std::move(socket)),
-      read_buffer_(4096) {
+      read_buffer_(4096),
+      handler_(handler) {
+    client_.id = id;
+    boost::system::error_code ec;
+    // Replies are small and often pipelined; without this Nagle holds each
+    // one back until the client's delayed ACK
+    socket_.set_option(boost::asio::ip::tcp::no_delay(true), ec);
+    auto peer = socket_.remote_endpoint(ec);
+    if (!ec) {
+        client_.addr = peer.address().to_string() + ":" + std::to_string(peer.port());
+    }
 }
 
 Connection::~Connection() {
@@ -14,6 +27,8 @@ Connection::~Connection() {
 
 void Connection::start() {
     active_.store(true);
+    last_activity_ = std::chrono::steady_clock::now();
+    if (handler_) handler_->stats().add(Stats::kConnectionsReceived);
 
     
     self_ref_ = shared_from_this();
@@ -25,18 +40,76 @@ void Connection::stop() {
     if (active_.exchange(false)) {
         boost::system::error_code ec;
         socket_.close(ec);
-        
+        if (handler_ && client_.tracking) {
+            handler_->tracking().forget_client(client_.id);
+        }
+        if (handler_ && client_.subscriptions) {
+            handler_->pubsub().forget_client(client_.id);
+        }
+        if (handler_) handler_->stats().add(Stats::kConnectionsClosed);
+        if (on_close_) on_close_(client_.id);
+        // Pending handlers hold their own reference, so this is not the last
+        self_ref_.reset();
     }
 }
 
 void Connection::send(const std::string& data) {
+    queue_output({data, nullptr});
+}
+
+void Connection::send(std::shared_ptr<const std::string> data) {
+    queue_output({{}, std::move(data)});
+}
+
+void Connection::queue_output(OutputChunk chunk) {
     if (!active_.load()) return;
-    write_queue_.push(data);
+    size_t size = chunk.data().size();
+    if (handler_) handler_->stats().add(Stats::kNetOutputBytes, size);
+    // Shared buffers count in full: each one pins the whole message
+    output_bytes_ += size;
+    write_queue_.push(std::move(chunk));
+    if (over_output_limits(std::chrono::steady_clock::now())) {
+        spdlog::warn("Client {} closed for exceeding output buffer limits ({} bytes queued)",
+                     client_.addr, output_bytes_);
+        if (handler_) handler_->stats().add(Stats::kOutputLimitDisconnects);
+        stop();
+        return;
+    }
     if (write_queue_.size() == 1) {
         do_write();
     }
 }
 
+bool Connection::over_output_limits(std::chrono::steady_clock::time_point now) {
+    if (limits_.output_hard_bytes && output_bytes_ > limits_.output_hard_bytes) return true;
+    if (!limits_.output_soft_bytes || output_bytes_ <= limits_.output_soft_bytes) {
+        soft_limit_since_ = {};
+        return false;
+    }
+    if (soft_limit_since_ == std::chrono::steady_clock::time_point{}) soft_limit_since_ = now;
+    return now - soft_limit_since_ >= limits_.output_soft_seconds;
+}
+
+void Connection::check_limits() {
+    auto self = shared_from_this();
+    boost::asio::post(socket_.get_executor(), [self]() {
+        if (!self->active_.load()) return;
+        auto now = std::chrono::steady_clock::now();
+        if (self->over_output_limits(now)) {
+            spdlog::warn("Client {} closed for staying over the soft output limit ({} bytes queued)",
+                         self->client_.addr, self->output_bytes_);
+            if (self->handler_) self->handler_->stats().add(Stats::kOutputLimitDisconnects);
+            self->stop();
+        } else if (self->limits_.idle_timeout.count() > 0 && self->client_.subscriptions == 0 &&
+                   now - self->last_activity_ >= self->limits_.idle_timeout) {
+            spdlog::info("Client {} closed after {}s idle", self->client_.addr,
+                         self->limits_.idle_timeout.count());
+            if (self->handler_) self->handler_->stats().add(Stats::kIdleDisconnects);
+            self->stop();
+        }
+    });
+}
+
 void Connection::enqueue_reply(const std::string& reply) {
     
     auto self = shared_from_this();
@@ -45,6 +118,13 @@ void Connection::enqueue_reply(const std::string& reply) {
     });
 }
 
+void Connection::enqueue_reply(std::shared_ptr<const std::string> reply) {
+    auto self = shared_from_this();
+    boost::asio::post(socket_.get_executor(), [self, reply = std::move(reply)]() mutable {
+        self->send(std::move(reply));
+    });
+}
+
 void Connection::set_buffer(std::unique_ptr<char[]> buf, size_t size) {
     aux_buffer_ = std::move(buf);
     aux_buffer_size_ = size;
@@ -61,8 +141,11 @@ void Connection::do_read() {
         boost::asio::buffer(read_buffer_),
         [this, self](boost::system::error_code ec, size_t bytes_read) {
             if (!ec) {
+                last_activity_ = std::chrono::steady_clock::now();
                 handle_data(read_buffer_.data(), bytes_read);
-                do_read();
+                // While paused the next read is issued by do_write() once
+                // the output backlog has drained
+                if (!input_paused_) do_read();
             } else {
                 stop();
             }
@@ -76,11 +159,19 @@ void Connection::do_write() {
     auto& front = write_queue_.front();
     boost::asio::async_write(
         socket_,
-        boost::asio::buffer(front),
+        boost::asio::buffer(front.data()),
         [this, self](boost::system::error_code ec, size_t /*bytes_written*/) {
             if (!ec) {
+                output_bytes_ -= write_queue_.front().data().size();
                 write_queue_.pop();
                 do_write();
+                // Resume at half the pause threshold so a client hovering
+                // around it does not flip between states on every write
+                if (input_paused_ && output_bytes_ <= limits_.output_pause_bytes / 2) {
+                    input_paused_ = false;
+                    process_input();
+                    if (!input_paused_ && active_.load()) do_read();
+                }
             } else {
                 stop();
             }
@@ -89,10 +180,71 @@ void Connection::do_write() {
 
 void Connection::handle_data(const uint8_t* data, size_t length) {
     // Process incoming data through the protocol parser
-    // This would normally dispatch to the command handler
     std::string msg(reinterpret_cast<const char*>(data), length);
     
     spdlog::debug("Received {} bytes: {}", length, msg.substr(0, 50));
+    if (!handler_) return;
+
+    handler_->stats().add(Stats::kNetInputBytes, length);
+    pending_input_.append(msg);
+    process_input();
+    // What is left is a command or payload not complete yet, or a pipeline
+    // held back by the output pause; either way the client could keep it
+    // growing without bound
+    if (active_.load() && limits_.query_buffer_bytes && pending_input_.size() > limits_.query_buffer_bytes) {
+        spdlog::warn("Client {} closed for exceeding the query buffer limit ({} bytes pending)",
+                     client_.addr, pending_input_.size());
+        handler_->stats().add(Stats::kQueryLimitDisconnects);
+        stop();
+    }
+}
+
+void Connection::process_input() {
+    Parser parser;
+    size_t start = 0;
+    size_t eol;
+    while (!input_paused_ && active_.load() &&
+           (eol = pending_input_.find('\n', start)) != std::string::npos) {
+        std::string line = pending_input_.substr(start, eol - start);
+        size_t line_start = start;
+        start = eol + 1;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+
+        auto cmd = parser.parse_text(line);
+        if (cmd && cmd->name == "BULKLOAD") {
+            std::optional<size_t> bytes;
+            if (cmd->args.size() == 1) {
+                const auto& arg = cmd->args[0];
+                size_t n = 0;
+                auto [ptr, ec] = std::from_chars(arg.data(), arg.data() + arg.size(), n);
+                if (ec == std::errc() && ptr == arg.data() + arg.size() && n <= kMaxBulkBytes) bytes = n;
+            }
+            if (!bytes) {
+                // Without the payload's length the stream can't be resynchronized
+                send(Parser::serialize_error("BULKLOAD needs a payload length of at most " +
+                                             std::to_string(kMaxBulkBytes) + " bytes"));
+                stop();
+                return;
+            }
+            if (pending_input_.size() - start < *bytes) {
+                start = line_start;  // wait for the rest of the payload
+                break;
+            }
+            send(handler_->bulk_load(std::string_view(pending_input_).substr(start, *bytes), client_));
+            start += *bytes;
+        } else if (cmd) {
+            send(handler_->execute(*cmd, client_));
+        }
+        // Stop running commands until the client reads what it has; the
+        // rest of the pipeline stays in pending_input_
+        if (limits_.output_pause_bytes && output_bytes_ >= limits_.output_pause_bytes) {
+            input_paused_ = true;
+        }
+    }
+    pending_input_.erase(0, start);
+
+    // Writes in this batch may have invalidated keys other clients cached
+    handler_->flush_invalidations();
 }
 
 }  // namespace cacheforge
@@ -1,29 +1,70 @@
 #pragma once
 
-#ifndef CACHEFORGE_CONFIG_H
-#define CACHEFORGE_CONFIG_H
+#ifndef CACHEFORGE_CONNECTION_H
+#define CACHEFORGE_CONNECTION_H
 
 #include <memory>
 #include <string>
 #include <vector>
 #include <queue>
 #include <atomic>
+#include <cstdint>
+#include <chrono>
+#include <functional>
 #include <boost/asio.hpp>
+#include "server/command_handler.h"
 
 namespace cacheforge {
 
+// Per-connection resource limits, set from Config by the Server.
+// Output is the bytes queued for the socket but not yet written: the hard
+// limit disconnects at once, the soft limit only when exceeded for
+// output_soft_seconds (Redis' client-output-buffer-limit). Above
+// output_pause_bytes the connection stops running the client's commands
+// until the backlog drains, so a client that does not read its replies
+// cannot grow the queue by itself. Input the connection holds but has not
+// run yet (a partial command line, a BULKLOAD payload still arriving) is
+// capped at query_buffer_bytes, over which the client is disconnected
+// (Redis' client-query-buffer-limit). Zero disables a limit.
+struct ClientLimits {
+    size_t output_hard_bytes = 0;
+    size_t output_soft_bytes = 0;
+    std::chrono::seconds output_soft_seconds{0};
+    size_t output_pause_bytes = 0;
+    std::chrono::seconds idle_timeout{0};
+    size_t query_buffer_bytes = 0;
+};
+
 class Connection : public std::enable_shared_from_this<Connection> {
 public:
-    explicit Connection(boost::asio::ip::tcp::socket socket);
+    // Largest BULKLOAD payload; it is buffered whole before it runs
+    static constexpr size_t kMaxBulkBytes = 256 * 1024 * 1024;
+
+    explicit Connection(boost::asio::ip::tcp::socket socket, CommandHandler* handler = nullptr,
+                        uint64_t id = 0);
     ~Connection();
 
     void start();
     void stop();
     void send(const std::string& data);
+    // Queues a buffer shared with other connections (pub/sub fan-out)
+    // without copying it
+    void send(std::shared_ptr<const std::string> data);
     bool is_active() const { return active_.load(); }
+    uint64_t id() const { return client_.id; }
+
+    // Call before start()
+    void set_limits(const ClientLimits& limits) { limits_ = limits; }
+    // Invoked once with the client id when the connection closes
+    void set_close_callback(std::function<void(uint64_t)> cb) { on_close_ = std::move(cb); }
+    // Closes the connection if it has been idle (pub/sub subscribers are
+    // exempt, as in Redis) or over the soft output limit for too long; safe
+    // to call from any thread
+    void check_limits();
 
     
     void enqueue_reply(const std::string& reply);
+    void enqueue_reply(std::shared_ptr<const std::string> reply);
 
     
     void set_buffer(std::unique_ptr<char[]> buf, size_t size);
@@ -33,7 +74,28 @@ private:
     boost::asio::ip::tcp::socket socket_;
     std::atomic<bool> active_{false};
     std::vector<uint8_t> read_buffer_;
-    std::queue<std::string> write_queue_;
+    // Replies are owned; pushes may share one buffer across connections
+    struct OutputChunk {
+        std::string owned;
+        std::shared_ptr<const std::string> shared;
+        const std::string& data() const { return shared ? *shared : owned; }
+    };
+    std::queue<OutputChunk> write_queue_;
+    size_t output_bytes_ = 0;  // sum of write_queue_ sizes
+
+    ClientLimits limits_;
+    std::function<void(uint64_t)> on_close_;
+    bool input_paused_ = false;
+    std::chrono::steady_clock::time_point soft_limit_since_{};  // epoch = under the limit
+    std::chrono::steady_clock::time_point last_activity_{};
+
+    // Commands are newline-terminated text; a partial line is kept until the
+    // rest of it arrives. "BULKLOAD <bytes>" is followed by that many bytes
+    // of binary frames, which are handed to CommandHandler::bulk_load()
+    // once all of them are in
+    CommandHandler* handler_ = nullptr;
+    std::string pending_input_;
+    ClientState client_;
 
     
     std::shared_ptr<Connection> self_ref_;
@@ -44,8 +106,11 @@ private:
     void do_read();
     void do_write();
     void handle_data(const uint8_t* data, size_t length);
+    void process_input();
+    void queue_output(OutputChunk chunk);
+    bool over_output_limits(std::chrono::steady_clock::time_point now);
 };
 
 }  // namespace cacheforge
 
-#endif  // CACHEFORGE_CONFIG_H
+#endif  // CACHEFORGE_CONNECTION_H
@@ -0,0 +1,79 @@
+#include "server/connection_registry.h"
+#include "server/connection.h"
+#include <bit>
+
+namespace cacheforge {
+
+ConnectionRegistry::ConnectionRegistry(size_t shard_count)
+    : shards_(std::bit_ceil(std::max<size_t>(1, shard_count))),
+      mask_(shards_.size() - 1) {}
+
+void ConnectionRegistry::add(uint64_t id, std::shared_ptr<Connection> conn) {
+    auto& shard = shard_for(id);
+    std::lock_guard lock(shard.mutex);
+    if (shard.conns.insert_or_assign(id, std::move(conn)).second) {
+        size_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+bool ConnectionRegistry::remove(uint64_t id) {
+    // The registry may hold the last reference; let it go after unlocking so
+    // the connection's destructor never runs under the shard lock
+    std::shared_ptr<Connection> released;
+    auto& shard = shard_for(id);
+    {
+        std::lock_guard lock(shard.mutex);
+        auto it = shard.conns.find(id);
+        if (it == shard.conns.end()) return false;
+        released = std::move(it->second);
+        shard.conns.erase(it);
+    }
+    size_.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+std::shared_ptr<Connection> ConnectionRegistry::find(uint64_t id) const {
+    const auto& shard = shard_for(id);
+    std::lock_guard lock(shard.mutex);
+    auto it = shard.conns.find(id);
+    return it == shard.conns.end() ? nullptr : it->second;
+}
+
+std::vector<std::shared_ptr<Connection>> ConnectionRegistry::shard_snapshot(size_t shard) const {
+    std::vector<std::shared_ptr<Connection>> out;
+    const auto& s = shards_[shard];
+    std::lock_guard lock(s.mutex);
+    out.reserve(s.conns.size());
+    for (const auto& [id, conn] : s.conns) out.push_back(conn);
+    return out;
+}
+
+void ConnectionRegistry::for_each(
+    const std::function<void(const std::shared_ptr<Connection>&)>& fn) const {
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        for (const auto& conn : shard_snapshot(i)) fn(conn);
+    }
+}
+
+size_t ConnectionRegistry::reap() {
+    size_t reaped = 0;
+    for (auto& shard : shards_) {
+        std::vector<std::shared_ptr<Connection>> released;
+        {
+            std::lock_guard lock(shard.mutex);
+            for (auto it = shard.conns.begin(); it != shard.conns.end();) {
+                if (!it->second || !it->second->is_active()) {
+                    released.push_back(std::move(it->second));
+                    it = shard.conns.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+        reaped += released.size();
+    }
+    size_.fetch_sub(reaped, std::memory_order_relaxed);
+    return reaped;
+}
+
+}  // namespace cacheforge
@@ -0,0 +1,56 @@
+#pragma once
+#ifndef CACHEFORGE_CONNECTION_REGISTRY_H
+#define CACHEFORGE_CONNECTION_REGISTRY_H
+
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+namespace cacheforge {
+
+class Connection;
+
+// Live connections keyed by client id. The id picks one of a fixed number
+// of shards, each with its own mutex, so accept, close and lookups from
+// different workers rarely contend and are O(1). Walks (broadcast, the
+// reaper) copy one shard at a time and never hold more than one lock or
+// call into a connection while holding it.
+class ConnectionRegistry {
+public:
+    explicit ConnectionRegistry(size_t shard_count = 64);
+
+    void add(uint64_t id, std::shared_ptr<Connection> conn);
+    // Returns false if the id was not registered
+    bool remove(uint64_t id);
+    std::shared_ptr<Connection> find(uint64_t id) const;
+    size_t size() const { return size_.load(std::memory_order_relaxed); }
+
+    size_t shard_count() const { return shards_.size(); }
+    // Copy of one shard's connections, for fan-out split across workers
+    std::vector<std::shared_ptr<Connection>> shard_snapshot(size_t shard) const;
+    void for_each(const std::function<void(const std::shared_ptr<Connection>&)>& fn) const;
+
+    // Drops connections that closed without unregistering; returns how many
+    size_t reap();
+
+private:
+    struct alignas(64) Shard {
+        mutable std::mutex mutex;
+        std::unordered_map<uint64_t, std::shared_ptr<Connection>> conns;
+    };
+
+    std::vector<Shard> shards_;
+    size_t mask_;
+    std::atomic<size_t> size_{0};
+
+    Shard& shard_for(uint64_t id) { return shards_[id & mask_]; }
+    const Shard& shard_for(uint64_t id) const { return shards_[id & mask_]; }
+};
+
+}  // namespace cacheforge
+
+#endif  // CACHEFORGE_CONNECTION_REGISTRY_H
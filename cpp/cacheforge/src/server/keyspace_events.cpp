@@ -0,0 +1,279 @@
+#include "server/keyspace_events.h"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+namespace cacheforge {
+
+namespace {
+
+std::atomic<uint64_t> next_instance_id{1};
+
+constexpr std::pair<char, int> kClassLetters[] = {
+    {'K', KeyspaceEvents::kKeyspace}, {'E', KeyspaceEvents::kKeyevent}, {'g', KeyspaceEvents::kGeneric},
+    {'$', KeyspaceEvents::kString},   {'h', KeyspaceEvents::kHash},     {'z', KeyspaceEvents::kZset},
+    {'x', KeyspaceEvents::kExpired},  {'b', KeyspaceEvents::kBloom},
+};
+
+}  // namespace
+
+// One producer thread's events. head is only written by that thread and
+// tail only by the publisher, each on a cache line of its own; a slot is
+// reused once tail has passed it, keeping its strings' capacity.
+struct KeyspaceEvents::Ring {
+    explicit Ring(size_t capacity) : slots(capacity), mask(capacity - 1) {}
+
+    std::vector<Event> slots;
+    const size_t mask;
+    alignas(64) std::atomic<uint64_t> head{0};  // events appended
+    std::atomic<uint64_t> dropped{0};
+    alignas(64) std::atomic<uint64_t> tail{0};  // events delivered
+};
+
+// The rings this thread appends to, by instance. The instance holds the
+// other reference to each; a ring only the instance still holds belongs to
+// an exited thread, and one only the thread holds to a destroyed instance.
+thread_local std::vector<std::pair<uint64_t, std::shared_ptr<KeyspaceEvents::Ring>>>
+    KeyspaceEvents::thread_rings_;
+
+KeyspaceEvents::KeyspaceEvents(size_t buffer_events)
+    : instance_id_(next_instance_id.fetch_add(1)) {
+    set_buffer_events(buffer_events);
+}
+
+KeyspaceEvents::~KeyspaceEvents() {
+    stop();
+}
+
+int KeyspaceEvents::parse_classes(std::string_view flags) {
+    int classes = 0;
+    for (char c : flags) {
+        if (c == 'A') {
+            classes |= kAll;
+            continue;
+        }
+        auto it = std::find_if(std::begin(kClassLetters), std::end(kClassLetters),
+                               [c](const auto& letter) { return letter.first == c; });
+        if (it == std::end(kClassLetters)) {
+            throw std::runtime_error(std::string("Invalid keyspace event class '") + c + "'");
+        }
+        classes |= it->second;
+    }
+    return classes;
+}
+
+std::string KeyspaceEvents::format_classes(int classes) {
+    std::string flags;
+    if ((classes & kAll) == kAll) {
+        flags += 'A';
+        classes &= ~kAll;
+    }
+    for (const auto& [letter, cls] : kClassLetters) {
+        if (classes & cls) flags += letter;
+    }
+    return flags;
+}
+
+void KeyspaceEvents::set_classes(int classes) {
+    std::lock_guard lock(consumers_mutex_);
+    classes_.store(classes, std::memory_order_relaxed);
+    update_active();
+}
+
+void KeyspaceEvents::set_buffer_events(size_t events) {
+    buffer_events_.store(std::bit_ceil(std::max<size_t>(events, 2)), std::memory_order_relaxed);
+}
+
+// Called with consumers_mutex_ held
+void KeyspaceEvents::update_active() {
+    int classes = classes_.load(std::memory_order_relaxed);
+    bool listening = (classes & (kKeyspace | kKeyevent)) || !consumers_.empty();
+    active_.store(listening ? classes & kAll : 0, std::memory_order_relaxed);
+    if (active_.load(std::memory_order_relaxed) != 0) launch();
+}
+
+uint64_t KeyspaceEvents::add_consumer(Consumer consumer) {
+    std::lock_guard lock(consumers_mutex_);
+    uint64_t id = next_consumer_id_++;
+    consumers_.emplace_back(id, std::move(consumer));
+    update_active();
+    return id;
+}
+
+void KeyspaceEvents::remove_consumer(uint64_t id) {
+    std::lock_guard lock(consumers_mutex_);
+    std::erase_if(consumers_, [id](const auto& entry) { return entry.first == id; });
+    update_active();
+}
+
+void KeyspaceEvents::set_publisher(Publish publish) {
+    std::lock_guard lock(consumers_mutex_);
+    publish_ = std::move(publish);
+}
+
+KeyspaceEvents::Ring& KeyspaceEvents::thread_ring() {
+    for (const auto& [id, ring] : thread_rings_) {
+        if (id == instance_id_) return *ring;
+    }
+    // First event of this thread here; forget rings of destroyed instances
+    std::erase_if(thread_rings_, [](const auto& entry) { return entry.second.use_count() == 1; });
+    auto ring = std::make_shared<Ring>(buffer_events_.load(std::memory_order_relaxed));
+    {
+        std::lock_guard lock(rings_mutex_);
+        rings_.push_back(ring);
+    }
+    thread_rings_.emplace_back(instance_id_, ring);
+    return *ring;
+}
+
+void KeyspaceEvents::append(int type, std::string_view event, std::string_view key) {
+    Ring& ring = thread_ring();
+    uint64_t head = ring.head.load(std::memory_order_relaxed);
+    if (head - ring.tail.load(std::memory_order_acquire) > ring.mask) {
+        // Only this thread writes the counter, so no read-modify-write
+        ring.dropped.store(ring.dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return;
+    }
+    Event& slot = ring.slots[head & ring.mask];
+    slot.type = type;
+    slot.event.assign(event);
+    slot.key.assign(key);
+    ring.head.store(head + 1, std::memory_order_release);
+    // Pairs with the fence in publish_loop: either the publisher sees this
+    // event before sleeping or this thread sees it asleep and wakes it
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (ring.tail.load(std::memory_order_relaxed) == head && waiting_.load(std::memory_order_relaxed) &&
+        waiting_.exchange(false)) {
+        { std::lock_guard lock(thread_mutex_); }
+        cv_.notify_one();
+    }
+}
+
+// Called with consumers_mutex_ held
+void KeyspaceEvents::deliver(const Event& event) {
+    int classes = classes_.load(std::memory_order_relaxed);
+    if (publish_) {
+        if (classes & kKeyspace) publish_("__keyspace@0__:" + event.key, event.event);
+        if (classes & kKeyevent) publish_("__keyevent@0__:" + event.event, event.key);
+    }
+    for (const auto& [id, consumer] : consumers_) {
+        try {
+            consumer(event);
+        } catch (const std::exception& e) {
+            spdlog::warn("Keyspace event consumer {} failed: {}", id, e.what());
+        }
+    }
+}
+
+size_t KeyspaceEvents::drain() {
+    std::lock_guard drain_lock(drain_mutex_);
+    std::vector<std::shared_ptr<Ring>> rings;
+    {
+        std::lock_guard lock(rings_mutex_);
+        rings = rings_;
+    }
+
+    size_t count = 0;
+    {
+        std::lock_guard lock(consumers_mutex_);
+        for (const auto& ring : rings) {
+            uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+            uint64_t head = ring->head.load(std::memory_order_acquire);
+            for (; tail != head; ++tail) {
+                deliver(ring->slots[tail & ring->mask]);
+                // Hand each slot back as soon as it is delivered
+                ring->tail.store(tail + 1, std::memory_order_release);
+                ++count;
+            }
+        }
+    }
+    rings.clear();
+
+    // Rings of exited threads get no more events; keep their counts
+    std::lock_guard lock(rings_mutex_);
+    for (auto it = rings_.begin(); it != rings_.end();) {
+        const auto& ring = **it;
+        if (it->use_count() == 1 && ring.tail.load(std::memory_order_relaxed) == ring.head.load()) {
+            retired_emitted_ += ring.head.load();
+            retired_dropped_ += ring.dropped.load(std::memory_order_relaxed);
+            it = rings_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    delivered_.fetch_add(count, std::memory_order_relaxed);
+    return count;
+}
+
+bool KeyspaceEvents::pending() const {
+    std::lock_guard lock(rings_mutex_);
+    return std::any_of(rings_.begin(), rings_.end(), [](const auto& ring) {
+        return ring->tail.load(std::memory_order_relaxed) != ring->head.load(std::memory_order_relaxed);
+    });
+}
+
+void KeyspaceEvents::publish_loop() {
+    while (running_.load()) {
+        if (drain() > 0) continue;
+        waiting_.store(true);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (pending()) {
+            waiting_.store(false);
+            continue;
+        }
+        std::unique_lock lock(thread_mutex_);
+        cv_.wait(lock, [this]() { return !waiting_.load() || !running_.load(); });
+        waiting_.store(false);
+    }
+}
+
+void KeyspaceEvents::start() {
+    {
+        std::lock_guard lock(thread_mutex_);
+        if (running_.exchange(true)) return;
+    }
+    std::lock_guard lock(consumers_mutex_);
+    if (active_.load(std::memory_order_relaxed) != 0) launch();
+}
+
+// Called with consumers_mutex_ held; a no-op before start() or once the
+// thread is up
+void KeyspaceEvents::launch() {
+    std::lock_guard lock(thread_mutex_);
+    if (!running_.load() || thread_.joinable()) return;
+    thread_ = std::thread([this]() { publish_loop(); });
+}
+
+bool KeyspaceEvents::publishing() const {
+    std::lock_guard lock(thread_mutex_);
+    return thread_.joinable();
+}
+
+void KeyspaceEvents::stop() {
+    std::thread thread;
+    {
+        std::lock_guard lock(thread_mutex_);
+        running_.store(false);
+        thread = std::move(thread_);
+    }
+    cv_.notify_all();
+    if (thread.joinable()) thread.join();
+    drain();
+}
+
+uint64_t KeyspaceEvents::emitted() const {
+    std::lock_guard lock(rings_mutex_);
+    uint64_t total = retired_emitted_;
+    for (const auto& ring : rings_) total += ring->head.load(std::memory_order_relaxed);
+    return total;
+}
+
+uint64_t KeyspaceEvents::dropped() const {
+    std::lock_guard lock(rings_mutex_);
+    uint64_t total = retired_dropped_;
+    for (const auto& ring : rings_) total += ring->dropped.load(std::memory_order_relaxed);
+    return total;
+}
+
+}  // namespace cacheforge
@@ -0,0 +1,140 @@
+#pragma once
+#ifndef CACHEFORGE_KEYSPACE_EVENTS_H
+#define CACHEFORGE_KEYSPACE_EVENTS_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+
+namespace cacheforge {
+
+// Keyspace notifications: writes and expirations reported as events, published on the __keyspace@0__:<key> and __keyevent@0__:<event>
+// channels and handed to in-process consumers.
+// The thread that causes an event (a network worker mid-command or the
+// expiry thread) only appends it to a ring buffer of its own: one per producer thread, single-producer
+// single-consumer, so appending takes no lock and, once the ring's slots
+// have grown to fit, no allocation. A publisher thread drains the rings
+// and delivers; it is only started once something listens, and sleeps
+// while every ring is empty until a producer whose ring goes from empty to
+// non-empty wakes it. When it lags and a ring is full, the event is dropped
+// and counted rather than making the producer wait.
+class KeyspaceEvents {
+public:
+    // Event classes, one per letter of the notify-keyspace-events flags.
+    // Nothing is ever evicted (past max_size the table keeps every key and
+    // tiering demotes values without dropping keys), so Redis' 'e' class
+    // does not exist here
+    static constexpr int kKeyspace = 1 << 0;  // K: __keyspace@0__:<key> channels
+    static constexpr int kKeyevent = 1 << 1;  // E: __keyevent@0__:<event> channels
+    static constexpr int kGeneric = 1 << 2;   // g: del, expire, restore
+    static constexpr int kString = 1 << 3;    // $: string, counter and HyperLogLog writes
+    static constexpr int kHash = 1 << 4;      // h
+    static constexpr int kZset = 1 << 5;      // z
+    static constexpr int kExpired = 1 << 6;   // x
+    static constexpr int kBloom = 1 << 7;     // b: Bloom filter writes
+    static constexpr int kAll = kGeneric | kString | kHash | kZset | kExpired | kBloom;  // A
+
+    static constexpr size_t kDefaultBufferEvents = 4096;
+
+    struct Event {
+        int type = 0;
+        std::string event;
+        std::string key;
+    };
+    using Consumer = std::function<void(const Event& event)>;
+    using Publish = std::function<void(const std::string& channel, const std::string& message)>;
+
+    explicit KeyspaceEvents(size_t buffer_events = kDefaultBufferEvents);
+    ~KeyspaceEvents();
+    KeyspaceEvents(const KeyspaceEvents&) = delete;
+    KeyspaceEvents& operator=(const KeyspaceEvents&) = delete;
+
+    // "KEA"-style flags to classes and back; parse throws std::runtime_error
+    // on an unknown letter
+    static int parse_classes(std::string_view flags);
+    static std::string format_classes(int classes);
+
+    void set_classes(int classes);
+    int classes() const { return classes_.load(std::memory_order_relaxed); }
+    // Events per producer thread's ring, rounded up to a power of two;
+    // applies to rings created afterwards
+    void set_buffer_events(size_t events);
+
+    // Whether an event of this type would be kept: its class is enabled and
+    // something listens (K or E is set, or a consumer is registered)
+    bool wants(int type) const { return (active_.load(std::memory_order_relaxed) & type) != 0; }
+
+    // Appends to the calling thread's ring; never blocks
+    void notify(int type, std::string_view event, std::string_view key) {
+        if (wants(type)) append(type, event, key);
+    }
+
+    // Consumers run on the publisher thread, so a slow one makes events
+    // drop instead of slowing writes. After remove_consumer returns, that
+    // consumer is not called again.
+    uint64_t add_consumer(Consumer consumer);
+    void remove_consumer(uint64_t id);
+    // Delivers to the K and E channels; unset, only consumers see events
+    void set_publisher(Publish publish);
+
+    // The publisher thread runs from start() to stop(), but is only
+    // launched once an event class is enabled with a listener
+    void start();
+    void stop();  // drains what is left, then joins the publisher thread
+    bool publishing() const;
+    // Delivers every buffered event on the calling thread; returns how many
+    size_t drain();
+
+    uint64_t emitted() const;  // buffered for delivery
+    uint64_t dropped() const;  // lost to a full ring
+    uint64_t delivered() const { return delivered_.load(std::memory_order_relaxed); }
+
+private:
+    struct Ring;
+    static thread_local std::vector<std::pair<uint64_t, std::shared_ptr<Ring>>> thread_rings_;
+
+    // Never reused, so a thread's cached ring can't be mistaken for one of
+    // a later instance at the same address
+    const uint64_t instance_id_;
+    std::atomic<int> classes_{0};
+    std::atomic<int> active_{0};
+    std::atomic<size_t> buffer_events_;
+
+    mutable std::mutex rings_mutex_;
+    std::vector<std::shared_ptr<Ring>> rings_;
+    uint64_t retired_emitted_ = 0;  // counts of rings whose thread has exited
+    uint64_t retired_dropped_ = 0;
+
+    std::mutex drain_mutex_;  // the rings' single consumer
+    std::mutex consumers_mutex_;
+    std::vector<std::pair<uint64_t, Consumer>> consumers_;
+    uint64_t next_consumer_id_ = 1;
+    Publish publish_;
+    std::atomic<uint64_t> delivered_{0};
+
+    std::atomic<bool> running_{false};
+    std::atomic<bool> waiting_{false};  // the publisher is asleep or about to be
+    mutable std::mutex thread_mutex_;
+    std::condition_variable cv_;
+    std::thread thread_;
+
+    void append(int type, std::string_view event, std::string_view key);
+    void launch();
+    void publish_loop();
+    bool pending() const;
+    Ring& thread_ring();
+    void deliver(const Event& event);
+    void update_active();
+};
+
+}  // namespace cacheforge
+
+#endif  // CACHEFORGE_KEYSPACE_EVENTS_H
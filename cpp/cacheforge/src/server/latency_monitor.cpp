@@ -0,0 +1,61 @@
+#include "server/latency_monitor.h"
+#include <algorithm>
+
+namespace cacheforge {
+
+LatencyMonitor::LatencyMonitor(uint64_t threshold_us) : threshold_us_(threshold_us) {}
+
+void LatencyMonitor::record(const std::string& event, uint64_t duration_us) {
+    uint64_t threshold = threshold_us_.load(std::memory_order_relaxed);
+    if (threshold == 0 || duration_us < threshold) return;
+
+    int64_t now = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    std::lock_guard lock(mutex_);
+    auto& series = events_[event];
+    // Like Redis, samples in the same second are merged keeping the worst
+    if (!series.samples.empty() && series.samples.back().timestamp == now) {
+        auto& last = series.samples.back();
+        last.duration_us = std::max(last.duration_us, duration_us);
+    } else {
+        series.samples.push_back({now, duration_us});
+        if (series.samples.size() > kHistoryLen) series.samples.pop_front();
+    }
+    series.max_us = std::max(series.max_us, duration_us);
+}
+
+std::vector<LatencyMonitor::EventSummary> LatencyMonitor::latest() const {
+    std::vector<EventSummary> result;
+    {
+        std::lock_guard lock(mutex_);
+        for (const auto& [event, series] : events_) {
+            if (series.samples.empty()) continue;
+            result.push_back({event, series.samples.back(), series.max_us});
+        }
+    }
+    std::sort(result.begin(), result.end(),
+              [](const auto& a, const auto& b) { return a.event < b.event; });
+    return result;
+}
+
+std::vector<LatencyMonitor::Sample> LatencyMonitor::history(const std::string& event) const {
+    std::lock_guard lock(mutex_);
+    auto it = events_.find(event);
+    if (it == events_.end()) return {};
+    return {it->second.samples.begin(), it->second.samples.end()};
+}
+
+size_t LatencyMonitor::reset(const std::vector<std::string>& events) {
+    std::lock_guard lock(mutex_);
+    if (events.empty()) {
+        size_t n = events_.size();
+        events_.clear();
+        return n;
+    }
+    size_t n = 0;
+    for (const auto& event : events) n += events_.erase(event);
+    return n;
+}
+
+}  // namespace cacheforge
@@ -0,0 +1,83 @@
+#pragma once
+#ifndef CACHEFORGE_LATENCY_MONITOR_H
+#define CACHEFORGE_LATENCY_MONITOR_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace cacheforge {
+
+// Latency monitor for internal event classes: command, expire-cycle,
+// active-defrag-cycle, tiering-demote, tiering-compact and snapshot-load.
+// Events at or above the threshold are kept as a short per-event history
+// plus the all-time maximum. Events are infrequent compared to commands, so
+// a mutex is acceptable; the threshold check in front of it is lock-free.
+class LatencyMonitor {
+public:
+    static constexpr size_t kHistoryLen = 160;
+
+    struct Sample {
+        int64_t timestamp;  // unix seconds
+        uint64_t duration_us;
+    };
+
+    struct EventSummary {
+        std::string event;
+        Sample latest;
+        uint64_t max_us;
+    };
+
+    explicit LatencyMonitor(uint64_t threshold_us = 0);
+
+    // threshold 0 disables the monitor
+    void set_threshold_us(uint64_t threshold_us) {
+        threshold_us_.store(threshold_us, std::memory_order_relaxed);
+    }
+    uint64_t threshold_us() const { return threshold_us_.load(std::memory_order_relaxed); }
+
+    void record(const std::string& event, uint64_t duration_us);
+
+    std::vector<EventSummary> latest() const;
+    std::vector<Sample> history(const std::string& event) const;
+    // Clears the given events, or all of them when empty; returns how many
+    size_t reset(const std::vector<std::string>& events = {});
+
+    // Times a scope and records it under `event` when it ends
+    class Scope {
+    public:
+        Scope(LatencyMonitor& monitor, std::string event)
+            : monitor_(monitor), event_(std::move(event)), started_(std::chrono::steady_clock::now()) {}
+        ~Scope() {
+            auto elapsed = std::chrono::steady_clock::now() - started_;
+            monitor_.record(event_, static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()));
+        }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        LatencyMonitor& monitor_;
+        std::string event_;
+        std::chrono::steady_clock::time_point started_;
+    };
+
+private:
+    struct Series {
+        std::deque<Sample> samples;
+        uint64_t max_us = 0;
+    };
+
+    std::atomic<uint64_t> threshold_us_;
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, Series> events_;
+};
+
+}  // namespace cacheforge
+
+#endif  // CACHEFORGE_LATENCY_MONITOR_H
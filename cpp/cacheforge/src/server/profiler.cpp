@@ -0,0 +1,237 @@
+#include "server/profiler.h"
+#include <spdlog/spdlog.h>
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <malloc.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+namespace cacheforge {
+
+namespace {
+
+// State the signal handler reads; only one profiler samples at a time
+std::atomic<bool> g_claimed{false};
+std::atomic<Profiler*> g_active{nullptr};
+std::atomic<uint64_t> g_next{0};
+std::atomic<uint64_t> g_dropped{0};
+std::atomic<int> g_in_handler{0};
+
+// The handler's own frame and the kernel's signal trampoline
+constexpr uint32_t kSkipFrames = 2;
+
+std::string symbolize(void* addr) {
+    // A return address points past its call; step back into it
+    auto pc = reinterpret_cast<uintptr_t>(addr) - 1;
+    Dl_info info{};
+    if (dladdr(reinterpret_cast<void*>(pc), &info) && info.dli_sname) {
+        int status = 0;
+        char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+        std::string name = status == 0 && demangled ? demangled : info.dli_sname;
+        std::free(demangled);
+        return name;
+    }
+    char buf[64];
+    if (info.dli_fname && info.dli_fbase) {
+        std::string module = std::filesystem::path(info.dli_fname).filename().string();
+        std::snprintf(buf, sizeof(buf), "+0x%zx", pc - reinterpret_cast<uintptr_t>(info.dli_fbase));
+        return module + buf;
+    }
+    std::snprintf(buf, sizeof(buf), "0x%zx", pc);
+    return buf;
+}
+
+const char* type_name(Value::Type type) {
+    switch (type) {
+        case Value::Type::String: return "string";
+        case Value::Type::Integer: return "integer";
+        case Value::Type::List: return "list";
+        case Value::Type::Binary: return "binary";
+        case Value::Type::Hash: return "hash";
+        case Value::Type::SortedSet: return "zset";
+        case Value::Type::HyperLogLog: return "hll";
+        case Value::Type::Bloom: return "bloom";
+    }
+    return "unknown";
+}
+
+// Bytes the allocator has handed out and not had back
+size_t malloc_in_use() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+#else
+    return 0;
+#endif
+}
+
+}  // namespace
+
+Profiler::Profiler(std::string output_dir) : output_dir_(std::move(output_dir)) {}
+
+Profiler::~Profiler() {
+    std::lock_guard lock(mutex_);
+    if (g_active.load() != this) return;
+    struct itimerval off{};
+    setitimer(ITIMER_PROF, &off, nullptr);
+    g_active.store(nullptr);
+    signal(SIGPROF, SIG_IGN);
+    while (g_in_handler.load() > 0) std::this_thread::yield();
+    g_claimed.store(false);
+}
+
+void Profiler::on_sigprof(int /*signo*/) {
+    int saved_errno = errno;
+    g_in_handler.fetch_add(1);
+    if (Profiler* self = g_active.load()) {
+        uint64_t slot = g_next.fetch_add(1, std::memory_order_relaxed);
+        if (slot < kMaxSamples) {
+            Sample& sample = self->samples_[slot];
+            sample.depth = static_cast<uint32_t>(backtrace(sample.frames, kMaxDepth));
+            sample.ready.store(true, std::memory_order_release);
+        } else {
+            g_dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    g_in_handler.fetch_sub(1);
+    errno = saved_errno;
+}
+
+void Profiler::start_cpu(int hz) {
+    std::lock_guard lock(mutex_);
+    if (hz < 1 || hz > 1000) throw std::runtime_error("sampling rate must be between 1 and 1000 Hz");
+    if (g_claimed.exchange(true)) throw std::runtime_error("a CPU profile is already running");
+
+    samples_ = std::make_unique<Sample[]>(kMaxSamples);
+    // The first backtrace() loads the unwinder, which is not safe to do in
+    // a signal handler
+    void* warmup[1];
+    backtrace(warmup, 1);
+
+    hz_ = hz;
+    g_next.store(0);
+    g_dropped.store(0);
+    g_active.store(this);
+
+    struct sigaction action{};
+    action.sa_handler = &Profiler::on_sigprof;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    // tv_usec must stay below a second, so 1 Hz is {1, 0}
+    long interval_us = 1000000L / hz;
+    struct itimerval timer{};
+    timer.it_interval.tv_sec = interval_us / 1000000;
+    timer.it_interval.tv_usec = interval_us % 1000000;
+    timer.it_value = timer.it_interval;
+    if (sigaction(SIGPROF, &action, nullptr) != 0 || setitimer(ITIMER_PROF, &timer, nullptr) != 0) {
+        int error = errno;
+        // Hand the claim back so a later PROFILE CPU START can try again
+        g_active.store(nullptr);
+        signal(SIGPROF, SIG_IGN);
+        while (g_in_handler.load() > 0) std::this_thread::yield();
+        samples_.reset();
+        g_claimed.store(false);
+        throw std::runtime_error(std::string("failed to start the profiling timer: ") + std::strerror(error));
+    }
+    spdlog::info("CPU profiling started at {} Hz", hz);
+}
+
+std::string Profiler::stop_cpu() {
+    std::lock_guard lock(mutex_);
+    if (g_active.load() != this) throw std::runtime_error("no CPU profile is running");
+
+    struct itimerval off{};
+    setitimer(ITIMER_PROF, &off, nullptr);
+    g_active.store(nullptr);
+    // A signal still pending would kill the process under SIG_DFL
+    signal(SIGPROF, SIG_IGN);
+    while (g_in_handler.load() > 0) std::this_thread::yield();
+
+    // Identical stacks are counted once; frames are symbolized once each
+    std::map<std::vector<void*>, uint64_t> stacks;
+    uint64_t taken = std::min<uint64_t>(g_next.load(), kMaxSamples);
+    for (uint64_t i = 0; i < taken; ++i) {
+        const Sample& sample = samples_[i];
+        if (!sample.ready.load(std::memory_order_acquire) || sample.depth <= kSkipFrames) continue;
+        // backtrace() lists the innermost frame first; folded stacks start at the root
+        std::vector<void*> frames(sample.frames + kSkipFrames, sample.frames + sample.depth);
+        std::reverse(frames.begin(), frames.end());
+        ++stacks[frames];
+    }
+    uint64_t dropped = g_dropped.load();
+    samples_.reset();
+    g_claimed.store(false);
+
+    std::unordered_map<void*, std::string> names;
+    std::string path = output_path("cpu");
+    std::ofstream out(path);
+    for (const auto& [frames, count] : stacks) {
+        std::string line;
+        for (void* frame : frames) {
+            auto it = names.find(frame);
+            if (it == names.end()) it = names.emplace(frame, symbolize(frame)).first;
+            if (!line.empty()) line += ';';
+            line += it->second;
+        }
+        out << line << ' ' << count << '\n';
+    }
+    out.close();
+    if (!out) throw std::runtime_error("failed to write " + path);
+    spdlog::info("CPU profile written to {} ({} samples, {} dropped)", path, taken, dropped);
+    return path;
+}
+
+Profiler::CpuStatus Profiler::cpu_status() const {
+    std::lock_guard lock(mutex_);
+    CpuStatus status;
+    status.running = g_active.load() == this;
+    if (status.running) {
+        status.hz = hz_;
+        status.samples = std::min<uint64_t>(g_next.load(), kMaxSamples);
+        status.dropped = g_dropped.load();
+    }
+    return status;
+}
+
+std::string Profiler::write_heap(const HashTable& table) const {
+    std::string path = output_path("heap");
+    std::ofstream out(path);
+    size_t keyspace = 0;
+    for (const auto& c : table.size_classes()) {
+        out << "heap;keyspace;" << type_name(c.type);
+        if (c.compressed) out << ";compressed";
+        if (c.cold) out << ";cold";
+        out << ";<=" << c.max_bytes << "B " << c.bytes << '\n';
+        keyspace += c.bytes;
+    }
+    // Whatever the allocator holds beyond the keyspace: buffers, indexes,
+    // fragmentation inside allocations
+    size_t in_use = malloc_in_use();
+    if (in_use > keyspace) out << "heap;other " << in_use - keyspace << '\n';
+    out.close();
+    if (!out) throw std::runtime_error("failed to write " + path);
+    spdlog::info("Heap profile written to {}", path);
+    return path;
+}
+
+std::string Profiler::output_path(const char* kind) const {
+    std::filesystem::create_directories(output_dir_);
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
+    return output_dir_ + "/" + kind + "_" + std::to_string(ms) + ".folded";
+}
+
+}  // namespace cacheforge
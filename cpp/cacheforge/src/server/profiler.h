@@ -0,0 +1,80 @@
+#pragma once
+#ifndef CACHEFORGE_PROFILER_H
+#define CACHEFORGE_PROFILER_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include "storage/hashtable.h"
+
+namespace cacheforge {
+
+// In-process profiles for instances no external profiler can attach to,
+// written to `output_dir` in the folded-stack format flamegraph.pl and
+// speedscope read ("frame;frame;frame weight" per line).
+//
+// The CPU profiler samples stacks on SIGPROF, which setitimer(ITIMER_PROF)
+// raises `hz` times per second of CPU time the process uses, in whichever
+// thread is running (at most once per kernel tick, so high rates may get
+// fewer samples). The handler only records the raw return addresses
+// into a buffer allocated by start_cpu(); stop_cpu() symbolizes and
+// aggregates them. Nothing is installed while it is stopped, so it costs
+// nothing then. Symbols come from the dynamic symbol table, so executables
+// must be linked with -rdynamic (ENABLE_EXPORTS) to name their own frames.
+//
+// The heap profile groups the table's entries by value type and size
+// class (HashTable::size_classes), weighted by bytes.
+class Profiler {
+public:
+    static constexpr size_t kMaxDepth = 48;
+    static constexpr size_t kMaxSamples = 1 << 15;  // ~5.5 min of CPU at 99 Hz
+
+    struct CpuStatus {
+        bool running = false;
+        int hz = 0;
+        uint64_t samples = 0;
+        uint64_t dropped = 0;  // taken after the buffer filled up
+    };
+
+    explicit Profiler(std::string output_dir);
+    ~Profiler();
+
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    // Throws std::runtime_error if `hz` is out of range or a CPU profile is
+    // already running in this process (SIGPROF is process-wide)
+    void start_cpu(int hz = 99);
+    // Stops sampling and writes the profile; returns its path. Throws
+    // std::runtime_error if not running or the file can't be written
+    std::string stop_cpu();
+    CpuStatus cpu_status() const;
+
+    // Writes a heap profile of `table`; returns its path
+    std::string write_heap(const HashTable& table) const;
+
+    const std::string& output_dir() const { return output_dir_; }
+
+private:
+    struct Sample {
+        std::atomic<bool> ready{false};
+        uint32_t depth = 0;
+        void* frames[kMaxDepth];
+    };
+
+    std::string output_dir_;
+    mutable std::mutex mutex_;
+    int hz_ = 0;
+    std::unique_ptr<Sample[]> samples_;
+
+    static void on_sigprof(int signo);
+    std::string output_path(const char* kind) const;
+};
+
+}  // namespace cacheforge
+
+#endif  // CACHEFORGE_PROFILER_H
@@ -0,0 +1,268 @@
+#include "server/pubsub.h"
+#include "protocol/parser.h"
+#include <algorithm>
+#include <mutex>
+
+namespace cacheforge {
+
+namespace {
+
+// Length of the pattern's literal prefix: everything up to the first
+// character that can match more than itself
+size_t literal_prefix(const std::string& pattern) {
+    size_t i = pattern.find_first_of("*?[\\");
+    return i == std::string::npos ? pattern.size() : i;
+}
+
+std::string serialize_message(const std::string& channel, const std::string& message) {
+    return Parser::serialize_push_header(3) + Parser::serialize_string("message") +
+           Parser::serialize_string(channel) + Parser::serialize_string(message);
+}
+
+std::string serialize_pmessage(const std::string& pattern, const std::string& channel,
+                               const std::string& message) {
+    return Parser::serialize_push_header(4) + Parser::serialize_string("pmessage") +
+           Parser::serialize_string(pattern) + Parser::serialize_string(channel) +
+           Parser::serialize_string(message);
+}
+
+// Matches one character against the pattern element at p, anything but
+// '*'; returns how many pattern characters the element spans, 0 if the
+// character does not match. An unterminated class runs to the pattern's end
+size_t match_one(const char* p, size_t plen, char c) {
+    switch (*p) {
+    case '?':
+        return 1;
+    case '[': {
+        size_t i = 1;
+        bool negate = i < plen && p[i] == '^';
+        if (negate) ++i;
+        bool matched = false;
+        while (i < plen && p[i] != ']') {
+            if (p[i] == '\\' && i + 1 < plen) {
+                ++i;
+                matched |= p[i] == c;
+            } else if (i + 2 < plen && p[i + 1] == '-') {
+                char lo = std::min(p[i], p[i + 2]), hi = std::max(p[i], p[i + 2]);
+                matched |= c >= lo && c <= hi;
+                i += 2;
+            } else {
+                matched |= p[i] == c;
+            }
+            ++i;
+        }
+        if (matched == negate) return 0;
+        return i < plen ? i + 1 : plen;
+    }
+    case '\\':
+        if (plen >= 2) return p[1] == c ? 2 : 0;
+        [[fallthrough]];
+    default:
+        return *p == c ? 1 : 0;
+    }
+}
+
+}  // namespace
+
+bool PubSub::glob_match(const char* p, size_t plen, const char* s, size_t slen) {
+    // Left to right, remembering only the last '*': on a mismatch that star
+    // takes one more character and matching resumes just past it. An
+    // earlier star never needs revisiting, since whatever it could absorb
+    // the later one can too, so the work is bounded by plen * slen with no
+    // recursion, whatever the pattern
+    const char* star_p = nullptr;
+    size_t star_plen = 0;
+    const char* star_s = nullptr;
+    size_t star_slen = 0;
+    for (;;) {
+        if (plen > 0 && *p == '*') {
+            while (plen > 0 && *p == '*') { ++p; --plen; }
+            if (plen == 0) return true;
+            star_p = p; star_plen = plen;
+            star_s = s; star_slen = slen;
+            continue;
+        }
+        if (plen == 0 && slen == 0) return true;
+        if (plen > 0 && slen > 0) {
+            size_t used = match_one(p, plen, *s);
+            if (used > 0) {
+                p += used; plen -= used;
+                ++s; --slen;
+                continue;
+            }
+        }
+        if (!star_p || star_slen == 0) return false;
+        ++star_s; --star_slen;
+        p = star_p; plen = star_plen;
+        s = star_s; slen = star_slen;
+    }
+}
+
+size_t PubSub::subscribe(uint64_t client_id, const std::string& channel) {
+    std::unique_lock lock(mutex_);
+    auto& subs = clients_[client_id];
+    if (subs.channels.insert(channel).second) channels_[channel].insert(client_id);
+    return subs.count();
+}
+
+size_t PubSub::unsubscribe(uint64_t client_id, const std::string& channel) {
+    std::unique_lock lock(mutex_);
+    return unsubscribe_locked(client_id, channel);
+}
+
+size_t PubSub::unsubscribe_locked(uint64_t client_id, const std::string& channel) {
+    auto client = clients_.find(client_id);
+    if (client == clients_.end()) return 0;
+    if (client->second.channels.erase(channel)) {
+        auto it = channels_.find(channel);
+        if (it != channels_.end()) {
+            it->second.erase(client_id);
+            if (it->second.empty()) channels_.erase(it);
+        }
+    }
+    size_t count = client->second.count();
+    if (count == 0) clients_.erase(client);
+    return count;
+}
+
+size_t PubSub::psubscribe(uint64_t client_id, const std::string& pattern) {
+    std::unique_lock lock(mutex_);
+    auto& subs = clients_[client_id];
+    if (!subs.patterns.insert(pattern).second) return subs.count();
+
+    PatternNode* node = &pattern_root_;
+    for (size_t i = 0, n = literal_prefix(pattern); i < n; ++i) {
+        auto& child = node->children[pattern[i]];
+        if (!child) child = std::make_unique<PatternNode>();
+        node = child.get();
+    }
+    auto& subscribers = node->patterns[pattern];
+    if (subscribers.empty()) pattern_count_++;
+    subscribers.insert(client_id);
+    return subs.count();
+}
+
+size_t PubSub::punsubscribe(uint64_t client_id, const std::string& pattern) {
+    std::unique_lock lock(mutex_);
+    return punsubscribe_locked(client_id, pattern);
+}
+
+size_t PubSub::punsubscribe_locked(uint64_t client_id, const std::string& pattern) {
+    auto client = clients_.find(client_id);
+    if (client == clients_.end()) return 0;
+    if (client->second.patterns.erase(pattern)) {
+        // Walk down remembering the path so emptied nodes can be pruned
+        std::vector<std::pair<PatternNode*, char>> path;
+        PatternNode* node = &pattern_root_;
+        for (size_t i = 0, n = literal_prefix(pattern); i < n && node; ++i) {
+            path.emplace_back(node, pattern[i]);
+            auto it = node->children.find(pattern[i]);
+            node = it == node->children.end() ? nullptr : it->second.get();
+        }
+        if (node) {
+            auto it = node->patterns.find(pattern);
+            if (it != node->patterns.end()) {
+                it->second.erase(client_id);
+                if (it->second.empty()) {
+                    node->patterns.erase(it);
+                    pattern_count_--;
+                }
+            }
+            for (auto p = path.rbegin(); p != path.rend(); ++p) {
+                auto child = p->first->children.find(p->second);
+                if (!child->second->patterns.empty() || !child->second->children.empty()) break;
+                p->first->children.erase(child);
+            }
+        }
+    }
+    size_t count = client->second.count();
+    if (count == 0) clients_.erase(client);
+    return count;
+}
+
+void PubSub::forget_client(uint64_t client_id) {
+    std::unique_lock lock(mutex_);
+    auto client = clients_.find(client_id);
+    if (client == clients_.end()) return;
+    std::vector<std::string> channels(client->second.channels.begin(), client->second.channels.end());
+    std::vector<std::string> patterns(client->second.patterns.begin(), client->second.patterns.end());
+    for (const auto& channel : channels) unsubscribe_locked(client_id, channel);
+    for (const auto& pattern : patterns) punsubscribe_locked(client_id, pattern);
+    clients_.erase(client_id);
+}
+
+std::vector<std::string> PubSub::channels_of(uint64_t client_id) const {
+    std::shared_lock lock(mutex_);
+    auto it = clients_.find(client_id);
+    if (it == clients_.end()) return {};
+    return {it->second.channels.begin(), it->second.channels.end()};
+}
+
+std::vector<std::string> PubSub::patterns_of(uint64_t client_id) const {
+    std::shared_lock lock(mutex_);
+    auto it = clients_.find(client_id);
+    if (it == clients_.end()) return {};
+    return {it->second.patterns.begin(), it->second.patterns.end()};
+}
+
+size_t PubSub::publish(const std::string& channel, const std::string& message,
+                       const Deliver& deliver) const {
+    std::vector<std::pair<Message, std::vector<uint64_t>>> batches;
+    {
+        std::shared_lock lock(mutex_);
+        auto it = channels_.find(channel);
+        if (it != channels_.end()) {
+            batches.emplace_back(std::make_shared<const std::string>(serialize_message(channel, message)),
+                                 std::vector<uint64_t>(it->second.begin(), it->second.end()));
+        }
+        if (pattern_count_ > 0) {
+            const PatternNode* node = &pattern_root_;
+            for (size_t depth = 0; node; ++depth) {
+                for (const auto& [pattern, subscribers] : node->patterns) {
+                    if (!glob_match(pattern.data(), pattern.size(), channel.data(), channel.size())) {
+                        continue;
+                    }
+                    batches.emplace_back(
+                        std::make_shared<const std::string>(serialize_pmessage(pattern, channel, message)),
+                        std::vector<uint64_t>(subscribers.begin(), subscribers.end()));
+                }
+                if (depth == channel.size()) break;
+                auto child = node->children.find(channel[depth]);
+                node = child == node->children.end() ? nullptr : child->second.get();
+            }
+        }
+    }
+
+    size_t receivers = 0;
+    for (const auto& [buffer, ids] : batches) {
+        receivers += ids.size();
+        if (!deliver) continue;
+        for (uint64_t id : ids) deliver(id, buffer);
+    }
+    return receivers;
+}
+
+std::vector<std::string> PubSub::active_channels(const std::string& pattern) const {
+    std::shared_lock lock(mutex_);
+    std::vector<std::string> out;
+    for (const auto& [channel, subscribers] : channels_) {
+        if (pattern.empty() || glob_match(pattern.data(), pattern.size(), channel.data(), channel.size())) {
+            out.push_back(channel);
+        }
+    }
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+size_t PubSub::num_subscribers(const std::string& channel) const {
+    std::shared_lock lock(mutex_);
+    auto it = channels_.find(channel);
+    return it == channels_.end() ? 0 : it->second.size();
+}
+
+size_t PubSub::num_patterns() const {
+    std::shared_lock lock(mutex_);
+    return pattern_count_;
+}
+
+}  // namespace cacheforge
@@ -0,0 +1,79 @@
+#pragma once
+#ifndef CACHEFORGE_PUBSUB_H
+#define CACHEFORGE_PUBSUB_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <shared_mutex>
+#include <cstdint>
+
+namespace cacheforge {
+
+// Channel and pattern subscriptions for PUBLISH/SUBSCRIBE/PSUBSCRIBE.
+// Channels map straight to their subscribers. Patterns live in a trie keyed
+// by their literal prefix (the part before the first glob character), so a
+// publish only glob-matches the patterns whose prefix the channel starts
+// with instead of every pattern on the server.
+// A published message is serialized once per channel (and once per
+// matching pattern) and the same buffer is handed to every recipient.
+class PubSub {
+public:
+    using Message = std::shared_ptr<const std::string>;
+    using Deliver = std::function<void(uint64_t client_id, const Message& message)>;
+
+    // Each returns the client's subscription count (channels + patterns)
+    // after the change, as SUBSCRIBE and friends reply
+    size_t subscribe(uint64_t client_id, const std::string& channel);
+    size_t unsubscribe(uint64_t client_id, const std::string& channel);
+    size_t psubscribe(uint64_t client_id, const std::string& pattern);
+    size_t punsubscribe(uint64_t client_id, const std::string& pattern);
+    void forget_client(uint64_t client_id);
+
+    std::vector<std::string> channels_of(uint64_t client_id) const;
+    std::vector<std::string> patterns_of(uint64_t client_id) const;
+
+    // Delivers to channel subscribers and matching pattern subscribers
+    // (once per matching pattern, like Redis); returns the number of
+    // deliveries. Recipients are collected under the lock and delivered
+    // after it is released.
+    size_t publish(const std::string& channel, const std::string& message,
+                   const Deliver& deliver) const;
+
+    // Channels with at least one subscriber, optionally glob-filtered
+    std::vector<std::string> active_channels(const std::string& pattern = "") const;
+    size_t num_subscribers(const std::string& channel) const;
+    size_t num_patterns() const;
+
+    // Redis-style glob: *, ?, [abc], [^a-z] and backslash escapes
+    static bool glob_match(const char* pattern, size_t plen, const char* str, size_t slen);
+
+private:
+    struct PatternNode {
+        std::unordered_map<char, std::unique_ptr<PatternNode>> children;
+        // Full pattern -> subscribers, for patterns whose literal prefix
+        // ends at this node
+        std::unordered_map<std::string, std::unordered_set<uint64_t>> patterns;
+    };
+    struct ClientSubs {
+        std::unordered_set<std::string> channels;
+        std::unordered_set<std::string> patterns;
+        size_t count() const { return channels.size() + patterns.size(); }
+    };
+
+    std::unordered_map<std::string, std::unordered_set<uint64_t>> channels_;
+    PatternNode pattern_root_;
+    size_t pattern_count_ = 0;
+    std::unordered_map<uint64_t, ClientSubs> clients_;
+    mutable std::shared_mutex mutex_;
+
+    size_t unsubscribe_locked(uint64_t client_id, const std::string& channel);
+    size_t punsubscribe_locked(uint64_t client_id, const std::string& pattern);
+};
+
+}  // namespace cacheforge
+
+#endif  // CACHEFORGE_PUBSUB_H
@@ -1,6 +1,10 @@
 #include "server/server.h"
 #include "server/connection.h"
+#include "utils/cpu.h"
+#include "protocol/parser.h"
 #include <spdlog/spdlog.h>
+#include <algorithm>
+#include <stdexcept>
 
 namespace cacheforge {
 
@@ -14,6 +18,78 @@ Server::Server(const Config& config)
                 boost::asio::ip::tcp::endpoint(
                     boost::asio::ip::make_address(config.bind_address),
                     config.port)) {
+    // The seed is process-wide and every table in the process already
+    // hashes with it, so a server can only check it, never change it
+    if (config.hash_seed != 0 && config.hash_seed != hashing::seed()) {
+        throw std::runtime_error("hash_seed must be applied with hashing::set_seed() before any Server exists");
+    }
+    table_.set_compression(config.value_compression_min_bytes);
+    handler_.tracking().set_max_keys(config.tracking_table_max_keys);
+    handler_.hotkeys().set_enabled(config.hotkeys_enabled);
+    handler_.hotkeys().set_sample_rate(config.hotkeys_sample_rate);
+    handler_.hotkeys().set_top_k(config.hotkeys_top_k);
+    handler_.hotkeys().set_decay_interval(config.hotkeys_decay_interval);
+    handler_.stats().set_latency_sample_rate(config.stats_latency_sample_rate);
+    handler_.slowlog().set_threshold_us(config.slowlog_log_slower_than_us);
+    handler_.latency_monitor().set_threshold_us(config.latency_monitor_threshold_us);
+    handler_.set_profiler(&profiler_);
+    worker_cpus_ = cpu::parse_list(config.worker_cpus);
+    persistence_cpus_ = cpu::parse_list(config.persistence_cpus);
+    expiry_.set_cpus(cpu::parse_list(config.expiry_cpus));
+    // Invalidations queued by the pass's keys go out in one push per client
+    expiry_.set_cycle_callback([this](std::chrono::microseconds took, size_t /*expired*/) {
+        handler_.flush_invalidations();
+        handler_.latency_monitor().record("expire-cycle", static_cast<uint64_t>(took.count()));
+    });
+    handler_.set_push_callback([this](uint64_t client_id,
+                                      const std::shared_ptr<const std::string>& message) {
+        if (auto conn = find_connection(client_id)) {
+            conn->enqueue_reply(message);
+        }
+    });
+    handler_.keyspace_events().set_buffer_events(config.keyspace_events_buffer);
+    handler_.keyspace_events().set_classes(KeyspaceEvents::parse_classes(config.notify_keyspace_events));
+    // No eviction callback: the table only reports a write past max_size
+    // and removes nothing, so counting it or invalidating the key would
+    // report an eviction that never happened
+    // Runs on the expiry thread after the key has left the table
+    expiry_.set_expiry_callback([this](const std::string& key) {
+        handler_.stats().add(Stats::kExpiredKeys);
+        handler_.invalidate_key(key);
+        handler_.keyspace_events().notify(KeyspaceEvents::kExpired, "expired", key);
+    });
+    if (!config.tiered_storage_dir.empty()) {
+        TieringOptions tiering;
+        tiering.dir = config.tiered_storage_dir;
+        tiering.memory_budget = config.max_memory_bytes;
+        tiering.segment_bytes = config.tiered_segment_bytes;
+        tiering.promote_after = config.tiered_promote_after;
+        tiering.compact_dead_ratio = config.tiered_compact_dead_ratio;
+        tiering_ = std::make_unique<TieredStorage>(table_, tiering);
+        handler_.set_tiering(tiering_.get());
+        spdlog::info("Tiered storage in {} above {} resident bytes", tiering.dir, tiering.memory_budget);
+    }
+    if (config.active_defrag) {
+        DefragOptions defrag;
+        defrag.start_ratio = config.active_defrag_start_ratio;
+        defrag.stop_ratio = config.active_defrag_stop_ratio;
+        defrag.ignore_bytes = config.active_defrag_ignore_bytes;
+        defrag.cpu_percent = config.active_defrag_cpu_percent;
+        defrag_ = std::make_unique<Defragmenter>(table_, defrag);
+        defrag_->set_cycle_callback([this](std::chrono::microseconds took) {
+            handler_.latency_monitor().record("active-defrag-cycle", static_cast<uint64_t>(took.count()));
+        });
+        handler_.set_defragmenter(defrag_.get());
+    }
+    if (!config.cluster_topology.empty()) {
+        std::string self = config.cluster_self.empty()
+                               ? "127.0.0.1:" + std::to_string(config.port)
+                               : config.cluster_self;
+        cluster_ = std::make_unique<ClusterState>(config.cluster_topology, self);
+        migrator_ = std::make_unique<SlotMigrator>(table_, *cluster_);
+        handler_.set_cluster(cluster_.get(), migrator_.get());
+        spdlog::info("Cluster node {} serving {} slots", self, cluster_->owned_slots());
+    }
     spdlog::info("Server initialized on {}:{}", config.bind_address, config.port);
 }
 
@@ -23,15 +99,44 @@ Server::~Server() {
 
 void Server::start() {
     running_.store(true);
-    run_workers(std::thread::hardware_concurrency());
+    if (config_.load_snapshot_on_start) {
+        handler_.set_load_progress(&load_progress_);
+        // Flagged before the first accept so no command sees a half-loaded
+        // table without the LOADING check
+        load_progress_.loading.store(true);
+        // On a thread of its own even when waited for, so it can be pinned
+        // to persistence_cpus; the load's workers inherit that placement
+        loader_thread_ = std::thread([this]() {
+            if (!persistence_cpus_.empty() && !cpu::pin_thread(persistence_cpus_)) {
+                spdlog::warn("Could not pin the snapshot loader to persistence_cpus");
+            }
+            load_snapshot();
+        });
+        if (!config_.serve_reads_while_loading) loader_thread_.join();
+    }
+    // Queue the first accept before the workers start so io_context::run()
+    // has work and does not return immediately
     accept_connection();
+    schedule_reaper();
+    expiry_.start_expiry_thread();
+    handler_.keyspace_events().start();
+    if (defrag_) defrag_->start();
+    size_t workers = config_.worker_threads;
+    if (workers == 0) workers = worker_cpus_.empty() ? cpu::default_threads() : worker_cpus_.size();
+    run_workers(workers);
 }
 
 void Server::stop() {
     
     accepting_ = false;
     running_.store(false);
+    load_progress_.cancelled.store(true);
+    if (loader_thread_.joinable()) loader_thread_.join();
     io_context_.stop();
+    expiry_.stop_expiry_thread();
+    if (migrator_) migrator_->stop();
+    handler_.keyspace_events().stop();
+    if (defrag_) defrag_->stop();
 
     for (auto& t : worker_threads_) {
         if (t.joinable()) {
@@ -39,52 +144,128 @@ void Server::stop() {
         }
     }
     worker_threads_.clear();
+
+    // No handlers run any more, so connections can be closed from here;
+    // each one unregisters itself
+    connections_.for_each([](const std::shared_ptr<Connection>& conn) { conn->stop(); });
+    connections_.reap();
 }
 
 size_t Server::connection_count() const {
-    
-    // while accept_connection may be modifying the vector
+    // Kept by the registry as an atomic, so no lock is needed here
     return connections_.size();
 }
 
 void Server::broadcast(const std::string& message) {
-    
-    for (auto& conn : connections_) {
-        if (conn && conn->is_active()) {
-            conn->send(message);
-        }
+    // One task per registry shard spreads the fan-out over the workers; each
+    // shard is locked only while it is copied, never while sending
+    auto shared = std::make_shared<const std::string>(message);
+    for (size_t i = 0; i < connections_.shard_count(); ++i) {
+        boost::asio::post(io_context_, [this, shared, i]() {
+            // Post onto each connection's strand rather than writing here
+            for (const auto& conn : connections_.shard_snapshot(i)) {
+                if (conn->is_active()) conn->enqueue_reply(shared);
+            }
+        });
     }
 }
 
 void Server::accept_connection() {
     if (!accepting_) return;
 
+    // Each socket gets its own strand so its reads and posted push
+    // messages never run concurrently on different workers
     acceptor_.async_accept(
+        boost::asio::make_strand(io_context_),
         [this](boost::system::error_code ec, boost::asio::ip::tcp::socket socket) {
             if (!ec) {
-                auto conn = std::make_shared<Connection>(std::move(socket));
-                
-                connections_.push_back(conn);
-                conn->start();
-                spdlog::info("New connection accepted, total: {}", connections_.size());
+                if (connections_.size() >= config_.max_connections) {
+                    boost::system::error_code write_ec;
+                    boost::asio::write(socket, boost::asio::buffer(
+                        Parser::serialize_error("max number of clients reached")), write_ec);
+                    socket.close(write_ec);
+                    handler_.stats().add(Stats::kRejectedConnections);
+                    spdlog::warn("Rejected connection: max_connections ({}) reached",
+                                 config_.max_connections);
+                } else {
+                    uint64_t id = next_client_id_.fetch_add(1);
+                    auto conn = std::make_shared<Connection>(std::move(socket), &handler_, id);
+                    conn->set_limits({config_.client_output_buffer_hard_limit,
+                                      config_.client_output_buffer_soft_limit,
+                                      config_.client_output_buffer_soft_seconds,
+                                      config_.client_output_pause_bytes,
+                                      config_.client_idle_timeout,
+                                      config_.client_query_buffer_limit});
+                    conn->set_close_callback([this](uint64_t closed) { connections_.remove(closed); });
+                    // Started first so the reaper never sees it inactive; one
+                    // that closes before add() is swept on the next pass
+                    conn->start();
+                    connections_.add(id, conn);
+                    spdlog::info("New connection accepted, total: {}", connections_.size());
+                }
             }
             accept_connection();
         });
 }
 
-void Server::run_workers(int thread_count) {
-    for (int i = 0; i < thread_count; ++i) {
-        worker_threads_.emplace_back([this]() {
+void Server::load_snapshot() {
+    LatencyMonitor::Scope timed(handler_.latency_monitor(), "snapshot-load");
+    auto started = std::chrono::steady_clock::now();
+    SnapshotManager snapshots(config_.snapshot_dir);
+    if (!snapshots.load_into(table_, &expiry_, &load_progress_, config_.snapshot_load_threads)) {
+        load_progress_.loading.store(false);
+        spdlog::info("No snapshot to load in {}", config_.snapshot_dir);
+        return;
+    }
+    auto took = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - started);
+    spdlog::info("Snapshot loaded in {} ms", took.count());
+}
+
+std::shared_ptr<Connection> Server::find_connection(uint64_t id) const {
+    auto conn = connections_.find(id);
+    return conn && conn->is_active() ? conn : nullptr;
+}
+
+void Server::run_workers(size_t thread_count) {
+    spdlog::info("Starting {} network worker threads", thread_count);
+    for (size_t i = 0; i < thread_count; ++i) {
+        worker_threads_.emplace_back([this, i]() {
+            if (!worker_cpus_.empty()) {
+                int cpu = worker_cpus_[i % worker_cpus_.size()];
+                if (!cpu::pin_thread({cpu})) spdlog::warn("Could not pin network worker {} to CPU {}", i, cpu);
+            }
             io_context_.run();
         });
     }
 }
 
-void Server::cleanup_connections() {
-    connections_.erase(
-        std::remove_if(connections_.begin(), connections_.end(),
-                       [](const auto& conn) { return !conn || !conn->is_active(); }),
-        connections_.end());
+void Server::schedule_reaper() {
+    // Once a second, like the client part of Redis' serverCron: sweep
+    // connections that closed without unregistering, let the live ones
+    // check idle and soft-limit timeouts on their own strands, demote what
+    // reads promoted past the memory budget, compact the tiered value log
+    // and move table resizes along
+    reap_timer_.expires_after(std::chrono::seconds(1));
+    reap_timer_.async_wait([this](boost::system::error_code ec) {
+        if (ec || !running_.load()) return;
+        connections_.reap();
+        connections_.for_each([](const std::shared_ptr<Connection>& conn) { conn->check_limits(); });
+        if (tiering_) {
+            auto& latency = handler_.latency_monitor();
+            if (tiering_->resident_bytes() > tiering_->memory_budget()) {
+                LatencyMonitor::Scope timed(latency, "tiering-demote");
+                tiering_->enforce_budget();
+            }
+            // One log segment per tick bounds the pause compaction adds
+            LatencyMonitor::Scope timed(latency, "tiering-compact");
+            tiering_->compact(1);
+        }
+        // Finish shard resizes that a read-mostly load leaves hanging, a
+        // millisecond per tick like Redis' incremental rehash in serverCron
+        table_.rehash_step(std::chrono::milliseconds(1));
+        schedule_reaper();
+    });
 }
 
 }  // namespace cacheforge
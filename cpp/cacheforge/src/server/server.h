@@ -5,8 +5,19 @@
 #include <thread>
 #include <atomic>
 #include <functional>
+#include <mutex>
+#include <cstdint>
 #include <boost/asio.hpp>
 #include "config/config.h"
+#include "storage/hashtable.h"
+#include "storage/expiry.h"
+#include "storage/tiering.h"
+#include "storage/defrag.h"
+#include "server/command_handler.h"
+#include "cluster/cluster.h"
+#include "cluster/migrator.h"
+#include "persistence/snapshot.h"
+#include "server/connection_registry.h"
 
 namespace cacheforge {
 
@@ -34,12 +45,28 @@ private:
     Config config_;
     boost::asio::io_context io_context_;
     boost::asio::ip::tcp::acceptor acceptor_;
-    std::vector<std::shared_ptr<Connection>> connections_;
+    HashTable table_;
+    ExpiryManager expiry_{table_};
+    CommandHandler handler_{table_, &expiry_};
+    std::unique_ptr<TieredStorage> tiering_;  // null unless tiered_storage_dir is set
+    std::unique_ptr<Defragmenter> defrag_;    // null unless active_defrag is set
+    std::unique_ptr<ClusterState> cluster_;   // null unless cluster_topology is set
+    std::unique_ptr<SlotMigrator> migrator_;
+    Profiler profiler_{config_.snapshot_dir};
+    LoadProgress load_progress_;
+    std::thread loader_thread_;  // a load that runs while serving reads
+    ConnectionRegistry connections_;
+    std::atomic<uint64_t> next_client_id_{1};
+    boost::asio::steady_timer reap_timer_{io_context_};
     std::vector<std::thread> worker_threads_;
+    std::vector<int> worker_cpus_;       // from Config::worker_cpus
+    std::vector<int> persistence_cpus_;  // from Config::persistence_cpus
     std::atomic<bool> running_{false};
 
-    void run_workers(int thread_count);
-    void cleanup_connections();
+    void run_workers(size_t thread_count);
+    void load_snapshot();
+    void schedule_reaper();
+    std::shared_ptr<Connection> find_connection(uint64_t id) const;
 };
 
 }  // namespace cacheforge
@@ -0,0 +1,96 @@
+#include "server/slowlog.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace cacheforge {
+
+namespace {
+
+uint8_t copy_truncated(char* dst, size_t cap, const std::string& src) {
+    size_t n = std::min(cap, src.size());
+    std::memcpy(dst, src.data(), n);
+    return static_cast<uint8_t>(n);
+}
+
+}  // namespace
+
+SlowLog::SlowLog(size_t capacity, int64_t threshold_us)
+    : capacity_(std::max<size_t>(1, capacity)),
+      slots_(new Slot[capacity_]),
+      threshold_us_(threshold_us) {}
+
+SlowLog::~SlowLog() = default;
+
+void SlowLog::record(const std::string& name, const std::vector<std::string>& args,
+                     const std::string& client, uint64_t duration_us) {
+    uint64_t id = next_id_.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = slots_[id % capacity_];
+
+    // Claim the slot; if a writer from a previous lap still owns it, drop
+    // this record rather than wait
+    uint64_t seq = slot.seq.load(std::memory_order_relaxed);
+    if ((seq & 1) || !slot.seq.compare_exchange_strong(seq, seq + 1, std::memory_order_acquire)) {
+        return;
+    }
+
+    Record& r = slot.record;
+    r.id = id;
+    r.timestamp = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    r.duration_us = duration_us;
+    r.total_args = static_cast<uint32_t>(args.size() + 1);
+    r.stored_args = static_cast<uint8_t>(std::min<size_t>(kMaxArgs, args.size() + 1));
+    r.arg_len[0] = copy_truncated(r.args[0], kMaxArgLen, name);
+    for (size_t i = 1; i < r.stored_args; ++i) {
+        r.arg_len[i] = copy_truncated(r.args[i], kMaxArgLen, args[i - 1]);
+    }
+    r.client_len = copy_truncated(r.client, kMaxClientLen, client);
+
+    slot.seq.store(seq + 2, std::memory_order_release);
+}
+
+std::vector<SlowLogEntry> SlowLog::entries(size_t count) const {
+    std::vector<SlowLogEntry> result;
+    uint64_t end = next_id_.load(std::memory_order_acquire);
+    uint64_t begin = std::max(reset_id_.load(std::memory_order_relaxed),
+                              end > capacity_ ? end - capacity_ : 0);
+
+    for (uint64_t id = end; id > begin && result.size() < count; --id) {
+        const Slot& slot = slots_[(id - 1) % capacity_];
+        uint64_t before = slot.seq.load(std::memory_order_acquire);
+        if (before & 1) continue;
+        Record r;
+        std::memcpy(&r, &slot.record, sizeof(Record));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.seq.load(std::memory_order_relaxed) != before || r.id != id - 1) continue;
+
+        SlowLogEntry entry;
+        entry.id = r.id;
+        entry.timestamp = r.timestamp;
+        entry.duration_us = r.duration_us;
+        for (size_t i = 0; i < r.stored_args; ++i) {
+            entry.args.emplace_back(r.args[i], r.arg_len[i]);
+        }
+        if (r.total_args > r.stored_args) {
+            entry.args.back() = "... (" + std::to_string(r.total_args - r.stored_args + 1) +
+                                " more arguments)";
+        }
+        entry.client.assign(r.client, r.client_len);
+        result.push_back(std::move(entry));
+    }
+    return result;
+}
+
+size_t SlowLog::size() const {
+    uint64_t end = next_id_.load(std::memory_order_acquire);
+    uint64_t begin = std::max(reset_id_.load(std::memory_order_relaxed),
+                              end > capacity_ ? end - capacity_ : 0);
+    return static_cast<size_t>(end - begin);
+}
+
+void SlowLog::reset() {
+    reset_id_.store(next_id_.load(std::memory_order_acquire), std::memory_order_relaxed);
+}
+
+}  // namespace cacheforge
@@ -0,0 +1,83 @@
+#pragma once
+#ifndef CACHEFORGE_SLOWLOG_H
+#define CACHEFORGE_SLOWLOG_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+
+namespace cacheforge {
+
+// One slow-log record, returned by SlowLog::entries()
+struct SlowLogEntry {
+    uint64_t id = 0;
+    int64_t timestamp = 0;  // unix seconds
+    uint64_t duration_us = 0;
+    std::vector<std::string> args;  // command name first, possibly truncated
+    std::string client;
+};
+
+// Lock-free ring buffer of commands slower than a threshold.
+// Writers claim a ticket with one fetch_add and fill the slot it maps to;
+// each slot carries a sequence number (odd while being written) so readers
+// copy it optimistically and skip slots that changed under them.
+// Records are fixed-size: at most kMaxArgs arguments of kMaxArgLen bytes
+// are kept, mirroring Redis' truncation of long argument lists.
+class SlowLog {
+public:
+    static constexpr size_t kMaxArgs = 8;
+    static constexpr size_t kMaxArgLen = 32;
+    static constexpr size_t kMaxClientLen = 48;
+
+    explicit SlowLog(size_t capacity = 128, int64_t threshold_us = 10000);
+    ~SlowLog();
+
+    // Cheap pre-check for the command path; negative threshold disables
+    bool is_slow(uint64_t duration_us) const {
+        int64_t threshold = threshold_us_.load(std::memory_order_relaxed);
+        return threshold >= 0 && duration_us >= static_cast<uint64_t>(threshold);
+    }
+
+    void record(const std::string& name, const std::vector<std::string>& args,
+                const std::string& client, uint64_t duration_us);
+
+    // Newest first, at most `count` records
+    std::vector<SlowLogEntry> entries(size_t count) const;
+    size_t size() const;
+    void reset();
+
+    void set_threshold_us(int64_t threshold_us) {
+        threshold_us_.store(threshold_us, std::memory_order_relaxed);
+    }
+    int64_t threshold_us() const { return threshold_us_.load(std::memory_order_relaxed); }
+    size_t capacity() const { return capacity_; }
+
+private:
+    struct Record {
+        uint64_t id;
+        int64_t timestamp;
+        uint64_t duration_us;
+        uint32_t total_args;  // including arguments that were not stored
+        uint8_t stored_args;
+        uint8_t arg_len[kMaxArgs];
+        uint8_t client_len;
+        char args[kMaxArgs][kMaxArgLen];
+        char client[kMaxClientLen];
+    };
+    struct Slot {
+        std::atomic<uint64_t> seq{0};
+        Record record;
+    };
+
+    const size_t capacity_;
+    std::unique_ptr<Slot[]> slots_;
+    std::atomic<uint64_t> next_id_{0};
+    std::atomic<uint64_t> reset_id_{0};  // records below this id are hidden
+    std::atomic<int64_t> threshold_us_;
+};
+
+}  // namespace cacheforge
+
+#endif  // CACHEFORGE_SLOWLOG_H
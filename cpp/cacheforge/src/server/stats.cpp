@@ -0,0 +1,206 @@
+#include "server/stats.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace cacheforge {
+
+namespace {
+
+std::atomic<uint64_t> g_next_stats_id{1};
+
+// Only the owning thread writes a block, so a load/store pair is enough and
+// avoids a locked read-modify-write on every increment
+inline void bump(std::atomic<uint64_t>& cell, uint64_t n) {
+    cell.store(cell.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+}  // namespace
+
+// ---------------------------------------------------------------------------
+// LatencyHistogram
+// ---------------------------------------------------------------------------
+
+size_t LatencyHistogram::bucket_for(uint64_t ns) {
+    if (ns < kSubBuckets) return static_cast<size_t>(ns);
+    size_t msb = 63 - static_cast<size_t>(__builtin_clzll(ns));
+    if (msb >= kMaxBits) return kBuckets - 1;
+    size_t sub = static_cast<size_t>(ns >> (msb - 3)) & (kSubBuckets - 1);
+    return (msb - 2) * kSubBuckets + sub;
+}
+
+uint64_t LatencyHistogram::bucket_upper_bound(size_t bucket) {
+    if (bucket < kSubBuckets) return bucket;
+    size_t msb = bucket / kSubBuckets + 2;
+    uint64_t sub = bucket % kSubBuckets;
+    uint64_t lower = (kSubBuckets + sub) << (msb - 3);
+    return lower + (uint64_t(1) << (msb - 3)) - 1;
+}
+
+void LatencyHistogram::record(uint64_t ns, uint64_t count) {
+    buckets_[bucket_for(ns)] += count;
+    count_ += count;
+    max_ = std::max(max_, ns);
+    sum_ += static_cast<long double>(ns) * count;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (size_t i = 0; i < kBuckets; ++i) buckets_[i] += other.buckets_[i];
+    count_ += other.count_;
+    max_ = std::max(max_, other.max_);
+    sum_ += other.sum_;
+}
+
+uint64_t LatencyHistogram::mean() const {
+    return count_ ? static_cast<uint64_t>(sum_ / count_) : 0;
+}
+
+uint64_t LatencyHistogram::percentile(double p) const {
+    if (count_ == 0) return 0;
+    auto target = static_cast<uint64_t>(p / 100.0 * static_cast<double>(count_) + 0.5);
+    target = std::clamp<uint64_t>(target, 1, count_);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBuckets; ++i) {
+        seen += buckets_[i];
+        if (seen >= target) return bucket_upper_bound(i);
+    }
+    return bucket_upper_bound(kBuckets - 1);
+}
+
+LatencyHistogram LatencyHistogram::corrected_for_omission(uint64_t expected_interval_ns) const {
+    LatencyHistogram out = *this;
+    const uint64_t interval = expected_interval_ns;
+    if (interval == 0) return out;
+
+    // Count the synthetic values v - k * interval (k >= 1, value >= interval)
+    // that land in each lower bucket at once instead of one by one, so a
+    // long stall with a short interval stays cheap
+    for (size_t b = 0; b < kBuckets; ++b) {
+        if (buckets_[b] == 0) continue;
+        const uint64_t v = bucket_upper_bound(b);
+        if (v < 2 * interval) continue;
+        const uint64_t k_max = v / interval - 1;
+        for (size_t t = 0; t <= b; ++t) {
+            uint64_t lo = t == 0 ? 0 : bucket_upper_bound(t - 1) + 1;
+            uint64_t hi = bucket_upper_bound(t);
+            if (hi < interval || lo >= v) continue;
+            // k such that lo <= v - k * interval <= hi
+            uint64_t k_lo = v > hi ? (v - hi + interval - 1) / interval : 1;
+            uint64_t k_hi = std::min(k_max, (v - lo) / interval);
+            k_lo = std::max<uint64_t>(k_lo, 1);
+            if (k_lo > k_hi) continue;
+            uint64_t n = (k_hi - k_lo + 1) * buckets_[b];
+            out.buckets_[t] += n;
+            out.count_ += n;
+            out.sum_ += static_cast<long double>(buckets_[b]) * (k_hi - k_lo + 1) *
+                        (static_cast<long double>(v) - interval * (k_lo + k_hi) / 2.0L);
+        }
+    }
+    return out;
+}
+
+// ---------------------------------------------------------------------------
+// Stats
+// ---------------------------------------------------------------------------
+
+Stats::Stats()
+    : id_(g_next_stats_id.fetch_add(1)),
+      started_(std::chrono::steady_clock::now()) {}
+
+Stats::~Stats() = default;
+
+size_t Stats::register_command(const std::string& name) {
+    auto it = std::find(command_names_.begin(), command_names_.end(), name);
+    if (it != command_names_.end()) return static_cast<size_t>(it - command_names_.begin());
+    if (command_names_.size() == kMaxCommands) {
+        throw std::length_error("too many commands for stats table");
+    }
+    command_names_.push_back(name);
+    return command_names_.size() - 1;
+}
+
+void Stats::add(Counter counter, uint64_t n) {
+    bump(local_block().counters[counter], n);
+}
+
+void Stats::record_call(size_t index) {
+    bump(local_block().calls[index], 1);
+}
+
+void Stats::record_latency(size_t index, uint64_t latency_ns) {
+    auto& block = local_block();
+    // Scale the sampled time so total time per command stays unbiased
+    bump(block.total_ns[index], latency_ns * latency_sample_rate_.load(std::memory_order_relaxed));
+    bump(block.latency[index][LatencyHistogram::bucket_for(latency_ns)], 1);
+}
+
+bool Stats::sample_latency() {
+    if (!enabled_.load(std::memory_order_relaxed)) return false;
+    thread_local uint32_t tick = 0;
+    if (++tick < latency_sample_rate_.load(std::memory_order_relaxed)) return false;
+    tick = 0;
+    return true;
+}
+
+void Stats::set_latency_sample_rate(uint32_t rate) {
+    latency_sample_rate_.store(std::max<uint32_t>(1, rate), std::memory_order_relaxed);
+}
+
+Stats::Snapshot Stats::snapshot() const {
+    Snapshot snap;
+    snap.uptime = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::steady_clock::now() - started_);
+
+    std::vector<CommandStats> commands(command_names_.size());
+    {
+        std::lock_guard lock(blocks_mutex_);
+        for (const auto& block : blocks_) {
+            for (size_t c = 0; c < kNumCounters; ++c) {
+                snap.counters[c] += block->counters[c].load(std::memory_order_relaxed);
+            }
+            for (size_t i = 0; i < commands.size(); ++i) {
+                uint64_t calls = block->calls[i].load(std::memory_order_relaxed);
+                if (calls == 0) continue;
+                commands[i].calls += calls;
+                commands[i].total_ns += block->total_ns[i].load(std::memory_order_relaxed);
+                for (size_t b = 0; b < LatencyHistogram::kBuckets; ++b) {
+                    uint64_t n = block->latency[i][b].load(std::memory_order_relaxed);
+                    if (n) commands[i].latency.record(LatencyHistogram::bucket_upper_bound(b), n);
+                }
+            }
+        }
+    }
+
+    for (size_t i = 0; i < commands.size(); ++i) {
+        if (commands[i].calls == 0) continue;
+        commands[i].name = command_names_[i];
+        snap.commands.push_back(std::move(commands[i]));
+    }
+    return snap;
+}
+
+Stats::ThreadBlock& Stats::local_block() {
+    // One-entry cache per thread; the id (not the address) identifies the
+    // owner so a new Stats at a reused address cannot hit a stale block
+    struct Cache {
+        uint64_t owner = 0;
+        ThreadBlock* block = nullptr;
+    };
+    thread_local Cache cache;
+    if (cache.owner != id_) {
+        cache.block = &register_thread();
+        cache.owner = id_;
+    }
+    return *cache.block;
+}
+
+Stats::ThreadBlock& Stats::register_thread() {
+    std::lock_guard lock(blocks_mutex_);
+    auto [it, inserted] = by_thread_.try_emplace(std::this_thread::get_id(), nullptr);
+    if (inserted) {
+        blocks_.push_back(std::make_unique<ThreadBlock>());
+        it->second = blocks_.back().get();
+    }
+    return *it->second;
+}
+
+}  // namespace cacheforge
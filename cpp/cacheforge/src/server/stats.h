@@ -0,0 +1,141 @@
+#pragma once
+#ifndef CACHEFORGE_STATS_H
+#define CACHEFORGE_STATS_H
+
+#include <string>
+#include <vector>
+#include <array>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <unordered_map>
+#include <cstdint>
+
+namespace cacheforge {
+
+// Log-linear latency histogram in nanoseconds (HDR-style): values below 8
+// get exact buckets, then every power of two is split into 8 sub-buckets,
+// so any recorded value is reported within 12.5%. Values above ~68s are
+// clamped into the last bucket.
+class LatencyHistogram {
+public:
+    static constexpr size_t kSubBuckets = 8;
+    static constexpr size_t kMaxBits = 36;
+    static constexpr size_t kBuckets = (kMaxBits - 2) * kSubBuckets;
+
+    static size_t bucket_for(uint64_t ns);
+    static uint64_t bucket_upper_bound(size_t bucket);
+
+    void record(uint64_t ns, uint64_t count = 1);
+    void merge(const LatencyHistogram& other);
+
+    uint64_t count() const { return count_; }
+    uint64_t max() const { return max_; }
+    uint64_t mean() const;
+    // Upper bound of the bucket holding the p-th percentile (0 < p <= 100)
+    uint64_t percentile(double p) const;
+
+    // Copy corrected for coordinated omission: a sample of value v implies
+    // the requests that should have been issued every expected_interval_ns
+    // while it was outstanding were delayed too, so synthetic samples
+    // v - interval, v - 2 * interval, ... are added (as in HdrHistogram)
+    LatencyHistogram corrected_for_omission(uint64_t expected_interval_ns) const;
+
+    std::array<uint64_t, kBuckets>& buckets() { return buckets_; }
+    const std::array<uint64_t, kBuckets>& buckets() const { return buckets_; }
+
+private:
+    std::array<uint64_t, kBuckets> buckets_{};
+    uint64_t count_ = 0;
+    uint64_t max_ = 0;
+    long double sum_ = 0;
+};
+
+// Runtime metrics. Every thread writes only to its own cache-line-aligned
+// block of counters, so recording is a plain relaxed load/store with no
+// shared writes; readers sum the blocks when a snapshot is taken.
+// Command calls are counted exactly, but only one command in
+// latency_sample_rate is recorded in the latency histograms: recording
+// costs more than the counters and would dominate the overhead on a fast
+// GET.
+class Stats {
+public:
+    enum Counter : size_t {
+        kKeyspaceHits,
+        kKeyspaceMisses,
+        kEvictedKeys,
+        kExpiredKeys,
+        kNetInputBytes,
+        kNetOutputBytes,
+        kConnectionsReceived,
+        kConnectionsClosed,
+        kRejectedConnections,
+        kOutputLimitDisconnects,
+        kQueryLimitDisconnects,
+        kIdleDisconnects,
+        kNumCounters
+    };
+    static constexpr size_t kMaxCommands = 64;
+
+    struct CommandStats {
+        std::string name;
+        uint64_t calls = 0;
+        uint64_t total_ns = 0;
+        LatencyHistogram latency;
+    };
+
+    struct Snapshot {
+        std::array<uint64_t, kNumCounters> counters{};
+        std::vector<CommandStats> commands;  // only commands that were called
+        std::chrono::seconds uptime{0};
+    };
+
+    Stats();
+    ~Stats();
+    Stats(const Stats&) = delete;
+    Stats& operator=(const Stats&) = delete;
+
+    // Assigns a slot to a command name; call during setup, before recording
+    size_t register_command(const std::string& name);
+
+    void add(Counter counter, uint64_t n = 1);
+    void record_call(size_t index);
+    void record_latency(size_t index, uint64_t latency_ns);
+
+    // True when the caller should time the current command
+    bool sample_latency();
+
+    // Disabling skips latency timing on the command path
+    void set_enabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+    void set_latency_sample_rate(uint32_t rate);
+
+    Snapshot snapshot() const;
+
+private:
+    struct alignas(64) ThreadBlock {
+        std::atomic<uint64_t> counters[kNumCounters] = {};
+        std::atomic<uint64_t> calls[kMaxCommands] = {};
+        std::atomic<uint64_t> total_ns[kMaxCommands] = {};
+        std::atomic<uint64_t> latency[kMaxCommands][LatencyHistogram::kBuckets] = {};
+    };
+
+    const uint64_t id_;
+    std::atomic<bool> enabled_{true};
+    std::atomic<uint32_t> latency_sample_rate_{8};
+    std::chrono::steady_clock::time_point started_;
+    std::vector<std::string> command_names_;
+
+    mutable std::mutex blocks_mutex_;
+    std::vector<std::unique_ptr<ThreadBlock>> blocks_;
+    std::unordered_map<std::thread::id, ThreadBlock*> by_thread_;
+
+    ThreadBlock& local_block();
+    ThreadBlock& register_thread();
+};
+
+}  // namespace cacheforge
+
+#endif  // CACHEFORGE_STATS_H
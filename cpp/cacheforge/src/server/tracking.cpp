@@ -0,0 +1,91 @@
+#include "server/tracking.h"
+#include <algorithm>
+#include <utility>
+
+namespace cacheforge {
+
+TrackingTable::TrackingTable(size_t max_keys) : max_keys_(max_keys) {}
+
+void TrackingTable::track(const HashedKey& hk, uint64_t client_id) {
+    size_t idx = shard_index(hk);
+    {
+        auto& shard = shards_[idx];
+        std::lock_guard lock(shard.mutex);
+        auto it = shard.readers.find(hk);
+        if (it == shard.readers.end()) {
+            it = shard.readers.try_emplace(std::string(hk.key)).first;
+            keys_.fetch_add(1, std::memory_order_relaxed);
+        }
+        auto& ids = it->second;
+        if (std::find(ids.begin(), ids.end(), client_id) == ids.end()) {
+            ids.push_back(client_id);
+        }
+    }
+
+    // Over budget: drop other keys, starting with this key's shard and
+    // holding one shard lock at a time
+    for (size_t i = 0; i < kShards && keys_.load(std::memory_order_relaxed) >
+                                          max_keys_.load(std::memory_order_relaxed);) {
+        auto& shard = shards_[(idx + i) % kShards];
+        std::lock_guard lock(shard.mutex);
+        auto victim = shard.readers.begin();
+        if (victim != shard.readers.end() && victim->first == hk.key) ++victim;
+        if (victim == shard.readers.end()) {
+            ++i;
+            continue;
+        }
+        invalidate_locked(shard, victim);
+    }
+}
+
+void TrackingTable::invalidate(const HashedKey& hk) {
+    // A key tracked before this write is counted before the write could
+    // have happened, so an empty table has nothing to invalidate
+    if (keys_.load(std::memory_order_relaxed) == 0) return;
+    auto& shard = shards_[shard_index(hk)];
+    std::lock_guard lock(shard.mutex);
+    auto it = shard.readers.find(hk);
+    if (it != shard.readers.end()) {
+        invalidate_locked(shard, it);
+    }
+}
+
+void TrackingTable::forget_client(uint64_t client_id) {
+    clients_.fetch_sub(1, std::memory_order_relaxed);
+    for (auto& shard : shards_) {
+        std::lock_guard lock(shard.mutex);
+        for (auto it = shard.readers.begin(); it != shard.readers.end();) {
+            auto& ids = it->second;
+            ids.erase(std::remove(ids.begin(), ids.end(), client_id), ids.end());
+            if (ids.empty()) {
+                it = shard.readers.erase(it);
+                keys_.fetch_sub(1, std::memory_order_relaxed);
+            } else {
+                ++it;
+            }
+        }
+    }
+    std::lock_guard lock(pending_mutex_);
+    pending_.erase(client_id);
+}
+
+std::unordered_map<uint64_t, std::vector<std::string>> TrackingTable::drain() {
+    if (!has_pending_.load(std::memory_order_acquire)) return {};
+    std::lock_guard lock(pending_mutex_);
+    has_pending_.store(false, std::memory_order_relaxed);
+    return std::exchange(pending_, {});
+}
+
+void TrackingTable::invalidate_locked(Shard& shard, Readers::iterator it) {
+    {
+        std::lock_guard lock(pending_mutex_);
+        for (uint64_t id : it->second) {
+            pending_[id].push_back(it->first);
+        }
+        has_pending_.store(true, std::memory_order_release);
+    }
+    shard.readers.erase(it);
+    keys_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+}  // namespace cacheforge
@@ -0,0 +1,73 @@
+#pragma once
+#ifndef CACHEFORGE_TRACKING_H
+#define CACHEFORGE_TRACKING_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include "utils/hash.h"
+
+namespace cacheforge {
+
+// Server-assisted client caching (CLIENT TRACKING).
+// Remembers which clients read each key and, when the key is modified or
+// expires, queues an invalidation for every such client. Each
+// key is forgotten once invalidated, so a client is only notified again
+// after it re-reads the key. The table is bounded: when it exceeds
+// max_keys, arbitrary keys are dropped and their readers invalidated
+// early so they can never serve a value the server no longer tracks.
+// Keys are spread over kShards locks, and invalidate() and drain() return
+// without locking anything while no key is tracked or nothing is pending,
+// so writes pay nothing for tracking until a client turns it on.
+class TrackingTable {
+public:
+    static constexpr size_t kShards = 16;
+
+    explicit TrackingTable(size_t max_keys = 1000000);
+
+    void track(const std::string& key, uint64_t client_id) { track(HashedKey(key), client_id); }
+    void track(const HashedKey& hk, uint64_t client_id);
+    void invalidate(const std::string& key) { invalidate(HashedKey(key)); }
+    void invalidate(const HashedKey& hk);
+    // A client turned tracking on; forget_client() when it turns it off or
+    // disconnects
+    void add_client() { clients_.fetch_add(1, std::memory_order_relaxed); }
+    void forget_client(uint64_t client_id);
+
+    // Pending invalidations grouped per client, batching every key that was
+    // invalidated since the previous drain into one message per client
+    std::unordered_map<uint64_t, std::vector<std::string>> drain();
+
+    void set_max_keys(size_t max_keys) { max_keys_.store(max_keys, std::memory_order_relaxed); }
+    size_t tracked_keys() const { return keys_.load(std::memory_order_relaxed); }
+    size_t clients() const { return clients_.load(std::memory_order_relaxed); }
+
+private:
+    // Few clients typically read the same key, so a small vector of ids is
+    // more compact than a set
+    using Readers = std::unordered_map<std::string, std::vector<uint64_t>, KeyHash, KeyEqual>;
+    struct alignas(64) Shard {
+        std::mutex mutex;
+        Readers readers;
+    };
+    Shard shards_[kShards];
+    std::atomic<size_t> keys_{0};
+    std::atomic<size_t> clients_{0};
+    std::atomic<size_t> max_keys_;
+
+    // Taken after a shard's lock, never before
+    std::mutex pending_mutex_;
+    std::unordered_map<uint64_t, std::vector<std::string>> pending_;
+    std::atomic<bool> has_pending_{false};
+
+    static size_t shard_index(const HashedKey& hk) { return (hk.hash >> 32) % kShards; }
+    // Queues the key's invalidations and erases it; caller holds its shard
+    void invalidate_locked(Shard& shard, Readers::iterator it);
+};
+
+}  // namespace cacheforge
+
+#endif  // CACHEFORGE_TRACKING_H
@@ -0,0 +1,141 @@
+#include "storage/defrag.h"
+#include <algorithm>
+#include <fstream>
+#include <unistd.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+namespace cacheforge {
+
+Defragmenter::Defragmenter(HashTable& table, const DefragOptions& options)
+    : table_(table), options_(options) {}
+
+Defragmenter::~Defragmenter() {
+    stop();
+}
+
+void Defragmenter::start() {
+    running_.store(true);
+    thread_ = std::thread([this]() { loop(); });
+}
+
+void Defragmenter::stop() {
+    running_.store(false);
+    cv_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+size_t Defragmenter::resident_bytes() {
+    std::ifstream statm("/proc/self/statm");
+    size_t pages = 0, resident = 0;
+    if (!(statm >> pages >> resident)) return 0;
+    return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+bool Defragmenter::fragmented() {
+    size_t logical = table_.memory_usage_estimate();
+    size_t rss = resident_bytes();
+    if (logical == 0 || rss == 0) {
+        fragmentation_.store(0, std::memory_order_relaxed);
+        return false;
+    }
+    double ratio = static_cast<double>(rss) / static_cast<double>(logical);
+    fragmentation_.store(ratio, std::memory_order_relaxed);
+    // Once started, passes go on until the lower ratio is reached
+    double threshold = active() ? options_.stop_ratio : options_.start_ratio;
+    return rss > logical + options_.ignore_bytes && ratio > threshold;
+}
+
+bool Defragmenter::sparse(uintptr_t page) const {
+    auto it = pages_.find(page);
+    return it != pages_.end() &&
+           static_cast<double>(it->second) <= options_.sparse_page_ratio * HashTable::kPageSize;
+}
+
+bool Defragmenter::cycle(std::chrono::microseconds budget) {
+    auto now = std::chrono::steady_clock::now();
+    auto deadline = now + budget;
+    if (phase_ == Phase::Idle) {
+        if (now < retry_at_) return false;
+        if (!fragmented()) {
+            active_.store(false, std::memory_order_relaxed);
+            return false;
+        }
+        active_.store(true, std::memory_order_relaxed);
+        phase_ = Phase::Measure;
+        shard_ = 0;
+        pass_moved_ = 0;
+    }
+
+    auto is_sparse = [this](uintptr_t page) { return sparse(page); };
+    bool more = true;
+    while (std::chrono::steady_clock::now() < deadline) {
+        if (phase_ == Phase::Measure) {
+            table_.page_usage(shard_++, pages_);
+            if (shard_ == HashTable::kShardCount) {
+                phase_ = Phase::Relocate;
+                shard_ = 0;
+            }
+        } else if (next_ < pending_.size()) {
+            size_t end = std::min(next_ + kBatchKeys, pending_.size());
+            std::vector<std::string> batch(pending_.begin() + static_cast<std::ptrdiff_t>(next_),
+                                           pending_.begin() + static_cast<std::ptrdiff_t>(end));
+            size_t moved = table_.relocate(batch, is_sparse, retired_);
+            next_ = end;
+            pass_moved_ += moved;
+            relocated_.fetch_add(moved, std::memory_order_relaxed);
+        } else if (shard_ < HashTable::kShardCount) {
+            // Keys written since the measurement are left where they are
+            pending_ = table_.sparse_keys(shard_++, is_sparse);
+            next_ = 0;
+        } else {
+            more = false;
+            break;
+        }
+    }
+    retired_ = {};
+    if (!more) finish_pass();
+    return more;
+}
+
+void Defragmenter::finish_pass() {
+    phase_ = Phase::Idle;
+    HashTable::PageUsage().swap(pages_);
+    std::vector<std::string>().swap(pending_);
+    next_ = 0;
+    passes_.fetch_add(1, std::memory_order_relaxed);
+#ifdef __GLIBC__
+    // Pages the moves emptied stay mapped until the allocator is asked to
+    // give back free memory in the middle of its heaps, not just the top
+    malloc_trim(0);
+#endif
+    if (!fragmented()) {
+        active_.store(false, std::memory_order_relaxed);
+    } else if (pass_moved_ == 0) {
+        // Nothing left to move; what remains is not ours to fix
+        retry_at_ = std::chrono::steady_clock::now() + kRetryAfter;
+    }
+}
+
+void Defragmenter::loop() {
+    auto work = std::chrono::duration_cast<std::chrono::microseconds>(kCycle) *
+                std::min<uint32_t>(options_.cpu_percent, 100) / 100;
+    while (running_.load()) {
+        auto begun = std::chrono::steady_clock::now();
+        uint64_t passes = passes_.load(std::memory_order_relaxed);
+        // Idle cycles only measure RSS and are not reported
+        if (cycle(work) || passes_.load(std::memory_order_relaxed) != passes) {
+            if (cycle_callback_) {
+                cycle_callback_(std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - begun));
+            }
+        }
+        std::unique_lock lock(mutex_);
+        cv_.wait_until(lock, begun + kCycle, [this]() { return !running_.load(); });
+    }
+}
+
+}  // namespace cacheforge
@@ -0,0 +1,108 @@
+#pragma once
+#ifndef CACHEFORGE_DEFRAG_H
+#define CACHEFORGE_DEFRAG_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+#include "storage/hashtable.h"
+
+namespace cacheforge {
+
+struct DefragOptions {
+    double start_ratio = 1.3;                  // RSS / dataset bytes that starts a pass
+    double stop_ratio = 1.1;                   // and that ends one
+    size_t ignore_bytes = 64 * 1024 * 1024;    // RSS over the dataset tolerated outright
+    uint32_t cpu_percent = 10;                 // share of each cycle spent working
+    double sparse_page_ratio = 0.5;            // pages at most this full are emptied
+};
+
+// Active defragmentation. After heavy churn the allocator holds pages on
+// which a few live values pin otherwise free memory, so the process's RSS
+// stays far above what the data needs. When RSS over the dataset estimate
+// passes start_ratio, a pass tallies how many bytes of the table's blocks
+// sit on each page, then moves the keys on the sparse ones, a batch at a
+// time under their shard's write lock, into fresh allocations, and finally
+// hands the emptied pages back to the OS. Relocation runs on this object's
+// own thread, whose allocator arena packs the copies densely, and the old
+// blocks are only freed at the end of a cycle: freed any earlier, the
+// thread's allocation cache would hand them straight back for the next
+// copies. A cycle works for cpu_percent of kCycle and keeps its place, so
+// a pass spreads over as many cycles as it needs without holding any lock
+// for long.
+class Defragmenter {
+public:
+    static constexpr std::chrono::milliseconds kCycle{100};
+    static constexpr size_t kBatchKeys = 16;
+
+    Defragmenter(HashTable& table, const DefragOptions& options);
+    ~Defragmenter();
+    Defragmenter(const Defragmenter&) = delete;
+    Defragmenter& operator=(const Defragmenter&) = delete;
+
+    void start();
+    void stop();
+    // Called on the defrag thread after each cycle that advanced a pass,
+    // with the time it took; set before start()
+    void set_cycle_callback(std::function<void(std::chrono::microseconds)> cb) {
+        cycle_callback_ = std::move(cb);
+    }
+
+    // Advances the current pass, or starts one when fragmentation calls for
+    // it, until `budget` runs out; returns true while a pass is under way
+    bool cycle(std::chrono::microseconds budget);
+
+    bool active() const { return active_.load(std::memory_order_relaxed); }
+    // RSS over the dataset estimate as last measured; 0 before any cycle
+    double fragmentation() const { return fragmentation_.load(std::memory_order_relaxed); }
+    uint64_t relocated() const { return relocated_.load(std::memory_order_relaxed); }
+    uint64_t passes() const { return passes_.load(std::memory_order_relaxed); }
+
+    // The process's resident set in bytes, from /proc/self/statm; 0 when
+    // that cannot be read
+    static size_t resident_bytes();
+
+private:
+    enum class Phase { Idle, Measure, Relocate };
+    // A pass that moved nothing is not retried for this long
+    static constexpr std::chrono::seconds kRetryAfter{10};
+
+    HashTable& table_;
+    DefragOptions options_;
+
+    Phase phase_ = Phase::Idle;
+    size_t shard_ = 0;
+    HashTable::PageUsage pages_;
+    std::vector<std::string> pending_;  // sparse keys of shard_ not yet moved
+    HashTable::Retired retired_;        // old blocks of this cycle's moves
+    size_t next_ = 0;
+    uint64_t pass_moved_ = 0;
+    std::chrono::steady_clock::time_point retry_at_{};
+
+    std::atomic<bool> active_{false};
+    std::atomic<double> fragmentation_{0};
+    std::atomic<uint64_t> relocated_{0};
+    std::atomic<uint64_t> passes_{0};
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::atomic<bool> running_{false};
+    std::thread thread_;
+    std::function<void(std::chrono::microseconds)> cycle_callback_;
+
+    bool fragmented();
+    bool sparse(uintptr_t page) const;
+    void finish_pass();
+    void loop();
+};
+
+}  // namespace cacheforge
+
+#endif  // CACHEFORGE_DEFRAG_H
@@ -0,0 +1,335 @@
+#pragma once
+#ifndef CACHEFORGE_DICT_H
+#define CACHEFORGE_DICT_H
+
+#include <string>
+#include <utility>
+#include <initializer_list>
+#include <tuple>
+#include <new>
+#include <memory>
+#include <cstdlib>
+#include <cstdint>
+#include <cstddef>
+#include "utils/hash.h"
+
+namespace cacheforge {
+
+// Chained hash map from string keys that resizes incrementally, after
+// Redis's dict. A resize allocates a second bucket array and leaves the
+// old one in place; every later insert or erase moves a few old buckets
+// across, and rehash_step() lets an idle owner finish the job. No single
+// operation rebuilds the whole table, which for std::unordered_map at tens
+// of millions of keys is a stall of hundreds of milliseconds. Lookups
+// check both arrays until the move is done.
+//
+// Keys are looked up by HashedKey and each node keeps its hash, so nothing
+// is hashed twice. Nodes only move through reallocate(), so pointers to
+// elements stay valid across resizes. Not thread-safe; callers lock.
+template <typename T>
+class Dict {
+public:
+    using value_type = std::pair<const std::string, T>;
+
+private:
+    struct Node : value_type {
+        uint64_t hash;
+        Node* next = nullptr;
+        Node(std::string_view key, uint64_t h)
+            : value_type(std::piecewise_construct, std::forward_as_tuple(key), std::tuple<>()),
+              hash(h) {}
+    };
+
+    struct Table {
+        Node** buckets = nullptr;
+        size_t size = 0;  // bucket count, a power of two
+        size_t mask() const { return size - 1; }
+    };
+
+public:
+    // Only iterators from begin() can be incremented; those from find()
+    // and try_emplace() are for access and comparison with end()
+    class iterator {
+    public:
+        iterator() = default;
+        value_type& operator*() const { return *node_; }
+        value_type* operator->() const { return node_; }
+        bool operator==(const iterator& other) const { return node_ == other.node_; }
+        bool operator!=(const iterator& other) const { return node_ != other.node_; }
+        iterator& operator++() {
+            if (node_->next) {
+                node_ = node_->next;
+            } else {
+                ++bucket_;
+                advance();
+            }
+            return *this;
+        }
+
+    private:
+        friend class Dict;
+        iterator(const Dict* dict, int table, size_t bucket, Node* node)
+            : dict_(dict), table_(table), bucket_(bucket), node_(node) {}
+        // Moves to the first node at or after (table_, bucket_)
+        void advance() {
+            for (; table_ < 2; ++table_, bucket_ = 0) {
+                const Table& t = dict_->tables_[table_];
+                for (; bucket_ < t.size; ++bucket_) {
+                    if (t.buckets[bucket_]) {
+                        node_ = t.buckets[bucket_];
+                        return;
+                    }
+                }
+            }
+            node_ = nullptr;
+        }
+
+        const Dict* dict_ = nullptr;
+        int table_ = 0;
+        size_t bucket_ = 0;
+        Node* node_ = nullptr;
+    };
+    using const_iterator = iterator;
+
+    Dict() = default;
+    ~Dict() { clear(); }
+    Dict(const Dict&) = delete;
+    Dict& operator=(const Dict&) = delete;
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    size_t bucket_count() const { return tables_[0].size + tables_[1].size; }
+    bool rehashing() const { return tables_[1].buckets != nullptr; }
+
+    iterator begin() const {
+        iterator it(this, 0, 0, nullptr);
+        it.advance();
+        return it;
+    }
+    iterator end() const { return iterator(); }
+
+    iterator find(const HashedKey& hk) const { return iterator(this, 0, 0, lookup(hk)); }
+    size_t count(const HashedKey& hk) const { return lookup(hk) ? 1 : 0; }
+    // Iterator to an element by address, e.g. one held through a pointer
+    iterator iterator_to(value_type& kv) const { return iterator(this, 0, 0, static_cast<Node*>(&kv)); }
+
+    // Finds the key or inserts it with a default-constructed value
+    std::pair<iterator, bool> try_emplace(const HashedKey& hk) {
+        if (rehashing()) {
+            rehash_step(kStepBuckets);
+        } else if (size_ >= tables_[0].size) {
+            resize(size_ + 1);
+        }
+        if (Node* node = lookup(hk)) return {iterator(this, 0, 0, node), false};
+        // New keys go to the newer array while a move is in progress
+        Table& t = rehashing() ? tables_[1] : tables_[0];
+        Node* node = new Node(hk.key, hk.hash);
+        Node*& head = t.buckets[hk.hash & t.mask()];
+        node->next = head;
+        head = node;
+        ++size_;
+        return {iterator(this, 0, 0, node), true};
+    }
+
+    void erase(iterator it) {
+        Node* node = it.node_;
+        unlink(node);
+        delete node;
+        --size_;
+        if (rehashing()) {
+            rehash_step(kStepBuckets);
+        } else if (tables_[0].size > kMinBuckets && size_ < tables_[0].size / 8) {
+            resize(size_);
+        }
+    }
+
+    // The old element of a reallocate(), freed when the handle is dropped
+    using Retired = std::unique_ptr<value_type, void (*)(value_type*)>;
+
+    // Moves an element into a newly allocated node that takes the old one's
+    // place in its chain, for memory defragmentation. The key is copied and
+    // the value moved. This is the one operation that moves a node: the
+    // caller re-points whatever held the old element's address. The old
+    // node is handed back rather than freed, so a caller moving many can
+    // keep the allocator from giving its memory straight to the next one.
+    std::pair<iterator, Retired> reallocate(iterator it) {
+        Node* old = it.node_;
+        Node* node = new Node(old->first, old->hash);
+        node->second = std::move(old->second);
+        node->next = old->next;
+        auto [old_chain, new_chain] = chains(old->hash);
+        for (Node** link : {old_chain, new_chain}) {
+            if (!link) continue;
+            while (*link && *link != old) link = &(*link)->next;
+            if (*link) {
+                *link = node;
+                break;
+            }
+        }
+        return {iterator(this, 0, 0, node),
+                Retired(old, [](value_type* kv) { delete static_cast<Node*>(kv); })};
+    }
+
+    void clear() {
+        for (Table& t : tables_) {
+            for (size_t i = 0; i < t.size; ++i) {
+                for (Node* node = t.buckets[i]; node;) {
+                    Node* next = node->next;
+                    delete node;
+                    node = next;
+                }
+            }
+            std::free(t.buckets);
+            t = Table{};
+        }
+        size_ = 0;
+        rehash_index_ = 0;
+    }
+
+    // Calls `fn` with each element of the bucket at `cursor` (0 to start)
+    // and returns the cursor of the next one, 0 once all were visited. As in
+    // Redis's dictScan the cursor counts with its bits reversed, and while a
+    // resize is in progress one call covers a bucket of the smaller array
+    // and every bucket of the larger one it splits into, so an element
+    // present for the whole scan is visited at least once however the
+    // table resizes between calls. An element may be visited twice.
+    template <typename Fn>
+    size_t scan(size_t cursor, Fn&& fn) const {
+        if (size_ == 0) return 0;
+        auto emit = [&fn](const Node* node) {
+            for (; node; node = node->next) fn(static_cast<const value_type&>(*node));
+        };
+        if (!rehashing()) {
+            size_t m0 = tables_[0].mask();
+            emit(tables_[0].buckets[cursor & m0]);
+            return next_cursor(cursor, m0);
+        }
+        const Table* small = &tables_[0];
+        const Table* large = &tables_[1];
+        if (small->size > large->size) std::swap(small, large);
+        size_t m0 = small->mask();
+        size_t m1 = large->mask();
+        emit(small->buckets[cursor & m0]);
+        do {
+            emit(large->buckets[cursor & m1]);
+            cursor = next_cursor(cursor, m1);
+        } while (cursor & (m0 ^ m1));
+        return cursor;
+    }
+
+    // Moves up to `buckets` old buckets to the new array, visiting at most
+    // ten times as many empty ones; returns true while the move continues
+    bool rehash_step(size_t buckets) {
+        if (!rehashing()) return false;
+        Table& from = tables_[0];
+        Table& to = tables_[1];
+        size_t empty_visits = buckets * 10;
+        while (buckets > 0 && rehash_index_ < from.size) {
+            Node* node = from.buckets[rehash_index_];
+            if (!node) {
+                ++rehash_index_;
+                if (--empty_visits == 0) return true;
+                continue;
+            }
+            while (node) {
+                Node* next = node->next;
+                Node*& head = to.buckets[node->hash & to.mask()];
+                node->next = head;
+                head = node;
+                node = next;
+            }
+            from.buckets[rehash_index_++] = nullptr;
+            --buckets;
+        }
+        if (rehash_index_ < from.size) return true;
+        std::free(from.buckets);
+        from = to;
+        to = Table{};
+        rehash_index_ = 0;
+        return false;
+    }
+
+private:
+    static constexpr size_t kMinBuckets = 16;
+    // Old buckets moved per insert or erase. A move must finish before the
+    // new array fills up; that takes as many inserts as the old array has
+    // buckets, and at this rate a quarter of them is enough
+    static constexpr size_t kStepBuckets = 4;
+
+    Table tables_[2];
+    size_t size_ = 0;
+    size_t rehash_index_ = 0;  // old buckets below this are already moved
+
+    static size_t reverse_bits(size_t v) {
+        size_t bits = sizeof(v) * 8;
+        size_t mask = ~size_t{0};
+        while ((bits >>= 1) > 0) {
+            mask ^= mask << bits;
+            v = ((v >> bits) & mask) | ((v << bits) & ~mask);
+        }
+        return v;
+    }
+
+    // Adds one to the bits of `cursor` under `mask`, counting from the top
+    static size_t next_cursor(size_t cursor, size_t mask) {
+        cursor |= ~mask;
+        return reverse_bits(reverse_bits(cursor) + 1);
+    }
+
+    // The chains a key can be on: its old bucket unless that was already
+    // moved, and while a move is in progress its new bucket, where keys
+    // inserted since the move began go. Absent chains are null.
+    std::pair<Node**, Node**> chains(uint64_t hash) const {
+        Node** old_chain = nullptr;
+        Node** new_chain = nullptr;
+        size_t index = hash & tables_[0].mask();
+        if (!rehashing() || index >= rehash_index_) old_chain = &tables_[0].buckets[index];
+        if (rehashing()) new_chain = &tables_[1].buckets[hash & tables_[1].mask()];
+        return {old_chain, new_chain};
+    }
+
+    Node* lookup(const HashedKey& hk) const {
+        if (size_ == 0) return nullptr;
+        auto [old_chain, new_chain] = chains(hk.hash);
+        for (Node** chain : {old_chain, new_chain}) {
+            if (!chain) continue;
+            for (Node* node = *chain; node; node = node->next) {
+                if (node->hash == hk.hash && node->first == hk.key) return node;
+            }
+        }
+        return nullptr;
+    }
+
+    void unlink(Node* node) {
+        auto [old_chain, new_chain] = chains(node->hash);
+        for (Node** link : {old_chain, new_chain}) {
+            if (!link) continue;
+            while (*link && *link != node) link = &(*link)->next;
+            if (*link) {
+                *link = node->next;
+                return;
+            }
+        }
+    }
+
+    // Starts moving to an array sized for `elements`
+    void resize(size_t elements) {
+        size_t size = kMinBuckets;
+        while (size < elements) size *= 2;
+        if (size == tables_[0].size) return;
+        // calloc hands out fresh zeroed pages for large arrays without
+        // touching them, so even a huge allocation costs no memset here
+        auto* buckets = static_cast<Node**>(std::calloc(size, sizeof(Node*)));
+        if (!buckets) throw std::bad_alloc();
+        if (!tables_[0].buckets) {
+            tables_[0] = Table{buckets, size};
+            return;
+        }
+        tables_[1] = Table{buckets, size};
+        rehash_index_ = 0;
+    }
+};
+
+}  // namespace cacheforge
+
+#endif  // CACHEFORGE_DICT_H
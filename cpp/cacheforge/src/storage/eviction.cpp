@@ -5,9 +5,11 @@ namespace cacheforge {
 EvictionManager::EvictionManager(size_t max_entries)
     : max_entries_(max_entries) {}
 
-void EvictionManager::record_access(const std::string& key) {
+bool EvictionManager::record_access(const std::string& key) {
     std::lock_guard lock(mutex_);
+    if (lookup_.find(key) == lookup_.end()) return false;
     touch(key);
+    return true;
 }
 
 void EvictionManager::record_insert(const std::string& key, size_t size_bytes) {
@@ -54,9 +56,8 @@ void EvictionManager::touch(const std::string& key) {
     auto it = lookup_.find(key);
     if (it == lookup_.end()) return;
 
-    Node node = *it->second;
-    lru_list_.erase(it->second);
-    lru_list_.push_front(node);
+    // splice() relinks the node in place, so the iterator in lookup_ stays valid
+    lru_list_.splice(lru_list_.begin(), lru_list_, it->second);
 }
 
 size_t EvictionManager::current_size() const {
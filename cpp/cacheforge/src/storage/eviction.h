@@ -8,6 +8,7 @@
 #include <mutex>
 #include <memory>
 #include <cstddef>
+#include "utils/hash.h"
 
 namespace cacheforge {
 
@@ -16,7 +17,8 @@ class EvictionManager {
 public:
     explicit EvictionManager(size_t max_entries);
 
-    void record_access(const std::string& key);
+    // Returns false if the key is not tracked
+    bool record_access(const std::string& key);
     void record_insert(const std::string& key, size_t size_bytes);
     void record_remove(const std::string& key);
 
@@ -42,7 +44,7 @@ private:
     // LRU list: front = most recently used, back = least recently used
     std::list<Node> lru_list_;
     // Map from key to iterator in lru_list_
-    std::unordered_map<std::string, std::list<Node>::iterator> lookup_;
+    std::unordered_map<std::string, std::list<Node>::iterator, KeyHash, KeyEqual> lookup_;
 
     mutable std::mutex mutex_;
 };
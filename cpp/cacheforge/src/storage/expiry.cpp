@@ -1,4 +1,5 @@
 #include "storage/expiry.h"
+#include "utils/cpu.h"
 #include <spdlog/spdlog.h>
 #include <limits>
 
@@ -6,36 +7,60 @@ namespace cacheforge {
 
 ExpiryManager::ExpiryManager() = default;
 
+ExpiryManager::ExpiryManager(HashTable& table) : table_(&table) {}
+
 ExpiryManager::~ExpiryManager() {
     stop_expiry_thread();
 }
 
-void ExpiryManager::set_expiry(const std::string& key, std::chrono::seconds ttl) {
-    {
+void ExpiryManager::set_expiry(const HashedKey& hk, std::chrono::seconds ttl) {
+    if (table_) {
+        table_->set_expiry(hk, Clock::now() + ttl);
+    } else {
         std::lock_guard lock(mutex_);
-        entries_[key] = {Clock::now() + ttl};
+        auto it = entries_.find(hk);
+        if (it != entries_.end()) {
+            it->second = {Clock::now() + ttl};
+        } else {
+            entries_.emplace(std::string(hk.key), ExpiryEntry{Clock::now() + ttl});
+        }
     }
     
     cv_.notify_one();
 }
 
-void ExpiryManager::remove_expiry(const std::string& key) {
+void ExpiryManager::remove_expiry(const HashedKey& hk) {
+    if (table_) {
+        table_->clear_expiry(hk);
+        return;
+    }
     std::lock_guard lock(mutex_);
-    entries_.erase(key);
+    auto it = entries_.find(hk);
+    if (it != entries_.end()) entries_.erase(it);
 }
 
-bool ExpiryManager::is_expired(const std::string& key) const {
+bool ExpiryManager::is_expired(const HashedKey& hk) const {
+    if (table_) {
+        auto deadline = table_->expiry(hk);
+        return deadline && Clock::now() >= *deadline;
+    }
     std::lock_guard lock(mutex_);
-    auto it = entries_.find(key);
+    auto it = entries_.find(hk);
     if (it == entries_.end()) return false;
     return Clock::now() >= it->second.expires_at;
 }
 
-std::chrono::seconds ExpiryManager::get_ttl(const std::string& key) const {
-    std::lock_guard lock(mutex_);
-    auto it = entries_.find(key);
-    if (it == entries_.end()) return std::chrono::seconds(-1);
-    auto remaining = it->second.expires_at - Clock::now();
+std::chrono::seconds ExpiryManager::get_ttl(const HashedKey& hk) const {
+    std::optional<TimePoint> deadline;
+    if (table_) {
+        deadline = table_->expiry(hk);
+    } else {
+        std::lock_guard lock(mutex_);
+        auto it = entries_.find(hk);
+        if (it != entries_.end()) deadline = it->second.expires_at;
+    }
+    if (!deadline) return std::chrono::seconds(-1);
+    auto remaining = *deadline - Clock::now();
     if (remaining.count() <= 0) return std::chrono::seconds(0);
     return std::chrono::duration_cast<std::chrono::seconds>(remaining);
 }
@@ -48,7 +73,12 @@ void ExpiryManager::set_expiry_seconds(const std::string& key, int64_t ttl_secon
 
 void ExpiryManager::start_expiry_thread() {
     running_.store(true);
-    expiry_thread_ = std::thread(&ExpiryManager::expiry_loop, this);
+    expiry_thread_ = std::thread([this]() {
+        if (!cpus_.empty() && !cpu::pin_thread(cpus_)) {
+            spdlog::warn("Could not pin the expiry thread to its CPUs");
+        }
+        expiry_loop();
+    });
 }
 
 void ExpiryManager::stop_expiry_thread() {
@@ -64,7 +94,13 @@ void ExpiryManager::set_expiry_callback(std::function<void(const std::string&)>
     callback_ = std::move(cb);
 }
 
+void ExpiryManager::set_cycle_callback(std::function<void(std::chrono::microseconds, size_t)> cb) {
+    std::lock_guard lock(mutex_);
+    cycle_callback_ = std::move(cb);
+}
+
 std::vector<std::string> ExpiryManager::get_expired_keys() const {
+    if (table_) return table_->expired_keys(Clock::now());
     std::lock_guard lock(mutex_);
     std::vector<std::string> expired;
     auto now = Clock::now();
@@ -78,29 +114,54 @@ std::vector<std::string> ExpiryManager::get_expired_keys() const {
 
 void ExpiryManager::expiry_loop() {
     while (running_.load()) {
-        std::unique_lock lock(mutex_);
-        cv_.wait_for(lock, std::chrono::milliseconds(100), [this]() {
-            return !running_.load();
-        });
-
-        if (!running_.load()) break;
-
-        auto now = Clock::now();
-        std::vector<std::string> to_expire;
+        std::function<void(const std::string&)> callback;
+        std::function<void(std::chrono::microseconds, size_t)> cycle_callback;
+        {
+            std::unique_lock lock(mutex_);
+            cv_.wait_for(lock, std::chrono::milliseconds(100), [this]() {
+                return !running_.load();
+            });
+
+            if (!running_.load()) break;
+            callback = callback_;
+            cycle_callback = cycle_callback_;
+        }
 
-        for (const auto& [key, entry] : entries_) {
-            if (now >= entry.expires_at) {
-                to_expire.push_back(key);
+        // Callbacks run without the expiry lock: they take table shard
+        // locks, and the canonical order is table shards before expiry
+        TimePoint now = Clock::now();
+        size_t expired = 0;
+        while (running_.load()) {
+            auto batch = take_expired(now, kCycleBatch);
+            if (callback) {
+                for (const auto& key : batch) callback(key);
             }
+            expired += batch.size();
+            if (batch.size() < kCycleBatch || Clock::now() - now >= kCycleTime) break;
         }
 
-        for (const auto& key : to_expire) {
-            entries_.erase(key);
-            if (callback_) {
-                callback_(key);
-            }
+        if (cycle_callback && expired > 0) {
+            cycle_callback(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - now),
+                           expired);
         }
     }
 }
 
+std::vector<std::string> ExpiryManager::take_expired(TimePoint now, size_t limit) {
+    // The table's shard locks come before the expiry lock, so due keys are
+    // taken from it without that lock
+    if (table_) return table_->remove_expired(now, limit);
+    std::lock_guard lock(mutex_);
+    std::vector<std::string> expired;
+    for (auto it = entries_.begin(); it != entries_.end() && expired.size() < limit;) {
+        if (now >= it->second.expires_at) {
+            expired.push_back(it->first);
+            it = entries_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    return expired;
+}
+
 }  // namespace cacheforge
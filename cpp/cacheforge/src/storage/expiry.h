@@ -11,46 +11,77 @@
 #include <condition_variable>
 #include <vector>
 #include <functional>
+#include "storage/hashtable.h"
+#include "utils/hash.h"
 
 namespace cacheforge {
 
-using Clock = std::chrono::steady_clock;
-using TimePoint = Clock::time_point;
-using Duration = Clock::duration;
-
+// Key deadlines and the background thread that acts on them. Standalone,
+// it keeps deadlines in its own map and leaves removing a due key to the
+// expiry callback. Bound to a table, it stores deadlines in the table's
+// entries instead of copying every key, setting one on a missing key does
+// nothing, and the thread removes due keys from the table itself before
+// the callback hears of them.
 class ExpiryManager {
 public:
+    // Like Redis' active-expire cycle, a pass takes due keys in batches of
+    // kCycleBatch and stops starting new batches once it has run for
+    // kCycleTime, a quarter of the thread's 100ms period; keys still due
+    // wait for the next pass
+    static constexpr size_t kCycleBatch = 200;
+    static constexpr std::chrono::milliseconds kCycleTime{25};
+
     ExpiryManager();
+    explicit ExpiryManager(HashTable& table);
     ~ExpiryManager();
 
     
-    void set_expiry(const std::string& key, std::chrono::seconds ttl);
-    void remove_expiry(const std::string& key);
-    bool is_expired(const std::string& key) const;
-    std::chrono::seconds get_ttl(const std::string& key) const;
+    void set_expiry(const std::string& key, std::chrono::seconds ttl) { set_expiry(HashedKey(key), ttl); }
+    void set_expiry(const HashedKey& hk, std::chrono::seconds ttl);
+    void remove_expiry(const std::string& key) { remove_expiry(HashedKey(key)); }
+    void remove_expiry(const HashedKey& hk);
+    bool is_expired(const std::string& key) const { return is_expired(HashedKey(key)); }
+    bool is_expired(const HashedKey& hk) const;
+    std::chrono::seconds get_ttl(const std::string& key) const { return get_ttl(HashedKey(key)); }
+    std::chrono::seconds get_ttl(const HashedKey& hk) const;
 
     
     void set_expiry_seconds(const std::string& key, int64_t ttl_seconds);
 
     void start_expiry_thread();
     void stop_expiry_thread();
+    // CPUs the expiry thread is pinned to when it starts; empty = any
+    void set_cpus(std::vector<int> cpus) { cpus_ = std::move(cpus); }
 
     void set_expiry_callback(std::function<void(const std::string&)> cb);
+    // Called after every active-expiry pass that removed keys, with the time
+    // the pass took, so work the expiry callback can batch is best left to
+    // it. Both callbacks run on the expiry thread without the expiry lock
+    // held, so they may take table locks and call back in
+    void set_cycle_callback(std::function<void(std::chrono::microseconds, size_t expired)> cb);
     std::vector<std::string> get_expired_keys() const;
+    // Whether deadlines live in `table`'s entries, so writes can set them
+    // together with the value
+    bool bound_to(const HashTable& table) const { return table_ == &table; }
 
 private:
     struct ExpiryEntry {
         TimePoint expires_at;
     };
 
+    HashTable* table_ = nullptr;
     mutable std::mutex mutex_;
     std::condition_variable cv_;
-    std::unordered_map<std::string, ExpiryEntry> entries_;
+    std::unordered_map<std::string, ExpiryEntry, KeyHash, KeyEqual> entries_;
     std::atomic<bool> running_{false};
     std::thread expiry_thread_;
+    std::vector<int> cpus_;
     std::function<void(const std::string&)> callback_;
+    std::function<void(std::chrono::microseconds, size_t)> cycle_callback_;
 
     void expiry_loop();
+    // Removes up to `limit` keys due at `now` and returns them
+    std::vector<std::string> take_expired(TimePoint now, size_t limit);
 };
 
 }  // namespace cacheforge
@@ -1,69 +1,747 @@
 #include "storage/hashtable.h"
 #include <regex>
 #include <algorithm>
+#include <bit>
+#include <map>
+#include <tuple>
 
 namespace cacheforge {
 
+namespace {
+// Set in Location::type for a value that was compressed when demoted
+constexpr uint8_t kColdCompressed = 0x80;
+
+// Shards held by the calling thread through a ShardLockSet
+thread_local const HashTable* t_locked_table = nullptr;
+thread_local uint64_t t_locked_shards = 0;
+}  // namespace
+
 HashTable::HashTable(size_t max_size)
-    : max_size_(max_size), probe_capacity_(max_size * 2) {
+    : shards_(kShardCount), probe_capacity_(max_size * 2), max_size_(max_size) {
     probe_table_.resize(probe_capacity_);
 }
 
-bool HashTable::set(const std::string& key, Value value) {
-    std::unique_lock lock_a(mutex_a_);
-    std::lock_guard lock_b(mutex_b_);
+bool HashTable::holds(size_t shard) const {
+    return t_locked_table == this && (t_locked_shards >> shard) & 1;
+}
 
-    auto [it, inserted] = data_.emplace(key, std::move(value));
-    if (!inserted) {
-        it->second = std::move(value);
-    } else {
-        
+std::unique_lock<std::shared_mutex> HashTable::write_lock(size_t shard) const {
+    if (holds(shard)) return std::unique_lock(shards_[shard].mutex, std::defer_lock);
+    return std::unique_lock(shards_[shard].mutex);
+}
+
+std::shared_lock<std::shared_mutex> HashTable::read_lock(size_t shard) const {
+    if (holds(shard)) return std::shared_lock(shards_[shard].mutex, std::defer_lock);
+    return std::shared_lock(shards_[shard].mutex);
+}
+
+bool HashTable::set(const HashedKey& hk, Value value) {
+    return store_key(hk, std::move(value), false, std::nullopt);
+}
+
+bool HashTable::set_with_expiry(const HashedKey& hk, Value value, std::optional<TimePoint> deadline) {
+    return store_key(hk, std::move(value), true, deadline);
+}
+
+bool HashTable::store_key(const HashedKey& hk, Value value, bool replace_deadline,
+                          std::optional<TimePoint> deadline) {
+    size_t idx = shard_index(hk);
+    bool inserted;
+    {
+        auto lock = write_lock(idx);
+        auto& shard = shards_[idx];
+        auto [it, fresh] = shard.data.try_emplace(hk);
+        forget_cold(it->second);
+        store(it->second, std::move(value));
+        it->second.version = ++shard.version;
+        lru_track(shard, *it);
+        if (replace_deadline) {
+            if (deadline) {
+                heap_set(shard, *it, *deadline);
+            } else {
+                heap_erase(shard, *it);
+            }
+        }
+        inserted = fresh;
+    }
+    if (inserted) {
         size_.fetch_add(1, std::memory_order_relaxed);
     }
 
     if (size_.load(std::memory_order_relaxed) > max_size_ && eviction_callback_) {
-        eviction_callback_(key);
+        eviction_callback_(std::string(hk.key));
     }
 
     return inserted;
 }
 
 std::optional<Value> HashTable::get(const std::string& key) {
-    std::shared_lock lock(mutex_a_);
-    auto it = data_.find(key);
-    if (it != data_.end()) {
-        return it->second;
+    HashedKey hk(key);
+    size_t idx = shard_index(hk);
+    std::optional<Value> result;
+    bool cold = false;
+    {
+        auto lock = read_lock(idx);
+        const auto& data = shards_[idx].data;
+        auto it = data.find(hk);
+        if (it == data.end()) return std::nullopt;
+        cold = it->second.cold.valid();
+        result = load(it->second);
     }
-    return std::nullopt;
+    if (cold) note_cold_read(idx, hk);
+    return result;
 }
 
-bool HashTable::remove(const std::string& key) {
-    std::lock_guard lock_b(mutex_b_);
-    std::unique_lock lock_a(mutex_a_);
+bool HashTable::remove(const HashedKey& hk) {
+    size_t idx = shard_index(hk);
+    auto lock = write_lock(idx);
+    auto& shard = shards_[idx];
 
-    auto it = data_.find(key);
-    if (it != data_.end()) {
-        data_.erase(it);
+    auto it = shard.data.find(hk);
+    if (it != shard.data.end()) {
+        erase(shard, it);
+        shard.removed_version = ++shard.version;
         size_.fetch_sub(1, std::memory_order_relaxed);
         return true;
     }
     return false;
 }
 
-bool HashTable::contains(const std::string& key) {
-    std::shared_lock lock(mutex_a_);
-    return data_.count(key) > 0;
+bool HashTable::update(const HashedKey& hk,
+                       const std::function<bool(Value& value, bool created)>& fn) {
+    size_t idx = shard_index(hk);
+    bool created;
+    {
+        auto lock = write_lock(idx);
+        auto& shard = shards_[idx];
+        auto [it, fresh] = shard.data.try_emplace(hk);
+        created = fresh;
+        auto& entry = it->second;
+        bool was_cold = entry.cold.valid();
+        promote(shard, *it);
+        std::optional<Value> packed;  // put back if fn changes nothing
+        if (entry.value.is_compressed()) {
+            packed = entry.value;
+            entry.value = entry.value.decompressed();
+            compressed_count_.fetch_sub(1, std::memory_order_relaxed);
+        }
+        // Not a write: no new version for WATCH and no LRU touch, though a
+        // value just brought back from disk must be listed as resident
+        auto unchanged = [&]() {
+            if (created) {
+                erase(shard, it);
+                return;
+            }
+            if (packed) {
+                entry.value = std::move(*packed);
+                compressed_count_.fetch_add(1, std::memory_order_relaxed);
+            }
+            if (was_cold) lru_track(shard, *it);
+        };
+        bool modified;
+        try {
+            modified = fn(entry.value, created);
+        } catch (...) {
+            unchanged();
+            throw;
+        }
+        if (!modified) {
+            unchanged();
+            return false;
+        }
+        if (compression_min_bytes_ > 0) store(entry, std::move(entry.value));
+        entry.version = ++shard.version;
+        lru_track(shard, *it);
+    }
+
+    if (created) {
+        size_.fetch_add(1, std::memory_order_relaxed);
+        if (size_.load(std::memory_order_relaxed) > max_size_ && eviction_callback_) {
+            eviction_callback_(std::string(hk.key));
+        }
+    }
+    return true;
+}
+
+bool HashTable::view(const HashedKey& hk, const std::function<void(const Value& value)>& fn) {
+    size_t idx = shard_index(hk);
+    {
+        auto lock = read_lock(idx);
+        const auto& data = shards_[idx].data;
+        auto it = data.find(hk);
+        if (it == data.end()) return false;
+        if (!it->second.cold.valid()) {
+            if (it->second.value.is_compressed()) {
+                fn(it->second.value.decompressed());
+            } else {
+                fn(it->second.value);
+            }
+            return true;
+        }
+        fn(load(it->second));
+    }
+    note_cold_read(idx, hk);
+    return true;
 }
 
-std::vector<std::string> HashTable::keys(const std::string& pattern) {
-    std::shared_lock lock(mutex_a_);
-    std::vector<std::string> result;
+uint64_t HashTable::version(const HashedKey& hk) const {
+    size_t idx = shard_index(hk);
+    auto lock = read_lock(idx);
+    const auto& shard = shards_[idx];
+    auto it = shard.data.find(hk);
+    return it != shard.data.end() ? it->second.version : shard.removed_version;
+}
+
+bool HashTable::remove_if_version(const std::string& key, uint64_t version) {
+    HashedKey hk(key);
+    size_t idx = shard_index(hk);
+    auto lock = write_lock(idx);
+    auto& shard = shards_[idx];
+
+    auto it = shard.data.find(hk);
+    if (it == shard.data.end() || it->second.version != version) return false;
+    erase(shard, it);
+    shard.removed_version = ++shard.version;
+    size_.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+HashTable::ShardLockSet::ShardLockSet(const HashTable* table, uint64_t mask)
+    : table_(table), mask_(mask) {
+    // Ascending shard order is the canonical order for every multi-shard lock
+    for (size_t i = 0; i < kShardCount; ++i) {
+        if ((mask_ >> i) & 1) table_->shards_[i].mutex.lock();
+    }
+    t_locked_table = table_;
+    t_locked_shards = mask_;
+}
+
+HashTable::ShardLockSet::ShardLockSet(ShardLockSet&& other) noexcept
+    : table_(other.table_), mask_(other.mask_) {
+    other.mask_ = 0;
+}
+
+HashTable::ShardLockSet::~ShardLockSet() {
+    if (mask_ == 0) return;
+    t_locked_table = nullptr;
+    t_locked_shards = 0;
+    for (size_t i = kShardCount; i-- > 0;) {
+        if ((mask_ >> i) & 1) table_->shards_[i].mutex.unlock();
+    }
+}
+
+HashTable::ShardLockSet HashTable::lock_shards(const std::vector<std::string>& keys,
+                                               bool all) const {
+    uint64_t mask = 0;
+    if (all) {
+        mask = kShardCount == 64 ? ~uint64_t{0} : (uint64_t{1} << kShardCount) - 1;
+    } else {
+        for (const auto& key : keys) mask |= uint64_t{1} << shard_index(HashedKey(key));
+    }
+    return ShardLockSet(this, mask);
+}
+
+HashTable::ShardLockSet HashTable::lock_shards(const std::vector<HashedKey>& keys) const {
+    uint64_t mask = 0;
+    for (const auto& hk : keys) mask |= uint64_t{1} << shard_index(hk);
+    return ShardLockSet(this, mask);
+}
+
+bool HashTable::holding_shards() const {
+    return t_locked_table == this;
+}
+
+void HashTable::set_value_log(ValueLog* log, uint32_t promote_after) {
+    value_log_ = log;
+    promote_after_ = promote_after;
+}
+
+Value HashTable::load_raw(const Entry& entry) const {
+    if (!entry.cold.valid()) return entry.value;
+    return Value::decode(static_cast<Value::Type>(entry.cold.type & ~kColdCompressed),
+                         value_log_->read(entry.cold), entry.cold.type & kColdCompressed);
+}
+
+Value HashTable::load(const Entry& entry) const {
+    if (entry.value.is_compressed()) return entry.value.decompressed();
+    Value value = load_raw(entry);
+    return value.is_compressed() ? value.decompressed() : value;
+}
+
+void HashTable::store(Entry& entry, Value value) {
+    if (entry.value.is_compressed()) compressed_count_.fetch_sub(1, std::memory_order_relaxed);
+    if (compression_min_bytes_ > 0 && !value.is_compressed()) {
+        if (auto packed = value.compressed(compression_min_bytes_)) value = std::move(*packed);
+    }
+    if (value.is_compressed()) compressed_count_.fetch_add(1, std::memory_order_relaxed);
+    entry.value = std::move(value);
+}
+
+std::optional<Value> HashTable::get_raw(const std::string& key) {
+    HashedKey hk(key);
+    size_t idx = shard_index(hk);
+    auto lock = read_lock(idx);
+    const auto& data = shards_[idx].data;
+    auto it = data.find(hk);
+    if (it == data.end()) return std::nullopt;
+    return load_raw(it->second);
+}
+
+void HashTable::promote(Shard& /*shard*/, Node& node) {
+    auto& entry = node.second;
+    if (!entry.cold.valid()) return;
+    Value value = load_raw(entry);
+    forget_cold(entry);
+    if (value.is_compressed()) compressed_count_.fetch_add(1, std::memory_order_relaxed);
+    entry.value = std::move(value);
+    promotions_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void HashTable::forget_cold(Entry& entry) {
+    if (!entry.cold.valid()) return;
+    value_log_->release(entry.cold);
+    entry.cold = ValueLog::Location{};
+    entry.cold_reads = 0;
+    cold_count_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void HashTable::note_cold_read(size_t shard, const HashedKey& hk) {
+    if (promote_after_ == 0) return;
+    auto lock = write_lock(shard);
+    auto& data = shards_[shard].data;
+    auto it = data.find(hk);
+    if (it == data.end() || !it->second.cold.valid()) return;
+    if (++it->second.cold_reads >= promote_after_) {
+        promote(shards_[shard], *it);
+        lru_track(shards_[shard], *it);
+    }
+}
+
+bool HashTable::demote(const std::string& key) {
+    if (!value_log_) return false;
+    HashedKey hk(key);
+    size_t idx = shard_index(hk);
+    auto lock = write_lock(idx);
+    auto& shard = shards_[idx];
+    auto it = shard.data.find(hk);
+    if (it == shard.data.end() || it->second.cold.valid()) return false;
+    demote(shard, *it);
+    return true;
+}
+
+void HashTable::demote(Shard& shard, Node& node) {
+    auto& entry = node.second;
+    lru_untrack(shard, node);
+    uint8_t type = static_cast<uint8_t>(entry.value.type());
+    if (entry.value.is_compressed()) {
+        type |= kColdCompressed;
+        compressed_count_.fetch_sub(1, std::memory_order_relaxed);
+    }
+    entry.cold = value_log_->append(type, entry.value.encode());
+    entry.value = Value();
+    entry.cold_reads = 0;
+    cold_count_.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool HashTable::demote_lru() {
+    if (!value_log_) return false;
+    // Each shard's tail is its least recently used value; the table-wide
+    // tick says which tail is oldest. The tails are read one shard at a
+    // time, so under concurrent access the choice is close to, not exactly,
+    // the global LRU.
+    size_t victim = kShardCount;
+    uint32_t oldest = 0;
+    for (size_t i = 0; i < kShardCount; ++i) {
+        auto lock = read_lock(i);
+        Node* tail = shards_[i].lru_tail;
+        if (!tail) continue;
+        // touch() may be stamping it under another shared lock
+        uint32_t tick = std::atomic_ref(tail->second.lru_tick).load(std::memory_order_relaxed);
+        // Serial-number comparison, so the 32-bit clock may wrap
+        if (victim == kShardCount || static_cast<int32_t>(tick - oldest) < 0) {
+            victim = i;
+            oldest = tick;
+        }
+    }
+    if (victim == kShardCount) return false;
+    auto lock = write_lock(victim);
+    auto& shard = shards_[victim];
+    // Tails read since they were listed go back to the front, each at most
+    // once per read. The tail may also have changed since it was read; its
+    // successor is as good
+    Node* tail;
+    while ((tail = shard.lru_tail) && tail->second.lru_tick != tail->second.lru_linked) {
+        lru_push_front(shard, *tail);
+    }
+    if (tail) demote(shard, *tail);
+    return true;
+}
+
+bool HashTable::touch(const HashedKey& hk) {
+    if (!value_log_) return false;
+    size_t idx = shard_index(hk);
+    // A read leaves the value and its size alone, so only the tick moves
+    // and readers of the shard keep sharing its lock
+    auto lock = read_lock(idx);
+    auto& shard = shards_[idx];
+    auto it = shard.data.find(hk);
+    if (it == shard.data.end() || it->second.cold.valid()) return false;
+    std::atomic_ref(it->second.lru_tick)
+        .store(lru_clock_.fetch_add(1, std::memory_order_relaxed), std::memory_order_relaxed);
+    return true;
+}
+
+void HashTable::lru_track(Shard& shard, Node& node) {
+    if (!value_log_) return;
+    auto& entry = node.second;
+    if (entry.cold.valid()) return;
+    size_t bytes = node.first.size() + entry.value.memory_size();
+    resident_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+    resident_bytes_.fetch_sub(entry.resident_bytes, std::memory_order_relaxed);
+    entry.resident_bytes = static_cast<uint32_t>(std::min<size_t>(bytes, UINT32_MAX));
+    entry.lru_tick = lru_clock_.fetch_add(1, std::memory_order_relaxed);
+    lru_push_front(shard, node);
+}
+
+void HashTable::lru_push_front(Shard& shard, Node& node) {
+    auto& entry = node.second;
+    entry.lru_linked = entry.lru_tick;
+    if (shard.lru_head == &node) return;
+    // Unlink if already listed, then push at the head
+    if (entry.lru_prev) entry.lru_prev->second.lru_next = entry.lru_next;
+    if (entry.lru_next) entry.lru_next->second.lru_prev = entry.lru_prev;
+    if (shard.lru_tail == &node) shard.lru_tail = entry.lru_prev;
+    entry.lru_prev = nullptr;
+    entry.lru_next = shard.lru_head;
+    if (shard.lru_head) shard.lru_head->second.lru_prev = &node;
+    shard.lru_head = &node;
+    if (!shard.lru_tail) shard.lru_tail = &node;
+}
+
+void HashTable::lru_untrack(Shard& shard, Node& node) {
+    auto& entry = node.second;
+    if (shard.lru_head != &node && !entry.lru_prev) return;  // not listed
+    if (entry.lru_prev) entry.lru_prev->second.lru_next = entry.lru_next;
+    if (entry.lru_next) entry.lru_next->second.lru_prev = entry.lru_prev;
+    if (shard.lru_head == &node) shard.lru_head = entry.lru_next;
+    if (shard.lru_tail == &node) shard.lru_tail = entry.lru_prev;
+    entry.lru_prev = nullptr;
+    entry.lru_next = nullptr;
+    resident_bytes_.fetch_sub(entry.resident_bytes, std::memory_order_relaxed);
+    entry.resident_bytes = 0;
+}
+
+void HashTable::erase(Shard& shard, Map::iterator it) {
+    auto& entry = it->second;
+    forget_cold(entry);
+    lru_untrack(shard, *it);
+    heap_erase(shard, *it);
+    if (entry.value.is_compressed()) compressed_count_.fetch_sub(1, std::memory_order_relaxed);
+    shard.data.erase(it);
+}
+
+bool HashTable::set_expiry(const HashedKey& hk, TimePoint deadline) {
+    size_t idx = shard_index(hk);
+    auto lock = write_lock(idx);
+    auto& shard = shards_[idx];
+    auto it = shard.data.find(hk);
+    if (it == shard.data.end()) return false;
+    heap_set(shard, *it, deadline);
+    return true;
+}
+
+bool HashTable::clear_expiry(const HashedKey& hk) {
+    size_t idx = shard_index(hk);
+    auto lock = write_lock(idx);
+    auto& shard = shards_[idx];
+    auto it = shard.data.find(hk);
+    if (it == shard.data.end() || it->second.expiry_slot == kNoSlot) return false;
+    heap_erase(shard, *it);
+    return true;
+}
+
+bool HashTable::remove_if_expired(const HashedKey& hk, TimePoint now) {
+    size_t idx = shard_index(hk);
+    auto lock = write_lock(idx);
+    auto& shard = shards_[idx];
+    auto it = shard.data.find(hk);
+    if (it == shard.data.end()) return false;
+    uint32_t slot = it->second.expiry_slot;
+    if (slot == kNoSlot || shard.expiry_heap[slot].first > now) return false;
+    erase(shard, it);
+    shard.removed_version = ++shard.version;
+    size_.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
 
-    if (pattern == "*") {
-        for (const auto& [key, _] : data_) {
-            result.push_back(key);
+std::optional<TimePoint> HashTable::expiry(const HashedKey& hk) const {
+    size_t idx = shard_index(hk);
+    auto lock = read_lock(idx);
+    const auto& shard = shards_[idx];
+    auto it = shard.data.find(hk);
+    if (it == shard.data.end() || it->second.expiry_slot == kNoSlot) return std::nullopt;
+    return shard.expiry_heap[it->second.expiry_slot].first;
+}
+
+std::vector<std::string> HashTable::remove_expired(TimePoint now, size_t limit) {
+    std::vector<std::string> removed;
+    for (size_t i = 0; i < kShardCount && removed.size() < limit; ++i) {
+        auto& shard = shards_[i];
+        {
+            // Most shards have nothing due; find that out without blocking readers
+            auto lock = read_lock(i);
+            if (shard.expiry_heap.empty() || shard.expiry_heap.front().first > now) continue;
+        }
+        auto lock = write_lock(i);
+        size_t erased = 0;
+        while (!shard.expiry_heap.empty() && shard.expiry_heap.front().first <= now &&
+               removed.size() < limit) {
+            Node* node = shard.expiry_heap.front().second;
+            removed.push_back(node->first);
+            erase(shard, shard.data.iterator_to(*node));
+            ++erased;
+        }
+        if (erased > 0) {
+            shard.removed_version = ++shard.version;
+            size_.fetch_sub(erased, std::memory_order_relaxed);
         }
+    }
+    return removed;
+}
+
+std::vector<std::string> HashTable::expired_keys(TimePoint now) const {
+    std::vector<std::string> expired;
+    for (size_t i = 0; i < kShardCount; ++i) {
+        auto lock = read_lock(i);
+        for (const auto& [deadline, node] : shards_[i].expiry_heap) {
+            if (deadline <= now) expired.push_back(node->first);
+        }
+    }
+    return expired;
+}
+
+void HashTable::heap_set(Shard& shard, Node& node, TimePoint deadline) {
+    auto& heap = shard.expiry_heap;
+    uint32_t& slot = node.second.expiry_slot;
+    if (slot == kNoSlot) {
+        heap.emplace_back(deadline, &node);
+        slot = static_cast<uint32_t>(heap.size() - 1);
+        expiry_count_.fetch_add(1, std::memory_order_relaxed);
+        heap_up(shard, slot);
+        return;
+    }
+    heap[slot].first = deadline;
+    heap_up(shard, slot);
+    heap_down(shard, node.second.expiry_slot);
+}
+
+void HashTable::heap_erase(Shard& shard, Node& node) {
+    auto& heap = shard.expiry_heap;
+    size_t slot = node.second.expiry_slot;
+    if (slot == kNoSlot) return;
+    node.second.expiry_slot = kNoSlot;
+    expiry_count_.fetch_sub(1, std::memory_order_relaxed);
+    if (slot != heap.size() - 1) {
+        Node* moved = heap.back().second;
+        heap[slot] = heap.back();
+        heap.pop_back();
+        heap_up(shard, slot);
+        heap_down(shard, moved->second.expiry_slot);
     } else {
+        heap.pop_back();
+    }
+}
+
+void HashTable::heap_place(Shard& shard, size_t slot) {
+    shard.expiry_heap[slot].second->second.expiry_slot = static_cast<uint32_t>(slot);
+}
+
+void HashTable::heap_up(Shard& shard, size_t slot) {
+    auto& heap = shard.expiry_heap;
+    while (slot > 0) {
+        size_t parent = (slot - 1) / 2;
+        if (heap[parent].first <= heap[slot].first) break;
+        std::swap(heap[parent], heap[slot]);
+        heap_place(shard, slot);
+        slot = parent;
+    }
+    heap_place(shard, slot);
+}
+
+void HashTable::heap_down(Shard& shard, size_t slot) {
+    auto& heap = shard.expiry_heap;
+    for (;;) {
+        size_t smallest = slot;
+        size_t left = 2 * slot + 1;
+        size_t right = left + 1;
+        if (left < heap.size() && heap[left].first < heap[smallest].first) smallest = left;
+        if (right < heap.size() && heap[right].first < heap[smallest].first) smallest = right;
+        if (smallest == slot) break;
+        std::swap(heap[smallest], heap[slot]);
+        heap_place(shard, slot);
+        slot = smallest;
+    }
+    heap_place(shard, slot);
+}
+
+std::optional<size_t> HashTable::resident_size(const std::string& key) const {
+    HashedKey hk(key);
+    size_t idx = shard_index(hk);
+    auto lock = read_lock(idx);
+    const auto& data = shards_[idx].data;
+    auto it = data.find(hk);
+    if (it == data.end() || it->second.cold.valid()) return std::nullopt;
+    return key.size() + it->second.value.memory_size();
+}
+
+size_t HashTable::relocate_cold(uint32_t segment) {
+    if (!value_log_) return 0;
+    size_t moved = 0;
+    for (size_t i = 0; i < kShardCount; ++i) {
+        auto lock = write_lock(i);
+        for (auto& [key, entry] : shards_[i].data) {
+            if (!entry.cold.valid() || entry.cold.segment != segment) continue;
+            auto fresh = value_log_->append(entry.cold.type, value_log_->read(entry.cold));
+            value_log_->release(entry.cold);
+            entry.cold = fresh;
+            ++moved;
+        }
+    }
+    return moved;
+}
+
+bool HashTable::rehash_step(std::chrono::microseconds budget) {
+    auto deadline = Clock::now() + budget;
+    bool pending = false;
+    for (size_t i = 0; i < kShardCount; ++i) {
+        {
+            auto lock = read_lock(i);
+            if (!shards_[i].data.rehashing()) continue;
+        }
+        // Short batches, so readers of the shard wait at most one batch
+        bool more = true;
+        while (more && Clock::now() < deadline) {
+            auto lock = write_lock(i);
+            more = shards_[i].data.rehash_step(128);
+        }
+        if (more) pending = true;
+        if (Clock::now() >= deadline) {
+            for (size_t j = i + 1; j < kShardCount && !pending; ++j) {
+                auto lock = read_lock(j);
+                pending = shards_[j].data.rehashing();
+            }
+            break;
+        }
+    }
+    return pending;
+}
+
+size_t HashTable::memory_usage_estimate(size_t samples) const {
+    // Per-node overhead of the shard's Dict: next pointer, cached hash and
+    // the key string object, plus one bucket pointer, and the entry's
+    // metadata around the value
+    constexpr size_t kNodeOverhead =
+        3 * sizeof(void*) + sizeof(std::string) + sizeof(Entry) - sizeof(Value);
+
+    size_t total = size();
+    if (total == 0) return 0;
+    // Sample evenly across shards so one large shard does not skew the mean
+    size_t per_shard = std::max<size_t>(1, samples / kShardCount);
+    size_t seen = 0;
+    size_t bytes = 0;
+    for (size_t i = 0; i < kShardCount; ++i) {
+        auto lock = read_lock(i);
+        const auto& data = shards_[i].data;
+        size_t taken = 0;
+        for (auto it = data.begin(); it != data.end() && taken < per_shard; ++it, ++taken) {
+            bytes += kNodeOverhead + it->first.size() + it->second.value.memory_size();
+        }
+        seen += taken;
+    }
+    if (seen == 0) return 0;
+    return bytes * total / seen;
+}
+
+std::vector<HashTable::SizeClass> HashTable::size_classes() const {
+    constexpr size_t kNodeOverhead =
+        3 * sizeof(void*) + sizeof(std::string) + sizeof(Entry) - sizeof(Value);
+
+    std::map<std::tuple<uint8_t, bool, bool, size_t>, std::pair<size_t, size_t>> classes;
+    for (size_t i = 0; i < kShardCount; ++i) {
+        auto lock = read_lock(i);
+        for (const auto& [key, entry] : shards_[i].data) {
+            bool cold = entry.cold.valid();
+            uint8_t type = cold ? entry.cold.type & ~kColdCompressed
+                                : static_cast<uint8_t>(entry.value.type());
+            bool compressed = cold ? (entry.cold.type & kColdCompressed) != 0
+                                   : entry.value.is_compressed();
+            size_t bytes = kNodeOverhead + key.size() + (cold ? 0 : entry.value.memory_size());
+            size_t max_bytes = std::bit_ceil(bytes);
+            auto& [entries, total] = classes[{type, compressed, cold, max_bytes}];
+            ++entries;
+            total += bytes;
+        }
+    }
+
+    std::vector<SizeClass> result;
+    result.reserve(classes.size());
+    for (const auto& [k, v] : classes) {
+        result.push_back({static_cast<Value::Type>(std::get<0>(k)), std::get<1>(k), std::get<2>(k),
+                          std::get<3>(k), v.first, v.second});
+    }
+    return result;
+}
+
+void HashTable::visit_shard(size_t shard,
+                            const std::function<void(const std::string& key, const Value& value,
+                                                     std::optional<TimePoint> deadline)>& fn) const {
+    auto lock = read_lock(shard);
+    const auto& s = shards_[shard];
+    for (const auto& [key, entry] : s.data) {
+        std::optional<TimePoint> deadline;
+        if (entry.expiry_slot != kNoSlot) deadline = s.expiry_heap[entry.expiry_slot].first;
+        if (entry.cold.valid()) {
+            fn(key, load_raw(entry), deadline);
+        } else {
+            fn(key, entry.value, deadline);
+        }
+    }
+}
+
+size_t HashTable::scan_shard(size_t shard, size_t cursor, size_t count,
+                             const std::function<void(const std::string& key, const Value& value,
+                                                      std::optional<TimePoint> deadline)>& fn) const {
+    auto lock = read_lock(shard);
+    const auto& s = shards_[shard];
+    size_t visited = 0;
+    // Empty buckets count a little too, so a sparse shard still yields
+    size_t buckets = std::max<size_t>(count, 1) * 10;
+    do {
+        cursor = s.data.scan(cursor, [&](const Map::value_type& kv) {
+            const auto& [key, entry] = kv;
+            std::optional<TimePoint> deadline;
+            if (entry.expiry_slot != kNoSlot) deadline = s.expiry_heap[entry.expiry_slot].first;
+            if (entry.cold.valid()) {
+                fn(key, load_raw(entry), deadline);
+            } else {
+                fn(key, entry.value, deadline);
+            }
+            ++visited;
+        });
+    } while (cursor != 0 && visited < count && --buckets > 0);
+    return cursor;
+}
+
+bool HashTable::contains(const HashedKey& hk) {
+    size_t idx = shard_index(hk);
+    auto lock = read_lock(idx);
+    return shards_[idx].data.count(hk) > 0;
+}
+
+std::vector<std::string> HashTable::keys(const std::string& pattern) {
+    std::vector<std::string> result;
+    std::optional<std::regex> re;
+    if (pattern != "*") {
         // Convert glob pattern to regex
         std::string regex_str;
         for (char c : pattern) {
@@ -71,9 +749,15 @@ std::vector<std::string> HashTable::keys(const std::string& pattern) {
             else if (c == '?') regex_str += ".";
             else regex_str += c;
         }
-        std::regex re(regex_str);
-        for (const auto& [key, _] : data_) {
-            if (std::regex_match(key, re)) {
+        re.emplace(regex_str);
+    }
+
+    // Shards are visited one at a time, so the result is not a point-in-time
+    // snapshot across shards
+    for (size_t i = 0; i < kShardCount; ++i) {
+        auto lock = read_lock(i);
+        for (const auto& [key, _] : shards_[i].data) {
+            if (!re || std::regex_match(key, *re)) {
                 result.push_back(key);
             }
         }
@@ -81,34 +765,144 @@ std::vector<std::string> HashTable::keys(const std::string& pattern) {
     return result;
 }
 
+std::vector<std::string> HashTable::keys_if(const std::function<bool(const std::string&)>& pred,
+                                            size_t limit) {
+    std::vector<std::string> result;
+    for (size_t i = 0; i < kShardCount && result.size() < limit; ++i) {
+        auto lock = read_lock(i);
+        for (const auto& [key, _] : shards_[i].data) {
+            if (result.size() >= limit) break;
+            if (pred(key)) result.push_back(key);
+        }
+    }
+    return result;
+}
+
+namespace {
+
+// The Dict node around each entry adds its cached hash and chain pointer
+template <typename NodeT>
+constexpr size_t kNodeBlockBytes = sizeof(NodeT) + sizeof(uint64_t) + sizeof(void*);
+
+uintptr_t page_of(const void* p) {
+    return reinterpret_cast<uintptr_t>(p) & ~(uintptr_t{HashTable::kPageSize} - 1);
+}
+
+// A key's characters when they live outside the node (past the inline buffer)
+template <typename NodeT>
+const char* key_block(const NodeT& node) {
+    const char* data = node.first.data();
+    const auto* self = reinterpret_cast<const char*>(&node);
+    return data < self || data >= self + sizeof(NodeT) ? data : nullptr;
+}
+
+}  // namespace
+
+void HashTable::page_usage(size_t shard, PageUsage& pages) const {
+    auto lock = read_lock(shard);
+    for (const auto& node : shards_[shard].data) {
+        pages[page_of(&node)] += kNodeBlockBytes<Node>;
+        if (const char* key = key_block(node)) pages[page_of(key)] += node.first.capacity() + 1;
+        if (node.second.cold.valid()) continue;
+        auto [block, bytes] = node.second.value.heap_block();
+        if (block) pages[page_of(block)] += bytes;
+    }
+}
+
+std::vector<std::string> HashTable::sparse_keys(size_t shard, const SparsePage& sparse) const {
+    std::vector<std::string> keys;
+    auto lock = read_lock(shard);
+    for (const auto& node : shards_[shard].data) {
+        const void* block = node.second.cold.valid() ? nullptr : node.second.value.heap_block().first;
+        if (sparse(page_of(&node)) || (block && sparse(page_of(block)))) keys.push_back(node.first);
+    }
+    return keys;
+}
+
+size_t HashTable::relocate(const std::vector<std::string>& keys, const SparsePage& sparse,
+                           Retired& retired) {
+    if (keys.empty()) return 0;
+    size_t idx = shard_of(keys.front());
+    auto lock = write_lock(idx);
+    auto& shard = shards_[idx];
+    size_t moved = 0;
+    for (const auto& key : keys) {
+        auto it = shard.data.find(HashedKey(key));
+        if (it == shard.data.end()) continue;
+        const void* block = it->second.cold.valid() ? nullptr : it->second.value.heap_block().first;
+        // Values without a single block (full-encoded hashes, sorted sets,
+        // HyperLogLogs, Bloom filters) are never copied: that would rebuild
+        // the whole structure under the write lock
+        bool move_value = block && sparse(page_of(block));
+        if (!move_value && !sparse(page_of(&*it))) continue;
+
+        Node* old = &*it;
+        auto [moved_it, old_node] = shard.data.reallocate(it);
+        retired.nodes.push_back(std::move(old_node));
+        Node* node = &*moved_it;
+        Entry& entry = node->second;
+        if (move_value) {
+            // Copying allocates exactly what the contents need
+            Value copy(entry.value);
+            retired.values.push_back(std::move(entry.value));
+            entry.value = std::move(copy);
+        }
+        // Everything that points at the node by address follows it
+        if (entry.expiry_slot != kNoSlot) shard.expiry_heap[entry.expiry_slot].second = node;
+        if (entry.lru_prev) entry.lru_prev->second.lru_next = node;
+        if (entry.lru_next) entry.lru_next->second.lru_prev = node;
+        if (shard.lru_head == old) shard.lru_head = node;
+        if (shard.lru_tail == old) shard.lru_tail = node;
+        ++moved;
+    }
+    return moved;
+}
+
 void HashTable::clear() {
-    std::unique_lock lock_a(mutex_a_);
-    std::lock_guard lock_b(mutex_b_);
-    data_.clear();
+    // Locked in canonical order rather than through lock_shards() so that
+    // a FLUSHALL inside EXEC, which already holds every shard, works too
+    std::vector<std::unique_lock<std::shared_mutex>> locks;
+    locks.reserve(kShardCount);
+    for (size_t i = 0; i < kShardCount; ++i) locks.push_back(write_lock(i));
+    for (auto& shard : shards_) {
+        for (auto& [key, entry] : shard.data) forget_cold(entry);
+        shard.data.clear();
+        shard.expiry_heap.clear();
+        shard.lru_head = nullptr;
+        shard.lru_tail = nullptr;
+        shard.removed_version = ++shard.version;
+    }
     size_.store(0, std::memory_order_relaxed);
+    compressed_count_.store(0, std::memory_order_relaxed);
+    expiry_count_.store(0, std::memory_order_relaxed);
+    resident_bytes_.store(0, std::memory_order_relaxed);
 }
 
 bool HashTable::set_with_probe(const std::string& key, Value value) {
     size_t idx = hash_key(key) % probe_capacity_;
+    Slot* reusable = nullptr;
 
     for (size_t i = 0; i < probe_capacity_; ++i) {
         size_t pos = (idx + i) % probe_capacity_;
         auto& slot = probe_table_[pos];
 
-        if (!slot.occupied) {
-            slot.key = key;
-            slot.value = std::move(value);
-            slot.occupied = true;
-            slot.deleted = false;
-            return true;
-        }
-
-        if (slot.key == key) {
+        if (slot.occupied && slot.key == key) {
             slot.value = std::move(value);
             return false;  // updated, not inserted
         }
+        if (!slot.occupied) {
+            // The key may still sit past a tombstone, so keep probing to the
+            // first never-used slot and insert at the earliest free one
+            if (!reusable) reusable = &slot;
+            if (!slot.deleted) break;
+        }
     }
-    return false;  // table full
+    if (!reusable) return false;  // table full
+    reusable->key = key;
+    reusable->value = std::move(value);
+    reusable->occupied = true;
+    reusable->deleted = false;
+    return true;
 }
 
 std::optional<Value> HashTable::get_with_probe(const std::string& key) {
@@ -118,10 +912,10 @@ std::optional<Value> HashTable::get_with_probe(const std::string& key) {
         size_t pos = (idx + i) % probe_capacity_;
         const auto& slot = probe_table_[pos];
 
-        
-        if (!slot.occupied) break;
+        // Tombstones continue the probe; only a never-used slot ends it
+        if (!slot.occupied && !slot.deleted) break;
 
-        if (slot.key == key && !slot.deleted) {
+        if (slot.occupied && slot.key == key) {
             return slot.value;
         }
     }
@@ -151,7 +945,7 @@ void HashTable::set_eviction_callback(std::function<void(const std::string&)> cb
 }
 
 size_t HashTable::hash_key(const std::string& key) const {
-    return std::hash<std::string>{}(key);
+    return hashing::hash(key);
 }
 
 }  // namespace cacheforge
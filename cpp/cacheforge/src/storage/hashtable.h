@@ -3,31 +3,233 @@
 #define CACHEFORGE_HASHTABLE_H
 
 #include <string>
-#include <unordered_map>
 #include <shared_mutex>
 #include <mutex>
 #include <optional>
 #include <atomic>
 #include <functional>
+#include <vector>
+#include <unordered_map>
+#include <chrono>
+#include <cstdint>
 #include "data/value.h"
+#include "storage/dict.h"
+#include "storage/value_log.h"
+#include "utils/hash.h"
 
 namespace cacheforge {
 
-// Thread-safe hash table for cache storage
+using Clock = std::chrono::steady_clock;
+using TimePoint = Clock::time_point;
+using Duration = Clock::duration;
+
+// Thread-safe hash table for cache storage.
+// Keys are spread over kShardCount shards, each with its own reader/writer
+// lock, so operations on different keys rarely contend. An operation only
+// ever takes the one lock of its key's shard; code that needs several
+// shards at once (transactions) goes through ShardLockSet, which takes
+// them in ascending shard order. That single canonical order is what keeps
+// multi-shard locking deadlock-free. Each shard is a Dict, which grows and
+// shrinks incrementally, so no write stalls on rebuilding a whole shard.
 class HashTable {
 public:
+    static constexpr size_t kShardCount = 64;
+
     HashTable(size_t max_size = 1000000);
 
     
-    bool set(const std::string& key, Value value);
+    bool set(const std::string& key, Value value) { return set(HashedKey(key), std::move(value)); }
     std::optional<Value> get(const std::string& key);
-    bool remove(const std::string& key);
+    bool remove(const std::string& key) { return remove(HashedKey(key)); }
+    // The HashedKey overloads here and below are for callers that touch a
+    // key several times per request and hash it once up front
+    bool set(const HashedKey& hk, Value value);
+    bool remove(const HashedKey& hk);
 
     
     size_t size() const { return size_.load(std::memory_order_relaxed); }
+    // Shard a key lives in; work split by shard never contends on a lock
+    size_t shard_of(const std::string& key) const { return shard_index(HashedKey(key)); }
+
+    // Read-modify-write under the write lock, so commands such as HSET or
+    // ZADD change one field in place instead of copying the whole value out
+    // and writing it back. A missing key is created as a default Value and
+    // `created` is true. fn returns whether it changed the value; only then
+    // is the key's version bumped and its LRU position refreshed, and if it
+    // did not (or threw) a freshly created entry is discarded. Returns what
+    // fn returned.
+    bool update(const std::string& key, const std::function<bool(Value& value, bool created)>& fn) {
+        return update(HashedKey(key), fn);
+    }
+    bool update(const HashedKey& hk, const std::function<bool(Value& value, bool created)>& fn);
+
+    // Runs fn on the stored value under the read lock without copying it.
+    // Returns false if the key does not exist.
+    bool view(const std::string& key, const std::function<void(const Value& value)>& fn) {
+        return view(HashedKey(key), fn);
+    }
+    bool view(const HashedKey& hk, const std::function<void(const Value& value)>& fn);
+
+    // Changes whenever the key is written or removed (WATCH). Every write
+    // takes a new number from its shard's counter; a missing key reports the
+    // shard's last removal, so removing another key of the same shard can
+    // change it too: a watcher may see a spurious change but never misses one.
+    uint64_t version(const std::string& key) const { return version(HashedKey(key)); }
+    uint64_t version(const HashedKey& hk) const;
+    // Removes the key only if it was not written since version() returned
+    // `version`, so a copy of the key taken at that version is still exact
+    bool remove_if_version(const std::string& key, uint64_t version);
+
+    // Exclusive locks on a set of shards, held for the object's lifetime.
+    // Table operations on those shards from the owning thread skip their
+    // own locking, so a batch of operations runs atomically with respect to
+    // every other thread. Not reentrant; one set per thread at a time.
+    class ShardLockSet {
+    public:
+        ShardLockSet(ShardLockSet&& other) noexcept;
+        ShardLockSet& operator=(ShardLockSet&&) = delete;
+        ~ShardLockSet();
+
+    private:
+        friend class HashTable;
+        ShardLockSet(const HashTable* table, uint64_t mask);
+        const HashTable* table_;
+        uint64_t mask_;
+    };
+    // Locks the shards of `keys`, or every shard when `all` is set
+    ShardLockSet lock_shards(const std::vector<std::string>& keys, bool all = false) const;
+    ShardLockSet lock_shards(const std::vector<HashedKey>& keys) const;
+
+    // True while the calling thread holds shards through a ShardLockSet;
+    // work that would lock further shards must wait until it is released
+    bool holding_shards() const;
+
+    // Tiered storage. With a value log attached, demote() moves a value to
+    // the log and keeps only its Location in the entry. Reads of a demoted
+    // value decode it from the log; the `promote_after`-th such read (0 =
+    // never) and any write bring it back into memory. Attaching a log also
+    // turns on the resident LRU below. Call before use.
+    void set_value_log(ValueLog* log, uint32_t promote_after = 2);
+    bool demote(const std::string& key);
+    // Bytes a key and its value hold in memory; nullopt if the key is
+    // missing or demoted
+    std::optional<size_t> resident_size(const std::string& key) const;
+    // Copies the demoted values stored in `segment` to the log's head so
+    // the segment can be dropped; returns how many moved
+    size_t relocate_cold(uint32_t segment);
+    size_t cold_count() const { return cold_count_.load(std::memory_order_relaxed); }
+    uint64_t promotions() const { return promotions_.load(std::memory_order_relaxed); }
+
+    // Expiry deadlines. A deadline lives in its key's entry, and each shard
+    // keeps a min-heap of (deadline, entry) so due keys are found without a
+    // scan; removing a key drops its deadline with it. set_expiry() on a
+    // missing key does nothing and returns false.
+    bool set_expiry(const std::string& key, TimePoint deadline) { return set_expiry(HashedKey(key), deadline); }
+    bool set_expiry(const HashedKey& hk, TimePoint deadline);
+    bool clear_expiry(const std::string& key) { return clear_expiry(HashedKey(key)); }
+    bool clear_expiry(const HashedKey& hk);
+    // set() keeps whatever deadline the key had; this writes the value and
+    // replaces the deadline, clearing it when empty, under the same shard
+    // lock, so the old deadline can never expire the new value
+    bool set_with_expiry(const std::string& key, Value value, std::optional<TimePoint> deadline) {
+        return set_with_expiry(HashedKey(key), std::move(value), deadline);
+    }
+    bool set_with_expiry(const HashedKey& hk, Value value, std::optional<TimePoint> deadline);
+    // Removes the key only if its deadline is at or before `now`, checked
+    // under the same lock, so a key rewritten since it came due stays
+    bool remove_if_expired(const std::string& key, TimePoint now) {
+        return remove_if_expired(HashedKey(key), now);
+    }
+    bool remove_if_expired(const HashedKey& hk, TimePoint now);
+    std::optional<TimePoint> expiry(const std::string& key) const { return expiry(HashedKey(key)); }
+    std::optional<TimePoint> expiry(const HashedKey& hk) const;
+    // Removes up to `limit` keys whose deadline is at or before `now` and
+    // returns them
+    std::vector<std::string> remove_expired(TimePoint now, size_t limit = SIZE_MAX);
+    std::vector<std::string> expired_keys(TimePoint now) const;
+    size_t expiry_count() const { return expiry_count_.load(std::memory_order_relaxed); }
+
+    // Resident LRU, kept while a value log is attached: each write puts its
+    // key at the front of its shard's list and records the bytes it holds.
+    // touch() records a read under the shared lock by stamping the key's
+    // tick only; demote_lru() moves a key read since it was listed back to
+    // the front when it reaches the tail, then demotes the least recently
+    // used resident value of the whole table
+    bool touch(const std::string& key) { return touch(HashedKey(key)); }
+    bool touch(const HashedKey& hk);
+    bool demote_lru();
+    size_t resident_bytes() const { return resident_bytes_.load(std::memory_order_relaxed); }
+
+    // Strings and binaries of at least `min_bytes` are stored LZ4-compressed
+    // when that saves space (0 = off) and decompressed on every read, so
+    // callers never see the compressed form. Call before use.
+    void set_compression(size_t min_bytes) { compression_min_bytes_ = min_bytes; }
+    // The stored value, still compressed if it is; snapshots and replicas
+    // ship these bytes as they are
+    std::optional<Value> get_raw(const std::string& key);
+    size_t compressed_count() const { return compressed_count_.load(std::memory_order_relaxed); }
+
+    // Advances resizes in progress, one shard at a time, until `budget` has
+    // passed; returns true while any shard is still resizing. Writes move
+    // the resize along too, so this is for when the table is mostly read
+    bool rehash_step(std::chrono::microseconds budget);
+
+    // Approximate bytes held by keys and values, extrapolated from a sample
+    // of entries so it stays cheap on large tables
+    size_t memory_usage_estimate(size_t samples = 1024) const;
 
-    bool contains(const std::string& key);
+    // Entries grouped by value type and power-of-two size class, the way a
+    // slab allocator buckets them. `bytes` counts key, value and per-entry
+    // overhead; a demoted value counts only its entry, under `cold`. Walks
+    // the whole table, one shard at a time under its read lock
+    struct SizeClass {
+        Value::Type type;
+        bool compressed;
+        bool cold;
+        size_t max_bytes;  // entries up to this size, above the class below
+        size_t entries;
+        size_t bytes;
+    };
+    std::vector<SizeClass> size_classes() const;
+
+    // Active defragmentation (see Defragmenter). page_usage() adds the
+    // bytes of every block a shard's entries own (the node, a key past the
+    // inline buffer and the value's heap_block()) to the page each starts
+    // on, under the shard's read lock. sparse_keys() lists the keys of a
+    // shard whose node or value block starts on a page `sparse` picks, and
+    // relocate() copies those keys' nodes and values to fresh allocations
+    // under their shard's write lock, re-checking `sparse` first; demoted
+    // values stay in the log. The keys must all be in one shard. The old
+    // blocks go to `retired` and are freed when it is dropped. Returns how
+    // many keys moved.
+    using PageUsage = std::unordered_map<uintptr_t, size_t>;
+    using SparsePage = std::function<bool(uintptr_t page)>;
+    static constexpr size_t kPageSize = 4096;
+    struct Retired;
+    void page_usage(size_t shard, PageUsage& pages) const;
+    std::vector<std::string> sparse_keys(size_t shard, const SparsePage& sparse) const;
+    size_t relocate(const std::vector<std::string>& keys, const SparsePage& sparse, Retired& retired);
+
+    bool contains(const std::string& key) { return contains(HashedKey(key)); }
+    bool contains(const HashedKey& hk);
     std::vector<std::string> keys(const std::string& pattern = "*");
+    // Up to `limit` keys for which `pred` is true, visiting shards one at
+    // a time under their read lock
+    std::vector<std::string> keys_if(const std::function<bool(const std::string&)>& pred,
+                                     size_t limit = SIZE_MAX);
+    // Calls `fn` with every key of one shard (0 to kShardCount - 1), its
+    // value as stored (see get_raw) and its deadline, if any, all under the
+    // shard's read lock; `fn` must not call back into the table
+    void visit_shard(size_t shard,
+                     const std::function<void(const std::string& key, const Value& value,
+                                              std::optional<TimePoint> deadline)>& fn) const;
+    // visit_shard a piece at a time: visits keys from `cursor` (0 to start)
+    // until at least `count` were seen or the shard is done, and returns
+    // the cursor to go on from, 0 when it is done (see Dict::scan). A key
+    // there for the whole scan is visited at least once, maybe twice
+    size_t scan_shard(size_t shard, size_t cursor, size_t count,
+                      const std::function<void(const std::string& key, const Value& value,
+                                               std::optional<TimePoint> deadline)>& fn) const;
     void clear();
 
     
@@ -36,11 +238,43 @@ public:
     std::optional<Value> get_with_probe(const std::string& key);
     bool remove_with_probe(const std::string& key);
 
+    // Called with the key just written whenever a write leaves more than
+    // max_size keys, after the shard lock is released. Nothing is removed:
+    // the key stays, and evicting is up to the callback.
     void set_eviction_callback(std::function<void(const std::string&)> cb);
 
 private:
-    // The main storage
-    std::unordered_map<std::string, Value> data_;
+    struct Entry;
+    using Node = std::pair<const std::string, Entry>;
+    static constexpr uint32_t kNoSlot = UINT32_MAX;
+
+    // Everything the table knows about a key sits in its entry, so expiry
+    // and the LRU point at map nodes instead of keeping copies of the key
+    struct Entry {
+        Value value;
+        uint64_t version = 0;
+        ValueLog::Location cold;  // valid when the value lives in the log
+        uint32_t cold_reads = 0;
+        uint32_t expiry_slot = kNoSlot;  // index in the shard's expiry heap
+        uint32_t resident_bytes = 0;     // counted in resident_bytes_ while in the LRU
+        uint32_t lru_tick = 0;           // table-wide clock at the last access
+        uint32_t lru_linked = 0;         // lru_tick when last put at the front
+        Node* lru_prev = nullptr;
+        Node* lru_next = nullptr;
+    };
+    using Map = Dict<Entry>;
+    struct alignas(64) Shard {
+        mutable std::shared_mutex mutex;
+        Map data;
+        uint64_t version = 0;          // last version handed out in this shard
+        uint64_t removed_version = 0;  // version of the last removal
+        std::vector<std::pair<TimePoint, Node*>> expiry_heap;
+        Node* lru_head = nullptr;  // most recently used
+        Node* lru_tail = nullptr;
+    };
+    static_assert(kShardCount <= 64, "shard masks are 64-bit");
+
+    std::vector<Shard> shards_;
 
     // Custom open-addressing table for high-performance path
     struct Slot {
@@ -52,15 +286,73 @@ private:
     std::vector<Slot> probe_table_;
     size_t probe_capacity_;
 
-    
-    mutable std::shared_mutex mutex_a_;
-    mutable std::mutex mutex_b_;
-
     std::atomic<size_t> size_{0};
     size_t max_size_;
     std::function<void(const std::string&)> eviction_callback_;
 
+    ValueLog* value_log_ = nullptr;
+    uint32_t promote_after_ = 0;
+    std::atomic<size_t> cold_count_{0};
+    std::atomic<uint64_t> promotions_{0};
+    size_t compression_min_bytes_ = 0;
+    std::atomic<size_t> compressed_count_{0};
+    std::atomic<size_t> expiry_count_{0};
+    std::atomic<size_t> resident_bytes_{0};
+    std::atomic<uint32_t> lru_clock_{0};
+
+    // Value of an entry as callers see it: read back from the log if it
+    // is demoted and decompressed if it is compressed
+    Value load(const Entry& entry) const;
+    // The entry's value as stored, read back from the log if demoted
+    Value load_raw(const Entry& entry) const;
+    // Stores `value` in the entry, compressing it if that is enabled and
+    // worthwhile; caller holds the write lock
+    void store(Entry& entry, Value value);
+    // Brings a demoted value back into memory; caller holds the write lock
+    void promote(Shard& shard, Node& node);
+    // Moves a resident value to the log; caller holds the write lock
+    void demote(Shard& shard, Node& node);
+    // set() and set_with_expiry(); the deadline is only touched when
+    // `replace_deadline` is set
+    bool store_key(const HashedKey& hk, Value value, bool replace_deadline,
+                   std::optional<TimePoint> deadline);
+    // Unlinks the entry from the LRU and expiry heap and erases it, without
+    // touching size_; caller holds the write lock
+    void erase(Shard& shard, Map::iterator it);
+
+    // Expiry heap maintenance; caller holds the write lock
+    void heap_set(Shard& shard, Node& node, TimePoint deadline);
+    void heap_erase(Shard& shard, Node& node);
+    void heap_place(Shard& shard, size_t slot);
+    void heap_up(Shard& shard, size_t slot);
+    void heap_down(Shard& shard, size_t slot);
+
+    // Puts a resident value at the front of the LRU with its current size,
+    // or takes it out of the LRU; no-ops without a value log. Caller holds
+    // the write lock
+    void lru_track(Shard& shard, Node& node);
+    void lru_untrack(Shard& shard, Node& node);
+    // Moves a listed value to the front, keeping its tick
+    void lru_push_front(Shard& shard, Node& node);
+    // Drops the entry's log record, if any; caller holds the write lock
+    void forget_cold(Entry& entry);
+    // Counts a read of a demoted value and promotes it once it is hot
+    void note_cold_read(size_t shard, const HashedKey& hk);
+
     size_t hash_key(const std::string& key) const;
+    // The shard comes from the hash's high bits and the shard's bucket from
+    // its low bits, so the two stay independent
+    size_t shard_index(const HashedKey& hk) const { return (hk.hash >> 32) % kShardCount; }
+    // Locks for one shard, left unlocked when this thread already holds the
+    // shard through a ShardLockSet
+    std::unique_lock<std::shared_mutex> write_lock(size_t shard) const;
+    std::shared_lock<std::shared_mutex> read_lock(size_t shard) const;
+    bool holds(size_t shard) const;
+};
+
+struct HashTable::Retired {
+    std::vector<Map::Retired> nodes;
+    std::vector<Value> values;
 };
 
 }  // namespace cacheforge
@@ -0,0 +1,171 @@
+#include "storage/hotkeys.h"
+#include <algorithm>
+#include <limits>
+
+namespace cacheforge {
+
+namespace {
+
+// Row i uses h1 + i * h2 (Kirsch-Mitzenmacher), so one key hash serves
+// every row of the sketch
+inline size_t row_hash(size_t hash, size_t row) {
+    size_t h2 = (hash >> 32) | 1;
+    return hash + row * h2;
+}
+
+bool heap_greater(const std::pair<uint64_t, std::string>& a,
+                  const std::pair<uint64_t, std::string>& b) {
+    return a.first > b.first;
+}
+
+}  // namespace
+
+HotKeyTracker::HotKeyTracker(size_t top_k, uint32_t sample_rate,
+                             std::chrono::seconds decay_interval,
+                             size_t width, size_t depth)
+    : sample_rate_(std::max<uint32_t>(1, sample_rate)),
+      width_(std::max<size_t>(1, width)),
+      depth_(std::max<size_t>(1, depth)),
+      top_k_(top_k),
+      sketch_(width_ * depth_, 0),
+      decay_interval_(decay_interval),
+      next_decay_(Clock::now() + decay_interval) {
+    heap_.reserve(top_k_);
+}
+
+void HotKeyTracker::record(const std::string& key) {
+    if (sample()) add(key, hashing::hash(key));
+}
+
+void HotKeyTracker::record(const HashedKey& hk) {
+    if (sample()) add(hk.key, hk.hash);
+}
+
+bool HotKeyTracker::sample() {
+    if (!enabled_.load(std::memory_order_relaxed)) return false;
+    thread_local uint32_t tick = 0;
+    if (++tick < sample_rate_.load(std::memory_order_relaxed)) return false;
+    tick = 0;
+    return true;
+}
+
+void HotKeyTracker::add(std::string_view key, size_t hash) {
+    std::lock_guard lock(mutex_);
+    sampled_++;
+    if (decay_interval_.count() > 0 && Clock::now() >= next_decay_) {
+        decay_locked();
+        next_decay_ = Clock::now() + decay_interval_;
+    }
+    offer_locked(key, increment_locked(hash));
+}
+
+std::vector<std::pair<std::string, uint64_t>> HotKeyTracker::top(size_t n) const {
+    std::vector<std::pair<std::string, uint64_t>> result;
+    uint64_t scale = sample_rate_.load(std::memory_order_relaxed);
+    {
+        std::lock_guard lock(mutex_);
+        result.reserve(heap_.size());
+        for (const auto& [count, key] : heap_) {
+            result.emplace_back(key, count * scale);
+        }
+    }
+    std::sort(result.begin(), result.end(), [](const auto& a, const auto& b) {
+        return a.second != b.second ? a.second > b.second : a.first < b.first;
+    });
+    if (result.size() > n) result.resize(n);
+    return result;
+}
+
+uint64_t HotKeyTracker::estimate(const std::string& key) const {
+    size_t hash = hashing::hash(key);
+    std::lock_guard lock(mutex_);
+    return estimate_locked(hash) * sample_rate_.load(std::memory_order_relaxed);
+}
+
+void HotKeyTracker::decay() {
+    std::lock_guard lock(mutex_);
+    decay_locked();
+}
+
+void HotKeyTracker::reset() {
+    std::lock_guard lock(mutex_);
+    std::fill(sketch_.begin(), sketch_.end(), 0);
+    heap_.clear();
+    sampled_ = 0;
+}
+
+void HotKeyTracker::set_sample_rate(uint32_t rate) {
+    sample_rate_.store(std::max<uint32_t>(1, rate), std::memory_order_relaxed);
+}
+
+void HotKeyTracker::set_decay_interval(std::chrono::seconds interval) {
+    std::lock_guard lock(mutex_);
+    decay_interval_ = interval;
+    next_decay_ = Clock::now() + interval;
+}
+
+void HotKeyTracker::set_top_k(size_t k) {
+    std::lock_guard lock(mutex_);
+    top_k_ = k;
+    while (heap_.size() > top_k_) {
+        std::pop_heap(heap_.begin(), heap_.end(), heap_greater);
+        heap_.pop_back();
+    }
+}
+
+uint64_t HotKeyTracker::sampled_accesses() const {
+    std::lock_guard lock(mutex_);
+    return sampled_;
+}
+
+uint64_t HotKeyTracker::increment_locked(size_t hash) {
+    // Conservative update: only raise the rows at the current minimum,
+    // which keeps the over-estimate from hash collisions much smaller
+    uint64_t current = estimate_locked(hash);
+    if (current == std::numeric_limits<uint32_t>::max()) return current;
+    for (size_t row = 0; row < depth_; ++row) {
+        uint32_t& cell = sketch_[row * width_ + row_hash(hash, row) % width_];
+        if (cell == current) cell++;
+    }
+    return current + 1;
+}
+
+uint64_t HotKeyTracker::estimate_locked(size_t hash) const {
+    uint32_t min = std::numeric_limits<uint32_t>::max();
+    for (size_t row = 0; row < depth_; ++row) {
+        min = std::min(min, sketch_[row * width_ + row_hash(hash, row) % width_]);
+    }
+    return min;
+}
+
+void HotKeyTracker::offer_locked(std::string_view key, uint64_t count) {
+    if (top_k_ == 0) return;
+
+    auto it = std::find_if(heap_.begin(), heap_.end(),
+                           [&](const auto& entry) { return entry.second == key; });
+    if (it != heap_.end()) {
+        it->first = count;
+        std::make_heap(heap_.begin(), heap_.end(), heap_greater);
+        return;
+    }
+
+    if (heap_.size() < top_k_) {
+        heap_.emplace_back(count, key);
+        std::push_heap(heap_.begin(), heap_.end(), heap_greater);
+    } else if (count > heap_.front().first) {
+        std::pop_heap(heap_.begin(), heap_.end(), heap_greater);
+        heap_.back() = {count, std::string(key)};
+        std::push_heap(heap_.begin(), heap_.end(), heap_greater);
+    }
+}
+
+void HotKeyTracker::decay_locked() {
+    for (auto& cell : sketch_) cell >>= 1;
+    for (auto& entry : heap_) entry.first >>= 1;
+    heap_.erase(std::remove_if(heap_.begin(), heap_.end(),
+                               [](const auto& entry) { return entry.first == 0; }),
+                heap_.end());
+    std::make_heap(heap_.begin(), heap_.end(), heap_greater);
+}
+
+}  // namespace cacheforge
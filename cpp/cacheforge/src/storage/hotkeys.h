@@ -0,0 +1,77 @@
+#pragma once
+#ifndef CACHEFORGE_HOTKEYS_H
+#define CACHEFORGE_HOTKEYS_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utility>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include "utils/hash.h"
+
+namespace cacheforge {
+
+// Hot-key detector: a count-min sketch estimates per-key access frequency
+// and a small min-heap keeps the K keys with the highest estimates.
+// Only one access in `sample_rate` reaches the sketch, so the common path is
+// a thread-local counter increment; reported counts are scaled back up.
+// All counters are halved every `decay_interval` so keys that cooled down
+// drop out of the top-K.
+class HotKeyTracker {
+public:
+    explicit HotKeyTracker(size_t top_k = 16, uint32_t sample_rate = 16,
+                           std::chrono::seconds decay_interval = std::chrono::seconds(60),
+                           size_t width = 4096, size_t depth = 4);
+
+    void record(const std::string& key);
+    // Same, reusing a hash the caller already has
+    void record(const HashedKey& hk);
+
+    // Top keys by estimated access count, highest first
+    std::vector<std::pair<std::string, uint64_t>> top(size_t n) const;
+    uint64_t estimate(const std::string& key) const;
+
+    void decay();
+    void reset();
+
+    void set_enabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+    void set_sample_rate(uint32_t rate);
+    void set_decay_interval(std::chrono::seconds interval);
+    void set_top_k(size_t k);
+
+    uint32_t sample_rate() const { return sample_rate_.load(std::memory_order_relaxed); }
+    uint64_t sampled_accesses() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    std::atomic<bool> enabled_{true};
+    std::atomic<uint32_t> sample_rate_;
+
+    mutable std::mutex mutex_;
+    size_t width_;
+    size_t depth_;
+    size_t top_k_;
+    std::vector<uint32_t> sketch_;  // depth_ rows of width_ counters
+    // Min-heap on count so the weakest candidate is evicted first
+    std::vector<std::pair<uint64_t, std::string>> heap_;
+    uint64_t sampled_ = 0;
+    std::chrono::seconds decay_interval_;
+    Clock::time_point next_decay_;
+
+    // True for the one access in sample_rate_ that reaches the sketch
+    bool sample();
+    void add(std::string_view key, size_t hash);
+    uint64_t increment_locked(size_t hash);
+    uint64_t estimate_locked(size_t hash) const;
+    void offer_locked(std::string_view key, uint64_t count);
+    void decay_locked();
+};
+
+}  // namespace cacheforge
+
+#endif  // CACHEFORGE_HOTKEYS_H
@@ -0,0 +1,46 @@
+#include "storage/tiering.h"
+
+namespace cacheforge {
+
+TieredStorage::TieredStorage(HashTable& table, const TieringOptions& options)
+    : table_(table),
+      options_(options),
+      log_(options.dir, options.segment_bytes) {
+    table_.set_value_log(&log_, options_.promote_after);
+}
+
+// The table already moved a written key to the front of its LRU
+void TieredStorage::on_write(const std::string& /*key*/) {
+    enforce_budget();
+}
+
+// A read that promoted a value may leave the table over budget until the
+// next enforce_budget(); readers never demote
+void TieredStorage::on_read(const HashedKey& hk) {
+    table_.touch(hk);
+}
+
+size_t TieredStorage::enforce_budget() {
+    if (table_.holding_shards()) return 0;
+    size_t demoted = 0;
+    while (table_.resident_bytes() > options_.memory_budget && table_.demote_lru()) {
+        ++demoted;
+    }
+    demotions_.fetch_add(demoted, std::memory_order_relaxed);
+    return demoted;
+}
+
+size_t TieredStorage::compact(size_t max_segments) {
+    if (table_.holding_shards()) return 0;
+    size_t dropped = 0;
+    for (uint32_t segment : log_.compaction_candidates(options_.compact_dead_ratio)) {
+        if (dropped == max_segments) break;
+        table_.relocate_cold(segment);
+        log_.drop_segment(segment);
+        ++dropped;
+    }
+    compactions_.fetch_add(dropped, std::memory_order_relaxed);
+    return dropped;
+}
+
+}  // namespace cacheforge
@@ -0,0 +1,66 @@
+#pragma once
+#ifndef CACHEFORGE_TIERING_H
+#define CACHEFORGE_TIERING_H
+
+#include <string>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include "storage/hashtable.h"
+#include "storage/value_log.h"
+
+namespace cacheforge {
+
+struct TieringOptions {
+    std::string dir;                            // where the value log lives
+    size_t memory_budget = 256 * 1024 * 1024;   // bytes of resident keys + values
+    size_t segment_bytes = 64 * 1024 * 1024;
+    uint32_t promote_after = 2;                 // cold reads before a value moves back
+    double compact_dead_ratio = 0.5;            // rewrite segments at least this dead
+};
+
+// Two-tier storage for a HashTable: the table keeps its resident values in
+// LRU order with their sizes, and whenever they add up to more than the
+// memory budget the least recently used ones are demoted to the value log
+// instead of being evicted. The key and a Location stay in the
+// table, so nothing is lost and a later read faults the value back in.
+// CommandHandler reports every key a command touched. Writes enforce the
+// budget as they go; reads only record the access, so values they promote
+// are demoted by enforce_budget(), which like compact() is meant to run
+// periodically off the command path. Demoted values live only in
+// the log, so the table must not be read once this object is gone.
+class TieredStorage {
+public:
+    TieredStorage(HashTable& table, const TieringOptions& options);
+    TieredStorage(const TieredStorage&) = delete;
+    TieredStorage& operator=(const TieredStorage&) = delete;
+
+    void on_write(const std::string& key);
+    void on_read(const std::string& key) { on_read(HashedKey(key)); }
+    void on_read(const HashedKey& hk);
+
+    // Demotes LRU values until the resident bytes fit the budget; returns
+    // how many were demoted. Skipped inside a transaction, whose shard
+    // locks must not be mixed with others
+    size_t enforce_budget();
+    // Rewrites up to `max_segments` mostly-dead log segments and drops
+    // them; returns how many were dropped
+    size_t compact(size_t max_segments = 1);
+
+    size_t resident_bytes() const { return table_.resident_bytes(); }
+    size_t memory_budget() const { return options_.memory_budget; }
+    uint64_t demotions() const { return demotions_.load(std::memory_order_relaxed); }
+    uint64_t compactions() const { return compactions_.load(std::memory_order_relaxed); }
+    const ValueLog& log() const { return log_; }
+
+private:
+    HashTable& table_;
+    TieringOptions options_;
+    ValueLog log_;
+    std::atomic<uint64_t> demotions_{0};
+    std::atomic<uint64_t> compactions_{0};
+};
+
+}  // namespace cacheforge
+
+#endif  // CACHEFORGE_TIERING_H
@@ -0,0 +1,148 @@
+#include "storage/value_log.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace cacheforge {
+
+namespace fs = std::filesystem;
+
+namespace {
+constexpr const char* kSegmentPrefix = "values.";
+constexpr const char* kSegmentSuffix = ".log";
+}  // namespace
+
+ValueLog::ValueLog(const std::string& dir, size_t segment_bytes)
+    : dir_(dir), segment_bytes_(std::max<size_t>(segment_bytes, 4096)) {
+    std::error_code ec;
+    fs::create_directories(dir_, ec);
+    if (ec) throw std::runtime_error("value log: cannot create " + dir_ + ": " + ec.message());
+    for (const auto& entry : fs::directory_iterator(dir_)) {
+        auto name = entry.path().filename().string();
+        if (name.rfind(kSegmentPrefix, 0) == 0 && entry.path().extension() == kSegmentSuffix) {
+            fs::remove(entry.path(), ec);
+        }
+    }
+}
+
+ValueLog::~ValueLog() {
+    for (auto& seg : segments_) {
+        if (seg) close_segment(*seg);
+    }
+}
+
+ValueLog::Segment* ValueLog::open_segment(size_t capacity) {
+    auto seg = std::make_unique<Segment>();
+    seg->capacity = capacity;
+    seg->path = dir_ + "/" + kSegmentPrefix + std::to_string(segments_.size()) + kSegmentSuffix;
+    seg->fd = ::open(seg->path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (seg->fd < 0) {
+        throw std::runtime_error("value log: cannot open " + seg->path + ": " + std::strerror(errno));
+    }
+    // Reserve the blocks up front so a full disk fails here, not with a
+    // SIGBUS on the first store into the mapping
+    if (::posix_fallocate(seg->fd, 0, static_cast<off_t>(capacity)) != 0) {
+        ::close(seg->fd);
+        ::unlink(seg->path.c_str());
+        throw std::runtime_error("value log: cannot allocate " + seg->path);
+    }
+    void* mem = ::mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, seg->fd, 0);
+    if (mem == MAP_FAILED) {
+        ::close(seg->fd);
+        ::unlink(seg->path.c_str());
+        throw std::runtime_error("value log: cannot map " + seg->path + ": " + std::strerror(errno));
+    }
+    seg->data = static_cast<char*>(mem);
+    file_bytes_.fetch_add(capacity, std::memory_order_relaxed);
+    segments_.push_back(std::move(seg));
+    return segments_.back().get();
+}
+
+void ValueLog::seal(Segment& seg) {
+    seg.sealed = true;
+    // Start write-back now and drop the pages from our resident set; a
+    // later read faults them back in from the page cache or the disk
+    ::msync(seg.data, seg.used, MS_ASYNC);
+    ::madvise(seg.data, seg.capacity, MADV_DONTNEED);
+}
+
+void ValueLog::close_segment(Segment& seg) {
+    if (seg.data) ::munmap(seg.data, seg.capacity);
+    if (seg.fd >= 0) ::close(seg.fd);
+    ::unlink(seg.path.c_str());
+    seg.data = nullptr;
+    seg.fd = -1;
+}
+
+ValueLog::Location ValueLog::append(uint8_t type, const std::string& bytes) {
+    std::unique_lock lock(mutex_);
+    if (!active_ || active_->capacity - active_->used < bytes.size()) {
+        if (active_) seal(*active_);
+        // A value larger than a segment gets a segment of its own
+        active_ = open_segment(std::max(segment_bytes_, bytes.size()));
+    }
+    Location loc;
+    loc.segment = static_cast<uint32_t>(segments_.size() - 1);
+    loc.offset = static_cast<uint32_t>(active_->used);
+    loc.length = static_cast<uint32_t>(bytes.size());
+    loc.type = type;
+    std::memcpy(active_->data + active_->used, bytes.data(), bytes.size());
+    active_->used += bytes.size();
+    live_bytes_.fetch_add(bytes.size(), std::memory_order_relaxed);
+    return loc;
+}
+
+std::string ValueLog::read(const Location& loc) const {
+    std::shared_lock lock(mutex_);
+    if (loc.segment >= segments_.size() || !segments_[loc.segment]) {
+        throw std::runtime_error("value log: read from a dropped segment");
+    }
+    const auto& seg = *segments_[loc.segment];
+    return std::string(seg.data + loc.offset, loc.length);
+}
+
+void ValueLog::release(const Location& loc) {
+    std::unique_lock lock(mutex_);
+    if (loc.segment >= segments_.size() || !segments_[loc.segment]) return;
+    segments_[loc.segment]->dead += loc.length;
+    live_bytes_.fetch_sub(loc.length, std::memory_order_relaxed);
+}
+
+std::vector<uint32_t> ValueLog::compaction_candidates(double min_dead_ratio) const {
+    std::shared_lock lock(mutex_);
+    std::vector<std::pair<double, uint32_t>> ranked;
+    for (size_t i = 0; i < segments_.size(); ++i) {
+        const auto& seg = segments_[i];
+        if (!seg || !seg->sealed || seg->used == 0) continue;
+        double ratio = static_cast<double>(seg->dead) / static_cast<double>(seg->used);
+        if (ratio >= min_dead_ratio) ranked.emplace_back(ratio, static_cast<uint32_t>(i));
+    }
+    std::sort(ranked.begin(), ranked.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+    std::vector<uint32_t> result;
+    for (const auto& [ratio, id] : ranked) result.push_back(id);
+    return result;
+}
+
+void ValueLog::drop_segment(uint32_t segment) {
+    std::unique_lock lock(mutex_);
+    if (segment >= segments_.size() || !segments_[segment]) return;
+    auto& seg = *segments_[segment];
+    if (&seg == active_) active_ = nullptr;
+    live_bytes_.fetch_sub(seg.used - std::min(seg.dead, seg.used), std::memory_order_relaxed);
+    file_bytes_.fetch_sub(seg.capacity, std::memory_order_relaxed);
+    close_segment(seg);
+    segments_[segment].reset();
+}
+
+size_t ValueLog::segment_count() const {
+    std::shared_lock lock(mutex_);
+    return static_cast<size_t>(std::count_if(segments_.begin(), segments_.end(),
+                                             [](const auto& seg) { return seg != nullptr; }));
+}
+
+}  // namespace cacheforge
@@ -0,0 +1,83 @@
+#pragma once
+#ifndef CACHEFORGE_VALUE_LOG_H
+#define CACHEFORGE_VALUE_LOG_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <shared_mutex>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+namespace cacheforge {
+
+// Append-only log of encoded values in memory-mapped segment files, the
+// cold tier of tiered storage. The table keeps a Location per demoted
+// value and reads it back straight from the mapping, so a cold read is a
+// page fault rather than a syscall. Records are never modified: releasing
+// one only counts its bytes as dead, and compaction copies the live
+// records out of a mostly-dead segment before the segment is dropped.
+// The log is a cache extension, not a durable store; segment files left
+// from an earlier run are deleted on startup.
+class ValueLog {
+public:
+    struct Location {
+        static constexpr uint32_t kNone = UINT32_MAX;
+        uint32_t segment = kNone;
+        uint32_t offset = 0;
+        uint32_t length = 0;
+        uint8_t type = 0;  // Value::Type of the encoded bytes
+        bool valid() const { return segment != kNone; }
+    };
+
+    // Throws std::runtime_error if the directory cannot be used
+    explicit ValueLog(const std::string& dir, size_t segment_bytes = 64 * 1024 * 1024);
+    ~ValueLog();
+    ValueLog(const ValueLog&) = delete;
+    ValueLog& operator=(const ValueLog&) = delete;
+
+    // Throws std::runtime_error when the disk is full
+    Location append(uint8_t type, const std::string& bytes);
+    std::string read(const Location& loc) const;
+    void release(const Location& loc);
+
+    // Sealed segments with at least `min_dead_ratio` of their bytes dead,
+    // most garbage first
+    std::vector<uint32_t> compaction_candidates(double min_dead_ratio) const;
+    // Unmaps and deletes a segment; call once nothing refers to it
+    void drop_segment(uint32_t segment);
+
+    size_t file_bytes() const { return file_bytes_.load(std::memory_order_relaxed); }
+    size_t live_bytes() const { return live_bytes_.load(std::memory_order_relaxed); }
+    size_t segment_count() const;
+
+private:
+    struct Segment {
+        int fd = -1;
+        char* data = nullptr;
+        size_t capacity = 0;
+        size_t used = 0;
+        size_t dead = 0;
+        bool sealed = false;
+        std::string path;
+    };
+
+    std::string dir_;
+    size_t segment_bytes_;
+    mutable std::shared_mutex mutex_;
+    // Indexed by segment id; dropped segments leave a null slot so ids and
+    // existing Locations stay valid
+    std::vector<std::unique_ptr<Segment>> segments_;
+    Segment* active_ = nullptr;
+    std::atomic<size_t> file_bytes_{0};
+    std::atomic<size_t> live_bytes_{0};
+
+    Segment* open_segment(size_t capacity);
+    void seal(Segment& seg);
+    void close_segment(Segment& seg);
+};
+
+}  // namespace cacheforge
+
+#endif  // CACHEFORGE_VALUE_LOG_H
@@ -0,0 +1,31 @@
+// cacheforge-benchmark: load generator for a running CacheForge server
+
+#include "tools/load_generator.h"
+#include <cstring>
+#include <iostream>
+
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--help") == 0) {
+            std::cout << cacheforge::LoadOptions::usage();
+            return 0;
+        }
+    }
+
+    cacheforge::LoadOptions options;
+    try {
+        options = cacheforge::LoadOptions::parse(argc, argv);
+    } catch (const std::invalid_argument& e) {
+        std::cerr << e.what() << "\n\n" << cacheforge::LoadOptions::usage();
+        return 2;
+    }
+
+    try {
+        auto report = cacheforge::run_load(options);
+        std::cout << report.format(options.json);
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "cacheforge-benchmark: " << e.what() << "\n";
+        return 1;
+    }
+}
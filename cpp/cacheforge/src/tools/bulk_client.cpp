@@ -0,0 +1,318 @@
+#include "tools/bulk_client.h"
+#include "protocol/parser.h"
+#include "server/connection.h"
+#include <boost/asio.hpp>
+#include <array>
+#include <charconv>
+#include <istream>
+#include <optional>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+
+namespace cacheforge {
+
+namespace {
+
+using SteadyClock = std::chrono::steady_clock;
+
+uint64_t parse_number(const std::string& flag, const std::string& text) {
+    size_t pos = 0;
+    uint64_t v = 0;
+    try {
+        v = std::stoull(text, &pos);
+    } catch (const std::exception&) {
+        pos = 0;
+    }
+    if (pos == 0 || pos != text.size()) {
+        throw std::invalid_argument("invalid value for " + flag + ": '" + text + "'");
+    }
+    return v;
+}
+
+// One blocking connection; replies are read whole
+class BulkConnection {
+public:
+    BulkConnection(const std::string& host, uint16_t port) : socket_(io_) {
+        boost::asio::ip::tcp::resolver resolver(io_);
+        boost::asio::connect(socket_, resolver.resolve(host, std::to_string(port)));
+        socket_.set_option(boost::asio::ip::tcp::no_delay(true));
+    }
+
+    void send(const std::string& line, std::string_view payload = {}) {
+        std::array<boost::asio::const_buffer, 2> buffers = {
+            boost::asio::buffer(line), boost::asio::buffer(payload.data(), payload.size())};
+        boost::asio::write(socket_, buffers);
+    }
+
+    std::string read_reply() {
+        for (;;) {
+            size_t n = Parser::reply_length(buffer_.data() + consumed_, buffer_.size() - consumed_);
+            if (n > 0) {
+                std::string reply = buffer_.substr(consumed_, n);
+                consumed_ += n;
+                if (consumed_ == buffer_.size()) {
+                    buffer_.clear();
+                    consumed_ = 0;
+                }
+                return reply;
+            }
+            char chunk[65536];
+            size_t got = socket_.read_some(boost::asio::buffer(chunk));
+            buffer_.append(chunk, got);
+        }
+    }
+
+private:
+    boost::asio::io_context io_;
+    boost::asio::ip::tcp::socket socket_;
+    std::string buffer_;
+    size_t consumed_ = 0;
+};
+
+// Readers for the few reply shapes the tool expects; `pos` advances past
+// what was read
+std::string_view reply_line(std::string_view reply, size_t& pos, char type) {
+    auto end = reply.find("\r\n", pos);
+    if (pos >= reply.size() || reply[pos] != type || end == std::string_view::npos) {
+        throw std::runtime_error("unexpected reply from server");
+    }
+    auto line = reply.substr(pos + 1, end - pos - 1);
+    pos = end + 2;
+    return line;
+}
+
+int64_t reply_integer(std::string_view reply, size_t& pos, char type = ':') {
+    auto line = reply_line(reply, pos, type);
+    int64_t v = 0;
+    auto [ptr, ec] = std::from_chars(line.data(), line.data() + line.size(), v);
+    if (ec != std::errc() || ptr != line.data() + line.size()) {
+        throw std::runtime_error("unexpected reply from server");
+    }
+    return v;
+}
+
+std::optional<std::string_view> reply_bulk(std::string_view reply, size_t& pos) {
+    int64_t length = reply_integer(reply, pos, '$');
+    if (length < 0) return std::nullopt;
+    auto value = reply.substr(pos, static_cast<size_t>(length));
+    pos += static_cast<size_t>(length) + 2;
+    return value;
+}
+
+void check_error(const std::string& reply) {
+    if (!reply.empty() && reply[0] == '-') {
+        throw std::runtime_error("server replied " + reply.substr(1, reply.size() - 3));
+    }
+}
+
+}  // namespace
+
+// ---------------------------------------------------------------------------
+// BulkOptions
+// ---------------------------------------------------------------------------
+
+std::string BulkOptions::usage() {
+    return
+        "Usage: cacheforge-import [options]\n"
+        "  -h, --host HOST          server address (default 127.0.0.1)\n"
+        "  -p, --port PORT          server port (default 6380)\n"
+        "  -f, --file PATH          input, or output with --export; - is stdin/stdout\n"
+        "                           (default -)\n"
+        "      --export             write the server's dataset as binary frames\n"
+        "                           instead of importing\n"
+        "      --text               input is text commands, one per line, instead of\n"
+        "                           binary frames\n"
+        "  -b, --chunk-bytes N      bytes of frames per BULKLOAD request (default 1048576)\n"
+        "  -w, --window N           BULKLOAD requests in flight (default 4)\n"
+        "  -q, --quiet              no progress on stderr\n";
+}
+
+BulkOptions BulkOptions::parse(int argc, char** argv) {
+    BulkOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string flag = argv[i];
+        if (flag == "--export") {
+            options.export_mode = true;
+            continue;
+        }
+        if (flag == "--text") {
+            options.text = true;
+            continue;
+        }
+        if (flag == "-q" || flag == "--quiet") {
+            options.quiet = true;
+            continue;
+        }
+        if (i + 1 >= argc) throw std::invalid_argument("missing value for " + flag);
+        std::string value = argv[++i];
+
+        if (flag == "-h" || flag == "--host") {
+            options.host = value;
+        } else if (flag == "-p" || flag == "--port") {
+            uint64_t port = parse_number(flag, value);
+            if (port == 0 || port > 65535) throw std::invalid_argument("port out of range");
+            options.port = static_cast<uint16_t>(port);
+        } else if (flag == "-f" || flag == "--file") {
+            options.file = value;
+        } else if (flag == "-b" || flag == "--chunk-bytes") {
+            options.chunk_bytes = parse_number(flag, value);
+        } else if (flag == "-w" || flag == "--window") {
+            options.window = parse_number(flag, value);
+        } else {
+            throw std::invalid_argument("unknown option " + flag);
+        }
+    }
+
+    if (options.chunk_bytes == 0 || options.chunk_bytes > Connection::kMaxBulkBytes) {
+        throw std::invalid_argument("--chunk-bytes must be between 1 and " +
+                                    std::to_string(Connection::kMaxBulkBytes));
+    }
+    if (options.window == 0) throw std::invalid_argument("--window must be positive");
+    if (options.export_mode && options.text) {
+        throw std::invalid_argument("--text applies to import only");
+    }
+    return options;
+}
+
+// ---------------------------------------------------------------------------
+// Running and reporting
+// ---------------------------------------------------------------------------
+
+double BulkReport::keys_per_sec() const {
+    double secs = std::chrono::duration<double>(elapsed).count();
+    return secs > 0 ? static_cast<double>(commands) / secs : 0.0;
+}
+
+std::string BulkReport::format() const {
+    std::ostringstream out;
+    out.setf(std::ios::fixed);
+    out.precision(2);
+    out << "keys: " << commands << " (" << failed << " failed), " << bytes << " bytes in "
+        << std::chrono::duration<double>(elapsed).count() << "s\n"
+        << "throughput: " << keys_per_sec() << " keys/sec\n";
+    if (!first_error.empty()) out << "first error: " << first_error << "\n";
+    return out.str();
+}
+
+BulkReport run_import(const BulkOptions& options, std::istream& in, const BulkProgress& progress) {
+    BulkConnection conn(options.host, options.port);
+    BulkReport report;
+    auto started = SteadyClock::now();
+
+    // Chunks are cut at frame boundaries; a frame bigger than chunk_bytes
+    // travels alone. Up to `window` chunks are in flight before a reply is
+    // awaited, so the server always has the next chunk buffered
+    size_t in_flight = 0;
+    auto await_reply = [&]() {
+        auto reply = conn.read_reply();
+        check_error(reply);
+        size_t pos = 0;
+        reply_integer(reply, pos, '*');
+        reply_integer(reply, pos);  // applied
+        report.failed += static_cast<uint64_t>(reply_integer(reply, pos));
+        auto error = reply_bulk(reply, pos);
+        if (error && report.first_error.empty()) report.first_error = std::string(*error);
+        --in_flight;
+        report.elapsed = SteadyClock::now() - started;
+        if (progress) progress(report);
+    };
+    auto send_chunk = [&](std::string_view chunk, uint64_t frames) {
+        if (chunk.empty()) return;
+        if (in_flight == options.window) await_reply();
+        conn.send("BULKLOAD " + std::to_string(chunk.size()) + "\r\n", chunk);
+        ++in_flight;
+        report.commands += frames;
+        report.bytes += chunk.size();
+    };
+
+    std::string buffer;
+    uint64_t frames = 0;
+    if (options.text) {
+        Parser parser;
+        std::string line;
+        while (std::getline(in, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            auto cmd = parser.parse_text(line);
+            if (!cmd) continue;
+            buffer += Parser::serialize_raw(*cmd);
+            ++frames;
+            if (buffer.size() >= options.chunk_bytes) {
+                send_chunk(buffer, frames);
+                buffer.clear();
+                frames = 0;
+            }
+        }
+        send_chunk(buffer, frames);
+    } else {
+        // `buffer` holds [0, scanned) of whole frames plus a partial tail
+        std::vector<char> block(options.chunk_bytes);
+        size_t scanned = 0;
+        for (;;) {
+            in.read(block.data(), static_cast<std::streamsize>(block.size()));
+            size_t got = static_cast<size_t>(in.gcount());
+            if (got == 0) break;
+            buffer.append(block.data(), got);
+            for (;;) {
+                size_t n = Parser::raw_frame_length(
+                    reinterpret_cast<const uint8_t*>(buffer.data()) + scanned, buffer.size() - scanned,
+                    Connection::kMaxBulkBytes);
+                if (n == 0) break;
+                if (scanned > 0 && scanned + n > options.chunk_bytes) {
+                    send_chunk(std::string_view(buffer).substr(0, scanned), frames);
+                    buffer.erase(0, scanned);
+                    scanned = 0;
+                    frames = 0;
+                }
+                scanned += n;
+                ++frames;
+            }
+        }
+        if (scanned != buffer.size()) {
+            throw std::runtime_error("input ends inside a frame at byte " +
+                                     std::to_string(report.bytes + scanned));
+        }
+        send_chunk(buffer, frames);
+    }
+    while (in_flight > 0) await_reply();
+    report.elapsed = SteadyClock::now() - started;
+    return report;
+}
+
+BulkReport run_export(const BulkOptions& options, std::ostream& out, const BulkProgress& progress) {
+    BulkConnection conn(options.host, options.port);
+    BulkReport report;
+    auto started = SteadyClock::now();
+
+    int64_t cursor = 0;
+    do {
+        conn.send("BULKDUMP " + std::to_string(cursor) + "\r\n");
+        auto reply = conn.read_reply();
+        check_error(reply);
+        size_t pos = 0;
+        reply_integer(reply, pos, '*');
+        auto next = reply_bulk(reply, pos);
+        auto frames = reply_bulk(reply, pos);
+        if (!next || !frames) throw std::runtime_error("unexpected reply from server");
+        cursor = std::stoll(std::string(*next));
+
+        const auto* data = reinterpret_cast<const uint8_t*>(frames->data());
+        for (size_t offset = 0; offset < frames->size();) {
+            size_t n = Parser::raw_frame_length(data + offset, frames->size() - offset);
+            if (n == 0) throw std::runtime_error("truncated frame in BULKDUMP reply");
+            offset += n;
+            ++report.commands;
+        }
+        out.write(frames->data(), static_cast<std::streamsize>(frames->size()));
+        if (!out) throw std::runtime_error("write failed");
+        report.bytes += frames->size();
+        report.elapsed = SteadyClock::now() - started;
+        if (progress) progress(report);
+    } while (cursor != 0);
+    out.flush();
+    report.elapsed = SteadyClock::now() - started;
+    return report;
+}
+
+}  // namespace cacheforge
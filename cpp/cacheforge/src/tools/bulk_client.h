@@ -0,0 +1,58 @@
+#pragma once
+#ifndef CACHEFORGE_BULK_CLIENT_H
+#define CACHEFORGE_BULK_CLIENT_H
+
+#include <string>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+
+namespace cacheforge {
+
+// Settings for cacheforge-import, see usage() for the command line
+struct BulkOptions {
+    std::string host = "127.0.0.1";
+    uint16_t port = 6380;
+    std::string file = "-";           // "-" = stdin for import, stdout for export
+    bool export_mode = false;
+    bool text = false;                // import text commands, one per line
+    size_t chunk_bytes = 1024 * 1024; // BULKLOAD payload size
+    size_t window = 4;                // BULKLOAD requests in flight
+    bool quiet = false;
+
+    // Throws std::invalid_argument on unknown flags or bad values
+    static BulkOptions parse(int argc, char** argv);
+    static std::string usage();
+};
+
+struct BulkReport {
+    uint64_t commands = 0;  // frames sent (import) or keys written (export)
+    uint64_t failed = 0;
+    uint64_t bytes = 0;
+    std::chrono::nanoseconds elapsed{0};
+    std::string first_error;
+
+    double keys_per_sec() const;
+    std::string format() const;
+};
+
+// Called after every acknowledged chunk (import) or shard (export)
+using BulkProgress = std::function<void(const BulkReport&)>;
+
+// Streams commands from `in` to the server with pipelined BULKLOAD
+// requests: binary frames (Parser::serialize_raw) unless options.text, in
+// which case each line is a text-protocol command. Throws on connection
+// failure or malformed input; commands the server rejects are counted in
+// the report instead
+BulkReport run_import(const BulkOptions& options, std::istream& in,
+                      const BulkProgress& progress = nullptr);
+
+// Writes every key on the server to `out` as RESTORE frames, paging
+// through the shards with BULKDUMP; the output is valid run_import() input
+BulkReport run_export(const BulkOptions& options, std::ostream& out,
+                      const BulkProgress& progress = nullptr);
+
+}  // namespace cacheforge
+
+#endif  // CACHEFORGE_BULK_CLIENT_H
@@ -0,0 +1,60 @@
+// cacheforge-import: bulk import into, and export out of, a running CacheForge server
+
+#include "tools/bulk_client.h"
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--help") == 0) {
+            std::cout << cacheforge::BulkOptions::usage();
+            return 0;
+        }
+    }
+
+    cacheforge::BulkOptions options;
+    try {
+        options = cacheforge::BulkOptions::parse(argc, argv);
+    } catch (const std::invalid_argument& e) {
+        std::cerr << e.what() << "\n\n" << cacheforge::BulkOptions::usage();
+        return 2;
+    }
+
+    // At most one progress line a second, overwritten in place
+    auto last = std::chrono::steady_clock::now();
+    auto progress = [&](const cacheforge::BulkReport& report) {
+        auto now = std::chrono::steady_clock::now();
+        if (options.quiet || now - last < std::chrono::seconds(1)) return;
+        last = now;
+        std::cerr << "\r" << report.commands << " keys, " << static_cast<uint64_t>(report.keys_per_sec())
+                  << " keys/sec" << std::flush;
+    };
+
+    try {
+        cacheforge::BulkReport report;
+        if (options.export_mode) {
+            std::ofstream file;
+            if (options.file != "-") {
+                file.open(options.file, std::ios::binary | std::ios::trunc);
+                if (!file) throw std::runtime_error("cannot open " + options.file);
+            }
+            report = cacheforge::run_export(options, options.file == "-" ? std::cout : file, progress);
+        } else {
+            std::ifstream file;
+            if (options.file != "-") {
+                file.open(options.file, std::ios::binary);
+                if (!file) throw std::runtime_error("cannot open " + options.file);
+            }
+            report = cacheforge::run_import(options, options.file == "-" ? std::cin : file, progress);
+        }
+        // Exports may be writing the data to stdout
+        if (!options.quiet) std::cerr << "\r";
+        std::cerr << report.format();
+        return report.failed > 0 ? 1 : 0;
+    } catch (const std::exception& e) {
+        std::cerr << "\ncacheforge-import: " << e.what() << "\n";
+        return 1;
+    }
+}
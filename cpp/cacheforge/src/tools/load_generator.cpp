@@ -0,0 +1,395 @@
+#include "tools/load_generator.h"
+#include <boost/asio.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <deque>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace cacheforge {
+
+namespace {
+
+using SteadyClock = std::chrono::steady_clock;
+
+uint64_t parse_number(const std::string& flag, const std::string& text) {
+    size_t pos = 0;
+    uint64_t v = 0;
+    try {
+        v = std::stoull(text, &pos);
+    } catch (const std::exception&) {
+        pos = 0;
+    }
+    if (pos == 0 || pos != text.size()) {
+        throw std::invalid_argument("invalid value for " + flag + ": '" + text + "'");
+    }
+    return v;
+}
+
+double parse_real(const std::string& flag, const std::string& text) {
+    size_t pos = 0;
+    double v = 0;
+    try {
+        v = std::stod(text, &pos);
+    } catch (const std::exception&) {
+        pos = 0;
+    }
+    if (pos == 0 || pos != text.size() || !std::isfinite(v) || v < 0) {
+        throw std::invalid_argument("invalid value for " + flag + ": '" + text + "'");
+    }
+    return v;
+}
+
+// "GET=80,SET=20"
+std::vector<std::pair<std::string, uint32_t>> parse_mix(const std::string& text) {
+    static const std::vector<std::string> kSupported = {"GET", "SET", "INCR", "HSET", "HGET", "ZADD"};
+    std::vector<std::pair<std::string, uint32_t>> mix;
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        auto eq = item.find('=');
+        std::string name = item.substr(0, eq);
+        std::transform(name.begin(), name.end(), name.begin(), ::toupper);
+        if (std::find(kSupported.begin(), kSupported.end(), name) == kSupported.end()) {
+            throw std::invalid_argument("unsupported command in --mix: '" + name + "'");
+        }
+        uint32_t weight = eq == std::string::npos
+            ? 1 : static_cast<uint32_t>(parse_number("--mix", item.substr(eq + 1)));
+        if (weight > 0) mix.emplace_back(name, weight);
+    }
+    if (mix.empty()) throw std::invalid_argument("--mix selects no commands");
+    return mix;
+}
+
+// One blocking connection driven by one thread
+class LoadConnection {
+public:
+    LoadConnection(boost::asio::io_context& io, const boost::asio::ip::tcp::endpoint& endpoint)
+        : socket_(io) {
+        socket_.connect(endpoint);
+        socket_.set_option(boost::asio::ip::tcp::no_delay(true));
+    }
+
+    void send(const std::string& data) {
+        boost::asio::write(socket_, boost::asio::buffer(data));
+    }
+
+    // Blocks until one complete reply is buffered and returns whether it
+    // was an error reply
+    bool read_reply() {
+        for (;;) {
+            size_t n = Parser::reply_length(buffer_.data() + consumed_, buffer_.size() - consumed_);
+            if (n > 0) {
+                bool error = buffer_[consumed_] == '-';
+                consumed_ += n;
+                if (consumed_ == buffer_.size()) {
+                    buffer_.clear();
+                    consumed_ = 0;
+                }
+                return error;
+            }
+            char chunk[16384];
+            size_t got = socket_.read_some(boost::asio::buffer(chunk));
+            buffer_.append(chunk, got);
+        }
+    }
+
+private:
+    boost::asio::ip::tcp::socket socket_;
+    std::string buffer_;
+    size_t consumed_ = 0;
+};
+
+}  // namespace
+
+// ---------------------------------------------------------------------------
+// LoadOptions
+// ---------------------------------------------------------------------------
+
+std::string LoadOptions::usage() {
+    return
+        "Usage: cacheforge-benchmark [options]\n"
+        "  -h, --host HOST          server address (default 127.0.0.1)\n"
+        "  -p, --port PORT          server port (default 6380)\n"
+        "  -c, --connections N      parallel connections, one thread each (default 50)\n"
+        "  -P, --pipeline N         requests in flight per connection (default 1)\n"
+        "  -k, --keyspace N         number of distinct keys (default 100000)\n"
+        "  -d, --value-size N|A-B   value size in bytes, fixed or uniform in [A, B] (default 32)\n"
+        "  -z, --zipf THETA         Zipfian key skew in (0, 1), 0 = uniform (default 0)\n"
+        "  -t, --duration SECONDS   run time when --requests is not given (default 10)\n"
+        "  -n, --requests N         total requests to send\n"
+        "  -r, --rate OPS           target total rate; latency is measured from the\n"
+        "                           intended send time (default: unthrottled)\n"
+        "  -m, --mix CMD=W,...      command mix from GET,SET,INCR,HSET,HGET,ZADD\n"
+        "                           (default GET=90,SET=10)\n"
+        "  -s, --seed N             random seed (default 1)\n"
+        "      --json               print the report as JSON\n";
+}
+
+LoadOptions LoadOptions::parse(int argc, char** argv) {
+    LoadOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string flag = argv[i];
+        if (flag == "--json") {
+            options.json = true;
+            continue;
+        }
+        if (i + 1 >= argc) throw std::invalid_argument("missing value for " + flag);
+        std::string value = argv[++i];
+
+        if (flag == "-h" || flag == "--host") {
+            options.host = value;
+        } else if (flag == "-p" || flag == "--port") {
+            uint64_t port = parse_number(flag, value);
+            if (port == 0 || port > 65535) throw std::invalid_argument("port out of range");
+            options.port = static_cast<uint16_t>(port);
+        } else if (flag == "-c" || flag == "--connections") {
+            options.connections = parse_number(flag, value);
+        } else if (flag == "-P" || flag == "--pipeline") {
+            options.pipeline = parse_number(flag, value);
+        } else if (flag == "-k" || flag == "--keyspace") {
+            options.keyspace = parse_number(flag, value);
+        } else if (flag == "-d" || flag == "--value-size") {
+            auto dash = value.find('-');
+            options.value_min = parse_number(flag, value.substr(0, dash));
+            options.value_max = dash == std::string::npos
+                ? options.value_min : parse_number(flag, value.substr(dash + 1));
+        } else if (flag == "-z" || flag == "--zipf") {
+            options.zipf = parse_real(flag, value);
+        } else if (flag == "-t" || flag == "--duration") {
+            options.duration = std::chrono::seconds(parse_number(flag, value));
+        } else if (flag == "-n" || flag == "--requests") {
+            options.requests = parse_number(flag, value);
+        } else if (flag == "-r" || flag == "--rate") {
+            options.rate = parse_real(flag, value);
+        } else if (flag == "-m" || flag == "--mix") {
+            options.mix = parse_mix(value);
+        } else if (flag == "-s" || flag == "--seed") {
+            options.seed = parse_number(flag, value);
+        } else {
+            throw std::invalid_argument("unknown option " + flag);
+        }
+    }
+
+    if (options.connections == 0) throw std::invalid_argument("--connections must be positive");
+    if (options.pipeline == 0) throw std::invalid_argument("--pipeline must be positive");
+    if (options.keyspace == 0) throw std::invalid_argument("--keyspace must be positive");
+    if (options.value_max < options.value_min) throw std::invalid_argument("bad --value-size range");
+    if (options.zipf >= 1.0) throw std::invalid_argument("--zipf must be below 1");
+    return options;
+}
+
+// ---------------------------------------------------------------------------
+// ZipfGenerator
+// ---------------------------------------------------------------------------
+
+ZipfGenerator::ZipfGenerator(uint64_t n, double theta) : n_(std::max<uint64_t>(1, n)), theta_(theta) {
+    if (theta_ <= 0) return;
+    for (uint64_t i = 1; i <= n_; ++i) zetan_ += 1.0 / std::pow(static_cast<double>(i), theta_);
+    double zeta2 = 1.0 + 1.0 / std::pow(2.0, theta_);
+    alpha_ = 1.0 / (1.0 - theta_);
+    eta_ = (1.0 - std::pow(2.0 / static_cast<double>(n_), 1.0 - theta_)) / (1.0 - zeta2 / zetan_);
+    half_pow_theta_ = 1.0 + std::pow(0.5, theta_);
+}
+
+uint64_t ZipfGenerator::next(std::mt19937_64& rng) {
+    if (theta_ <= 0) return std::uniform_int_distribution<uint64_t>(0, n_ - 1)(rng);
+
+    double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+    double uz = u * zetan_;
+    if (uz < 1.0) return 0;
+    if (uz < half_pow_theta_) return std::min<uint64_t>(1, n_ - 1);
+    auto v = static_cast<uint64_t>(static_cast<double>(n_) * std::pow(eta_ * u - eta_ + 1.0, alpha_));
+    return std::min(v, n_ - 1);
+}
+
+// ---------------------------------------------------------------------------
+// WorkloadGenerator
+// ---------------------------------------------------------------------------
+
+WorkloadGenerator::WorkloadGenerator(const LoadOptions& options, uint64_t seed)
+    : options_(options),
+      rng_(seed),
+      zipf_(options.keyspace, options.zipf),
+      value_pool_(options.value_max, 'x') {
+    uint32_t total = 0;
+    for (const auto& [name, weight] : options_.mix) {
+        total += weight;
+        cumulative_weights_.push_back(total);
+    }
+}
+
+Command WorkloadGenerator::next() {
+    uint32_t pick = std::uniform_int_distribution<uint32_t>(0, cumulative_weights_.back() - 1)(rng_);
+    size_t i = std::upper_bound(cumulative_weights_.begin(), cumulative_weights_.end(), pick) -
+               cumulative_weights_.begin();
+    const std::string& name = options_.mix[i].first;
+
+    if (name == "GET") return {name, {key("key:")}};
+    if (name == "SET") return {name, {key("key:"), value()}};
+    if (name == "INCR") return {name, {key("counter:")}};
+    if (name == "HSET") return {name, {key("hash:"), "field", value()}};
+    if (name == "HGET") return {name, {key("hash:"), "field"}};
+    // ZADD
+    return {name, {"zset", std::to_string(rng_() % 1000000), key("member:")}};
+}
+
+std::string WorkloadGenerator::key(const char* prefix) {
+    return prefix + std::to_string(zipf_.next(rng_));
+}
+
+std::string WorkloadGenerator::value() {
+    size_t size = std::uniform_int_distribution<size_t>(options_.value_min, options_.value_max)(rng_);
+    // Values are sent in the text protocol, so they must not be empty
+    return value_pool_.substr(0, std::max<size_t>(1, size));
+}
+
+// ---------------------------------------------------------------------------
+// Running and reporting
+// ---------------------------------------------------------------------------
+
+double LoadReport::throughput() const {
+    double secs = std::chrono::duration<double>(elapsed).count();
+    return secs > 0 ? static_cast<double>(requests) / secs : 0.0;
+}
+
+std::string LoadReport::format(bool json) const {
+    static const double kPercentiles[] = {50, 90, 99, 99.9, 99.99};
+    auto us = [](uint64_t ns) { return static_cast<double>(ns) / 1000.0; };
+    std::ostringstream out;
+    out.setf(std::ios::fixed);
+    out.precision(2);
+
+    if (json) {
+        out << "{\"requests\":" << requests << ",\"errors\":" << errors
+            << ",\"elapsed_sec\":" << std::chrono::duration<double>(elapsed).count()
+            << ",\"ops_per_sec\":" << throughput()
+            << ",\"open_loop\":" << (open_loop ? "true" : "false");
+        auto histogram = [&](const char* name, const LatencyHistogram& h) {
+            out << ",\"" << name << "\":{\"mean\":" << us(h.mean());
+            for (double p : kPercentiles) out << ",\"p" << p << "\":" << us(h.percentile(p));
+            out << ",\"max\":" << us(h.max()) << "}";
+        };
+        histogram("latency_usec", latency);
+        histogram("corrected_latency_usec", corrected);
+        out << "}\n";
+        return out.str();
+    }
+
+    out << "requests: " << requests << " (" << errors << " errors) in "
+        << std::chrono::duration<double>(elapsed).count() << "s\n"
+        << "throughput: " << throughput() << " ops/sec\n";
+    auto table = [&](const char* title, const LatencyHistogram& h) {
+        out << title << " (usec): mean " << us(h.mean());
+        for (double p : kPercentiles) out << "  p" << p << " " << us(h.percentile(p));
+        out << "  max " << us(h.max()) << "\n";
+    };
+    table("latency", latency);
+    table(open_loop ? "latency from schedule" : "latency, omission corrected", corrected);
+    return out.str();
+}
+
+LoadReport run_load(const LoadOptions& options) {
+    boost::asio::io_context io;
+    boost::asio::ip::tcp::resolver resolver(io);
+    auto endpoint = *resolver.resolve(options.host, std::to_string(options.port)).begin();
+
+    // Connect everything up front so a refused connection fails the run
+    // before any load is generated
+    std::vector<std::unique_ptr<LoadConnection>> conns;
+    for (size_t i = 0; i < options.connections; ++i) {
+        conns.push_back(std::make_unique<LoadConnection>(io, endpoint.endpoint()));
+    }
+
+    const bool paced = options.rate > 0;
+    // Per-connection spacing between intended send times
+    const auto interval = paced
+        ? std::chrono::nanoseconds(static_cast<int64_t>(1e9 * options.connections / options.rate))
+        : std::chrono::nanoseconds(0);
+
+    std::atomic<uint64_t> budget{options.requests};
+    std::atomic<bool> failed{false};
+    std::mutex merge_mutex;
+    LoadReport report;
+    report.open_loop = paced;
+    LatencyHistogram scheduled;
+
+    const auto start = SteadyClock::now();
+    const auto deadline = start + options.duration;
+
+    auto worker = [&](size_t index) {
+        WorkloadGenerator workload(options, options.seed * 1000003 + index);
+        LatencyHistogram measured, from_schedule;
+        uint64_t sent = 0, errors = 0;
+        std::deque<SteadyClock::time_point> issued, intended;
+        auto& conn = *conns[index];
+
+        try {
+            while (!failed.load(std::memory_order_relaxed)) {
+                size_t batch = options.pipeline;
+                if (options.requests) {
+                    uint64_t left = budget.load(std::memory_order_relaxed);
+                    while (left > 0 &&
+                           !budget.compare_exchange_weak(left, left - std::min<uint64_t>(batch, left))) {
+                    }
+                    if (left == 0) break;
+                    batch = static_cast<size_t>(std::min<uint64_t>(batch, left));
+                } else if (SteadyClock::now() >= deadline) {
+                    break;
+                }
+
+                // Paced runs wait for the last request of the batch to be due
+                // and charge every request from its own intended time
+                if (paced) {
+                    for (size_t i = 0; i < batch; ++i) {
+                        intended.push_back(start + interval * static_cast<int64_t>(sent + i));
+                    }
+                    std::this_thread::sleep_until(intended.back());
+                }
+
+                std::string wire;
+                for (size_t i = 0; i < batch; ++i) wire += Parser::serialize_command(workload.next());
+                auto now = SteadyClock::now();
+                conn.send(wire);
+                for (size_t i = 0; i < batch; ++i) issued.push_back(now);
+                sent += batch;
+
+                for (size_t i = 0; i < batch; ++i) {
+                    if (conn.read_reply()) errors++;
+                    auto done = SteadyClock::now();
+                    measured.record(static_cast<uint64_t>((done - issued.front()).count()));
+                    issued.pop_front();
+                    if (paced) {
+                        from_schedule.record(static_cast<uint64_t>((done - intended.front()).count()));
+                        intended.pop_front();
+                    }
+                }
+            }
+        } catch (const std::exception&) {
+            failed.store(true);
+        }
+
+        std::lock_guard lock(merge_mutex);
+        report.requests += sent;
+        report.errors += errors;
+        report.latency.merge(measured);
+        scheduled.merge(from_schedule);
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < conns.size(); ++i) threads.emplace_back(worker, i);
+    for (auto& t : threads) t.join();
+    report.elapsed = SteadyClock::now() - start;
+
+    if (failed.load()) throw std::runtime_error("connection to server failed during the run");
+
+    // Closed-loop runs never see the requests that a stalled server kept
+    // them from sending; estimate those from the mean service time
+    report.corrected = paced ? scheduled : report.latency.corrected_for_omission(report.latency.mean());
+    return report;
+}
+
+}  // namespace cacheforge
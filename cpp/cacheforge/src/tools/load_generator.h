@@ -0,0 +1,89 @@
+#pragma once
+#ifndef CACHEFORGE_LOAD_GENERATOR_H
+#define CACHEFORGE_LOAD_GENERATOR_H
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <random>
+#include <chrono>
+#include <cstdint>
+#include "protocol/parser.h"
+#include "server/stats.h"
+
+namespace cacheforge {
+
+// Settings for cacheforge-benchmark, see usage() for the command line
+struct LoadOptions {
+    std::string host = "127.0.0.1";
+    uint16_t port = 6380;
+    size_t connections = 50;
+    size_t pipeline = 1;
+    uint64_t keyspace = 100000;
+    size_t value_min = 32;
+    size_t value_max = 32;
+    double zipf = 0.0;  // 0 = uniform, otherwise the skew in (0, 1)
+    std::chrono::seconds duration{10};
+    uint64_t requests = 0;  // stop after this many requests; 0 = run for duration
+    double rate = 0.0;      // total requests/second; 0 = as fast as possible
+    std::vector<std::pair<std::string, uint32_t>> mix{{"GET", 90}, {"SET", 10}};
+    uint64_t seed = 1;
+    bool json = false;
+
+    // Throws std::invalid_argument on unknown flags or bad values
+    static LoadOptions parse(int argc, char** argv);
+    static std::string usage();
+};
+
+// Zipfian integers in [0, n) using Gray et al.'s method (as in YCSB):
+// constant time per draw after an O(n) zeta precomputation
+class ZipfGenerator {
+public:
+    ZipfGenerator(uint64_t n, double theta);
+    uint64_t next(std::mt19937_64& rng);
+
+private:
+    uint64_t n_;
+    double theta_;
+    double alpha_ = 0;
+    double zetan_ = 0;
+    double eta_ = 0;
+    double half_pow_theta_ = 0;
+};
+
+// Produces the next request according to the command mix, key distribution
+// and value sizes
+class WorkloadGenerator {
+public:
+    WorkloadGenerator(const LoadOptions& options, uint64_t seed);
+    Command next();
+
+private:
+    const LoadOptions& options_;
+    std::mt19937_64 rng_;
+    ZipfGenerator zipf_;
+    std::vector<uint32_t> cumulative_weights_;
+    std::string value_pool_;
+
+    std::string key(const char* prefix);
+    std::string value();
+};
+
+struct LoadReport {
+    uint64_t requests = 0;
+    uint64_t errors = 0;
+    std::chrono::nanoseconds elapsed{0};
+    bool open_loop = false;  // paced by --rate, latency measured from schedule
+    LatencyHistogram latency;    // service latency as measured
+    LatencyHistogram corrected;  // coordinated-omission corrected
+
+    double throughput() const;
+    std::string format(bool json) const;
+};
+
+// Runs the workload against a server; throws on connection failure
+LoadReport run_load(const LoadOptions& options);
+
+}  // namespace cacheforge
+
+#endif  // CACHEFORGE_LOAD_GENERATOR_H
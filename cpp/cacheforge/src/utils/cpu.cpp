@@ -0,0 +1,151 @@
+#include "utils/cpu.h"
+#include <pthread.h>
+#include <sched.h>
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace cacheforge {
+namespace cpu {
+
+namespace {
+
+int parse_cpu(const std::string& list, std::string_view s) {
+    int v = -1;
+    auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), v);
+    if (ec != std::errc() || ptr != s.data() + s.size() || s.empty() || v < 0 || v >= CPU_SETSIZE) {
+        throw std::runtime_error("invalid CPU list '" + list + "'");
+    }
+    return v;
+}
+
+std::optional<std::string> read_line(const std::string& path) {
+    std::ifstream in(path);
+    std::string line;
+    if (!std::getline(in, line)) return std::nullopt;
+    return line;
+}
+
+// "max 100000" or "<quota> <period>"
+std::optional<double> quota_v2(const std::string& path) {
+    auto line = read_line(path);
+    if (!line) return std::nullopt;
+    std::istringstream in(*line);
+    std::string quota;
+    double period = 0;
+    if (!(in >> quota >> period) || quota == "max" || period <= 0) return std::nullopt;
+    try {
+        return std::stod(quota) / period;
+    } catch (const std::exception&) {
+        return std::nullopt;
+    }
+}
+
+// cpu.cfs_quota_us is -1 when unlimited
+std::optional<double> quota_v1(const std::string& dir) {
+    auto quota = read_line(dir + "/cpu.cfs_quota_us");
+    auto period = read_line(dir + "/cpu.cfs_period_us");
+    if (!quota || !period) return std::nullopt;
+    try {
+        double q = std::stod(*quota);
+        double p = std::stod(*period);
+        if (q <= 0 || p <= 0) return std::nullopt;
+        return q / p;
+    } catch (const std::exception&) {
+        return std::nullopt;
+    }
+}
+
+}  // namespace
+
+std::vector<int> parse_list(const std::string& list) {
+    std::vector<int> cpus;
+    std::string_view rest(list);
+    while (!rest.empty()) {
+        auto comma = rest.find(',');
+        std::string_view item = rest.substr(0, comma);
+        rest = comma == std::string_view::npos ? std::string_view() : rest.substr(comma + 1);
+        auto dash = item.find('-');
+        int first = parse_cpu(list, item.substr(0, dash));
+        int last = dash == std::string_view::npos ? first : parse_cpu(list, item.substr(dash + 1));
+        if (last < first) throw std::runtime_error("invalid CPU list '" + list + "'");
+        for (int c = first; c <= last; ++c) cpus.push_back(c);
+    }
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return cpus;
+}
+
+std::vector<int> allowed() {
+    std::vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) return cpus;
+    for (int c = 0; c < CPU_SETSIZE; ++c) {
+        if (CPU_ISSET(c, &set)) cpus.push_back(c);
+    }
+    return cpus;
+}
+
+std::optional<double> cgroup_quota(const std::string& cgroup_root, const std::string& proc_cgroup) {
+    // Lines of /proc/self/cgroup: "0::/path" for v2, "N:cpu,cpuacct:/path"
+    // for v1. Inside a container the path is usually "/" and the files sit
+    // at the mount root, so that is tried as well
+    std::ifstream in(proc_cgroup);
+    std::string line;
+    std::optional<std::string> v2_path;
+    std::optional<std::pair<std::string, std::string>> v1;  // controller dir, path
+    while (std::getline(in, line)) {
+        auto first = line.find(':');
+        auto second = line.find(':', first + 1);
+        if (first == std::string::npos || second == std::string::npos) continue;
+        std::string controllers = line.substr(first + 1, second - first - 1);
+        std::string path = line.substr(second + 1);
+        if (line.compare(0, first, "0") == 0 && controllers.empty()) {
+            v2_path = path;
+        } else {
+            std::istringstream names(controllers);
+            std::string name;
+            while (std::getline(names, name, ',')) {
+                if (name == "cpu") v1.emplace(controllers, path);
+            }
+        }
+    }
+
+    if (v2_path) {
+        if (auto q = quota_v2(cgroup_root + *v2_path + "/cpu.max")) return q;
+    }
+    if (auto q = quota_v2(cgroup_root + "/cpu.max")) return q;
+    if (v1) {
+        for (const auto& dir : {cgroup_root + "/" + v1->first, cgroup_root + "/cpu"}) {
+            if (auto q = quota_v1(dir + v1->second)) return q;
+            if (auto q = quota_v1(dir)) return q;
+        }
+    }
+    return std::nullopt;
+}
+
+size_t default_threads() {
+    size_t count = allowed().size();
+    if (count == 0) count = std::thread::hardware_concurrency();
+    if (auto quota = cgroup_quota()) {
+        count = std::min(count, static_cast<size_t>(std::ceil(*quota)));
+    }
+    return std::max<size_t>(1, count);
+}
+
+bool pin_thread(const std::vector<int>& cpus) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int c : cpus) {
+        if (c >= 0 && c < CPU_SETSIZE) CPU_SET(c, &set);
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+}  // namespace cpu
+}  // namespace cacheforge
@@ -0,0 +1,43 @@
+#pragma once
+#ifndef CACHEFORGE_CPU_H
+#define CACHEFORGE_CPU_H
+
+#include <string>
+#include <vector>
+#include <optional>
+#include <cstddef>
+
+namespace cacheforge {
+
+// How many CPUs the process may actually use, and pinning threads to them.
+// In a container, hardware_concurrency() reports the host's cores even
+// when the cgroup grants only a fraction of one, so thread counts sized
+// from it oversubscribe the quota and get throttled.
+namespace cpu {
+
+// Parses a cpuset-style list such as "0-3,8,10-11". An empty string gives
+// an empty list; malformed input throws std::runtime_error
+std::vector<int> parse_list(const std::string& list);
+
+// CPUs the calling thread may run on, from its affinity mask
+std::vector<int> allowed();
+
+// CPUs' worth of time the cgroup quota grants (cgroup v2 cpu.max, else v1
+// cfs_quota_us / cfs_period_us), or nullopt when there is no quota. The
+// paths are parameters so tests can point them at a fake hierarchy
+std::optional<double> cgroup_quota(const std::string& cgroup_root = "/sys/fs/cgroup",
+                                   const std::string& proc_cgroup = "/proc/self/cgroup");
+
+// Threads worth running: the allowed CPUs, capped by the quota rounded
+// up, and at least one
+size_t default_threads();
+
+// Restricts the calling thread to `cpus`; false if that fails (e.g. none
+// of them is available to the process)
+bool pin_thread(const std::vector<int>& cpus);
+
+}  // namespace cpu
+
+}  // namespace cacheforge
+
+#endif  // CACHEFORGE_CPU_H
@@ -0,0 +1,19 @@
+#include "utils/hash.h"
+#include <random>
+
+namespace cacheforge::hashing {
+
+namespace {
+uint64_t random_seed() {
+    std::random_device rd;
+    return (static_cast<uint64_t>(rd()) << 32) ^ rd();
+}
+}  // namespace
+
+std::atomic<uint64_t> detail::g_seed{random_seed()};
+
+void set_seed(uint64_t seed) {
+    detail::g_seed.store(seed, std::memory_order_relaxed);
+}
+
+}  // namespace cacheforge::hashing
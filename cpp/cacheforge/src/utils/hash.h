@@ -0,0 +1,127 @@
+#pragma once
+#ifndef CACHEFORGE_HASH_H
+#define CACHEFORGE_HASH_H
+
+#include <string>
+#include <string_view>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+namespace cacheforge {
+
+// Seeded 64-bit key hash in the wyhash family: a few 64x64->128-bit
+// multiplies per 16 bytes, and identical on every platform and standard
+// library, unlike std::hash. The seed is random per process, so clients
+// cannot precompute keys that all collide in one bucket.
+namespace hashing {
+
+namespace detail {
+extern std::atomic<uint64_t> g_seed;
+
+constexpr uint64_t kSecret[4] = {0xa0761d6478bd642full, 0xe7037ed1a0b428dbull,
+                                 0x8ebc6af09c88c6e3ull, 0x589965cc75374cc3ull};
+
+inline uint64_t read64(const uint8_t* p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint64_t read32(const uint8_t* p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint64_t mix(uint64_t a, uint64_t b) {
+    __uint128_t r = static_cast<__uint128_t>(a) * b;
+    return static_cast<uint64_t>(r) ^ static_cast<uint64_t>(r >> 64);
+}
+}  // namespace detail
+
+inline uint64_t hash_bytes(const void* data, size_t len, uint64_t seed) {
+    using namespace detail;
+    const auto* p = static_cast<const uint8_t*>(data);
+    seed ^= mix(seed ^ kSecret[0], kSecret[1]);
+    uint64_t a = 0;
+    uint64_t b = 0;
+    if (len <= 16) {
+        if (len >= 4) {
+            size_t step = (len >> 3) << 2;
+            a = (read32(p) << 32) | read32(p + step);
+            b = (read32(p + len - 4) << 32) | read32(p + len - 4 - step);
+        } else if (len > 0) {
+            a = (static_cast<uint64_t>(p[0]) << 16) | (static_cast<uint64_t>(p[len >> 1]) << 8) | p[len - 1];
+        }
+    } else {
+        size_t i = len;
+        if (i > 48) {
+            uint64_t see1 = seed;
+            uint64_t see2 = seed;
+            do {
+                seed = mix(read64(p) ^ kSecret[1] ^ seed, read64(p + 8) ^ seed);
+                see1 = mix(read64(p + 16) ^ kSecret[2] ^ see1, read64(p + 24) ^ see1);
+                see2 = mix(read64(p + 32) ^ kSecret[3] ^ see2, read64(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = mix(read64(p) ^ kSecret[1] ^ seed, read64(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+        a = read64(p + i - 16);
+        b = read64(p + i - 8);
+    }
+    // Seeding only one operand would let a key zero the other and with it
+    // the seed's whole contribution (wyhash's protected mode does the same)
+    a ^= kSecret[1] ^ seed;
+    b ^= kSecret[0] ^ seed;
+    __uint128_t r = static_cast<__uint128_t>(a) * b;
+    a = static_cast<uint64_t>(r);
+    b = static_cast<uint64_t>(r >> 64);
+    return mix(a ^ kSecret[0] ^ len, b ^ kSecret[1]);
+}
+
+// Process-wide seed, random unless set. Change it only before any
+// hashed container is filled: stored keys are not rehashed.
+inline uint64_t seed() { return detail::g_seed.load(std::memory_order_relaxed); }
+void set_seed(uint64_t seed);
+
+inline uint64_t hash(std::string_view key) { return hash_bytes(key.data(), key.size(), seed()); }
+
+}  // namespace hashing
+
+// A key with its hash, computed once and reused for shard routing and the
+// shard's own lookup
+struct HashedKey {
+    std::string_view key;
+    uint64_t hash;
+    explicit HashedKey(std::string_view k) : key(k), hash(hashing::hash(k)) {}
+};
+
+// Hasher and equality for key-indexed unordered containers. Transparent,
+// so a HashedKey looks up without hashing again. operator() is
+// deliberately not noexcept: libstdc++ then caches each node's hash and
+// growing the table does not rehash any key.
+struct KeyHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view key) const { return hashing::hash(key); }
+    size_t operator()(const std::string& key) const { return hashing::hash(key); }
+    size_t operator()(const HashedKey& key) const { return key.hash; }
+};
+
+struct KeyEqual {
+    using is_transparent = void;
+    bool operator()(std::string_view a, std::string_view b) const noexcept { return a == b; }
+    bool operator()(const HashedKey& a, std::string_view b) const noexcept { return a.key == b; }
+    bool operator()(std::string_view a, const HashedKey& b) const noexcept { return a == b.key; }
+};
+
+}  // namespace cacheforge
+
+#endif  // CACHEFORGE_HASH_H
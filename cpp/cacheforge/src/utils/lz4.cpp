@@ -0,0 +1,143 @@
+#include "utils/lz4.h"
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace cacheforge::lz4 {
+
+namespace {
+
+constexpr size_t kMinMatch = 4;
+constexpr size_t kLastLiterals = 5;   // the block must end in literals
+constexpr size_t kMatchLimit = 12;    // no match may start in the last 12 bytes
+constexpr size_t kMaxOffset = 65535;
+constexpr int kHashBits = 12;
+
+uint32_t read32(const char* p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+uint32_t hash(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - kHashBits);
+}
+
+void put_length(std::string& out, size_t length) {
+    while (length >= 255) {
+        out.push_back(static_cast<char>(255));
+        length -= 255;
+    }
+    out.push_back(static_cast<char>(length));
+}
+
+void put_sequence(std::string& out, const char* literals, size_t literal_len,
+                  size_t offset, size_t match_len) {
+    size_t ml = match_len - kMinMatch;
+    uint8_t token = static_cast<uint8_t>((literal_len < 15 ? literal_len : 15) << 4);
+    token |= static_cast<uint8_t>(ml < 15 ? ml : 15);
+    out.push_back(static_cast<char>(token));
+    if (literal_len >= 15) put_length(out, literal_len - 15);
+    out.append(literals, literal_len);
+    out.push_back(static_cast<char>(offset & 0xff));
+    out.push_back(static_cast<char>(offset >> 8));
+    if (ml >= 15) put_length(out, ml - 15);
+}
+
+void put_last_literals(std::string& out, const char* literals, size_t literal_len) {
+    out.push_back(static_cast<char>((literal_len < 15 ? literal_len : 15) << 4));
+    if (literal_len >= 15) put_length(out, literal_len - 15);
+    out.append(literals, literal_len);
+}
+
+}  // namespace
+
+std::string compress(std::string_view input) {
+    const char* in = input.data();
+    const size_t n = input.size();
+    std::string out;
+    out.reserve(n + n / 255 + 16);
+
+    size_t anchor = 0;
+    if (n > kMatchLimit) {
+        // Positions are stored +1 so that 0 means empty
+        std::vector<uint32_t> table(size_t{1} << kHashBits, 0);
+        const size_t limit = n - kMatchLimit;
+        size_t ip = 0;
+        while (ip < limit) {
+            uint32_t sequence = read32(in + ip);
+            uint32_t& slot = table[hash(sequence)];
+            size_t candidate = slot;
+            slot = static_cast<uint32_t>(ip + 1);
+            if (candidate == 0 || ip + 1 - candidate > kMaxOffset ||
+                read32(in + candidate - 1) != sequence) {
+                // Step faster through data that keeps failing to match
+                ip += 1 + ((ip - anchor) >> 6);
+                continue;
+            }
+            size_t match = candidate - 1;
+            while (ip > anchor && match > 0 && in[ip - 1] == in[match - 1]) {
+                --ip;
+                --match;
+            }
+            size_t len = kMinMatch;
+            while (ip + len < n - kLastLiterals && in[match + len] == in[ip + len]) ++len;
+
+            put_sequence(out, in + anchor, ip - anchor, ip - match, len);
+            ip += len;
+            anchor = ip;
+            if (ip < limit) table[hash(read32(in + ip - 2))] = static_cast<uint32_t>(ip - 2 + 1);
+        }
+    }
+    put_last_literals(out, in + anchor, n - anchor);
+    return out;
+}
+
+bool decompress(std::string_view block, char* out, size_t size) {
+    const auto* src = reinterpret_cast<const uint8_t*>(block.data());
+    const size_t src_size = block.size();
+    size_t s = 0;
+    size_t d = 0;
+
+    auto read_length = [&](size_t& length) {
+        uint8_t b;
+        do {
+            if (s >= src_size) return false;
+            b = src[s++];
+            length += b;
+        } while (b == 255);
+        return true;
+    };
+
+    while (s < src_size) {
+        uint8_t token = src[s++];
+        size_t literal_len = token >> 4;
+        if (literal_len == 15 && !read_length(literal_len)) return false;
+        if (literal_len > src_size - s || literal_len > size - d) return false;
+        std::memcpy(out + d, src + s, literal_len);
+        s += literal_len;
+        d += literal_len;
+        if (s == src_size) break;  // the last sequence has no match
+
+        if (src_size - s < 2) return false;
+        size_t offset = src[s] | (static_cast<size_t>(src[s + 1]) << 8);
+        s += 2;
+        if (offset == 0 || offset > d) return false;
+        size_t match_len = token & 15;
+        if (match_len == 15 && !read_length(match_len)) return false;
+        match_len += kMinMatch;
+        if (match_len > size - d) return false;
+
+        const char* from = out + d - offset;
+        if (offset >= match_len) {
+            std::memcpy(out + d, from, match_len);
+        } else {
+            // Overlapping copy repeats the last `offset` bytes
+            for (size_t i = 0; i < match_len; ++i) out[d + i] = from[i];
+        }
+        d += match_len;
+    }
+    return d == size;
+}
+
+}  // namespace cacheforge::lz4
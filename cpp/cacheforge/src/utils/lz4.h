@@ -0,0 +1,22 @@
+#pragma once
+#ifndef CACHEFORGE_LZ4_H
+#define CACHEFORGE_LZ4_H
+
+#include <string>
+#include <string_view>
+#include <cstddef>
+
+namespace cacheforge::lz4 {
+
+// LZ4 block format (no frame header): a greedy single-probe matcher like
+// LZ4's fast mode. Output is readable by any LZ4 block decoder.
+std::string compress(std::string_view input);
+
+// Decodes a block that must expand to exactly `size` bytes into `out`.
+// Returns false on malformed input instead of reading or writing out of
+// bounds, so it is safe on data loaded from disk.
+bool decompress(std::string_view block, char* out, size_t size);
+
+}  // namespace cacheforge::lz4
+
+#endif  // CACHEFORGE_LZ4_H
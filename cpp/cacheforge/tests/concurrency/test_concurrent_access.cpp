@@ -2,6 +2,7 @@
 #include "storage/hashtable.h"
 #include "storage/eviction.h"
 #include "storage/expiry.h"
+#include "server/command_handler.h"
 #include <thread>
 #include <vector>
 #include <atomic>
@@ -276,3 +277,24 @@ TEST(ConcurrencyTest, test_hashtable_stress) {
 
     for (auto& t : threads) t.join();
 }
+
+TEST(ConcurrencyTest, test_concurrent_incr_no_lost_updates) {
+    HashTable ht(1000);
+    CommandHandler handler(ht);
+    const int num_threads = 8;
+    const int ops = 500;
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&handler, ops]() {
+            for (int i = 0; i < ops; ++i) {
+                handler.execute({"INCR", {"hot_counter"}});
+            }
+        });
+    }
+
+    for (auto& t : threads) t.join();
+    auto val = ht.get("hot_counter");
+    ASSERT_TRUE(val.has_value());
+    EXPECT_EQ(val->as_integer(), num_threads * ops);
+}
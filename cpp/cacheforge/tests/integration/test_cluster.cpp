@@ -0,0 +1,373 @@
+#include <gtest/gtest.h>
+#include "server/server.h"
+#include "cluster/cluster.h"
+#include "config/config.h"
+#include "protocol/parser.h"
+#include <boost/asio.hpp>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <csignal>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+using namespace cacheforge;
+
+// Each node is a Server of its own on a loopback port, as separate
+// processes would be; they share nothing but the network. One test runs
+// the real binary as separate processes, configured from the environment.
+
+namespace {
+
+std::string node_name(uint16_t port) {
+    return "127.0.0.1:" + std::to_string(port);
+}
+
+// Slots split evenly over nodes on consecutive ports
+std::string even_topology(uint16_t first_port, size_t nodes) {
+    std::string topology;
+    size_t per_node = ClusterState::kSlots / nodes;
+    for (size_t i = 0; i < nodes; ++i) {
+        size_t first = i * per_node;
+        size_t last = i + 1 == nodes ? ClusterState::kSlots - 1 : first + per_node - 1;
+        if (!topology.empty()) topology += ' ';
+        topology += node_name(static_cast<uint16_t>(first_port + i)) + "=" +
+                    std::to_string(first) + "-" + std::to_string(last);
+    }
+    return topology;
+}
+
+std::vector<std::unique_ptr<Server>> start_cluster(uint16_t first_port, size_t nodes) {
+    std::vector<std::unique_ptr<Server>> servers;
+    for (size_t i = 0; i < nodes; ++i) {
+        Config cfg;
+        cfg.bind_address = "127.0.0.1";
+        cfg.port = static_cast<uint16_t>(first_port + i);
+        cfg.cluster_topology = even_topology(first_port, nodes);
+        servers.push_back(std::make_unique<Server>(cfg));
+        servers.back()->start();
+    }
+    return servers;
+}
+
+// Blocking connection to one node
+class NodeClient {
+public:
+    explicit NodeClient(const std::string& node) : socket_(io_) {
+        auto colon = node.rfind(':');
+        socket_.connect({boost::asio::ip::make_address(node.substr(0, colon)),
+                         static_cast<uint16_t>(std::stoi(node.substr(colon + 1)))});
+        socket_.set_option(boost::asio::ip::tcp::no_delay(true));
+    }
+
+    void send(const std::string& data) { boost::asio::write(socket_, boost::asio::buffer(data)); }
+
+    std::string read_reply() {
+        for (;;) {
+            size_t n = Parser::reply_length(buffer_.data(), buffer_.size());
+            if (n > 0) {
+                std::string reply = buffer_.substr(0, n);
+                buffer_.erase(0, n);
+                return reply;
+            }
+            char chunk[16384];
+            size_t got = socket_.read_some(boost::asio::buffer(chunk));
+            buffer_.append(chunk, got);
+        }
+    }
+
+    std::string call(const std::string& line) {
+        send(line + "\r\n");
+        return read_reply();
+    }
+
+private:
+    boost::asio::io_context io_;
+    boost::asio::ip::tcp::socket socket_;
+    std::string buffer_;
+};
+
+// Client that follows MOVED (and remembers it) and ASK (once), as cluster
+// clients do
+class ClusterClient {
+public:
+    explicit ClusterClient(std::string seed) : seed_(std::move(seed)) {}
+
+    std::string call(const std::string& key, const std::string& line) {
+        uint16_t slot = key_slot(key);
+        auto known = slots_.find(slot);
+        std::string node = known != slots_.end() ? known->second : seed_;
+        bool asking = false;
+        for (int hop = 0; hop < 5; ++hop) {
+            auto& conn = connection(node);
+            if (asking) conn.call("ASKING");
+            std::string reply = conn.call(line);
+            redirects_ += reply.rfind("-MOVED ", 0) == 0 || reply.rfind("-ASK ", 0) == 0;
+            if (reply.rfind("-MOVED ", 0) == 0) {
+                node = target(reply);
+                slots_[slot] = node;
+                asking = false;
+            } else if (reply.rfind("-ASK ", 0) == 0) {
+                node = target(reply);
+                asking = true;
+            } else {
+                return reply;
+            }
+        }
+        return "-too many redirections";
+    }
+
+    size_t redirects() const { return redirects_; }
+
+private:
+    std::string seed_;
+    std::map<uint16_t, std::string> slots_;
+    std::map<std::string, std::unique_ptr<NodeClient>> connections_;
+    size_t redirects_ = 0;
+
+    // "-MOVED <slot> <host:port>\r\n"
+    static std::string target(const std::string& reply) {
+        auto space = reply.rfind(' ');
+        return reply.substr(space + 1, reply.size() - space - 3);
+    }
+
+    NodeClient& connection(const std::string& node) {
+        auto& conn = connections_[node];
+        if (!conn) conn = std::make_unique<NodeClient>(node);
+        return *conn;
+    }
+};
+
+// Runs the cacheforge binary as a cluster node configured through its
+// environment, as a deployment would
+class NodeProcess {
+public:
+    NodeProcess(uint16_t port, const std::string& topology) : port_(port) {
+        std::vector<std::string> env = {"CACHEFORGE_BIND=127.0.0.1",
+                                        "CACHEFORGE_PORT=" + std::to_string(port),
+                                        "CACHEFORGE_CLUSTER_TOPOLOGY=" + topology,
+                                        "CACHEFORGE_LOG_LEVEL=warn"};
+        for (char** var = environ; *var; ++var) {
+            if (std::string_view(*var).rfind("CACHEFORGE_", 0) != 0) env.emplace_back(*var);
+        }
+        // Built before fork(): the child may only exec
+        std::vector<char*> envp;
+        for (auto& var : env) envp.push_back(var.data());
+        envp.push_back(nullptr);
+        char* argv[] = {const_cast<char*>(CACHEFORGE_BIN), nullptr};
+        pid_ = ::fork();
+        if (pid_ == 0) {
+            ::execve(CACHEFORGE_BIN, argv, envp.data());
+            ::_exit(127);
+        }
+    }
+    ~NodeProcess() {
+        if (pid_ <= 0) return;
+        ::kill(pid_, SIGTERM);
+        int status = 0;
+        for (int i = 0; i < 100 && ::waitpid(pid_, &status, WNOHANG) == 0; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+        if (::waitpid(pid_, &status, WNOHANG) == 0) {
+            ::kill(pid_, SIGKILL);
+            ::waitpid(pid_, &status, 0);
+        }
+    }
+    NodeProcess(const NodeProcess&) = delete;
+    NodeProcess& operator=(const NodeProcess&) = delete;
+
+    // Waits until the node accepts connections
+    bool ready(std::chrono::milliseconds timeout = std::chrono::milliseconds(10000)) const {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (std::chrono::steady_clock::now() < deadline) {
+            try {
+                NodeClient probe(node_name(port_));
+                return true;
+            } catch (const boost::system::system_error&) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            }
+        }
+        return false;
+    }
+
+private:
+    uint16_t port_;
+    pid_t pid_ = -1;
+};
+
+int64_t info_field(NodeClient& conn, const std::string& field) {
+    std::string info = conn.call("CLUSTER INFO");
+    auto pos = info.find(field + ":");
+    if (pos == std::string::npos) return -1;
+    return std::stoll(info.substr(pos + field.size() + 1));
+}
+
+}  // namespace
+
+TEST(ClusterIntegrationTest, test_redirects_between_nodes) {
+    auto servers = start_cluster(16400, 2);
+    NodeClient first(node_name(16400));
+    // "foo" is in slot 12182, owned by the second node
+    EXPECT_EQ(first.call("SET foo 1"), "-MOVED 12182 127.0.0.1:16401\r\n");
+    EXPECT_EQ(first.call("CLUSTER KEYSLOT foo"), ":12182\r\n");
+
+    ClusterClient client(node_name(16400));
+    for (int i = 0; i < 200; ++i) {
+        std::string key = "key" + std::to_string(i);
+        ASSERT_EQ(client.call(key, "SET " + key + " v" + std::to_string(i)), "+OK\r\n");
+    }
+    for (int i = 0; i < 200; ++i) {
+        std::string key = "key" + std::to_string(i);
+        std::string value = "v" + std::to_string(i);
+        EXPECT_EQ(client.call(key, "GET " + key),
+                  "$" + std::to_string(value.size()) + "\r\n" + value + "\r\n");
+    }
+    // Redirected once per slot, after which the client goes straight there
+    EXPECT_LE(client.redirects(), 200u);
+    size_t redirects = client.redirects();
+    client.call("key0", "GET key0");
+    EXPECT_EQ(client.redirects(), redirects);
+
+    for (auto& server : servers) server->stop();
+}
+
+TEST(ClusterIntegrationTest, test_slot_migration_under_writes) {
+    auto servers = start_cluster(16402, 2);
+    const uint16_t slot = key_slot("bar");  // 5061, on the first node
+    ClusterClient loader(node_name(16402));
+    for (int i = 0; i < 2000; ++i) {
+        std::string key = "{bar}" + std::to_string(i);
+        ASSERT_EQ(loader.call(key, "SET " + key + " value" + std::to_string(i)), "+OK\r\n");
+    }
+
+    // A client keeps incrementing a counter in the slot throughout, and
+    // adds new keys that must land on the target while the slot moves
+    std::atomic<bool> done{false};
+    std::atomic<int64_t> increments{0};
+    std::atomic<int> errors{0};
+    std::thread writer([&]() {
+        ClusterClient client(node_name(16402));
+        int n = 0;
+        while (!done.load()) {
+            std::string reply = client.call("{bar}counter", "INCR {bar}counter");
+            if (reply[0] == ':') {
+                increments.fetch_add(1);
+            } else {
+                errors.fetch_add(1);
+            }
+            std::string key = "{bar}new" + std::to_string(n++);
+            if (client.call(key, "SET " + key + " x") != "+OK\r\n") errors.fetch_add(1);
+        }
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    NodeClient source(node_name(16402));
+    NodeClient target(node_name(16403));
+    ASSERT_EQ(source.call("CLUSTER MIGRATE " + std::to_string(slot) + " " + node_name(16403)), "+OK\r\n");
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(20);
+    while (info_field(source, "cluster_migrating") != 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    done.store(true);
+    writer.join();
+
+    EXPECT_EQ(info_field(source, "cluster_migrating"), 0);
+    EXPECT_EQ(source.call("CLUSTER INFO").find("cluster_migration_error:\r\n") != std::string::npos, true);
+    EXPECT_GE(info_field(source, "cluster_migration_keys_moved"), 2000);
+    EXPECT_EQ(errors.load(), 0);
+    EXPECT_EQ(source.call("CLUSTER COUNTKEYSINSLOT " + std::to_string(slot)), ":0\r\n");
+    EXPECT_EQ(source.call("GET {bar}0"), "-MOVED 5061 127.0.0.1:16403\r\n");
+
+    // Every key and every increment made it across
+    EXPECT_EQ(target.call("GET {bar}1999"), "$9\r\nvalue1999\r\n");
+    std::string counter = std::to_string(increments.load());
+    EXPECT_EQ(target.call("GET {bar}counter"),
+              "$" + std::to_string(counter.size()) + "\r\n" + counter + "\r\n");
+    EXPECT_GE(std::stoll(target.call("CLUSTER COUNTKEYSINSLOT " + std::to_string(slot)).substr(1)), 2001);
+
+    for (auto& server : servers) server->stop();
+}
+
+TEST(ClusterIntegrationTest, test_throughput_from_one_to_four_nodes) {
+    // Pipelined SETs from one connection per node. On a single core the
+    // nodes compete for the same CPU, so this reports the numbers rather
+    // than asserting that they scale
+    const int kRequests = 20000;
+    const int kPipeline = 32;
+    uint16_t port = 16404;
+    for (size_t nodes : {1u, 2u, 4u}) {
+        auto servers = start_cluster(port, nodes);
+        ClusterState layout(even_topology(port, nodes), node_name(port));
+
+        // Keys grouped by owner so every request goes straight to its node
+        std::map<std::string, std::vector<std::string>> keys;
+        for (int i = 0; keys.size() < nodes || i < kRequests; ++i) {
+            std::string key = "key:" + std::to_string(i);
+            keys[*layout.owner(key_slot(key))].push_back(key);
+        }
+
+        std::atomic<int> errors{0};
+        std::vector<std::thread> clients;
+        auto started = std::chrono::steady_clock::now();
+        for (const auto& [node, owned] : keys) {
+            clients.emplace_back([&, node = node, owned = &owned]() {
+                NodeClient conn(node);
+                int per_node = kRequests / static_cast<int>(nodes);
+                for (int sent = 0; sent < per_node; sent += kPipeline) {
+                    std::string batch;
+                    int count = std::min(kPipeline, per_node - sent);
+                    for (int j = 0; j < count; ++j) {
+                        const auto& key = (*owned)[(sent + j) % owned->size()];
+                        batch += "SET " + key + " value\r\n";
+                    }
+                    conn.send(batch);
+                    for (int j = 0; j < count; ++j) {
+                        if (conn.read_reply() != "+OK\r\n") errors.fetch_add(1);
+                    }
+                }
+            });
+        }
+        for (auto& t : clients) t.join();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+        EXPECT_EQ(errors.load(), 0);
+        std::cout << "[cluster] " << nodes << " node(s): "
+                  << static_cast<int64_t>(kRequests / seconds) << " SET/s\n";
+        for (auto& server : servers) server->stop();
+        port = static_cast<uint16_t>(port + nodes);
+    }
+}
+
+TEST(ClusterIntegrationTest, test_nodes_as_separate_processes) {
+    const uint16_t port = 16415;
+    std::string topology = even_topology(port, 2);
+    NodeProcess first(port, topology);
+    NodeProcess second(port + 1, topology);
+    ASSERT_TRUE(first.ready());
+    ASSERT_TRUE(second.ready());
+
+    NodeClient direct(node_name(port));
+    EXPECT_EQ(direct.call("SET foo 1"), "-MOVED 12182 127.0.0.1:16416\r\n");
+    EXPECT_NE(direct.call("CLUSTER INFO").find("cluster_my_slots:8192"), std::string::npos);
+
+    ClusterClient client(node_name(port));
+    for (int i = 0; i < 100; ++i) {
+        std::string key = "key" + std::to_string(i);
+        ASSERT_EQ(client.call(key, "SET " + key + " v" + std::to_string(i)), "+OK\r\n");
+    }
+    for (int i = 0; i < 100; ++i) {
+        std::string key = "key" + std::to_string(i);
+        std::string value = "v" + std::to_string(i);
+        EXPECT_EQ(client.call(key, "GET " + key),
+                  "$" + std::to_string(value.size()) + "\r\n" + value + "\r\n");
+    }
+    EXPECT_GT(client.redirects(), 0u);
+}
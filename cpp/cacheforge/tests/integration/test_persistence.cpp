@@ -3,7 +3,16 @@
 #include "storage/hashtable.h"
 #include "storage/eviction.h"
 #include "data/value.h"
+#include "server/server.h"
+#include "protocol/parser.h"
+#include "tools/bulk_client.h"
+#include <boost/asio.hpp>
+#include <chrono>
 #include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
 
 using namespace cacheforge;
 
@@ -108,3 +117,130 @@ TEST(PersistenceIntegrationTest, test_empty_snapshot) {
 
     std::filesystem::remove_all(dir);
 }
+
+TEST(PersistenceIntegrationTest, test_server_warm_restart_from_snapshot) {
+    std::string dir = (std::filesystem::temp_directory_path() /
+                       ("cacheforge_warm_" + std::to_string(::getpid()))).string();
+    std::filesystem::remove_all(dir);
+    {
+        SnapshotManager sm(dir);
+        std::vector<SnapshotEntry> entries;
+        for (int i = 0; i < 50000; ++i) {
+            entries.push_back({"key:" + std::to_string(i), Value("value" + std::to_string(i)), 0});
+        }
+        entries.push_back({"session", Value("s"), 3600});
+        ASSERT_TRUE(sm.save_snapshot(entries));
+    }
+
+    Config cfg;
+    cfg.bind_address = "127.0.0.1";
+    cfg.port = 16411;
+    cfg.snapshot_dir = dir;
+    cfg.load_snapshot_on_start = true;
+    cfg.serve_reads_while_loading = true;
+    cfg.snapshot_load_threads = 2;
+    Server server(cfg);
+    server.start();
+
+    boost::asio::io_context io;
+    boost::asio::ip::tcp::socket sock(io);
+    sock.connect({boost::asio::ip::make_address("127.0.0.1"), cfg.port});
+    auto call = [&sock](const std::string& line) {
+        boost::asio::write(sock, boost::asio::buffer(line + "\r\n"));
+        std::string reply;
+        char buf[4096];
+        while (Parser::reply_length(reply.data(), reply.size()) == 0) {
+            size_t n = sock.read_some(boost::asio::buffer(buf));
+            reply.append(buf, n);
+        }
+        return reply;
+    };
+
+    // Served (or refused with LOADING) while the load runs, never wrong
+    auto early = call("GET key:49999");
+    EXPECT_TRUE(early == "$10\r\nvalue49999\r\n" || early.rfind("-LOADING", 0) == 0) << early;
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    while (call("INFO persistence").find("loading:0") == std::string::npos &&
+           std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(call("GET key:49999"), "$10\r\nvalue49999\r\n");
+    EXPECT_NE(call("INFO keyspace").find("keys:50001"), std::string::npos);
+    // Counted from the save, which the file name records to the second
+    auto ttl = std::stoll(call("TTL session").substr(1));
+    EXPECT_GE(ttl, 3590);
+    EXPECT_LE(ttl, 3600);
+    EXPECT_EQ(call("SET key:0 fresh"), "+OK\r\n");
+
+    server.stop();
+    std::filesystem::remove_all(dir);
+}
+
+TEST(PersistenceIntegrationTest, test_bulk_import_export_between_servers) {
+    auto start = [](uint16_t port) {
+        Config cfg;
+        cfg.bind_address = "127.0.0.1";
+        cfg.port = port;
+        cfg.worker_threads = 1;
+        auto server = std::make_unique<Server>(cfg);
+        server->start();
+        return server;
+    };
+    auto source = start(16412);
+    auto target = start(16413);
+
+    BulkOptions options;
+    options.port = 16412;
+    options.text = true;
+    options.chunk_bytes = 64 * 1024;
+    std::stringstream text;
+    constexpr int kKeys = 50000;
+    for (int i = 0; i < kKeys; ++i) text << "SET key:" << i << " value" << i << "\n";
+    text << "HSET profile name alice\nEXPIRE key:0 3600\nGET key:1\n";
+    size_t progress_calls = 0;
+    auto imported = run_import(options, text, [&](const BulkReport&) { ++progress_calls; });
+    EXPECT_EQ(imported.commands, kKeys + 3u);
+    EXPECT_EQ(imported.failed, 1u);  // the GET
+    EXPECT_NE(imported.first_error.find("write commands only"), std::string::npos);
+    EXPECT_GT(progress_calls, 1u);
+    std::cout << "import: " << imported.format();
+
+    // Export the first server and load the frames into the second
+    options.text = false;
+    std::stringstream dump;
+    auto exported = run_export(options, dump);
+    EXPECT_EQ(exported.commands, kKeys + 1u);
+    std::cout << "export: " << exported.format();
+    options.port = 16413;
+    auto reimported = run_import(options, dump);
+    EXPECT_EQ(reimported.commands, kKeys + 1u);
+    EXPECT_EQ(reimported.failed, 0u);
+    std::cout << "re-import: " << reimported.format();
+
+    boost::asio::io_context io;
+    boost::asio::ip::tcp::socket sock(io);
+    sock.connect({boost::asio::ip::make_address("127.0.0.1"), 16413});
+    auto call = [&sock](const std::string& line) {
+        boost::asio::write(sock, boost::asio::buffer(line + "\r\n"));
+        std::string reply;
+        char buf[4096];
+        while (Parser::reply_length(reply.data(), reply.size()) == 0) {
+            size_t n = sock.read_some(boost::asio::buffer(buf));
+            reply.append(buf, n);
+        }
+        return reply;
+    };
+    EXPECT_EQ(call("GET key:49999"), "$10\r\nvalue49999\r\n");
+    EXPECT_EQ(call("HGET profile name"), "$5\r\nalice\r\n");
+    auto ttl = std::stoll(call("TTL key:0").substr(1));
+    EXPECT_GE(ttl, 3590);
+    EXPECT_LE(ttl, 3600);
+    EXPECT_NE(call("INFO keyspace").find("keys:50001"), std::string::npos);
+
+    // A bad length can't be skipped over, so the connection is closed
+    EXPECT_EQ(call("BULKLOAD x").rfind("-ERR BULKLOAD needs a payload length", 0), 0u);
+
+    source->stop();
+    target->stop();
+}
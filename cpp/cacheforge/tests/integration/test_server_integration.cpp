@@ -6,7 +6,10 @@
 #include "storage/eviction.h"
 #include "storage/expiry.h"
 #include "protocol/parser.h"
+#include "tools/load_generator.h"
 #include <csignal>
+#include <filesystem>
+#include <unistd.h>
 #include <thread>
 #include <atomic>
 
@@ -192,3 +195,466 @@ TEST(ServerIntegrationTest, test_keys_command) {
     auto user_keys = ht.keys("user:*");
     EXPECT_EQ(user_keys.size(), 2);
 }
+
+// ========== Client-side caching ==========
+
+namespace {
+
+// Reads from a loopback client until `needle` shows up or the deadline passes
+std::string read_until(boost::asio::ip::tcp::socket& sock, const std::string& needle,
+                       std::chrono::milliseconds timeout = std::chrono::milliseconds(2000)) {
+    std::string received;
+    sock.non_blocking(true);
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    char buf[512];
+    while (received.find(needle) == std::string::npos &&
+           std::chrono::steady_clock::now() < deadline) {
+        boost::system::error_code ec;
+        size_t n = sock.read_some(boost::asio::buffer(buf), ec);
+        if (ec == boost::asio::error::would_block) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            continue;
+        }
+        if (ec) break;
+        received.append(buf, n);
+    }
+    return received;
+}
+
+}  // namespace
+
+TEST(ServerIntegrationTest, test_client_tracking_push_over_loopback) {
+    Config cfg;
+    cfg.bind_address = "127.0.0.1";
+    cfg.port = 16391;
+    Server server(cfg);
+    server.start();
+
+    boost::asio::io_context io;
+    boost::asio::ip::tcp::endpoint ep(boost::asio::ip::make_address("127.0.0.1"), cfg.port);
+    boost::asio::ip::tcp::socket reader(io), writer(io);
+    reader.connect(ep);
+    writer.connect(ep);
+
+    boost::asio::write(reader, boost::asio::buffer(std::string("CLIENT TRACKING ON\r\nGET k\r\n")));
+    EXPECT_NE(read_until(reader, "$-1\r\n").find("$-1\r\n"), std::string::npos);
+
+    boost::asio::write(writer, boost::asio::buffer(std::string("SET k v\r\n")));
+    EXPECT_NE(read_until(writer, "+OK\r\n").find("+OK\r\n"), std::string::npos);
+
+    const std::string push = ">2\r\n$10\r\ninvalidate\r\n*1\r\n$1\r\nk\r\n";
+    EXPECT_NE(read_until(reader, push).find(push), std::string::npos);
+
+    server.stop();
+}
+
+TEST(ServerIntegrationTest, test_load_generator_against_server) {
+    Config cfg;
+    cfg.bind_address = "127.0.0.1";
+    cfg.port = 16392;
+    Server server(cfg);
+    server.start();
+
+    LoadOptions options;
+    options.port = cfg.port;
+    options.connections = 4;
+    options.pipeline = 8;
+    options.keyspace = 100;
+    options.requests = 2000;
+    options.mix = {{"GET", 1}, {"SET", 1}, {"INCR", 1}};
+
+    auto report = run_load(options);
+    EXPECT_EQ(report.requests, 2000u);
+    EXPECT_EQ(report.errors, 0u);
+    EXPECT_EQ(report.latency.count(), 2000u);
+    EXPECT_GE(report.corrected.count(), report.latency.count());
+    EXPECT_NE(report.format(true).find("\"requests\":2000"), std::string::npos);
+
+    server.stop();
+}
+
+// ========== Admission control and output buffer limits ==========
+
+namespace {
+
+// True once the server has closed the connection (EOF or reset), discarding
+// anything still buffered on the way
+bool wait_closed(boost::asio::ip::tcp::socket& sock,
+                 std::chrono::milliseconds timeout = std::chrono::milliseconds(4000)) {
+    sock.non_blocking(true);
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    char buf[65536];
+    while (std::chrono::steady_clock::now() < deadline) {
+        boost::system::error_code ec;
+        sock.read_some(boost::asio::buffer(buf), ec);
+        if (ec == boost::asio::error::would_block) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
+        }
+        if (ec) return true;
+    }
+    return false;
+}
+
+std::string info_stats(const boost::asio::ip::tcp::endpoint& ep) {
+    boost::asio::io_context io;
+    boost::asio::ip::tcp::socket sock(io);
+    sock.connect(ep);
+    boost::asio::write(sock, boost::asio::buffer(std::string("INFO stats\r\n")));
+    return read_until(sock, "evicted_keys");
+}
+
+}  // namespace
+
+TEST(ServerIntegrationTest, test_max_connections_rejects_extra_clients) {
+    Config cfg;
+    cfg.bind_address = "127.0.0.1";
+    cfg.port = 16393;
+    cfg.max_connections = 2;
+    Server server(cfg);
+    server.start();
+
+    boost::asio::io_context io;
+    boost::asio::ip::tcp::endpoint ep(boost::asio::ip::make_address("127.0.0.1"), cfg.port);
+    boost::asio::ip::tcp::socket a(io), b(io), c(io);
+    for (auto* sock : {&a, &b}) {
+        sock->connect(ep);
+        boost::asio::write(*sock, boost::asio::buffer(std::string("PING\r\n")));
+        ASSERT_NE(read_until(*sock, "+PONG\r\n").find("+PONG"), std::string::npos);
+    }
+
+    c.connect(ep);
+    EXPECT_NE(read_until(c, "reached").find("-ERR max number of clients reached"), std::string::npos);
+    EXPECT_TRUE(wait_closed(c));
+
+    // A freed slot can be reused once the server has seen the close
+    a.close();
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    boost::asio::ip::tcp::socket d(io);
+    d.connect(ep);
+    boost::asio::write(d, boost::asio::buffer(std::string("PING\r\n")));
+    EXPECT_NE(read_until(d, "+PONG\r\n").find("+PONG"), std::string::npos);
+    d.close();
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    EXPECT_NE(info_stats(ep).find("rejected_connections:1\r\n"), std::string::npos);
+    server.stop();
+}
+
+TEST(ServerIntegrationTest, test_idle_clients_are_reaped) {
+    Config cfg;
+    cfg.bind_address = "127.0.0.1";
+    cfg.port = 16394;
+    cfg.client_idle_timeout = std::chrono::seconds(1);
+    Server server(cfg);
+    server.start();
+
+    boost::asio::io_context io;
+    boost::asio::ip::tcp::endpoint ep(boost::asio::ip::make_address("127.0.0.1"), cfg.port);
+    boost::asio::ip::tcp::socket idle(io), busy(io);
+    idle.connect(ep);
+    busy.connect(ep);
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(2500);
+    while (std::chrono::steady_clock::now() < deadline) {
+        boost::asio::write(busy, boost::asio::buffer(std::string("PING\r\n")));
+        ASSERT_NE(read_until(busy, "+PONG\r\n").find("+PONG"), std::string::npos);
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+    }
+    EXPECT_TRUE(wait_closed(idle, std::chrono::milliseconds(100)));
+    // Closed connections are swept on the reaper's next pass
+    for (int i = 0; i < 30 && server.connection_count() != 1; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    EXPECT_EQ(server.connection_count(), 1u);
+
+    server.stop();
+}
+
+TEST(ServerIntegrationTest, test_slow_reader_is_paused_not_buffered) {
+    // 2000 pipelined GETs of a 16KB value are ~32MB of replies, far over the
+    // 1MB hard limit; pausing the client's commands keeps the queue small
+    Config cfg;
+    cfg.bind_address = "127.0.0.1";
+    cfg.port = 16395;
+    cfg.client_output_buffer_hard_limit = 1024 * 1024;
+    cfg.client_output_buffer_soft_limit = 0;
+    cfg.client_output_pause_bytes = 64 * 1024;
+    Server server(cfg);
+    server.start();
+
+    boost::asio::io_context io;
+    boost::asio::ip::tcp::endpoint ep(boost::asio::ip::make_address("127.0.0.1"), cfg.port);
+    boost::asio::ip::tcp::socket sock(io);
+    sock.connect(ep);
+    boost::asio::write(sock, boost::asio::buffer("SET big " + std::string(16384, 'x') + "\r\n"));
+    ASSERT_NE(read_until(sock, "+OK\r\n").find("+OK"), std::string::npos);
+
+    const size_t kRequests = 2000;
+    std::string pipeline;
+    for (size_t i = 0; i < kRequests; ++i) pipeline += "GET big\r\n";
+    boost::asio::write(sock, boost::asio::buffer(pipeline));
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+    // Drain slowly-started reader: every reply must arrive, none dropped
+    std::string buffered;
+    size_t replies = 0;
+    char buf[65536];
+    sock.non_blocking(true);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (replies < kRequests && std::chrono::steady_clock::now() < deadline) {
+        boost::system::error_code ec;
+        size_t n = sock.read_some(boost::asio::buffer(buf), ec);
+        if (ec == boost::asio::error::would_block) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        ASSERT_FALSE(ec) << "server closed a paused connection: " << ec.message();
+        buffered.append(buf, n);
+        size_t len;
+        while ((len = Parser::reply_length(buffered.data(), buffered.size())) > 0) {
+            replies++;
+            buffered.erase(0, len);
+        }
+    }
+    EXPECT_EQ(replies, kRequests);
+    EXPECT_NE(info_stats(ep).find("client_output_buffer_limit_disconnections:0\r\n"), std::string::npos);
+    server.stop();
+}
+
+TEST(ServerIntegrationTest, test_output_limits_disconnect_slow_clients) {
+    // Without pausing, a client that never reads blows through the limits
+    Config cfg;
+    cfg.bind_address = "127.0.0.1";
+    cfg.port = 16396;
+    cfg.client_output_buffer_hard_limit = 32 * 1024 * 1024;
+    cfg.client_output_buffer_soft_limit = 1024 * 1024;
+    cfg.client_output_buffer_soft_seconds = std::chrono::seconds(1);
+    cfg.client_output_pause_bytes = 0;
+    Server server(cfg);
+    server.start();
+
+    boost::asio::io_context io;
+    boost::asio::ip::tcp::endpoint ep(boost::asio::ip::make_address("127.0.0.1"), cfg.port);
+    boost::asio::ip::tcp::socket hard(io), soft(io);
+    hard.connect(ep);
+    soft.connect(ep);
+    boost::asio::write(hard, boost::asio::buffer("SET big " + std::string(256 * 1024, 'x') + "\r\n"));
+    ASSERT_NE(read_until(hard, "+OK\r\n").find("+OK"), std::string::npos);
+
+    // Well over the hard limit once the socket buffers are full
+    std::string pipeline;
+    for (int i = 0; i < 256; ++i) pipeline += "GET big\r\n";
+    boost::asio::write(hard, boost::asio::buffer(pipeline));
+    EXPECT_TRUE(wait_closed(hard));
+
+    // Between the soft and hard limits: closed after the grace period
+    std::string some;
+    for (int i = 0; i < 64; ++i) some += "GET big\r\n";
+    boost::asio::write(soft, boost::asio::buffer(some));
+    // Reading would drain the queue, so only look at the socket afterwards
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    EXPECT_NE(info_stats(ep).find("client_output_buffer_limit_disconnections:1\r\n"), std::string::npos);
+    std::this_thread::sleep_for(std::chrono::milliseconds(2500));
+    EXPECT_TRUE(wait_closed(soft, std::chrono::milliseconds(1000)));
+
+    EXPECT_NE(info_stats(ep).find("client_output_buffer_limit_disconnections:2\r\n"), std::string::npos);
+    server.stop();
+}
+
+TEST(ServerIntegrationTest, test_query_buffer_limit_disconnects_unterminated_input) {
+    Config cfg;
+    cfg.bind_address = "127.0.0.1";
+    cfg.port = 16417;
+    cfg.client_query_buffer_limit = 64 * 1024;
+    Server server(cfg);
+    server.start();
+
+    boost::asio::io_context io;
+    boost::asio::ip::tcp::endpoint ep(boost::asio::ip::make_address("127.0.0.1"), cfg.port);
+    boost::asio::ip::tcp::socket endless(io), pipelined(io);
+    endless.connect(ep);
+    pipelined.connect(ep);
+
+    // A pipeline far over the limit is fine: each command runs as it lands
+    std::string pipeline;
+    for (int i = 0; i < 4096; ++i) pipeline += "SET k" + std::to_string(i) + " " + std::string(32, 'v') + "\r\n";
+    boost::asio::write(pipelined, boost::asio::buffer(pipeline));
+    std::string expected;
+    for (int i = 0; i < 4096; ++i) expected += "+OK\r\n";
+    std::string replies;
+    for (int i = 0; i < 200 && replies.size() < expected.size(); ++i) replies += read_until(pipelined, "+OK\r\n");
+    EXPECT_EQ(replies, expected);
+
+    // A line that never ends is not
+    boost::system::error_code ec;
+    boost::asio::write(endless, boost::asio::buffer("SET k " + std::string(256 * 1024, 'x')), ec);
+    EXPECT_TRUE(wait_closed(endless));
+    EXPECT_NE(info_stats(ep).find("client_query_buffer_limit_disconnections:1\r\n"), std::string::npos);
+    server.stop();
+}
+
+TEST(ServerIntegrationTest, test_registry_tracks_many_connections_and_broadcasts) {
+    Config cfg;
+    cfg.bind_address = "127.0.0.1";
+    cfg.port = 16397;
+    Server server(cfg);
+    server.start();
+
+    boost::asio::io_context io;
+    boost::asio::ip::tcp::endpoint ep(boost::asio::ip::make_address("127.0.0.1"), cfg.port);
+    std::vector<std::unique_ptr<boost::asio::ip::tcp::socket>> clients;
+    for (int i = 0; i < 200; ++i) {
+        clients.push_back(std::make_unique<boost::asio::ip::tcp::socket>(io));
+        clients.back()->connect(ep);
+    }
+    for (int i = 0; i < 50 && server.connection_count() != 200; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    EXPECT_EQ(server.connection_count(), 200u);
+
+    // Closing unregisters at once, without waiting for the reaper
+    for (int i = 0; i < 100; ++i) clients[i]->close();
+    for (int i = 0; i < 50 && server.connection_count() != 100; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(server.connection_count(), 100u);
+
+    server.broadcast("+hello\r\n");
+    for (int i = 100; i < 200; ++i) {
+        EXPECT_NE(read_until(*clients[i], "+hello\r\n").find("+hello"), std::string::npos);
+    }
+
+    server.stop();
+    EXPECT_EQ(server.connection_count(), 0u);
+}
+
+TEST(ServerIntegrationTest, test_pubsub_over_loopback) {
+    Config cfg;
+    cfg.bind_address = "127.0.0.1";
+    cfg.port = 16398;
+    Server server(cfg);
+    server.start();
+
+    boost::asio::io_context io;
+    boost::asio::ip::tcp::endpoint ep(boost::asio::ip::make_address("127.0.0.1"), cfg.port);
+    boost::asio::ip::tcp::socket sub(io), psub(io), pub(io);
+    sub.connect(ep);
+    psub.connect(ep);
+    pub.connect(ep);
+
+    boost::asio::write(sub, boost::asio::buffer(std::string("SUBSCRIBE news\r\n")));
+    ASSERT_NE(read_until(sub, ":1\r\n").find("subscribe"), std::string::npos);
+    boost::asio::write(psub, boost::asio::buffer(std::string("PSUBSCRIBE new*\r\n")));
+    ASSERT_NE(read_until(psub, ":1\r\n").find("psubscribe"), std::string::npos);
+
+    boost::asio::write(pub, boost::asio::buffer(std::string("PUBLISH news hello\r\n")));
+    EXPECT_NE(read_until(pub, ":2\r\n").find(":2\r\n"), std::string::npos);
+
+    const std::string message = ">3\r\n$7\r\nmessage\r\n$4\r\nnews\r\n$5\r\nhello\r\n";
+    EXPECT_NE(read_until(sub, message).find(message), std::string::npos);
+    const std::string pmessage = ">4\r\n$8\r\npmessage\r\n$4\r\nnew*\r\n$4\r\nnews\r\n$5\r\nhello\r\n";
+    EXPECT_NE(read_until(psub, pmessage).find(pmessage), std::string::npos);
+
+    // A closed subscriber is dropped from the channel
+    sub.close();
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    boost::asio::write(pub, boost::asio::buffer(std::string("PUBSUB NUMSUB news\r\n")));
+    EXPECT_NE(read_until(pub, ":0\r\n").find("$4\r\nnews\r\n:0\r\n"), std::string::npos);
+
+    server.stop();
+}
+
+TEST(ServerIntegrationTest, test_tiered_storage_over_loopback) {
+    Config cfg;
+    cfg.bind_address = "127.0.0.1";
+    cfg.port = 16399;
+    cfg.max_memory_bytes = 16 * 1024;
+    cfg.tiered_storage_dir = (std::filesystem::temp_directory_path() /
+                              ("cacheforge_tiered_it_" + std::to_string(::getpid()))).string();
+    {
+        Server server(cfg);
+        server.start();
+
+        boost::asio::io_context io;
+        boost::asio::ip::tcp::endpoint ep(boost::asio::ip::make_address("127.0.0.1"), cfg.port);
+        boost::asio::ip::tcp::socket sock(io);
+        sock.connect(ep);
+
+        const std::string value(512, 'v');
+        std::string batch;
+        for (int i = 0; i < 200; ++i) batch += "SET k" + std::to_string(i) + " " + value + "\r\n";
+        boost::asio::write(sock, boost::asio::buffer(batch));
+        std::string replies;
+        for (int i = 0; i < 200; ++i) replies += "+OK\r\n";
+        ASSERT_EQ(read_until(sock, replies), replies);
+
+        // The oldest value was demoted to disk and reads back intact
+        boost::asio::write(sock, boost::asio::buffer(std::string("GET k0\r\n")));
+        std::string expected = "$512\r\n" + value + "\r\n";
+        EXPECT_EQ(read_until(sock, expected), expected);
+
+        boost::asio::write(sock, boost::asio::buffer(std::string("INFO tiered\r\n")));
+        auto info = read_until(sock, "tiered_compactions");
+        auto pos = info.find("tiered_cold_keys:");
+        ASSERT_NE(pos, std::string::npos);
+        EXPECT_GT(std::stoul(info.substr(pos + 17)), 150u);
+
+        server.stop();
+    }
+    std::filesystem::remove_all(cfg.tiered_storage_dir);
+}
+
+TEST(ServerIntegrationTest, test_keyspace_notifications_over_loopback) {
+    Config cfg;
+    cfg.bind_address = "127.0.0.1";
+    cfg.port = 16414;
+    cfg.notify_keyspace_events = "KEA";
+    Server server(cfg);
+    server.start();
+
+    boost::asio::io_context io;
+    boost::asio::ip::tcp::endpoint ep(boost::asio::ip::make_address("127.0.0.1"), cfg.port);
+    boost::asio::ip::tcp::socket events(io), keys(io), writer(io);
+    events.connect(ep);
+    keys.connect(ep);
+    writer.connect(ep);
+
+    boost::asio::write(events, boost::asio::buffer(std::string("SUBSCRIBE __keyevent@0__:expired\r\n")));
+    ASSERT_NE(read_until(events, ":1\r\n").find("subscribe"), std::string::npos);
+    boost::asio::write(keys, boost::asio::buffer(std::string("PSUBSCRIBE __keyspace@0__:*\r\n")));
+    ASSERT_NE(read_until(keys, ":1\r\n").find("psubscribe"), std::string::npos);
+
+    boost::asio::write(writer, boost::asio::buffer(std::string("SET k v EX 1\r\n")));
+    EXPECT_NE(read_until(writer, "+OK\r\n").find("+OK\r\n"), std::string::npos);
+
+    const std::string set = "$16\r\n__keyspace@0__:k\r\n$3\r\nset\r\n";
+    EXPECT_NE(read_until(keys, set).find(set), std::string::npos);
+    // Reported by the expiry thread once the key is due
+    const std::string expired = ">3\r\n$7\r\nmessage\r\n$22\r\n__keyevent@0__:expired\r\n$1\r\nk\r\n";
+    EXPECT_NE(read_until(events, expired, std::chrono::milliseconds(4000)).find(expired), std::string::npos);
+
+    boost::asio::write(writer, boost::asio::buffer(std::string("INFO stats\r\n")));
+    auto info = read_until(writer, "keyspace_events_dropped:");
+    EXPECT_NE(info.find("notify_keyspace_events:AKE"), std::string::npos);
+
+    server.stop();
+}
+
+TEST(ServerIntegrationTest, test_server_refuses_to_change_the_hash_seed) {
+    // Another server's table already hashes with the process's seed
+    HashTable other;
+    other.set("k", Value("v"));
+
+    Config cfg;
+    cfg.bind_address = "127.0.0.1";
+    cfg.port = 16418;
+    cfg.hash_seed = hashing::seed() ^ 1;
+    EXPECT_THROW(Server server(cfg), std::runtime_error);
+    EXPECT_TRUE(other.contains("k"));
+
+    // The seed already in use is accepted
+    cfg.hash_seed = hashing::seed();
+    Server server(cfg);
+    EXPECT_TRUE(other.contains("k"));
+}
@@ -0,0 +1,52 @@
+#include <gtest/gtest.h>
+#include "tools/bulk_client.h"
+#include <stdexcept>
+
+using namespace cacheforge;
+
+namespace {
+
+BulkOptions parse(std::vector<std::string> args) {
+    std::vector<char*> argv{const_cast<char*>("cacheforge-import")};
+    for (auto& a : args) argv.push_back(a.data());
+    return BulkOptions::parse(static_cast<int>(argv.size()), argv.data());
+}
+
+}  // namespace
+
+TEST(BulkClientTest, test_parse_options) {
+    auto o = parse({});
+    EXPECT_EQ(o.file, "-");
+    EXPECT_FALSE(o.export_mode);
+    EXPECT_EQ(o.window, 4u);
+
+    o = parse({"-p", "7000", "-f", "dump.bin", "--text", "-b", "65536", "-w", "8", "-q"});
+    EXPECT_EQ(o.port, 7000);
+    EXPECT_EQ(o.file, "dump.bin");
+    EXPECT_TRUE(o.text);
+    EXPECT_EQ(o.chunk_bytes, 65536u);
+    EXPECT_EQ(o.window, 8u);
+    EXPECT_TRUE(o.quiet);
+    EXPECT_TRUE(parse({"--export"}).export_mode);
+
+    EXPECT_THROW(parse({"-b", "0"}), std::invalid_argument);
+    EXPECT_THROW(parse({"-b", "1000000000"}), std::invalid_argument);
+    EXPECT_THROW(parse({"-w", "0"}), std::invalid_argument);
+    EXPECT_THROW(parse({"--export", "--text"}), std::invalid_argument);
+    EXPECT_THROW(parse({"-p"}), std::invalid_argument);
+    EXPECT_THROW(parse({"--bogus", "1"}), std::invalid_argument);
+}
+
+TEST(BulkClientTest, test_report_format) {
+    BulkReport report;
+    report.commands = 1000;
+    report.failed = 2;
+    report.bytes = 4096;
+    report.elapsed = std::chrono::milliseconds(500);
+    report.first_error = "boom";
+    EXPECT_DOUBLE_EQ(report.keys_per_sec(), 2000.0);
+    auto text = report.format();
+    EXPECT_NE(text.find("keys: 1000 (2 failed)"), std::string::npos);
+    EXPECT_NE(text.find("2000.00 keys/sec"), std::string::npos);
+    EXPECT_NE(text.find("first error: boom"), std::string::npos);
+}
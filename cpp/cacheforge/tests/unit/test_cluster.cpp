@@ -0,0 +1,263 @@
+#include <gtest/gtest.h>
+#include "cluster/cluster.h"
+#include "server/command_handler.h"
+#include "storage/hashtable.h"
+#include "protocol/parser.h"
+#include <boost/asio.hpp>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <stdexcept>
+#include <string>
+
+using namespace cacheforge;
+
+namespace {
+
+const char* const kTopology = "127.0.0.1:7000=0-8191 127.0.0.1:7001=8192-16383";
+
+std::string run(CommandHandler& handler, ClientState& client, const std::string& line) {
+    Parser parser;
+    return handler.execute(*parser.parse_text(line), client);
+}
+
+bool never(const std::string&) { return false; }
+bool always(const std::string&) { return true; }
+
+}  // namespace
+
+TEST(ClusterTest, test_key_slot_matches_redis_cluster) {
+    EXPECT_EQ(key_slot("123456789"), 0x31C3 & 16383);
+    EXPECT_EQ(key_slot("foo"), 12182);
+    EXPECT_EQ(key_slot("bar"), 5061);
+    EXPECT_EQ(key_slot(""), 0);
+    // Only a non-empty {tag} is hashed
+    EXPECT_EQ(key_slot("{user1000}.following"), key_slot("{user1000}.followers"));
+    EXPECT_EQ(key_slot("{user1000}.following"), key_slot("user1000"));
+    EXPECT_NE(key_slot("{}foo"), key_slot("foo"));
+}
+
+TEST(ClusterTest, test_topology_parsing) {
+    ClusterState state(kTopology, "127.0.0.1:7000");
+    EXPECT_EQ(state.owned_slots(), 8192u);
+    EXPECT_TRUE(state.owns(0));
+    EXPECT_FALSE(state.owns(8192));
+    EXPECT_EQ(state.owner(16383), "127.0.0.1:7001");
+    auto ranges = state.ranges();
+    ASSERT_EQ(ranges.size(), 2u);
+    EXPECT_EQ(ranges[1].first, 8192);
+    EXPECT_EQ(ranges[1].last, 16383);
+    EXPECT_EQ(ranges[1].node, "127.0.0.1:7001");
+
+    ClusterState split("a:1=0-99,200 b:2=100-199 c:3", "c:3");
+    EXPECT_EQ(split.owned_slots(), 0u);
+    EXPECT_EQ(split.owner(200), "a:1");
+    EXPECT_FALSE(split.owner(201).has_value());
+
+    EXPECT_THROW(ClusterState("a:1=0-10 b:2=10-20", "a:1"), std::runtime_error);
+    EXPECT_THROW(ClusterState("a:1=0-16384", "a:1"), std::runtime_error);
+    EXPECT_THROW(ClusterState("a:1=9-3", "a:1"), std::runtime_error);
+    EXPECT_THROW(ClusterState("a:1=x", "a:1"), std::runtime_error);
+    EXPECT_THROW(ClusterState("nohost=0-1", "nohost"), std::runtime_error);
+    EXPECT_THROW(ClusterState(kTopology, "127.0.0.1:7002"), std::runtime_error);
+}
+
+TEST(ClusterTest, test_route_moved_crossslot_and_down) {
+    ClusterState state("127.0.0.1:7000=0-8191 127.0.0.1:7001=8192-16000", "127.0.0.1:7000");
+    EXPECT_FALSE(state.route({"bar"}, false, never).has_value());
+    EXPECT_FALSE(state.route({}, false, never).has_value());
+    EXPECT_EQ(state.route({"foo"}, false, never), "-MOVED 12182 127.0.0.1:7001\r\n");
+    EXPECT_EQ(state.route({"foo", "bar"}, false, never)->rfind("-CROSSSLOT", 0), 0u);
+    EXPECT_FALSE(state.route({"{bar}a", "{bar}b"}, false, never).has_value());
+
+    std::string unowned;
+    for (int i = 0; unowned.empty(); ++i) {
+        std::string key = "k" + std::to_string(i);
+        if (key_slot(key) > 16000) unowned = key;
+    }
+    EXPECT_EQ(state.route({unowned}, false, never)->rfind("-CLUSTERDOWN", 0), 0u);
+}
+
+TEST(ClusterTest, test_route_during_migration) {
+    ClusterState source(kTopology, "127.0.0.1:7000");
+    ClusterState target(kTopology, "127.0.0.1:7001");
+    source.set_migrating(5061, "127.0.0.1:7001");
+    target.set_importing(5061, "127.0.0.1:7000");
+    EXPECT_THROW(target.set_migrating(5061, "127.0.0.1:7000"), std::runtime_error);
+    EXPECT_THROW(source.set_importing(5061, "127.0.0.1:7001"), std::runtime_error);
+    EXPECT_THROW(source.set_migrating(5061, "nobody:1"), std::runtime_error);
+
+    // Keys still on the source are served there; the rest are asked for
+    // on the target, which only accepts them after ASKING
+    EXPECT_FALSE(source.route({"bar"}, false, always).has_value());
+    EXPECT_EQ(source.route({"bar"}, false, never), "-ASK 5061 127.0.0.1:7001\r\n");
+    EXPECT_EQ(target.route({"bar"}, false, never), "-MOVED 5061 127.0.0.1:7000\r\n");
+    EXPECT_FALSE(target.route({"bar"}, true, never).has_value());
+    auto only_first = [](const std::string& key) { return key == "{bar}1"; };
+    EXPECT_EQ(source.route({"{bar}1", "{bar}2"}, false, only_first)->rfind("-TRYAGAIN", 0), 0u);
+
+    source.set_owner(5061, "127.0.0.1:7001");
+    target.set_owner(5061, "127.0.0.1:7001");
+    EXPECT_EQ(source.route({"bar"}, false, always), "-MOVED 5061 127.0.0.1:7001\r\n");
+    EXPECT_FALSE(target.route({"bar"}, false, never).has_value());
+    EXPECT_FALSE(source.migrating_to(5061).has_value());
+}
+
+TEST(ClusterTest, test_dump_restore_roundtrip) {
+    Value text(std::string("hello world"));
+    Value restored = restore_value(dump_value(text));
+    EXPECT_EQ(restored.type(), Value::Type::String);
+    EXPECT_EQ(restored.as_string(), "hello world");
+
+    Value big(std::string(4096, 'z'));
+    auto packed = big.compressed(64);
+    ASSERT_TRUE(packed.has_value());
+    Value restored_packed = restore_value(dump_value(*packed));
+    EXPECT_TRUE(restored_packed.is_compressed());
+    EXPECT_EQ(restored_packed.decompressed().as_string(), std::string(4096, 'z'));
+
+    EXPECT_THROW(restore_value(""), std::runtime_error);
+    EXPECT_THROW(restore_value("0"), std::runtime_error);
+    EXPECT_THROW(restore_value("zz"), std::runtime_error);
+    EXPECT_THROW(restore_value("7f"), std::runtime_error);
+    // A compressed string declaring ~4 GB behind a one-byte block, and one
+    // whose small declared size is plausible but whose block is garbage
+    EXPECT_THROW(restore_value("80fffffff000"), std::runtime_error);
+    EXPECT_THROW(restore_value("8010000000ff"), std::runtime_error);
+}
+
+TEST(ClusterTest, test_restore_rejects_oversized_compressed_payload) {
+    HashTable ht(1000);
+    CommandHandler handler(ht);
+    ClientState client;
+    EXPECT_EQ(run(handler, client, "RESTORE k 0 80fffffff000").rfind("-", 0), 0u);
+    EXPECT_EQ(run(handler, client, "GET k"), "$-1\r\n");
+}
+
+TEST(ClusterTest, test_command_handler_redirects) {
+    HashTable ht(1000);
+    CommandHandler handler(ht);
+    ClusterState state(kTopology, "127.0.0.1:7000");
+    handler.set_cluster(&state);
+    ClientState client;
+
+    EXPECT_EQ(run(handler, client, "SET bar 1"), "+OK\r\n");
+    EXPECT_EQ(run(handler, client, "SET foo 1"), "-MOVED 12182 127.0.0.1:7001\r\n");
+    EXPECT_EQ(run(handler, client, "GET foo"), "-MOVED 12182 127.0.0.1:7001\r\n");
+    EXPECT_EQ(run(handler, client, "DEL foo bar").rfind("-CROSSSLOT", 0), 0u);
+    EXPECT_EQ(run(handler, client, "PING"), "+PONG\r\n");
+    EXPECT_EQ(run(handler, client, "CLUSTER KEYSLOT foo"), ":12182\r\n");
+    EXPECT_EQ(run(handler, client, "CLUSTER COUNTKEYSINSLOT 5061"), ":1\r\n");
+    EXPECT_EQ(run(handler, client, "CLUSTER GETKEYSINSLOT 5061 10"), "*1\r\n$3\r\nbar\r\n");
+    EXPECT_NE(run(handler, client, "CLUSTER INFO").find("cluster_my_slots:8192"), std::string::npos);
+    EXPECT_EQ(run(handler, client, "CLUSTER SLOTS").rfind("*2\r\n*3\r\n:0\r\n:8191\r\n*2\r\n", 0), 0u);
+
+    // A queued command that would be redirected fails the transaction
+    EXPECT_EQ(run(handler, client, "MULTI"), "+OK\r\n");
+    EXPECT_EQ(run(handler, client, "SET foo 2"), "-MOVED 12182 127.0.0.1:7001\r\n");
+    EXPECT_EQ(run(handler, client, "EXEC").rfind("-ERR EXECABORT", 0), 0u);
+}
+
+TEST(ClusterTest, test_setslot_refused_inside_multi) {
+    // EXEC would hold every shard while SETSLOT MIGRATING waits for a GET
+    // that is itself waiting for a shard
+    HashTable ht(1000);
+    CommandHandler handler(ht);
+    ClusterState state(kTopology, "127.0.0.1:7000");
+    handler.set_cluster(&state);
+    ClientState setup;
+    run(handler, setup, "SET bar 1");
+
+    std::atomic<bool> done{false};
+    std::thread reader([&]() {
+        ClientState client;
+        while (!done.load()) EXPECT_EQ(run(handler, client, "GET bar"), "$1\r\n1\r\n");
+    });
+    ClientState client;
+    for (int i = 0; i < 200; ++i) {
+        EXPECT_EQ(run(handler, client, "MULTI"), "+OK\r\n");
+        EXPECT_EQ(run(handler, client, "PING"), "+QUEUED\r\n");
+        EXPECT_EQ(run(handler, client, "CLUSTER SETSLOT 5061 MIGRATING 127.0.0.1:7001"),
+                  "-ERR CLUSTER SETSLOT is not allowed in a transaction\r\n");
+        EXPECT_EQ(run(handler, client, "CLUSTER MIGRATE 5061 127.0.0.1:7001").rfind("-ERR", 0), 0u);
+        EXPECT_EQ(run(handler, client, "EXEC").rfind("-ERR EXECABORT", 0), 0u);
+    }
+    done.store(true);
+    reader.join();
+    EXPECT_FALSE(state.migrating_to(5061).has_value());
+    EXPECT_EQ(run(handler, client, "CLUSTER SETSLOT 5061 MIGRATING 127.0.0.1:7001"), "+OK\r\n");
+}
+
+TEST(ClusterTest, test_asking_and_restore_on_importing_node) {
+    HashTable ht(1000);
+    CommandHandler handler(ht);
+    ClusterState state(kTopology, "127.0.0.1:7001");
+    handler.set_cluster(&state);
+    ClientState client;
+
+    std::string payload = dump_value(Value(std::string("v1")));
+    EXPECT_EQ(run(handler, client, "RESTORE bar 0 " + payload), "-MOVED 5061 127.0.0.1:7000\r\n");
+    EXPECT_EQ(run(handler, client, "CLUSTER SETSLOT 5061 IMPORTING 127.0.0.1:7000"), "+OK\r\n");
+    EXPECT_EQ(run(handler, client, "ASKING"), "+OK\r\n");
+    EXPECT_EQ(run(handler, client, "RESTORE bar 0 " + payload), "+OK\r\n");
+    // ASKING covers one command only
+    EXPECT_EQ(run(handler, client, "GET bar"), "-MOVED 5061 127.0.0.1:7000\r\n");
+    EXPECT_EQ(run(handler, client, "ASKING"), "+OK\r\n");
+    EXPECT_EQ(run(handler, client, "GET bar"), "$2\r\nv1\r\n");
+    EXPECT_EQ(run(handler, client, "ASKING"), "+OK\r\n");
+    EXPECT_EQ(run(handler, client, "RESTORE bar 0 " + payload).rfind("-BUSYKEY", 0), 0u);
+
+    EXPECT_EQ(run(handler, client, "CLUSTER SETSLOT 5061 NODE 127.0.0.1:7001"), "+OK\r\n");
+    EXPECT_EQ(run(handler, client, "GET bar"), "$2\r\nv1\r\n");
+    EXPECT_EQ(run(handler, client, "RESTORE bar -1 " + payload + " REPLACE").rfind("-ERR Invalid TTL", 0), 0u);
+    EXPECT_EQ(run(handler, client, "RESTORE bar 0 nothex REPLACE").rfind("-ERR", 0), 0u);
+    EXPECT_EQ(run(handler, client, "CLUSTER SETSLOT 99999 STABLE"), "-ERR Invalid slot\r\n");
+}
+
+TEST(ClusterTest, test_cluster_commands_need_cluster_mode) {
+    HashTable ht(100);
+    CommandHandler handler(ht);
+    ClientState client;
+    EXPECT_EQ(run(handler, client, "CLUSTER KEYSLOT foo"), ":12182\r\n");
+    EXPECT_EQ(run(handler, client, "CLUSTER INFO").rfind("-ERR This instance has cluster support disabled", 0), 0u);
+    EXPECT_EQ(run(handler, client, "ASKING").rfind("-ERR", 0), 0u);
+    EXPECT_EQ(run(handler, client, "SET foo 1"), "+OK\r\n");
+}
+
+TEST(ClusterTest, test_remove_if_version_keeps_newer_writes) {
+    HashTable ht(100);
+    ht.set("k", Value(std::string("a")));
+    uint64_t version = ht.version("k");
+    ht.set("k", Value(std::string("b")));
+    EXPECT_FALSE(ht.remove_if_version("k", version));
+    EXPECT_TRUE(ht.contains("k"));
+    EXPECT_TRUE(ht.remove_if_version("k", ht.version("k")));
+    EXPECT_FALSE(ht.contains("k"));
+    EXPECT_FALSE(ht.remove_if_version("k", ht.version("k")));
+
+    for (int i = 0; i < 50; ++i) ht.set("k" + std::to_string(i), Value(std::string("v")));
+    auto evens = ht.keys_if([](const std::string& key) { return std::stoi(key.substr(1)) % 2 == 0; });
+    EXPECT_EQ(evens.size(), 25u);
+    EXPECT_EQ(ht.keys_if([](const std::string&) { return true; }, 7).size(), 7u);
+}
+
+TEST(ClusterTest, test_migration_gives_up_on_a_silent_target) {
+    // Connections to the target are accepted by the kernel but never read
+    boost::asio::io_context io;
+    boost::asio::ip::tcp::acceptor silent(io, {boost::asio::ip::make_address("127.0.0.1"), 0});
+    std::string target = "127.0.0.1:" + std::to_string(silent.local_endpoint().port());
+    ClusterState cluster("127.0.0.1:7000=0-8191 " + target + "=8192-16383", "127.0.0.1:7000");
+    HashTable ht(1000);
+    ht.set("bar", Value(std::string("v")));
+
+    SlotMigrator migrator(ht, cluster, 128, std::chrono::milliseconds(200));
+    auto started = std::chrono::steady_clock::now();
+    migrator.start(5061, target);
+    while (migrator.status().running && std::chrono::steady_clock::now() - started < std::chrono::seconds(5)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    auto status = migrator.status();
+    EXPECT_FALSE(status.running);
+    EXPECT_NE(status.error.find("did not answer"), std::string::npos) << status.error;
+    EXPECT_TRUE(ht.contains("bar"));
+}
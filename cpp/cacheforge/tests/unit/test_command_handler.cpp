@@ -0,0 +1,576 @@
+#include <gtest/gtest.h>
+#include "server/command_handler.h"
+#include "protocol/parser.h"
+#include "storage/hashtable.h"
+#include "storage/expiry.h"
+#include "server/tracking.h"
+#include <chrono>
+#include <future>
+#include <thread>
+
+using namespace cacheforge;
+
+namespace {
+
+std::string run(CommandHandler& handler, const std::string& line) {
+    Parser parser;
+    auto cmd = parser.parse_text(line);
+    EXPECT_TRUE(cmd.has_value()) << line;
+    return handler.execute(*cmd);
+}
+
+}  // namespace
+
+TEST(CommandHandlerTest, test_basic_string_commands) {
+    HashTable ht(100);
+    CommandHandler handler(ht);
+
+    EXPECT_EQ(run(handler, "PING"), "+PONG\r\n");
+    EXPECT_EQ(run(handler, "SET k v"), "+OK\r\n");
+    EXPECT_EQ(run(handler, "GET k"), "$1\r\nv\r\n");
+    EXPECT_EQ(run(handler, "DEL k missing"), ":1\r\n");
+    EXPECT_EQ(run(handler, "GET k"), "$-1\r\n");
+}
+
+TEST(CommandHandlerTest, test_unknown_command) {
+    HashTable ht(100);
+    CommandHandler handler(ht);
+    EXPECT_EQ(run(handler, "NOPE"), "-ERR unknown command 'NOPE'\r\n");
+}
+
+TEST(CommandHandlerTest, test_hset_hget_hmget) {
+    HashTable ht(100);
+    CommandHandler handler(ht);
+
+    EXPECT_EQ(run(handler, "HSET user:1 name alice age 30"), ":2\r\n");
+    EXPECT_EQ(run(handler, "HSET user:1 age 31"), ":0\r\n");
+    EXPECT_EQ(run(handler, "HGET user:1 age"), "$2\r\n31\r\n");
+    EXPECT_EQ(run(handler, "HGET user:1 nope"), "$-1\r\n");
+    EXPECT_EQ(run(handler, "HMGET user:1 name nope"), "*2\r\n$5\r\nalice\r\n$-1\r\n");
+    EXPECT_EQ(run(handler, "HINCRBY user:1 age 2"), ":33\r\n");
+    EXPECT_EQ(run(handler, "HINCRBY user:1 name 1"), "-ERR hash value is not an integer\r\n");
+}
+
+TEST(CommandHandlerTest, test_hash_updates_in_place) {
+    HashTable ht(100);
+    CommandHandler handler(ht);
+
+    run(handler, "HSET h f1 a");
+    run(handler, "HSET h f2 b");
+    auto v = ht.get("h");
+    ASSERT_TRUE(v.has_value());
+    EXPECT_EQ(v->type(), Value::Type::Hash);
+    EXPECT_EQ(v->as_hash().size(), 2u);
+    EXPECT_EQ(ht.size(), 1u);
+}
+
+TEST(CommandHandlerTest, test_wrong_type_errors) {
+    HashTable ht(100);
+    CommandHandler handler(ht);
+
+    run(handler, "SET plain v");
+    EXPECT_NE(run(handler, "HSET plain f v").find("WRONGTYPE"), std::string::npos);
+    EXPECT_NE(run(handler, "ZADD plain 1 m").find("WRONGTYPE"), std::string::npos);
+    run(handler, "HSET h f v");
+    EXPECT_NE(run(handler, "GET h").find("WRONGTYPE"), std::string::npos);
+}
+
+TEST(CommandHandlerTest, test_zadd_zrank_zrangebyscore) {
+    HashTable ht(100);
+    CommandHandler handler(ht);
+
+    EXPECT_EQ(run(handler, "ZADD board 10 alice 20 bob 15 carol"), ":3\r\n");
+    EXPECT_EQ(run(handler, "ZRANK board carol"), ":1\r\n");
+    EXPECT_EQ(run(handler, "ZRANK board nobody"), "$-1\r\n");
+    EXPECT_EQ(run(handler, "ZRANGEBYSCORE board 12 +inf"),
+              "*2\r\n$5\r\ncarol\r\n$3\r\nbob\r\n");
+    EXPECT_EQ(run(handler, "ZRANGEBYSCORE board (10 20 WITHSCORES LIMIT 0 1"),
+              "*2\r\n$5\r\ncarol\r\n$2\r\n15\r\n");
+    EXPECT_EQ(run(handler, "ZADD board notanumber x"), "-ERR value is not a valid float\r\n");
+}
+
+TEST(CommandHandlerTest, test_wrong_arity) {
+    HashTable ht(100);
+    CommandHandler handler(ht);
+    EXPECT_EQ(run(handler, "HSET h f"), "-ERR wrong number of arguments for 'hset' command\r\n");
+    EXPECT_FALSE(ht.contains("h"));
+}
+
+TEST(CommandHandlerTest, test_incr_decr_family) {
+    HashTable ht(100);
+    CommandHandler handler(ht);
+
+    EXPECT_EQ(run(handler, "INCR hits"), ":1\r\n");
+    EXPECT_EQ(run(handler, "INCRBY hits 41"), ":42\r\n");
+    EXPECT_EQ(run(handler, "DECR hits"), ":41\r\n");
+    EXPECT_EQ(run(handler, "DECRBY hits 50"), ":-9\r\n");
+    EXPECT_EQ(run(handler, "GET hits"), "$2\r\n-9\r\n");
+    EXPECT_EQ(ht.get("hits")->type(), Value::Type::Integer);
+}
+
+TEST(CommandHandlerTest, test_incr_converts_numeric_string) {
+    HashTable ht(100);
+    CommandHandler handler(ht);
+
+    run(handler, "SET n 100");
+    EXPECT_EQ(run(handler, "INCR n"), ":101\r\n");
+    EXPECT_EQ(ht.get("n")->type(), Value::Type::Integer);
+
+    run(handler, "SET s 12abc");
+    EXPECT_EQ(run(handler, "INCR s"), "-ERR value is not an integer or out of range\r\n");
+    EXPECT_EQ(ht.get("s")->as_string(), "12abc");
+
+    run(handler, "HSET h f v");
+    EXPECT_NE(run(handler, "INCR h").find("WRONGTYPE"), std::string::npos);
+}
+
+TEST(CommandHandlerTest, test_incr_overflow_rejected) {
+    HashTable ht(100);
+    CommandHandler handler(ht);
+
+    run(handler, "SET max " + std::to_string(INT64_MAX));
+    EXPECT_EQ(run(handler, "INCR max"), "-ERR increment or decrement would overflow\r\n");
+    EXPECT_EQ(run(handler, "GET max"), "$19\r\n" + std::to_string(INT64_MAX) + "\r\n");
+}
+
+TEST(CommandHandlerTest, test_incrbyfloat) {
+    HashTable ht(100);
+    CommandHandler handler(ht);
+
+    EXPECT_EQ(run(handler, "INCRBYFLOAT f 1.5"), "$3\r\n1.5\r\n");
+    run(handler, "INCR i");
+    EXPECT_EQ(run(handler, "INCRBYFLOAT i 0.25"), "$4\r\n1.25\r\n");
+    EXPECT_EQ(run(handler, "INCRBYFLOAT f abc"), "-ERR value is not a valid float\r\n");
+}
+
+TEST(CommandHandlerTest, test_client_tracking_invalidates_readers) {
+    HashTable ht(100);
+    CommandHandler handler(ht);
+    std::vector<std::pair<uint64_t, std::string>> pushes;
+    handler.set_push_callback([&](uint64_t id, const std::shared_ptr<const std::string>& msg) {
+        pushes.emplace_back(id, *msg);
+    });
+
+    Parser parser;
+    ClientState reader{1, false};
+    ClientState writer{2, false};
+    EXPECT_EQ(handler.execute(*parser.parse_text("CLIENT TRACKING ON"), reader), "+OK\r\n");
+    handler.execute(*parser.parse_text("SET k v"), writer);
+    handler.execute(*parser.parse_text("GET k"), reader);
+    handler.execute(*parser.parse_text("GET other"), writer);
+    EXPECT_EQ(handler.tracking().tracked_keys(), 1u);
+
+    handler.execute(*parser.parse_text("SET k v2"), writer);
+    handler.execute(*parser.parse_text("DEL k"), writer);
+    handler.flush_invalidations();
+
+    ASSERT_EQ(pushes.size(), 1u);
+    EXPECT_EQ(pushes[0].first, 1u);
+    EXPECT_EQ(pushes[0].second, ">2\r\n$10\r\ninvalidate\r\n*1\r\n$1\r\nk\r\n");
+    EXPECT_EQ(handler.tracking().tracked_keys(), 0u);
+}
+
+TEST(CommandHandlerTest, test_failed_writes_keep_tracking_and_watch) {
+    HashTable ht(100);
+    CommandHandler handler(ht);
+    int pushes = 0;
+    handler.set_push_callback([&](uint64_t, const std::shared_ptr<const std::string>&) { ++pushes; });
+
+    Parser parser;
+    ClientState reader{1, false};
+    ClientState writer{2, false};
+    handler.execute(*parser.parse_text("SET k v"), writer);
+    handler.execute(*parser.parse_text("CLIENT TRACKING ON"), reader);
+    handler.execute(*parser.parse_text("GET k"), reader);
+    uint64_t version = ht.version("k");
+
+    // Refused writes change nothing, so the reader's copy stays valid
+    EXPECT_NE(handler.execute(*parser.parse_text("HSET k f v"), writer).find("WRONGTYPE"), std::string::npos);
+    EXPECT_EQ(handler.execute(*parser.parse_text("INCR k"), writer)[0], '-');
+    handler.flush_invalidations();
+    EXPECT_EQ(pushes, 0);
+    EXPECT_EQ(handler.tracking().tracked_keys(), 1u);
+    EXPECT_EQ(ht.version("k"), version);
+
+    handler.execute(*parser.parse_text("SET k v2"), writer);
+    handler.flush_invalidations();
+    EXPECT_EQ(pushes, 1);
+}
+
+TEST(CommandHandlerTest, test_client_tracking_off_stops_notifications) {
+    HashTable ht(100);
+    CommandHandler handler(ht);
+    int pushes = 0;
+    handler.set_push_callback([&](uint64_t, const std::shared_ptr<const std::string>&) { pushes++; });
+
+    Parser parser;
+    ClientState reader{7, false};
+    handler.execute(*parser.parse_text("CLIENT TRACKING ON"), reader);
+    handler.execute(*parser.parse_text("HGET h f"), reader);
+    EXPECT_NE(run(handler, "INFO clients").find("tracking_clients:1\r\n"), std::string::npos);
+    handler.execute(*parser.parse_text("CLIENT TRACKING OFF"), reader);
+    EXPECT_NE(run(handler, "INFO clients").find("tracking_clients:0\r\n"), std::string::npos);
+    run(handler, "HSET h f v");
+    handler.flush_invalidations();
+    EXPECT_EQ(pushes, 0);
+    EXPECT_EQ(handler.execute(*parser.parse_text("CLIENT ID"), reader), ":7\r\n");
+}
+
+TEST(CommandHandlerTest, test_tracking_table_is_bounded) {
+    TrackingTable table(2);
+    table.track("a", 1);
+    table.track("b", 1);
+    table.track("c", 2);
+    EXPECT_EQ(table.tracked_keys(), 2u);
+
+    // The dropped key's reader is invalidated rather than silently forgotten
+    auto pending = table.drain();
+    ASSERT_EQ(pending.size(), 1u);
+    EXPECT_EQ(pending.begin()->first, 1u);
+    EXPECT_EQ(pending.begin()->second.size(), 1u);
+}
+
+TEST(CommandHandlerTest, test_tracking_table_spans_shards) {
+    TrackingTable table(1000);
+    for (int i = 0; i < 200; ++i) table.track("k" + std::to_string(i), i % 3);
+    EXPECT_EQ(table.tracked_keys(), 200u);
+    for (int i = 0; i < 200; i += 2) table.invalidate("k" + std::to_string(i));
+    EXPECT_EQ(table.tracked_keys(), 100u);
+    size_t keys = 0;
+    for (const auto& [id, invalidated] : table.drain()) keys += invalidated.size();
+    EXPECT_EQ(keys, 100u);
+    EXPECT_TRUE(table.drain().empty());
+
+    table.add_client();
+    EXPECT_EQ(table.clients(), 1u);
+    table.forget_client(1);
+    EXPECT_EQ(table.clients(), 0u);
+    EXPECT_EQ(table.tracked_keys(), 66u);  // the odd keys of clients 0 and 2
+}
+
+TEST(CommandHandlerTest, test_expire_ttl_and_lazy_expiry) {
+    HashTable ht(100);
+    ExpiryManager expiry;
+    CommandHandler handler(ht, &expiry);
+
+    EXPECT_EQ(run(handler, "TTL k"), ":-2\r\n");
+    run(handler, "SET k v");
+    EXPECT_EQ(run(handler, "TTL k"), ":-1\r\n");
+    EXPECT_EQ(run(handler, "EXPIRE k 100"), ":1\r\n");
+    EXPECT_EQ(run(handler, "TTL k"), ":99\r\n");
+    EXPECT_EQ(run(handler, "EXPIRE k 0"), "-ERR invalid expire time in 'expire' command\r\n");
+    run(handler, "SET k v");
+    EXPECT_EQ(run(handler, "TTL k"), ":-1\r\n");
+
+    EXPECT_EQ(run(handler, "SET t v EX 1"), "+OK\r\n");
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+    EXPECT_EQ(run(handler, "GET t"), "$-1\r\n");
+    EXPECT_FALSE(ht.contains("t"));
+}
+
+namespace {
+
+std::string run(CommandHandler& handler, ClientState& client, const std::string& line) {
+    Parser parser;
+    auto cmd = parser.parse_text(line);
+    EXPECT_TRUE(cmd.has_value()) << line;
+    return handler.execute(*cmd, client);
+}
+
+}  // namespace
+
+TEST(CommandHandlerTest, test_multi_exec_queues_and_runs) {
+    HashTable ht(100);
+    CommandHandler handler(ht);
+    ClientState client;
+
+    EXPECT_EQ(run(handler, client, "EXEC"), "-ERR EXEC without MULTI\r\n");
+    EXPECT_EQ(run(handler, client, "MULTI"), "+OK\r\n");
+    EXPECT_EQ(run(handler, client, "MULTI"), "-ERR MULTI calls can not be nested\r\n");
+    EXPECT_EQ(run(handler, client, "SET k 1"), "+QUEUED\r\n");
+    EXPECT_EQ(run(handler, client, "INCR k"), "+QUEUED\r\n");
+    EXPECT_EQ(run(handler, client, "HGET k f"), "+QUEUED\r\n");
+    EXPECT_FALSE(ht.contains("k"));  // nothing runs before EXEC
+
+    // Runtime errors are reported per command and do not roll back
+    EXPECT_EQ(run(handler, client, "EXEC"),
+              "*3\r\n+OK\r\n:2\r\n-ERR WRONGTYPE Operation against a key holding the wrong kind of value\r\n");
+    EXPECT_EQ(run(handler, client, "GET k"), "$1\r\n2\r\n");
+}
+
+TEST(CommandHandlerTest, test_multi_discard_and_queue_errors) {
+    HashTable ht(100);
+    CommandHandler handler(ht);
+    ClientState client;
+
+    EXPECT_EQ(run(handler, client, "DISCARD"), "-ERR DISCARD without MULTI\r\n");
+    run(handler, client, "MULTI");
+    run(handler, client, "SET k v");
+    EXPECT_EQ(run(handler, client, "DISCARD"), "+OK\r\n");
+    EXPECT_FALSE(ht.contains("k"));
+
+    run(handler, client, "MULTI");
+    run(handler, client, "SET k v");
+    EXPECT_EQ(run(handler, client, "NOPE"), "-ERR unknown command 'NOPE'\r\n");
+    EXPECT_EQ(run(handler, client, "EXEC"),
+              "-ERR EXECABORT Transaction discarded because of previous errors.\r\n");
+    EXPECT_FALSE(ht.contains("k"));
+    EXPECT_FALSE(client.in_multi);
+}
+
+TEST(CommandHandlerTest, test_exec_locks_whole_table_only_for_table_commands) {
+    HashTable ht(100);
+    CommandHandler handler(ht);
+    ClientState client;
+
+    // Another thread holds one shard until told to let go
+    std::promise<void> held, release;
+    std::thread holder([&]() {
+        auto locked = ht.lock_shards(std::vector<std::string>{"busy"});
+        held.set_value();
+        release.get_future().wait();
+    });
+    held.get_future().wait();
+
+    // Keyless commands that never read the table run past it
+    run(handler, client, "MULTI");
+    run(handler, client, "PING");
+    run(handler, client, "PUBLISH ch m");
+    auto exec = std::async(std::launch::async, [&]() { return run(handler, client, "EXEC"); });
+    ASSERT_EQ(exec.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+    EXPECT_EQ(exec.get(), "*2\r\n+PONG\r\n:0\r\n");
+
+    // KEYS scans every shard, so its transaction waits for the held one
+    run(handler, client, "MULTI");
+    run(handler, client, "KEYS *");
+    exec = std::async(std::launch::async, [&]() { return run(handler, client, "EXEC"); });
+    EXPECT_EQ(exec.wait_for(std::chrono::milliseconds(100)), std::future_status::timeout);
+    release.set_value();
+    holder.join();
+    EXPECT_EQ(exec.get(), "*1\r\n*0\r\n");
+}
+
+TEST(CommandHandlerTest, test_watch_aborts_exec_after_concurrent_write) {
+    HashTable ht(100);
+    CommandHandler handler(ht);
+    ClientState client;
+    ClientState other;
+    other.id = 2;
+
+    run(handler, client, "SET k 1");
+    EXPECT_EQ(run(handler, client, "WATCH k"), "+OK\r\n");
+    run(handler, client, "MULTI");
+    EXPECT_EQ(run(handler, client, "WATCH k"), "-ERR WATCH inside MULTI is not allowed\r\n");
+    run(handler, client, "SET k 10");
+    run(handler, other, "SET k 5");
+    EXPECT_EQ(run(handler, client, "EXEC"), "*-1\r\n");
+    EXPECT_EQ(run(handler, client, "GET k"), "$1\r\n5\r\n");
+
+    // EXEC clears the watch list, so the retry succeeds
+    run(handler, client, "MULTI");
+    run(handler, client, "SET k 10");
+    EXPECT_EQ(run(handler, client, "EXEC"), "*1\r\n+OK\r\n");
+
+    // Reads and UNWATCH do not abort
+    run(handler, client, "WATCH k");
+    run(handler, other, "GET k");
+    run(handler, client, "MULTI");
+    run(handler, client, "INCR k");
+    EXPECT_EQ(run(handler, client, "EXEC"), "*1\r\n:11\r\n");
+    run(handler, client, "WATCH k");
+    run(handler, other, "SET k 0");
+    EXPECT_EQ(run(handler, client, "UNWATCH"), "+OK\r\n");
+    run(handler, client, "MULTI");
+    run(handler, client, "INCR k");
+    EXPECT_EQ(run(handler, client, "EXEC"), "*1\r\n:1\r\n");
+}
+
+TEST(CommandHandlerTest, test_watched_counter_has_no_lost_updates) {
+    HashTable ht(1000);
+    CommandHandler handler(ht);
+    constexpr int kThreads = 4;
+    constexpr int kIncrements = 200;
+
+    auto worker = [&](uint64_t id) {
+        ClientState client;
+        client.id = id;
+        for (int done = 0; done < kIncrements;) {
+            run(handler, client, "WATCH counter");
+            auto current = run(handler, client, "GET counter");
+            int64_t value = 0;
+            if (current != "$-1\r\n") value = std::stoll(current.substr(current.find("\r\n") + 2));
+            run(handler, client, "MULTI");
+            run(handler, client, "SET counter " + std::to_string(value + 1));
+            // A concurrent EXEC aborts this one; retry until it commits
+            if (run(handler, client, "EXEC") != "*-1\r\n") ++done;
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int i = 0; i < kThreads; ++i) threads.emplace_back(worker, i + 1);
+    for (auto& t : threads) t.join();
+    EXPECT_EQ(run(handler, "GET counter"), "$3\r\n800\r\n");
+}
+
+TEST(CommandHandlerTest, test_loading_serves_only_loaded_keys) {
+    HashTable ht(100);
+    CommandHandler handler(ht);
+    LoadProgress progress;
+    handler.set_load_progress(&progress);
+    progress.loading.store(true);
+    ht.set("loaded", Value(std::string("v")));
+
+    EXPECT_EQ(run(handler, "GET loaded"), "$1\r\nv\r\n");
+    EXPECT_EQ(run(handler, "GET pending").rfind("-LOADING", 0), 0u);
+    EXPECT_EQ(run(handler, "SET loaded w").rfind("-LOADING", 0), 0u);
+    EXPECT_EQ(run(handler, "PING"), "+PONG\r\n");
+    EXPECT_NE(run(handler, "INFO persistence").find("loading:1"), std::string::npos);
+
+    progress.loading.store(false);
+    EXPECT_EQ(run(handler, "GET pending"), "$-1\r\n");
+    EXPECT_EQ(run(handler, "SET loaded w"), "+OK\r\n");
+    EXPECT_NE(run(handler, "INFO persistence").find("loading:0"), std::string::npos);
+}
+
+namespace {
+
+std::string frames(const std::vector<std::string>& lines) {
+    Parser parser;
+    std::string out;
+    for (const auto& line : lines) out += Parser::serialize_raw(*parser.parse_text(line));
+    return out;
+}
+
+}  // namespace
+
+TEST(CommandHandlerTest, test_bulk_load_applies_writes) {
+    HashTable ht(1000);
+    ExpiryManager expiry(ht);
+    CommandHandler handler(ht, &expiry);
+    ClientState client;
+
+    std::vector<std::string> lines;
+    for (size_t i = 0; i < CommandHandler::kBulkBatch * 2 + 10; ++i) {
+        lines.push_back("SET key:" + std::to_string(i) + " " + std::to_string(i));
+    }
+    lines.push_back("HSET h f v");
+    lines.push_back("INCR key:3");
+    lines.push_back("EXPIRE key:4 100");
+    EXPECT_EQ(handler.bulk_load(frames(lines), client), "*3\r\n:525\r\n:0\r\n$-1\r\n");
+    EXPECT_EQ(run(handler, "GET key:521"), "$3\r\n521\r\n");
+    EXPECT_EQ(run(handler, "GET key:3"), "$1\r\n4\r\n");
+    EXPECT_EQ(run(handler, "HGET h f"), "$1\r\nv\r\n");
+    EXPECT_EQ(run(handler, "TTL key:4"), ":99\r\n");
+
+    // Failures are counted, the rest still applies
+    auto reply = handler.bulk_load(frames({"GET key:1", "INCR h", "SET ok 1"}), client);
+    EXPECT_EQ(reply.rfind("*3\r\n:1\r\n:2\r\n$", 0), 0u);
+    EXPECT_NE(reply.find("BULKLOAD accepts write commands only, got 'GET'"), std::string::npos);
+    EXPECT_EQ(run(handler, "GET ok"), "$1\r\n1\r\n");
+
+    // A truncated frame ends the payload
+    auto cut = frames({"SET a 1", "SET b 2"});
+    cut.pop_back();
+    EXPECT_EQ(handler.bulk_load(cut, client), "*3\r\n:1\r\n:1\r\n$26\r\ntruncated frame at byte 21\r\n");
+    EXPECT_FALSE(ht.contains("b"));
+}
+
+TEST(CommandHandlerTest, test_bulkdump_round_trips_through_bulk_load) {
+    HashTable ht(1000);
+    ExpiryManager expiry(ht);
+    CommandHandler handler(ht, &expiry);
+    for (int i = 0; i < 200; ++i) run(handler, "SET key:" + std::to_string(i) + " " + std::to_string(i));
+    run(handler, "HSET h f v");
+    run(handler, "ZADD z 1.5 m");
+    run(handler, "EXPIRE key:7 100");
+
+    // Page through every shard the way cacheforge-import --export does
+    std::string dump;
+    int64_t cursor = 0;
+    size_t pages = 0;
+    do {
+        auto reply = run(handler, "BULKDUMP " + std::to_string(cursor) + " COUNT 5");
+        ASSERT_EQ(reply.substr(0, 5), "*2\r\n$");
+        size_t pos = reply.find("\r\n", 4) + 2;
+        size_t end = reply.find("\r\n", pos);
+        cursor = std::stoll(reply.substr(pos, end - pos));
+        pos = end + 2;
+        end = reply.find("\r\n", pos);
+        size_t length = std::stoul(reply.substr(pos + 1, end - pos - 1));
+        dump += reply.substr(end + 2, length);
+        ++pages;
+    } while (cursor != 0);
+    // Pages end at COUNT keys rather than at shard boundaries
+    EXPECT_GE(pages, 202u / 10);
+    EXPECT_LE(pages, 202u / 5 + 1);
+    EXPECT_EQ(run(handler, "BULKDUMP -1"), "-ERR invalid cursor\r\n");
+    EXPECT_EQ(run(handler, "BULKDUMP 0 COUNT 0"), "-ERR value is not an integer or out of range\r\n");
+    EXPECT_EQ(run(handler, "BULKDUMP 0 LIMIT 5"), "-ERR syntax error\r\n");
+
+    HashTable copy_table(1000);
+    ExpiryManager copy_expiry(copy_table);
+    CommandHandler copy(copy_table, &copy_expiry);
+    ClientState client;
+    EXPECT_EQ(copy.bulk_load(dump, client), "*3\r\n:202\r\n:0\r\n$-1\r\n");
+    EXPECT_EQ(copy_table.size(), 202u);
+    EXPECT_EQ(run(copy, "GET key:199"), "$3\r\n199\r\n");
+    EXPECT_EQ(run(copy, "HGET h f"), "$1\r\nv\r\n");
+    EXPECT_EQ(run(copy, "ZRANGEBYSCORE z 1 2"), "*1\r\n$1\r\nm\r\n");
+    auto ttl = std::stoll(run(copy, "TTL key:7").substr(1));
+    EXPECT_GE(ttl, 99);
+    EXPECT_LE(ttl, 100);
+    EXPECT_EQ(run(copy, "TTL key:8"), ":-1\r\n");
+}
+
+TEST(CommandHandlerTest, test_pfadd_pfcount_pfmerge) {
+    HashTable ht(100);
+    CommandHandler handler(ht);
+
+    EXPECT_EQ(run(handler, "PFCOUNT visitors"), ":0\r\n");
+    EXPECT_EQ(run(handler, "PFADD visitors a b c"), ":1\r\n");
+    EXPECT_EQ(run(handler, "PFADD visitors a b"), ":0\r\n");
+    EXPECT_EQ(run(handler, "PFCOUNT visitors"), ":3\r\n");
+    EXPECT_EQ(run(handler, "PFADD empty"), ":1\r\n");
+    EXPECT_EQ(run(handler, "PFCOUNT empty"), ":0\r\n");
+
+    run(handler, "PFADD other c d e");
+    EXPECT_EQ(run(handler, "PFCOUNT visitors other"), ":5\r\n");
+    EXPECT_EQ(run(handler, "PFMERGE all visitors other"), "+OK\r\n");
+    EXPECT_EQ(run(handler, "PFCOUNT all"), ":5\r\n");
+    // The destination's registers are kept
+    run(handler, "PFADD all f");
+    EXPECT_EQ(run(handler, "PFMERGE all other"), "+OK\r\n");
+    EXPECT_EQ(run(handler, "PFCOUNT all"), ":6\r\n");
+
+    run(handler, "SET s v");
+    EXPECT_EQ(run(handler, "PFADD s x").rfind("-ERR WRONGTYPE", 0), 0u);
+    EXPECT_EQ(run(handler, "PFCOUNT visitors s").rfind("-ERR WRONGTYPE", 0), 0u);
+    EXPECT_EQ(run(handler, "PFMERGE s visitors").rfind("-ERR WRONGTYPE", 0), 0u);
+    EXPECT_EQ(run(handler, "GET visitors").rfind("-ERR WRONGTYPE", 0), 0u);
+}
+
+TEST(CommandHandlerTest, test_bloom_filter_commands) {
+    HashTable ht(100);
+    CommandHandler handler(ht);
+
+    EXPECT_EQ(run(handler, "BF.EXISTS seen a"), ":0\r\n");
+    EXPECT_EQ(run(handler, "BF.ADD seen a"), ":1\r\n");
+    EXPECT_EQ(run(handler, "BF.ADD seen a"), ":0\r\n");
+    EXPECT_EQ(run(handler, "BF.EXISTS seen a"), ":1\r\n");
+    EXPECT_EQ(run(handler, "BF.MADD seen a b c"), "*3\r\n:0\r\n:1\r\n:1\r\n");
+    EXPECT_EQ(run(handler, "BF.MEXISTS seen a c zzz"), "*3\r\n:1\r\n:1\r\n:0\r\n");
+
+    EXPECT_EQ(run(handler, "BF.RESERVE tight 0.001 1000"), "+OK\r\n");
+    EXPECT_EQ(run(handler, "BF.RESERVE tight 0.001 1000"), "-ERR item exists\r\n");
+    EXPECT_EQ(run(handler, "BF.RESERVE bad 1.5 1000").rfind("-ERR error rate", 0), 0u);
+    EXPECT_EQ(run(handler, "BF.RESERVE bad 0.01 0").rfind("-ERR capacity", 0), 0u);
+    EXPECT_FALSE(ht.contains("bad"));
+    auto info = run(handler, "BF.INFO tight");
+    EXPECT_NE(info.find("$8\r\nCapacity\r\n:1000\r\n"), std::string::npos);
+    EXPECT_NE(info.find("$5\r\n0.001\r\n"), std::string::npos);
+    EXPECT_EQ(run(handler, "BF.INFO missing"), "-ERR not found\r\n");
+
+    run(handler, "SET s v");
+    EXPECT_EQ(run(handler, "BF.ADD s x").rfind("-ERR WRONGTYPE", 0), 0u);
+    EXPECT_EQ(run(handler, "BF.EXISTS s x").rfind("-ERR WRONGTYPE", 0), 0u);
+    EXPECT_EQ(run(handler, "BF.ADD seen").rfind("-ERR wrong number", 0), 0u);
+}
@@ -0,0 +1,160 @@
+#include <gtest/gtest.h>
+#include "utils/lz4.h"
+#include "data/value.h"
+#include "storage/hashtable.h"
+#include "persistence/snapshot.h"
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+using namespace cacheforge;
+
+namespace {
+
+std::string json_payload(size_t size) {
+    std::string s = "[";
+    for (int i = 0; s.size() < size; ++i) {
+        s += "{\"id\":" + std::to_string(i) + ",\"name\":\"user-" + std::to_string(i % 97) +
+             "\",\"active\":true,\"tags\":[\"a\",\"b\"]},";
+    }
+    s.resize(size);
+    return s;
+}
+
+std::string random_bytes(size_t size, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    std::string s(size, '\0');
+    for (auto& c : s) c = static_cast<char>(rng());
+    return s;
+}
+
+std::string round_trip(const std::string& input) {
+    std::string block = lz4::compress(input);
+    std::string out(input.size(), '\0');
+    EXPECT_TRUE(lz4::decompress(block, out.data(), out.size()));
+    return out;
+}
+
+}  // namespace
+
+TEST(CompressionTest, test_lz4_round_trip) {
+    for (size_t size : {0, 1, 12, 13, 64, 1000, 70000}) {
+        auto json = json_payload(size);
+        EXPECT_EQ(round_trip(json), json) << size;
+        auto noise = random_bytes(size, size);
+        EXPECT_EQ(round_trip(noise), noise) << size;
+    }
+    // Long runs produce overlapping matches and multi-byte lengths
+    std::string run(100000, 'a');
+    EXPECT_EQ(round_trip(run), run);
+    EXPECT_LT(lz4::compress(run).size(), 1000u);
+    EXPECT_LT(lz4::compress(json_payload(8192)).size(), 8192u / 4);
+}
+
+TEST(CompressionTest, test_lz4_rejects_malformed_blocks) {
+    auto input = json_payload(4096);
+    auto block = lz4::compress(input);
+    std::string out(input.size(), '\0');
+    EXPECT_FALSE(lz4::decompress(block, out.data(), out.size() - 1));
+    EXPECT_FALSE(lz4::decompress(block.substr(0, block.size() / 2), out.data(), out.size()));
+    // An offset pointing before the start of the output
+    const std::string bad_offset("\x10" "a" "\x05\x00", 4);
+    EXPECT_FALSE(lz4::decompress(bad_offset, out.data(), 5));
+    // Random garbage never reads or writes out of bounds
+    for (uint64_t seed = 0; seed < 200; ++seed) {
+        auto garbage = random_bytes(64, seed);
+        lz4::decompress(garbage, out.data(), 256);
+    }
+}
+
+TEST(CompressionTest, test_value_compression) {
+    Value json(json_payload(4096));
+    auto packed = json.compressed(1024);
+    ASSERT_TRUE(packed.has_value());
+    EXPECT_TRUE(packed->is_compressed());
+    EXPECT_EQ(packed->type(), Value::Type::String);
+    EXPECT_LT(packed->memory_size(), json.memory_size() / 4);
+    EXPECT_EQ(packed->decompressed(), json);
+
+    auto bytes = json_payload(2048);
+    Value binary(std::vector<uint8_t>(bytes.begin(), bytes.end()));
+    auto packed_binary = binary.compressed(1024);
+    ASSERT_TRUE(packed_binary.has_value());
+    EXPECT_EQ(packed_binary->type(), Value::Type::Binary);
+    EXPECT_EQ(packed_binary->decompressed(), binary);
+
+    // Below the threshold, incompressible, or not a string: left alone
+    EXPECT_FALSE(Value(json_payload(512)).compressed(1024).has_value());
+    EXPECT_FALSE(Value(random_bytes(4096, 1)).compressed(1024).has_value());
+    EXPECT_FALSE(Value(int64_t{42}).compressed(0).has_value());
+
+    // encode() ships the compressed bytes; decode() takes them back as-is
+    auto encoded = packed->encode();
+    EXPECT_EQ(encoded.size(), packed->memory_size() - sizeof(Value));
+    auto decoded = Value::decode(Value::Type::String, encoded, true);
+    EXPECT_TRUE(decoded.is_compressed());
+    EXPECT_EQ(decoded.decompressed(), json);
+    EXPECT_THROW(Value::decode(Value::Type::String, "ab", true), std::runtime_error);
+}
+
+TEST(CompressionTest, test_hashtable_is_transparent) {
+    HashTable ht;
+    ht.set_compression(1024);
+    auto payload = json_payload(8192);
+    ht.set("doc", Value(payload));
+    ht.set("small", Value(std::string("tiny")));
+    EXPECT_EQ(ht.compressed_count(), 1u);
+    EXPECT_EQ(ht.get("doc")->as_string(), payload);
+    EXPECT_TRUE(ht.view("doc", [&](const Value& v) { EXPECT_EQ(v.as_string(), payload); }));
+    EXPECT_TRUE(ht.get_raw("doc")->is_compressed());
+    EXPECT_LT(*ht.resident_size("doc"), payload.size() / 4);
+
+    // Writers see the plain value; the result is compressed again
+    ht.update("doc", [&](Value& v, bool) {
+        EXPECT_FALSE(v.is_compressed());
+        v = Value(v.as_string() + payload);
+        return true;
+    });
+    EXPECT_EQ(ht.compressed_count(), 1u);
+    // One that changes nothing leaves the stored, compressed value as it was
+    ht.update("doc", [&](Value& v, bool) {
+        EXPECT_FALSE(v.is_compressed());
+        return false;
+    });
+    EXPECT_TRUE(ht.get_raw("doc")->is_compressed());
+    EXPECT_EQ(ht.compressed_count(), 1u);
+    EXPECT_EQ(ht.get("doc")->as_string(), payload + payload);
+
+    ht.set("doc", Value(std::string("short now")));
+    EXPECT_EQ(ht.compressed_count(), 0u);
+    ht.set("doc", Value(payload));
+    ht.remove("doc");
+    EXPECT_EQ(ht.compressed_count(), 0u);
+}
+
+TEST(CompressionTest, test_snapshot_keeps_compressed_bytes) {
+    auto dir = (std::filesystem::temp_directory_path() /
+                ("cacheforge_compression_" + std::to_string(::getpid()))).string();
+    std::filesystem::remove_all(dir);
+    auto payload = json_payload(8192);
+    {
+        HashTable ht;
+        ht.set_compression(1024);
+        ht.set("doc", Value(payload));
+        SnapshotManager snapshots(dir);
+        ASSERT_TRUE(snapshots.save_snapshot({{"doc", *ht.get_raw("doc"), -1}}));
+    }
+    SnapshotManager snapshots(dir);
+    std::vector<SnapshotEntry> entries;
+    ASSERT_TRUE(snapshots.load_snapshot(entries));
+    ASSERT_EQ(entries.size(), 1u);
+    EXPECT_TRUE(entries[0].value.is_compressed());
+
+    // Loading into a table without compression still reads back plainly
+    HashTable ht;
+    ht.set(entries[0].key, entries[0].value);
+    EXPECT_EQ(ht.get("doc")->as_string(), payload);
+    std::filesystem::remove_all(dir);
+}
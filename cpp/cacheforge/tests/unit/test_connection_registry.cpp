@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+#include "server/connection_registry.h"
+#include "server/connection.h"
+#include <thread>
+
+using namespace cacheforge;
+
+namespace {
+
+// Unstarted connections report inactive, which is all the registry looks at
+std::shared_ptr<Connection> make_connection(boost::asio::io_context& io, uint64_t id) {
+    return std::make_shared<Connection>(boost::asio::ip::tcp::socket(io), nullptr, id);
+}
+
+}  // namespace
+
+TEST(ConnectionRegistryTest, test_add_find_remove) {
+    boost::asio::io_context io;
+    ConnectionRegistry registry(4);
+    for (uint64_t id = 1; id <= 100; ++id) registry.add(id, make_connection(io, id));
+    EXPECT_EQ(registry.size(), 100u);
+
+    auto conn = registry.find(42);
+    ASSERT_NE(conn, nullptr);
+    EXPECT_EQ(conn->id(), 42u);
+    EXPECT_EQ(registry.find(1000), nullptr);
+
+    EXPECT_TRUE(registry.remove(42));
+    EXPECT_FALSE(registry.remove(42));
+    EXPECT_EQ(registry.find(42), nullptr);
+    EXPECT_EQ(registry.size(), 99u);
+
+    size_t seen = 0;
+    registry.for_each([&](const std::shared_ptr<Connection>&) { seen++; });
+    EXPECT_EQ(seen, 99u);
+}
+
+TEST(ConnectionRegistryTest, test_shard_count_rounds_to_power_of_two) {
+    EXPECT_EQ(ConnectionRegistry(5).shard_count(), 8u);
+    EXPECT_EQ(ConnectionRegistry(0).shard_count(), 1u);
+
+    boost::asio::io_context io;
+    ConnectionRegistry registry(8);
+    for (uint64_t id = 0; id < 64; ++id) registry.add(id, make_connection(io, id));
+    size_t total = 0;
+    for (size_t i = 0; i < registry.shard_count(); ++i) {
+        size_t n = registry.shard_snapshot(i).size();
+        EXPECT_EQ(n, 8u);  // sequential ids spread evenly
+        total += n;
+    }
+    EXPECT_EQ(total, 64u);
+}
+
+TEST(ConnectionRegistryTest, test_reap_drops_inactive) {
+    boost::asio::io_context io;
+    ConnectionRegistry registry;
+    registry.add(1, make_connection(io, 1));
+    registry.add(2, nullptr);
+    EXPECT_EQ(registry.reap(), 2u);
+    EXPECT_EQ(registry.size(), 0u);
+}
+
+TEST(ConnectionRegistryTest, test_concurrent_add_remove) {
+    boost::asio::io_context io;
+    ConnectionRegistry registry(16);
+    std::vector<std::thread> threads;
+    for (uint64_t t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t]() {
+            for (uint64_t i = 0; i < 2000; ++i) {
+                uint64_t id = t * 100000 + i;
+                registry.add(id, make_connection(io, id));
+                if (i % 2 == 0) registry.remove(id);
+            }
+        });
+    }
+    for (auto& th : threads) th.join();
+    EXPECT_EQ(registry.size(), 4000u);
+}
@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+#include "utils/cpu.h"
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+using namespace cacheforge;
+
+namespace {
+
+std::string temp_dir(const std::string& name) {
+    auto dir = std::filesystem::temp_directory_path() /
+               ("cacheforge_" + name + "_" + std::to_string(::getpid()));
+    std::filesystem::remove_all(dir);
+    return dir.string();
+}
+
+void write_file(const std::string& path, const std::string& contents) {
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path());
+    std::ofstream(path) << contents;
+}
+
+}  // namespace
+
+TEST(CpuTest, test_parse_list) {
+    EXPECT_TRUE(cpu::parse_list("").empty());
+    EXPECT_EQ(cpu::parse_list("3"), std::vector<int>({3}));
+    EXPECT_EQ(cpu::parse_list("0-3,8,10-11"), std::vector<int>({0, 1, 2, 3, 8, 10, 11}));
+    EXPECT_EQ(cpu::parse_list("5,1-2,2"), std::vector<int>({1, 2, 5}));
+    EXPECT_THROW(cpu::parse_list("a"), std::runtime_error);
+    EXPECT_THROW(cpu::parse_list("3-1"), std::runtime_error);
+    EXPECT_THROW(cpu::parse_list("1,,2"), std::runtime_error);
+    EXPECT_THROW(cpu::parse_list("-1"), std::runtime_error);
+    EXPECT_THROW(cpu::parse_list("99999"), std::runtime_error);
+}
+
+TEST(CpuTest, test_cgroup_v2_quota) {
+    auto root = temp_dir("cgroup_v2");
+    write_file(root + "/proc_cgroup", "0::/app.slice/cache.service\n");
+    EXPECT_FALSE(cpu::cgroup_quota(root, root + "/proc_cgroup").has_value());
+
+    write_file(root + "/app.slice/cache.service/cpu.max", "max 100000\n");
+    EXPECT_FALSE(cpu::cgroup_quota(root, root + "/proc_cgroup").has_value());
+    write_file(root + "/app.slice/cache.service/cpu.max", "150000 100000\n");
+    EXPECT_DOUBLE_EQ(*cpu::cgroup_quota(root, root + "/proc_cgroup"), 1.5);
+
+    // Inside a container the cgroup is the mount root
+    write_file(root + "/proc_cgroup", "0::/\n");
+    write_file(root + "/cpu.max", "50000 100000\n");
+    EXPECT_DOUBLE_EQ(*cpu::cgroup_quota(root, root + "/proc_cgroup"), 0.5);
+    std::filesystem::remove_all(root);
+}
+
+TEST(CpuTest, test_cgroup_v1_quota) {
+    auto root = temp_dir("cgroup_v1");
+    write_file(root + "/proc_cgroup", "4:memory:/docker/abc\n3:cpu,cpuacct:/docker/abc\n");
+    write_file(root + "/cpu,cpuacct/docker/abc/cpu.cfs_quota_us", "-1\n");
+    write_file(root + "/cpu,cpuacct/docker/abc/cpu.cfs_period_us", "100000\n");
+    EXPECT_FALSE(cpu::cgroup_quota(root, root + "/proc_cgroup").has_value());
+    write_file(root + "/cpu,cpuacct/docker/abc/cpu.cfs_quota_us", "400000\n");
+    EXPECT_DOUBLE_EQ(*cpu::cgroup_quota(root, root + "/proc_cgroup"), 4.0);
+    EXPECT_FALSE(cpu::cgroup_quota(root + "/missing", root + "/missing/proc_cgroup").has_value());
+    std::filesystem::remove_all(root);
+}
+
+TEST(CpuTest, test_default_threads_and_pinning) {
+    auto cpus = cpu::allowed();
+    ASSERT_FALSE(cpus.empty());
+    EXPECT_GE(cpu::default_threads(), 1u);
+    EXPECT_LE(cpu::default_threads(), cpus.size());
+
+    // On a thread of its own so the test runner's affinity is left alone
+    std::thread([&]() {
+        EXPECT_TRUE(cpu::pin_thread({cpus.back()}));
+        EXPECT_EQ(cpu::allowed(), std::vector<int>({cpus.back()}));
+        EXPECT_EQ(cpu::default_threads(), 1u);
+        // Inherited by threads it starts
+        std::thread([&]() { EXPECT_EQ(cpu::allowed(), std::vector<int>({cpus.back()})); }).join();
+        EXPECT_FALSE(cpu::pin_thread({}));
+    }).join();
+    EXPECT_EQ(cpu::allowed(), cpus);
+}
@@ -0,0 +1,323 @@
+#include <gtest/gtest.h>
+#include "data/value.h"
+#include "data/hash_object.h"
+#include "data/sorted_set.h"
+#include "data/hyperloglog.h"
+#include "data/bloom_filter.h"
+#include "persistence/snapshot.h"
+#include <filesystem>
+#include <cmath>
+
+using namespace cacheforge;
+
+// ========== HashObject ==========
+
+TEST(DataTypeTest, test_hash_set_get_remove) {
+    HashObject h;
+    EXPECT_TRUE(h.set("name", "alice"));
+    EXPECT_FALSE(h.set("name", "bob"));  // update, not insert
+    EXPECT_EQ(h.get("name"), "bob");
+    EXPECT_FALSE(h.get("missing").has_value());
+    EXPECT_TRUE(h.remove("name"));
+    EXPECT_FALSE(h.remove("name"));
+    EXPECT_TRUE(h.empty());
+}
+
+TEST(DataTypeTest, test_hash_converts_to_table_when_large) {
+    HashObject h;
+    for (size_t i = 0; i < HashObject::kMaxCompactEntries; ++i) {
+        h.set("f" + std::to_string(i), "v");
+    }
+    EXPECT_EQ(h.encoding(), HashObject::Encoding::Compact);
+
+    h.set("one_more", "v");
+    EXPECT_EQ(h.encoding(), HashObject::Encoding::Table);
+    EXPECT_EQ(h.size(), HashObject::kMaxCompactEntries + 1);
+    EXPECT_EQ(h.get("f0"), "v");
+}
+
+TEST(DataTypeTest, test_hash_converts_on_long_value) {
+    HashObject h;
+    h.set("short", "x");
+    h.set("short", std::string(HashObject::kMaxCompactItemSize + 1, 'y'));
+    EXPECT_EQ(h.encoding(), HashObject::Encoding::Table);
+    EXPECT_EQ(h.get("short")->size(), HashObject::kMaxCompactItemSize + 1);
+}
+
+TEST(DataTypeTest, test_hash_increment) {
+    HashObject h;
+    EXPECT_EQ(h.increment("counter", 5), 5);
+    EXPECT_EQ(h.increment("counter", -7), -2);
+    h.set("text", "abc");
+    EXPECT_THROW(h.increment("text", 1), std::runtime_error);
+    h.set("big", std::to_string(INT64_MAX));
+    EXPECT_THROW(h.increment("big", 1), std::runtime_error);
+}
+
+// ========== SortedSet ==========
+
+TEST(DataTypeTest, test_sorted_set_rank_and_range_compact) {
+    SortedSet z;
+    EXPECT_TRUE(z.add("b", 2.0));
+    EXPECT_TRUE(z.add("a", 1.0));
+    EXPECT_TRUE(z.add("c", 3.0));
+    EXPECT_FALSE(z.add("a", 4.0));  // score update moves "a" to the end
+
+    EXPECT_EQ(z.encoding(), SortedSet::Encoding::Compact);
+    EXPECT_EQ(z.rank("b"), 0u);
+    EXPECT_EQ(z.rank("a"), 2u);
+    EXPECT_FALSE(z.rank("zzz").has_value());
+
+    auto range = z.range_by_score({2.0, 3.0});
+    ASSERT_EQ(range.size(), 2u);
+    EXPECT_EQ(range[0].first, "b");
+    EXPECT_EQ(range[1].first, "c");
+
+    auto exclusive = z.range_by_score({2.0, 4.0, true, true});
+    ASSERT_EQ(exclusive.size(), 1u);
+    EXPECT_EQ(exclusive[0].first, "c");
+}
+
+TEST(DataTypeTest, test_sorted_set_skiplist_matches_compact) {
+    SortedSet z;
+    const size_t n = SortedSet::kMaxCompactEntries * 4;
+    for (size_t i = 0; i < n; ++i) {
+        // Insert in a scrambled order so the skiplist has to place members
+        size_t k = (i * 7919) % n;
+        z.add("m" + std::to_string(k), static_cast<double>(k));
+    }
+    EXPECT_EQ(z.encoding(), SortedSet::Encoding::SkipList);
+    EXPECT_EQ(z.size(), n);
+
+    for (size_t k = 0; k < n; k += 37) {
+        EXPECT_EQ(z.rank("m" + std::to_string(k)), k);
+    }
+
+    auto range = z.range_by_score({10.0, 19.0}, 2, 3);
+    ASSERT_EQ(range.size(), 3u);
+    EXPECT_EQ(range[0].first, "m12");
+    EXPECT_EQ(range[2].first, "m14");
+
+    EXPECT_TRUE(z.remove("m0"));
+    EXPECT_EQ(z.rank("m1"), 0u);
+    EXPECT_EQ(z.size(), n - 1);
+}
+
+TEST(DataTypeTest, test_sorted_set_copy_is_deep) {
+    SortedSet z;
+    for (int i = 0; i < 200; ++i) z.add("m" + std::to_string(i), i);
+    SortedSet copy = z;
+    z.remove("m5");
+    EXPECT_TRUE(copy.score("m5").has_value());
+    EXPECT_EQ(copy.size(), 200u);
+    EXPECT_EQ(copy.rank("m199"), 199u);
+}
+
+TEST(DataTypeTest, test_sorted_set_infinite_bounds) {
+    SortedSet z;
+    z.add("low", -1e300);
+    z.add("high", 1e300);
+    EXPECT_EQ(z.range_by_score({-HUGE_VAL, HUGE_VAL}).size(), 2u);
+}
+
+// ========== HyperLogLog ==========
+
+TEST(DataTypeTest, test_hyperloglog_estimates_within_error) {
+    HyperLogLog hll;
+    EXPECT_EQ(hll.count(), 0u);
+    EXPECT_TRUE(hll.add("a"));
+    EXPECT_FALSE(hll.add("a"));
+    EXPECT_EQ(hll.count(), 1u);
+
+    // Small sets are exact or nearly so while sparse
+    for (int i = 0; i < 1000; ++i) hll.add("user:" + std::to_string(i));
+    EXPECT_EQ(hll.encoding(), HyperLogLog::Encoding::Sparse);
+    EXPECT_NEAR(static_cast<double>(hll.count()), 1001.0, 10.0);
+    EXPECT_LT(hll.memory_size(), 8 * 1024u);
+
+    // 0.81% standard error; 3 sigma is about 2.5%
+    for (int i = 1000; i < 200000; ++i) hll.add("user:" + std::to_string(i));
+    EXPECT_EQ(hll.encoding(), HyperLogLog::Encoding::Dense);
+    EXPECT_NEAR(static_cast<double>(hll.count()), 200001.0, 200001.0 * 0.025);
+    EXPECT_EQ(hll.memory_size(), HyperLogLog::kRegisters);
+}
+
+TEST(DataTypeTest, test_hyperloglog_merge_estimates_union) {
+    HyperLogLog a;
+    HyperLogLog b;
+    HyperLogLog small;
+    for (int i = 0; i < 50000; ++i) a.add("x" + std::to_string(i));
+    for (int i = 25000; i < 75000; ++i) b.add("x" + std::to_string(i));
+    for (int i = 0; i < 100; ++i) small.add("y" + std::to_string(i));
+
+    // Dense into dense, then sparse into dense
+    HyperLogLog all = a;
+    all.merge(b);
+    EXPECT_NEAR(static_cast<double>(all.count()), 75000.0, 75000.0 * 0.025);
+    all.merge(small);
+    EXPECT_NEAR(static_cast<double>(all.count()), 75100.0, 75100.0 * 0.025);
+
+    // Dense into sparse converts; merging is idempotent
+    HyperLogLog target = small;
+    target.merge(a);
+    EXPECT_EQ(target.encoding(), HyperLogLog::Encoding::Dense);
+    auto before = target.count();
+    target.merge(a);
+    EXPECT_EQ(target.count(), before);
+}
+
+TEST(DataTypeTest, test_hyperloglog_encode_decode) {
+    HyperLogLog sparse;
+    for (int i = 0; i < 100; ++i) sparse.add(std::to_string(i));
+    HyperLogLog dense = sparse;
+    for (int i = 0; i < 10000; ++i) dense.add(std::to_string(i));
+
+    for (const auto& hll : {sparse, dense}) {
+        auto decoded = HyperLogLog::decode(hll.encode());
+        EXPECT_EQ(decoded, hll);
+        EXPECT_EQ(decoded.encoding(), hll.encoding());
+        EXPECT_EQ(decoded.count(), hll.count());
+    }
+    auto bytes = sparse.encode();
+    EXPECT_THROW(HyperLogLog::decode(bytes.substr(0, bytes.size() - 1)), std::runtime_error);
+    bytes[0] = 7;
+    EXPECT_THROW(HyperLogLog::decode(bytes), std::runtime_error);
+    EXPECT_THROW(HyperLogLog::decode(""), std::runtime_error);
+}
+
+// ========== BloomFilter ==========
+
+TEST(DataTypeTest, test_bloom_filter_no_false_negatives_and_bounded_rate) {
+    BloomFilter bloom(0.01, 10000);
+    uint64_t added = 0;
+    for (int i = 0; i < 10000; ++i) added += bloom.add("member:" + std::to_string(i));
+    EXPECT_EQ(bloom.layers(), 1u);
+    for (int i = 0; i < 10000; ++i) ASSERT_TRUE(bloom.contains("member:" + std::to_string(i)));
+
+    int false_positives = 0;
+    for (int i = 0; i < 100000; ++i) {
+        if (bloom.contains("other:" + std::to_string(i))) false_positives++;
+    }
+    EXPECT_LT(false_positives, 1000);  // under 1%
+
+    // A false positive while adding skips that item too
+    EXPECT_GT(added, 9900u);
+    EXPECT_FALSE(bloom.add("member:1"));  // already present, not counted
+    EXPECT_EQ(bloom.size(), added);
+    EXPECT_THROW(BloomFilter(0.0, 10), std::runtime_error);
+    EXPECT_THROW(BloomFilter(1.0, 10), std::runtime_error);
+    EXPECT_THROW(BloomFilter(0.01, 0), std::runtime_error);
+}
+
+TEST(DataTypeTest, test_bloom_filter_scales_past_capacity) {
+    BloomFilter bloom(0.01, 100);
+    for (int i = 0; i < 3000; ++i) bloom.add("k" + std::to_string(i));
+    // 100 + 200 + 400 + 800 + 1600
+    EXPECT_EQ(bloom.layers(), 5u);
+    EXPECT_EQ(bloom.capacity(), 3100u);
+    for (int i = 0; i < 3000; ++i) ASSERT_TRUE(bloom.contains("k" + std::to_string(i)));
+
+    int false_positives = 0;
+    for (int i = 0; i < 100000; ++i) {
+        if (bloom.contains("x" + std::to_string(i))) false_positives++;
+    }
+    EXPECT_LT(false_positives, 1000);
+
+    auto decoded = BloomFilter::decode(bloom.encode());
+    EXPECT_EQ(decoded, bloom);
+    EXPECT_TRUE(decoded.contains("k2999"));
+    auto bytes = bloom.encode();
+    EXPECT_THROW(BloomFilter::decode(bytes.substr(0, bytes.size() - 8)), std::runtime_error);
+}
+
+// ========== Value integration ==========
+
+TEST(DataTypeTest, test_value_memory_size_grows_with_fields) {
+    HashObject small;
+    small.set("f", "v");
+    HashObject large;
+    for (int i = 0; i < 500; ++i) large.set("field" + std::to_string(i), "value");
+
+    EXPECT_GT(Value(large).memory_size(), Value(small).memory_size());
+}
+
+TEST(DataTypeTest, test_value_encode_decode_roundtrip) {
+    HashObject h;
+    h.set("a", "1");
+    h.set("b", std::string(100, 'x'));
+    SortedSet z;
+    z.add("x", 1.5);
+    z.add("y", -2.25);
+
+    std::vector<Value> values = {
+        Value("plain"),
+        Value(int64_t(-42)),
+        Value(std::vector<std::string>{"l1", "", "l3"}),
+        Value(std::vector<uint8_t>{0x00, 0xFF}),
+        Value(h),
+        Value(z),
+        Value(HyperLogLog{}),
+        Value(BloomFilter(0.001, 50)),
+    };
+    for (const auto& v : values) {
+        EXPECT_EQ(Value::decode(v.type(), v.encode()), v);
+    }
+}
+
+TEST(DataTypeTest, test_value_decode_rejects_truncated_input) {
+    HashObject h;
+    h.set("field", "value");
+    std::string bytes = Value(h).encode();
+    bytes.resize(bytes.size() - 3);
+    EXPECT_THROW(Value::decode(Value::Type::Hash, bytes), std::runtime_error);
+}
+
+TEST(DataTypeTest, test_snapshot_roundtrip_hash_and_sorted_set) {
+    std::string dir = "/tmp/cacheforge_test_datatypes";
+    std::filesystem::remove_all(dir);
+    SnapshotManager sm(dir);
+
+    HashObject h;
+    h.set("name", "alice");
+    SortedSet z;
+    z.add("player", 99.5);
+
+    std::vector<SnapshotEntry> entries = {{"user:1", Value(h), 0}, {"board", Value(z), 60}};
+    ASSERT_TRUE(sm.save_snapshot(entries));
+
+    std::vector<SnapshotEntry> loaded;
+    ASSERT_TRUE(sm.load_snapshot(loaded));
+    ASSERT_EQ(loaded.size(), 2u);
+    EXPECT_EQ(loaded[0].value.as_hash().get("name"), "alice");
+    EXPECT_EQ(loaded[1].value.as_sorted_set().score("player"), 99.5);
+    EXPECT_EQ(loaded[1].ttl_remaining, 60);
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST(DataTypeTest, test_snapshot_roundtrip_hyperloglog_and_bloom) {
+    std::string dir = "/tmp/cacheforge_test_probabilistic";
+    std::filesystem::remove_all(dir);
+    SnapshotManager sm(dir);
+
+    HyperLogLog sparse;
+    sparse.add("one");
+    HyperLogLog dense;
+    for (int i = 0; i < 5000; ++i) dense.add("visitor:" + std::to_string(i));
+    BloomFilter bloom;
+    bloom.add("seen");
+
+    std::vector<SnapshotEntry> entries = {
+        {"sparse", Value(sparse), 0}, {"dense", Value(dense), 0}, {"bloom", Value(bloom), 0}};
+    ASSERT_TRUE(sm.save_snapshot(entries));
+
+    std::vector<SnapshotEntry> loaded;
+    ASSERT_TRUE(sm.load_snapshot(loaded));
+    ASSERT_EQ(loaded.size(), 3u);
+    EXPECT_EQ(loaded[0].value.as_hyperloglog(), sparse);
+    EXPECT_EQ(loaded[1].value.as_hyperloglog().count(), dense.count());
+    EXPECT_TRUE(loaded[2].value.as_bloom().contains("seen"));
+    EXPECT_FALSE(loaded[2].value.as_bloom().contains("unseen"));
+
+    std::filesystem::remove_all(dir);
+}
@@ -0,0 +1,197 @@
+#include <gtest/gtest.h>
+#include "storage/defrag.h"
+#include "storage/hashtable.h"
+#include "storage/tiering.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+using namespace cacheforge;
+
+namespace {
+
+std::string payload(int i, size_t size = 200) {
+    std::string s = "value-" + std::to_string(i) + "-";
+    s.resize(size, 'x');
+    return s;
+}
+
+// Moves every key of the table, treating each page it uses as sparse
+size_t relocate_all(HashTable& ht) {
+    HashTable::PageUsage pages;
+    for (size_t shard = 0; shard < HashTable::kShardCount; ++shard) ht.page_usage(shard, pages);
+    auto any = [&pages](uintptr_t page) { return pages.count(page) > 0; };
+    HashTable::Retired retired;
+    size_t moved = 0;
+    for (size_t shard = 0; shard < HashTable::kShardCount; ++shard) {
+        auto keys = ht.sparse_keys(shard, any);
+        for (size_t i = 0; i < keys.size(); i += Defragmenter::kBatchKeys) {
+            auto end = keys.begin() + static_cast<std::ptrdiff_t>(std::min(i + Defragmenter::kBatchKeys, keys.size()));
+            moved += ht.relocate({keys.begin() + static_cast<std::ptrdiff_t>(i), end}, any, retired);
+        }
+    }
+    return moved;
+}
+
+}  // namespace
+
+TEST(DefragTest, test_relocate_keeps_values_and_deadlines) {
+    HashTable ht(10000);
+    auto now = Clock::now();
+    for (int i = 0; i < 1000; ++i) {
+        std::string key = "k" + std::to_string(i);
+        if (i % 3 == 0) {
+            ht.set(key, Value(std::vector<std::string>{payload(i, 40), "b"}));
+        } else {
+            ht.set(key, Value(payload(i, i % 2 ? 10 : 300)));
+        }
+        if (i % 2 == 0) ht.set_expiry(key, now + std::chrono::seconds(i + 1));
+    }
+    uint64_t version = ht.version("k1");
+
+    EXPECT_EQ(relocate_all(ht), 1000u);
+    EXPECT_EQ(ht.size(), 1000u);
+    EXPECT_EQ(ht.version("k1"), version);  // moving a value is not a write
+    for (int i = 0; i < 1000; ++i) {
+        std::string key = "k" + std::to_string(i);
+        auto value = ht.get(key);
+        ASSERT_TRUE(value.has_value());
+        if (i % 3 == 0) {
+            EXPECT_EQ(value->as_list().front(), payload(i, 40));
+        } else {
+            EXPECT_EQ(value->as_string(), payload(i, i % 2 ? 10 : 300));
+        }
+        EXPECT_EQ(ht.expiry(key).has_value(), i % 2 == 0);
+    }
+    // The expiry heaps point at the moved entries
+    auto expired = ht.remove_expired(now + std::chrono::seconds(100));
+    EXPECT_EQ(expired.size(), 50u);
+    EXPECT_FALSE(ht.contains("k98"));
+    EXPECT_TRUE(ht.contains("k100"));
+    EXPECT_EQ(ht.expiry_count(), 450u);
+}
+
+TEST(DefragTest, test_relocate_copies_only_single_block_values) {
+    HashTable ht(1000);
+    HashObject hash;
+    for (int i = 0; i < 200; ++i) hash.set("f" + std::to_string(i), payload(i, 20));
+    ASSERT_EQ(hash.encoding(), HashObject::Encoding::Table);
+    ht.set("h", Value(std::move(hash)));
+    ht.set("s", Value(payload(1, 300)));
+
+    HashTable::PageUsage pages;
+    for (size_t shard = 0; shard < HashTable::kShardCount; ++shard) ht.page_usage(shard, pages);
+    auto any = [&pages](uintptr_t page) { return pages.count(page) > 0; };
+
+    // A table-encoded hash has no single block: only its node moves, and
+    // the structure itself is left alone rather than rebuilt
+    HashTable::Retired retired;
+    EXPECT_EQ(ht.relocate({"h"}, any, retired), 1u);
+    EXPECT_EQ(retired.nodes.size(), 1u);
+    EXPECT_TRUE(retired.values.empty());
+    auto value = ht.get("h");
+    ASSERT_TRUE(value.has_value());
+    EXPECT_EQ(value->as_hash().size(), 200u);
+    EXPECT_EQ(value->as_hash().get("f7"), payload(7, 20));
+
+    // A long string is one block, copied into a fresh allocation
+    EXPECT_EQ(ht.relocate({"s"}, any, retired), 1u);
+    EXPECT_EQ(retired.values.size(), 1u);
+    EXPECT_EQ(ht.get("s")->as_string(), payload(1, 300));
+}
+
+TEST(DefragTest, test_relocate_keeps_lru_order) {
+    TieringOptions options;
+    options.dir = (std::filesystem::temp_directory_path() /
+                   ("cacheforge_defrag_" + std::to_string(::getpid()))).string();
+    std::filesystem::remove_all(options.dir);
+    options.memory_budget = 1 << 30;
+    HashTable ht(1000);
+    TieredStorage tiers(ht, options);
+    for (int i = 0; i < 100; ++i) ht.set("k" + std::to_string(i), Value(payload(i)));
+
+    EXPECT_EQ(relocate_all(ht), 100u);
+    for (int i = 0; i < 40; ++i) ASSERT_TRUE(ht.demote_lru());
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_EQ(ht.resident_size("k" + std::to_string(i)).has_value(), i >= 40) << i;
+    }
+    EXPECT_EQ(ht.get("k7")->as_string(), payload(7));
+    std::filesystem::remove_all(options.dir);
+}
+
+// After deleting three keys in four at random every allocator page keeps a
+// few live values, so freeing them returns next to nothing to the OS. The
+// defragmenter must bring RSS most of the way back down to what the
+// remaining data needs.
+TEST(DefragTest, test_churn_converges_rss_toward_dataset) {
+    constexpr int kKeys = 200000;
+    HashTable ht(100);
+#ifdef __GLIBC__
+    malloc_trim(0);
+#endif
+    size_t baseline = Defragmenter::resident_bytes();
+    if (baseline == 0) GTEST_SKIP() << "no /proc/self/statm";
+    auto grown = [baseline]() {
+        size_t rss = Defragmenter::resident_bytes();
+        return rss > baseline ? rss - baseline : 0;
+    };
+
+    for (int i = 0; i < kKeys; ++i) ht.set("key:" + std::to_string(i), Value(payload(i)));
+    std::mt19937 rng(42);
+    std::vector<int> survivors;
+    for (int i = 0; i < kKeys; ++i) {
+        if (rng() % 4 != 0) {
+            ht.remove("key:" + std::to_string(i));
+        } else {
+            survivors.push_back(i);
+        }
+    }
+    ASSERT_EQ(ht.size(), survivors.size());
+#ifdef __GLIBC__
+    malloc_trim(0);
+#endif
+    size_t fragmented = grown();
+    size_t dataset = ht.memory_usage_estimate();
+    ASSERT_GT(fragmented, 2 * dataset);
+
+    DefragOptions options;
+    options.start_ratio = 1.3;
+    options.stop_ratio = 1.1;
+    options.ignore_bytes = baseline;  // what the process held before the data
+    options.cpu_percent = 100;
+    Defragmenter defrag(ht, options);
+    std::atomic<size_t> reported{0};
+    defrag.set_cycle_callback([&reported](std::chrono::microseconds) { reported.fetch_add(1); });
+    defrag.start();
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    while (std::chrono::steady_clock::now() < deadline && (defrag.passes() == 0 || defrag.active()) &&
+           defrag.passes() < 3) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    defrag.stop();
+
+    size_t after = grown();
+    EXPECT_GT(defrag.relocated(), 0u);
+    EXPECT_GE(defrag.passes(), 1u);
+    // Every cycle of a pass was reported, and at least one per pass
+    EXPECT_GE(reported.load(), defrag.passes());
+    // Most of the excess over the dataset is gone
+    EXPECT_LT(after - std::min(after, dataset), (fragmented - dataset) / 3)
+        << "before " << fragmented << " after " << after << " dataset " << dataset;
+    // Relocation lost and corrupted nothing
+    EXPECT_EQ(ht.size(), survivors.size());
+    for (int i : survivors) {
+        auto value = ht.get("key:" + std::to_string(i));
+        ASSERT_TRUE(value.has_value()) << i;
+        EXPECT_EQ(value->as_string(), payload(i)) << i;
+    }
+}
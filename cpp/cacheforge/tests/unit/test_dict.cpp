@@ -0,0 +1,172 @@
+#include <gtest/gtest.h>
+#include "storage/dict.h"
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace cacheforge;
+
+TEST(DictTest, test_matches_unordered_map_through_resizes) {
+    Dict<int> dict;
+    std::unordered_map<std::string, int> reference;
+    std::mt19937_64 rng(7);
+    bool saw_rehash = false;
+    for (int op = 0; op < 200000; ++op) {
+        std::string key = "k" + std::to_string(rng() % 20000);
+        HashedKey hk(key);
+        // Grow early on, then mostly shrink so both directions resize
+        bool insert = op < 120000 ? rng() % 4 != 0 : rng() % 4 == 0;
+        if (insert) {
+            auto [it, fresh] = dict.try_emplace(hk);
+            EXPECT_EQ(fresh, reference.count(key) == 0);
+            it->second = op;
+            reference[key] = op;
+        } else {
+            auto it = dict.find(hk);
+            ASSERT_EQ(it != dict.end(), reference.count(key) == 1);
+            if (it != dict.end()) {
+                EXPECT_EQ(it->second, reference[key]);
+                dict.erase(it);
+                reference.erase(key);
+            }
+        }
+        saw_rehash |= dict.rehashing();
+    }
+    EXPECT_TRUE(saw_rehash);
+    ASSERT_EQ(dict.size(), reference.size());
+    for (const auto& [key, value] : reference) {
+        auto it = dict.find(HashedKey(key));
+        ASSERT_NE(it, dict.end());
+        EXPECT_EQ(it->second, value);
+    }
+}
+
+TEST(DictTest, test_iteration_mid_rehash_visits_each_key_once) {
+    Dict<int> dict;
+    int inserted = 0;
+    while (!dict.rehashing() || inserted < 1000) {
+        dict.try_emplace(HashedKey("key" + std::to_string(inserted++)));
+    }
+    ASSERT_TRUE(dict.rehashing());
+    std::vector<std::string> seen;
+    for (auto& [key, value] : dict) seen.push_back(key);
+    std::sort(seen.begin(), seen.end());
+    EXPECT_EQ(std::unique(seen.begin(), seen.end()), seen.end());
+    EXPECT_EQ(seen.size(), static_cast<size_t>(inserted));
+}
+
+TEST(DictTest, test_elements_never_move) {
+    Dict<int> dict;
+    auto* first = &*dict.try_emplace(HashedKey("first")).first;
+    for (int i = 0; i < 100000; ++i) dict.try_emplace(HashedKey("k" + std::to_string(i)));
+    while (dict.rehash_step(1000)) {
+    }
+    EXPECT_EQ(&*dict.find(HashedKey("first")), first);
+    dict.erase(dict.iterator_to(*first));
+    EXPECT_EQ(dict.find(HashedKey("first")), dict.end());
+}
+
+TEST(DictTest, test_reallocate_moves_node_in_place_of_old) {
+    Dict<std::string> dict;
+    int inserted = 0;
+    while (!dict.rehashing()) {
+        auto [it, fresh] = dict.try_emplace(HashedKey("key" + std::to_string(inserted)));
+        it->second = "value" + std::to_string(inserted++);
+    }
+    // Keys on both arrays, mid-move
+    for (int i = 0; i < inserted; i += 3) {
+        std::string key = "key" + std::to_string(i);
+        auto* before = &*dict.find(HashedKey(key));
+        auto [it, old] = dict.reallocate(dict.find(HashedKey(key)));
+        EXPECT_EQ(old.get(), before);
+        EXPECT_EQ(it->first, key);
+    }
+    EXPECT_EQ(dict.size(), static_cast<size_t>(inserted));
+    for (int i = 0; i < inserted; ++i) {
+        auto it = dict.find(HashedKey("key" + std::to_string(i)));
+        ASSERT_NE(it, dict.end());
+        EXPECT_EQ(it->second, "value" + std::to_string(i));
+    }
+    size_t visited = 0;
+    for (auto it = dict.begin(); it != dict.end(); ++it) ++visited;
+    EXPECT_EQ(visited, static_cast<size_t>(inserted));
+}
+
+// The worst single insert while growing from empty must cost a small
+// fraction of rebuilding the table at once. Scaled down from the 50M-key
+// production case to 2M so the test fits in CI memory and time; the
+// stop-the-world cost it is compared with grows linearly with the table,
+// the incremental one does not
+TEST(DictTest, test_growth_has_no_stop_the_world_insert) {
+    constexpr size_t kKeys = 2000000;
+    std::vector<std::string> keys;
+    keys.reserve(kKeys);
+    for (size_t i = 0; i < kKeys; ++i) keys.push_back("user:" + std::to_string(i));
+
+    using Nanos = std::chrono::nanoseconds;
+    auto worst_insert = [&](auto&& insert) {
+        Nanos worst{0};
+        for (const auto& key : keys) {
+            auto start = std::chrono::steady_clock::now();
+            insert(key);
+            worst = std::max(worst, std::chrono::duration_cast<Nanos>(std::chrono::steady_clock::now() - start));
+        }
+        return worst;
+    };
+
+    Dict<int> dict;
+    Nanos incremental = worst_insert([&](const std::string& key) { dict.try_emplace(HashedKey(key)); });
+    std::unordered_map<std::string, int, KeyHash, KeyEqual> map;
+    Nanos stop_the_world = worst_insert([&](const std::string& key) { map.try_emplace(key); });
+
+    EXPECT_EQ(dict.size(), kKeys);
+    EXPECT_LT(incremental * 4, stop_the_world)
+        << "worst insert " << incremental.count() << "ns, unordered_map worst "
+        << stop_the_world.count() << "ns";
+}
+
+TEST(DictTest, test_scan_visits_every_key_across_resizes) {
+    Dict<int> dict;
+    for (int i = 0; i < 1000; ++i) dict.try_emplace(HashedKey("stay" + std::to_string(i)));
+    std::vector<std::string> seen;
+    auto record = [&seen](const Dict<int>::value_type& kv) { seen.push_back(kv.first); };
+
+    // Grow through several resizes, then shrink, between scan steps
+    size_t cursor = 0;
+    int steps = 0;
+    bool saw_rehash = false;
+    do {
+        cursor = dict.scan(cursor, record);
+        ++steps;
+        if (steps < 200) {
+            for (int i = 0; i < 100; ++i) {
+                dict.try_emplace(HashedKey("grow" + std::to_string(steps) + "-" + std::to_string(i)));
+            }
+        } else if (steps < 400) {
+            for (int i = 0; i < 100; ++i) {
+                auto it = dict.find(HashedKey("grow" + std::to_string(steps - 199) + "-" + std::to_string(i)));
+                if (it != dict.end()) dict.erase(it);
+            }
+        }
+        saw_rehash |= dict.rehashing();
+    } while (cursor != 0);
+    EXPECT_TRUE(saw_rehash);
+
+    std::sort(seen.begin(), seen.end());
+    for (int i = 0; i < 1000; ++i) {
+        EXPECT_TRUE(std::binary_search(seen.begin(), seen.end(), "stay" + std::to_string(i))) << i;
+    }
+    // Without resizes each key is visited exactly once
+    seen.clear();
+    while (dict.rehashing()) dict.rehash_step(1000);
+    cursor = 0;
+    do {
+        cursor = dict.scan(cursor, record);
+    } while (cursor != 0);
+    std::sort(seen.begin(), seen.end());
+    EXPECT_EQ(std::unique(seen.begin(), seen.end()), seen.end());
+    EXPECT_EQ(seen.size(), dict.size());
+}
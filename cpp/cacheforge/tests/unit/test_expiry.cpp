@@ -1,5 +1,8 @@
 #include <gtest/gtest.h>
 #include "storage/expiry.h"
+#include "storage/hashtable.h"
+#include <mutex>
+#include <vector>
 #include <thread>
 #include <chrono>
 
@@ -132,3 +135,72 @@ TEST(ExpiryTest, test_get_expired_keys) {
     auto expired = em.get_expired_keys();
     EXPECT_EQ(expired.size(), 2);
 }
+
+TEST(ExpiryTest, test_table_bound_manager_keeps_deadlines_in_the_table) {
+    HashTable table;
+    ExpiryManager em(table);
+    std::vector<std::string> expired;
+    std::mutex expired_mutex;
+    em.set_expiry_callback([&](const std::string& key) {
+        std::lock_guard lock(expired_mutex);
+        expired.push_back(key);
+    });
+
+    table.set("short", Value("1"));
+    table.set("long", Value("2"));
+    em.set_expiry("short", std::chrono::seconds(0));
+    em.set_expiry("long", std::chrono::seconds(100));
+    em.set_expiry("missing", std::chrono::seconds(0));
+    EXPECT_EQ(table.expiry_count(), 2u);
+    EXPECT_EQ(em.get_ttl("missing").count(), -1);
+    EXPECT_GT(em.get_ttl("long").count(), 90);
+
+    em.start_expiry_thread();
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    em.stop_expiry_thread();
+
+    // The thread removed the due key from the table before the callback ran
+    std::lock_guard lock(expired_mutex);
+    ASSERT_EQ(expired.size(), 1u);
+    EXPECT_EQ(expired[0], "short");
+    EXPECT_FALSE(table.contains("short"));
+    EXPECT_TRUE(table.contains("long"));
+    em.remove_expiry("long");
+    EXPECT_EQ(em.get_ttl("long").count(), -1);
+}
+
+TEST(ExpiryTest, test_active_expiry_pass_is_bounded) {
+    HashTable table;
+    ExpiryManager em(table);
+    // A slow callback makes every batch take about 20ms
+    em.set_expiry_callback([](const std::string&) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    });
+    std::vector<size_t> passes;
+    std::mutex passes_mutex;
+    em.set_cycle_callback([&](std::chrono::microseconds, size_t expired) {
+        std::lock_guard lock(passes_mutex);
+        passes.push_back(expired);
+    });
+
+    const size_t keys = 5 * ExpiryManager::kCycleBatch;
+    for (size_t i = 0; i < keys; ++i) {
+        table.set("k" + std::to_string(i), Value("v"));
+        em.set_expiry("k" + std::to_string(i), std::chrono::seconds(0));
+    }
+    em.start_expiry_thread();
+    for (int i = 0; i < 100 && table.size() > 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    em.stop_expiry_thread();
+
+    // Every key went, in whole batches over more than one pass
+    EXPECT_EQ(table.size(), 0u);
+    std::lock_guard lock(passes_mutex);
+    ASSERT_GT(passes.size(), 1u);
+    EXPECT_LT(passes[0], keys);
+    EXPECT_EQ(passes[0] % ExpiryManager::kCycleBatch, 0u);
+    size_t total = 0;
+    for (size_t expired : passes) total += expired;
+    EXPECT_EQ(total, keys);
+}
@@ -0,0 +1,136 @@
+#include <gtest/gtest.h>
+#include "utils/hash.h"
+#include "storage/hashtable.h"
+#include <bitset>
+#include <cstring>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace cacheforge;
+
+TEST(HashTest, SameSeedSameHash) {
+    std::string key = "user:1000:profile";
+    EXPECT_EQ(hashing::hash_bytes(key.data(), key.size(), 42), hashing::hash_bytes(key.data(), key.size(), 42));
+    EXPECT_NE(hashing::hash_bytes(key.data(), key.size(), 42), hashing::hash_bytes(key.data(), key.size(), 43));
+}
+
+TEST(HashTest, KeysCannotCancelTheSeed) {
+    // kSecret is public. These keys put kSecret[1] into the first multiply
+    // operand, which zeroed it and made the hash independent of the seed.
+    uint64_t secret = hashing::detail::kSecret[1];
+    uint32_t hi = static_cast<uint32_t>(secret >> 32);
+    uint32_t lo = static_cast<uint32_t>(secret);
+    std::vector<std::string> keys;
+    for (uint32_t tail = 0; tail < 4; ++tail) {
+        std::string key(16, '\0');
+        std::memcpy(&key[0], &hi, 4);
+        std::memcpy(&key[4], &tail, 4);
+        std::memcpy(&key[8], &lo, 4);
+        std::memcpy(&key[12], &tail, 4);
+        keys.push_back(key);
+    }
+    // Longer keys: a 16-byte block starting with kSecret[1]
+    std::string block(40, 'x');
+    std::memcpy(&block[0], &secret, 8);
+    keys.push_back(block);
+
+    for (const auto& key : keys) {
+        std::set<uint64_t> seen;
+        for (uint64_t seed : {1ull, 12345ull, 0xdeadbeefull}) {
+            seen.insert(hashing::hash_bytes(key.data(), key.size(), seed));
+        }
+        EXPECT_EQ(seen.size(), 3u) << "key length " << key.size();
+    }
+    std::set<uint64_t> across;
+    for (const auto& key : keys) across.insert(hashing::hash_bytes(key.data(), key.size(), 99));
+    EXPECT_EQ(across.size(), keys.size());
+}
+
+TEST(HashTest, DistinctAcrossLengths) {
+    // Prefixes of every length from 0 to 200 cover each input-size branch
+    std::string text;
+    for (int i = 0; i < 200; ++i) text += static_cast<char>('a' + i % 26);
+    std::set<uint64_t> seen;
+    for (size_t len = 0; len <= text.size(); ++len) {
+        seen.insert(hashing::hash_bytes(text.data(), len, 7));
+    }
+    EXPECT_EQ(seen.size(), text.size() + 1);
+}
+
+TEST(HashTest, SingleBitFlipAvalanches) {
+    for (size_t len : {3u, 8u, 16u, 40u, 100u}) {
+        std::string key(len, 'k');
+        uint64_t base = hashing::hash_bytes(key.data(), key.size(), 1);
+        size_t flipped = 0;
+        size_t trials = 0;
+        for (size_t byte = 0; byte < len; ++byte) {
+            for (int bit = 0; bit < 8; ++bit) {
+                std::string changed = key;
+                changed[byte] = static_cast<char>(changed[byte] ^ (1 << bit));
+                flipped += std::bitset<64>(base ^ hashing::hash_bytes(changed.data(), len, 1)).count();
+                ++trials;
+            }
+        }
+        double average = static_cast<double>(flipped) / static_cast<double>(trials);
+        EXPECT_GT(average, 24.0) << "length " << len;
+        EXPECT_LT(average, 40.0) << "length " << len;
+    }
+}
+
+TEST(HashTest, HashedKeyLooksUpWithoutRehashing) {
+    std::unordered_map<std::string, int, KeyHash, KeyEqual> map;
+    map["alpha"] = 1;
+    map["beta"] = 2;
+    HashedKey hk("beta");
+    EXPECT_EQ(hk.hash, KeyHash{}(std::string("beta")));
+    auto it = map.find(hk);
+    ASSERT_NE(it, map.end());
+    EXPECT_EQ(it->second, 2);
+    EXPECT_EQ(map.find(HashedKey("gamma")), map.end());
+}
+
+TEST(HashTest, TableWorksUnderFixedSeed) {
+    uint64_t saved = hashing::seed();
+    hashing::set_seed(0x5eed);
+    {
+        HashTable table;
+        for (int i = 0; i < 5000; ++i) table.set("key:" + std::to_string(i), Value("v" + std::to_string(i)));
+        EXPECT_EQ(table.size(), 5000u);
+        for (int i = 0; i < 5000; i += 7) {
+            auto value = table.get("key:" + std::to_string(i));
+            ASSERT_TRUE(value.has_value());
+            EXPECT_EQ(value->as_string(), "v" + std::to_string(i));
+        }
+        EXPECT_TRUE(table.remove("key:42"));
+        EXPECT_FALSE(table.contains("key:42"));
+    }
+    hashing::set_seed(saved);
+}
+
+TEST(HashTest, HashedKeyOverloadsMatchStringOnes) {
+    HashTable table;
+    std::string key = "counter";
+    HashedKey hk(key);
+    EXPECT_TRUE(table.set(hk, Value(std::string("a"))));
+    EXPECT_EQ(table.get(key)->as_string(), "a");
+    uint64_t version = table.version(hk);
+    EXPECT_EQ(version, table.version(key));
+    EXPECT_TRUE(table.update(hk, [](Value& v, bool created) {
+        EXPECT_FALSE(created);
+        v = Value(std::string("b"));
+        return true;
+    }));
+    EXPECT_NE(table.version(hk), version);
+    EXPECT_TRUE(table.set_expiry(hk, Clock::now() + std::chrono::hours(1)));
+    EXPECT_TRUE(table.expiry(key).has_value());
+    EXPECT_TRUE(table.clear_expiry(hk));
+    {
+        auto locked = table.lock_shards(std::vector<HashedKey>{hk});
+        EXPECT_TRUE(table.holding_shards());
+        EXPECT_TRUE(table.contains(hk));
+    }
+    EXPECT_TRUE(table.remove(hk));
+    EXPECT_FALSE(table.contains(key));
+}
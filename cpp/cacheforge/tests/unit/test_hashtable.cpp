@@ -1,5 +1,11 @@
 #include <gtest/gtest.h>
 #include "storage/hashtable.h"
+#include <atomic>
+#include <chrono>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
 
 using namespace cacheforge;
 
@@ -151,3 +157,219 @@ TEST(HashTableTest, test_clear) {
     EXPECT_EQ(ht.size(), 0);
     EXPECT_FALSE(ht.contains("a"));
 }
+
+TEST(HashTableTest, test_version_changes_on_write_and_remove) {
+    HashTable ht;
+    uint64_t missing = ht.version("k");
+    ht.set("k", Value("1"));
+    uint64_t v1 = ht.version("k");
+    EXPECT_NE(v1, missing);
+    EXPECT_EQ(ht.version("k"), v1);  // reads leave it alone
+    ht.get("k");
+    EXPECT_EQ(ht.version("k"), v1);
+
+    ht.update("k", [](Value& value, bool) {
+        value = Value("2");
+        return true;
+    });
+    uint64_t v2 = ht.version("k");
+    EXPECT_NE(v2, v1);
+
+    ht.remove("k");
+    EXPECT_NE(ht.version("k"), v2);
+    uint64_t removed = ht.version("k");
+    ht.clear();
+    EXPECT_NE(ht.version("k"), removed);
+}
+
+TEST(HashTableTest, test_failed_update_keeps_version) {
+    HashTable ht;
+    ht.set("k", Value("1"));
+    uint64_t before = ht.version("k");
+    EXPECT_THROW(ht.update("k", [](Value&, bool) -> bool { throw std::runtime_error("no"); }),
+                 std::runtime_error);
+    EXPECT_EQ(ht.version("k"), before);
+
+    // An update that reports no change is not a write either
+    EXPECT_FALSE(ht.update("k", [](Value&, bool) { return false; }));
+    EXPECT_EQ(ht.version("k"), before);
+    EXPECT_EQ(ht.get("k")->as_string(), "1");
+    uint64_t missing = ht.version("new");
+    EXPECT_FALSE(ht.update("new", [](Value&, bool created) {
+        EXPECT_TRUE(created);
+        return false;
+    }));
+    EXPECT_FALSE(ht.contains("new"));
+    EXPECT_EQ(ht.version("new"), missing);
+    EXPECT_EQ(ht.size(), 1u);
+}
+
+TEST(HashTableTest, test_lock_shards_excludes_other_threads) {
+    HashTable ht;
+    ht.set("k", Value("1"));
+    std::atomic<bool> written{false};
+    std::thread writer;
+    {
+        auto locked = ht.lock_shards({"k"});
+        writer = std::thread([&] {
+            ht.set("k", Value("2"));
+            written = true;
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        EXPECT_FALSE(written.load());
+        // The owning thread still reads and writes the locked shard
+        EXPECT_EQ(ht.get("k")->as_string(), "1");
+        ht.set("k", Value("3"));
+        ht.clear();
+        EXPECT_FALSE(ht.contains("k"));
+    }
+    writer.join();
+    EXPECT_TRUE(written.load());
+    EXPECT_EQ(ht.get("k")->as_string(), "2");
+}
+
+TEST(HashTableTest, test_overlapping_lock_sets_do_not_deadlock) {
+    HashTable ht;
+    std::vector<std::string> keys;
+    for (int i = 0; i < 32; ++i) keys.push_back("key" + std::to_string(i));
+    std::vector<std::string> reversed(keys.rbegin(), keys.rend());
+
+    auto worker = [&](const std::vector<std::string>& order) {
+        for (int i = 0; i < 2000; ++i) {
+            auto locked = ht.lock_shards(order);
+            ht.update(order[0], [](Value& value, bool created) {
+                value = Value(created ? int64_t{1} : value.as_integer() + 1);
+                return true;
+            });
+        }
+    };
+    std::thread a(worker, keys);
+    std::thread b(worker, reversed);
+    a.join();
+    b.join();
+    EXPECT_EQ(ht.get("key0")->as_integer() + ht.get("key31")->as_integer(), 4000);
+}
+
+TEST(HashTableTest, test_expiry_heap_removes_due_keys_in_deadline_order) {
+    HashTable ht;
+    auto now = Clock::now();
+    for (int i = 0; i < 200; ++i) {
+        ht.set("k" + std::to_string(i), Value(int64_t{i}));
+        // Deadlines out of insertion order, some already due
+        ht.set_expiry("k" + std::to_string(i), now + std::chrono::seconds((i * 37) % 200 - 100));
+    }
+    EXPECT_FALSE(ht.set_expiry("missing", now));
+    EXPECT_EQ(ht.expiry_count(), 200u);
+
+    // Moving and clearing deadlines keeps the heap consistent
+    ht.set_expiry("k1", now + std::chrono::hours(1));
+    EXPECT_TRUE(ht.clear_expiry("k2"));
+    EXPECT_FALSE(ht.expiry("k2").has_value());
+    ASSERT_TRUE(ht.expiry("k1").has_value());
+    EXPECT_EQ(*ht.expiry("k1"), now + std::chrono::hours(1));
+
+    auto due = ht.expired_keys(now);
+    auto removed = ht.remove_expired(now);
+    EXPECT_EQ(removed.size(), due.size());
+    for (const auto& key : removed) {
+        EXPECT_FALSE(ht.contains(key));
+        EXPECT_FALSE(ht.expiry(key).has_value());
+    }
+    EXPECT_EQ(ht.size(), 200u - removed.size());
+    EXPECT_EQ(ht.expiry_count(), 199u - removed.size());
+    EXPECT_TRUE(ht.remove_expired(now).empty());
+    // Exactly the keys due at `now` went; the rest keep their deadlines
+    for (int i = 0; i < 200; ++i) {
+        std::string key = "k" + std::to_string(i);
+        auto deadline = ht.expiry(key);
+        if (i == 2) {
+            EXPECT_TRUE(ht.contains(key));
+            EXPECT_FALSE(deadline.has_value());
+        } else if (i == 1 || (i * 37) % 200 - 100 > 0) {
+            ASSERT_TRUE(deadline.has_value()) << key;
+            EXPECT_GT(*deadline, now) << key;
+        } else {
+            EXPECT_FALSE(ht.contains(key)) << key;
+        }
+    }
+}
+
+TEST(HashTableTest, test_remove_drops_the_deadline_with_the_key) {
+    HashTable ht;
+    ht.set("k", Value("v"));
+    ht.set_expiry("k", Clock::now());
+    ASSERT_TRUE(ht.remove("k"));
+    EXPECT_EQ(ht.expiry_count(), 0u);
+    // A key recreated after removal starts without the old deadline
+    ht.set("k", Value("again"));
+    EXPECT_FALSE(ht.expiry("k").has_value());
+    EXPECT_TRUE(ht.remove_expired(Clock::now() + std::chrono::hours(1)).empty());
+    EXPECT_TRUE(ht.contains("k"));
+}
+
+TEST(HashTableTest, test_overwrite_replaces_a_due_deadline) {
+    HashTable ht;
+    auto now = Clock::now();
+    ht.set("k", Value("old"));
+    ht.set_expiry("k", now - std::chrono::seconds(1));
+
+    // Rewritten without a deadline, the key is no longer due
+    ht.set_with_expiry("k", Value("new"), std::nullopt);
+    EXPECT_FALSE(ht.expiry("k").has_value());
+    EXPECT_TRUE(ht.remove_expired(now).empty());
+    EXPECT_FALSE(ht.remove_if_expired("k", now));
+    ASSERT_TRUE(ht.get("k").has_value());
+    EXPECT_EQ(ht.get("k")->as_string(), "new");
+
+    // With a later deadline it stays until that one passes
+    ht.set_expiry("k", now - std::chrono::seconds(1));
+    ht.set_with_expiry("k", Value("newer"), now + std::chrono::seconds(10));
+    EXPECT_TRUE(ht.remove_expired(now).empty());
+    EXPECT_EQ(ht.get("k")->as_string(), "newer");
+    EXPECT_TRUE(ht.remove_if_expired("k", now + std::chrono::seconds(10)));
+    EXPECT_FALSE(ht.contains("k"));
+    EXPECT_EQ(ht.expiry_count(), 0u);
+}
+
+TEST(HashTableTest, test_background_rehash_finishes_resizes) {
+    HashTable ht;
+    for (int i = 0; i < 50000; ++i) ht.set("k" + std::to_string(i), Value(int64_t{i}));
+    // Read-only from here: only rehash_step() moves pending resizes along
+    int rounds = 0;
+    while (ht.rehash_step(std::chrono::microseconds(200))) ++rounds;
+    EXPECT_LT(rounds, 10000);
+    EXPECT_FALSE(ht.rehash_step(std::chrono::microseconds(200)));
+    for (int i = 0; i < 50000; i += 13) {
+        EXPECT_EQ(ht.get("k" + std::to_string(i))->as_integer(), i);
+    }
+    EXPECT_EQ(ht.keys().size(), 50000u);
+}
+
+TEST(HashTableTest, test_scan_shard_resumes_across_writes) {
+    HashTable ht;
+    for (int i = 0; i < 20000; ++i) ht.set("k" + std::to_string(i), Value(int64_t{i}));
+    ht.set_expiry("k7", Clock::now() + std::chrono::seconds(100));
+
+    std::set<std::string> seen;
+    bool deadline_seen = false;
+    int calls = 0;
+    for (size_t shard = 0; shard < HashTable::kShardCount; ++shard) {
+        size_t cursor = 0;
+        do {
+            size_t before = seen.size();
+            cursor = ht.scan_shard(shard, cursor, 16,
+                                   [&](const std::string& key, const Value& value, std::optional<TimePoint> deadline) {
+                if (key[0] != 'k') return;
+                EXPECT_EQ(value.as_integer(), std::stoll(key.substr(1)));
+                if (deadline) deadline_seen = key == "k7";
+                seen.insert(key);
+            });
+            EXPECT_LT(seen.size() - before, 100u);  // a few buckets' worth, not the shard
+            // Writes between calls resize the shards under the cursor
+            for (int i = 0; i < 20; ++i) ht.set("new" + std::to_string(calls * 20 + i), Value(int64_t{0}));
+            ++calls;
+        } while (cursor != 0);
+    }
+    EXPECT_TRUE(deadline_seen);
+    for (int i = 0; i < 20000; ++i) EXPECT_EQ(seen.count("k" + std::to_string(i)), 1u) << i;
+}
@@ -0,0 +1,68 @@
+#include <gtest/gtest.h>
+#include "storage/hotkeys.h"
+#include "server/command_handler.h"
+#include "protocol/parser.h"
+#include "storage/hashtable.h"
+#include <chrono>
+#include <thread>
+
+using namespace cacheforge;
+
+TEST(HotKeyTest, test_top_k_finds_hot_key) {
+    HotKeyTracker tracker(4, 1);
+    for (int i = 0; i < 1000; ++i) {
+        tracker.record("hot");
+        tracker.record("key:" + std::to_string(i));
+        if (i % 2 == 0) tracker.record("warm");
+    }
+
+    auto top = tracker.top(2);
+    ASSERT_EQ(top.size(), 2u);
+    EXPECT_EQ(top[0].first, "hot");
+    EXPECT_EQ(top[1].first, "warm");
+    EXPECT_GE(top[0].second, 1000u);
+    EXPECT_GE(tracker.estimate("warm"), 500u);
+}
+
+TEST(HotKeyTest, test_sampling_scales_estimates) {
+    HotKeyTracker tracker(4, 8);
+    for (int i = 0; i < 8000; ++i) tracker.record("hot");
+
+    EXPECT_EQ(tracker.sampled_accesses(), 1000u);
+    EXPECT_EQ(tracker.estimate("hot"), 8000u);
+}
+
+TEST(HotKeyTest, test_decay_halves_counts) {
+    HotKeyTracker tracker(4, 1, std::chrono::seconds(0));
+    for (int i = 0; i < 100; ++i) tracker.record("a");
+    tracker.record("b");
+
+    tracker.decay();
+    EXPECT_EQ(tracker.estimate("a"), 50u);
+    auto top = tracker.top(10);
+    ASSERT_EQ(top.size(), 1u);  // "b" decayed to zero and left the top-K
+    EXPECT_EQ(top[0].first, "a");
+}
+
+TEST(HotKeyTest, test_disabled_records_nothing) {
+    HotKeyTracker tracker(4, 1);
+    tracker.set_enabled(false);
+    tracker.record("a");
+    EXPECT_EQ(tracker.sampled_accesses(), 0u);
+    EXPECT_TRUE(tracker.top(10).empty());
+}
+
+TEST(HotKeyTest, test_hotkeys_command) {
+    HashTable ht(100);
+    CommandHandler handler(ht);
+    handler.hotkeys().set_sample_rate(1);
+
+    Parser parser;
+    for (int i = 0; i < 5; ++i) handler.execute(*parser.parse_text("GET popular"));
+    handler.execute(*parser.parse_text("SET other v"));
+
+    EXPECT_EQ(handler.execute(*parser.parse_text("HOTKEYS 1")),
+              "*2\r\n$7\r\npopular\r\n$1\r\n5\r\n");
+    EXPECT_EQ(handler.execute(*parser.parse_text("HOTKEYS x")),
+              "-ERR value is not an integer or out of range\r\n");
+}
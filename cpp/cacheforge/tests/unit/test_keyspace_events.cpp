@@ -0,0 +1,220 @@
+#include <gtest/gtest.h>
+#include "server/keyspace_events.h"
+#include "server/command_handler.h"
+#include "storage/hashtable.h"
+#include "storage/expiry.h"
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+
+using namespace cacheforge;
+
+namespace {
+
+Command make_cmd(std::string name, std::vector<std::string> args) {
+    return Command{std::move(name), std::move(args)};
+}
+
+struct Recorder {
+    std::vector<KeyspaceEvents::Event> events;
+    KeyspaceEvents::Consumer consumer() {
+        return [this](const KeyspaceEvents::Event& e) { events.push_back(e); };
+    }
+};
+
+}  // namespace
+
+TEST(KeyspaceEventsTest, test_parse_and_format_classes) {
+    EXPECT_EQ(KeyspaceEvents::parse_classes(""), 0);
+    EXPECT_EQ(KeyspaceEvents::parse_classes("Ex"), KeyspaceEvents::kKeyevent | KeyspaceEvents::kExpired);
+    EXPECT_EQ(KeyspaceEvents::parse_classes("KEA"),
+              KeyspaceEvents::kKeyspace | KeyspaceEvents::kKeyevent | KeyspaceEvents::kAll);
+    EXPECT_EQ(KeyspaceEvents::format_classes(KeyspaceEvents::parse_classes("KEA")), "AKE");
+    EXPECT_EQ(KeyspaceEvents::format_classes(KeyspaceEvents::parse_classes("xgK")), "Kgx");
+    EXPECT_THROW(KeyspaceEvents::parse_classes("Kq"), std::runtime_error);
+    // Nothing is evicted, so there is no class for it
+    EXPECT_THROW(KeyspaceEvents::parse_classes("Ke"), std::runtime_error);
+}
+
+TEST(KeyspaceEventsTest, test_nothing_buffered_without_listeners) {
+    KeyspaceEvents bus;
+    bus.notify(KeyspaceEvents::kGeneric, "del", "k");
+    // Classes without K, E or a consumer: nobody would see the event
+    bus.set_classes(KeyspaceEvents::kAll);
+    bus.notify(KeyspaceEvents::kGeneric, "del", "k");
+    EXPECT_EQ(bus.emitted(), 0u);
+
+    Recorder recorder;
+    auto id = bus.add_consumer(recorder.consumer());
+    bus.notify(KeyspaceEvents::kGeneric, "del", "k");
+    EXPECT_EQ(bus.drain(), 1u);
+    bus.remove_consumer(id);
+    bus.notify(KeyspaceEvents::kGeneric, "del", "k");
+    EXPECT_EQ(bus.drain(), 0u);
+    ASSERT_EQ(recorder.events.size(), 1u);
+    EXPECT_EQ(recorder.events[0].event, "del");
+    EXPECT_EQ(recorder.events[0].key, "k");
+}
+
+TEST(KeyspaceEventsTest, test_writes_raise_events_by_class) {
+    HashTable ht(100);
+    CommandHandler handler(ht);
+    auto& bus = handler.keyspace_events();
+    Recorder recorder;
+    bus.add_consumer(recorder.consumer());
+    bus.set_classes(KeyspaceEvents::parse_classes("g$h"));
+
+    handler.execute(make_cmd("SET", {"a", "1"}));
+    handler.execute(make_cmd("INCR", {"a"}));
+    handler.execute(make_cmd("HSET", {"h", "f", "v"}));
+    handler.execute(make_cmd("ZADD", {"z", "1", "m"}));      // class z is off
+    handler.execute(make_cmd("HSET", {"a", "f", "v"}));      // WRONGTYPE: no event
+    handler.execute(make_cmd("GET", {"a"}));                 // reads raise none
+    handler.execute(make_cmd("DEL", {"a", "missing", "h"}));  // one per removed key
+
+    bus.drain();
+    std::vector<std::pair<std::string, std::string>> seen;
+    for (const auto& e : recorder.events) seen.emplace_back(e.event, e.key);
+    EXPECT_EQ(seen, (std::vector<std::pair<std::string, std::string>>{
+                        {"set", "a"}, {"incr", "a"}, {"hset", "h"}, {"del", "a"}, {"del", "h"}}));
+    EXPECT_EQ(bus.delivered(), 5u);
+}
+
+TEST(KeyspaceEventsTest, test_writes_that_change_nothing_raise_no_event) {
+    HashTable ht(100);
+    ExpiryManager expiry(ht);
+    CommandHandler handler(ht, &expiry);
+    Recorder recorder;
+    handler.keyspace_events().add_consumer(recorder.consumer());
+    handler.keyspace_events().set_classes(KeyspaceEvents::kAll);
+
+    EXPECT_EQ(handler.execute(make_cmd("EXPIRE", {"missing", "10"})), ":0\r\n");
+    handler.execute(make_cmd("PFADD", {"p", "x"}));
+    EXPECT_EQ(handler.execute(make_cmd("PFADD", {"p", "x"})), ":0\r\n");  // estimate unchanged
+    handler.execute(make_cmd("BF.RESERVE", {"b", "0.01", "100"}));
+    handler.execute(make_cmd("BF.RESERVE", {"b", "0.01", "100"}));          // item exists
+    handler.execute(make_cmd("EXPIRE", {"p", "10"}));
+    handler.keyspace_events().drain();
+
+    std::vector<std::pair<std::string, std::string>> seen;
+    for (const auto& e : recorder.events) seen.emplace_back(e.event, e.key);
+    EXPECT_EQ(seen, (std::vector<std::pair<std::string, std::string>>{
+                        {"pfadd", "p"}, {"bf.reserve", "b"}, {"expire", "p"}}));
+}
+
+TEST(KeyspaceEventsTest, test_live_keys_never_raise_evicted) {
+    // Past max_size the table only reports the write; every key stays
+    HashTable ht(2);
+    CommandHandler handler(ht);
+    Recorder recorder;
+    handler.keyspace_events().add_consumer(recorder.consumer());
+    handler.keyspace_events().set_classes(KeyspaceEvents::kAll);
+
+    for (const char* key : {"a", "b", "c", "d", "c"}) handler.execute(make_cmd("SET", {key, "v"}));
+    handler.keyspace_events().drain();
+
+    EXPECT_EQ(ht.size(), 4u);
+    for (const auto& e : recorder.events) EXPECT_NE(e.event, "evicted") << e.key;
+    EXPECT_EQ(recorder.events.size(), 5u);
+    EXPECT_NE(handler.execute(make_cmd("INFO", {"stats"})).find("evicted_keys:0\r\n"), std::string::npos);
+}
+
+TEST(KeyspaceEventsTest, test_published_on_keyspace_and_keyevent_channels) {
+    HashTable ht(100);
+    CommandHandler handler(ht);
+    std::map<uint64_t, std::vector<std::string>> received;
+    handler.set_push_callback([&](uint64_t id, const std::shared_ptr<const std::string>& m) {
+        received[id].push_back(*m);
+    });
+    handler.pubsub().subscribe(1, "__keyevent@0__:pfadd");
+    handler.pubsub().psubscribe(2, "__keyspace@0__:*");
+    handler.keyspace_events().set_classes(KeyspaceEvents::parse_classes("KEA"));
+
+    handler.execute(make_cmd("PFADD", {"visitors", "alice"}));
+    EXPECT_TRUE(received.empty());  // delivered by the publisher, not the write
+    handler.keyspace_events().drain();
+
+    ASSERT_EQ(received[1].size(), 1u);
+    EXPECT_EQ(received[1][0], ">3\r\n$7\r\nmessage\r\n$20\r\n__keyevent@0__:pfadd\r\n$8\r\nvisitors\r\n");
+    ASSERT_EQ(received[2].size(), 1u);
+    EXPECT_NE(received[2][0].find("__keyspace@0__:visitors\r\n$5\r\npfadd\r\n"), std::string::npos);
+}
+
+TEST(KeyspaceEventsTest, test_full_buffer_drops_and_counts) {
+    KeyspaceEvents bus(4);
+    Recorder recorder;
+    bus.add_consumer(recorder.consumer());
+    bus.set_classes(KeyspaceEvents::kAll);
+
+    for (int i = 0; i < 10; ++i) bus.notify(KeyspaceEvents::kExpired, "expired", "k" + std::to_string(i));
+    EXPECT_EQ(bus.emitted(), 4u);
+    EXPECT_EQ(bus.dropped(), 6u);
+    EXPECT_EQ(bus.drain(), 4u);
+    ASSERT_EQ(recorder.events.size(), 4u);
+    EXPECT_EQ(recorder.events[3].key, "k3");
+
+    // Draining frees the slots again
+    bus.notify(KeyspaceEvents::kExpired, "expired", "k10");
+    EXPECT_EQ(bus.drain(), 1u);
+    EXPECT_EQ(recorder.events.back().key, "k10");
+}
+
+TEST(KeyspaceEventsTest, test_producer_threads_with_publisher_thread) {
+    constexpr int kThreads = 4;
+    constexpr int kEvents = 5000;
+    KeyspaceEvents bus(256);
+    std::map<std::string, int> per_thread;
+    bus.add_consumer([&](const KeyspaceEvents::Event& e) { per_thread[e.key.substr(0, 2)]++; });
+    bus.set_classes(KeyspaceEvents::kAll);
+    bus.start();
+
+    std::vector<std::thread> producers;
+    for (int t = 0; t < kThreads; ++t) {
+        producers.emplace_back([&bus, t]() {
+            for (int i = 0; i < kEvents; ++i) {
+                bus.notify(KeyspaceEvents::kString, "set", "t" + std::to_string(t) + ":" + std::to_string(i));
+            }
+        });
+    }
+    for (auto& p : producers) p.join();
+    bus.stop();
+
+    // Every event was either delivered or counted as dropped, and the rings
+    // of the exited threads keep their counts
+    EXPECT_EQ(bus.emitted() + bus.dropped(), static_cast<uint64_t>(kThreads * kEvents));
+    EXPECT_EQ(bus.delivered(), bus.emitted());
+    int total = 0;
+    for (const auto& [thread, count] : per_thread) total += count;
+    EXPECT_EQ(static_cast<uint64_t>(total), bus.delivered());
+    EXPECT_LE(per_thread.size(), static_cast<size_t>(kThreads));
+}
+
+TEST(KeyspaceEventsTest, test_publisher_starts_with_a_listener_and_wakes_on_events) {
+    KeyspaceEvents bus;
+    bus.start();
+    EXPECT_FALSE(bus.publishing());  // nothing listens yet
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<std::string> keys;
+    bus.add_consumer([&](const KeyspaceEvents::Event& e) {
+        std::lock_guard lock(mutex);
+        keys.push_back(e.key);
+        cv.notify_all();
+    });
+    EXPECT_FALSE(bus.publishing());  // a consumer but no class
+    bus.set_classes(KeyspaceEvents::kGeneric);
+    EXPECT_TRUE(bus.publishing());
+
+    // Each event arrives while the publisher sleeps and must wake it
+    for (int i = 0; i < 20; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        bus.notify(KeyspaceEvents::kGeneric, "del", "k" + std::to_string(i));
+        std::unique_lock lock(mutex);
+        ASSERT_TRUE(cv.wait_for(lock, std::chrono::seconds(5), [&]() { return keys.size() == size_t(i) + 1; }))
+            << "event " << i << " not delivered";
+    }
+    bus.stop();
+    EXPECT_FALSE(bus.publishing());
+}
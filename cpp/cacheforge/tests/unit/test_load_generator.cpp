@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+#include "tools/load_generator.h"
+#include "protocol/parser.h"
+#include "server/stats.h"
+#include <map>
+#include <stdexcept>
+
+using namespace cacheforge;
+
+namespace {
+
+LoadOptions parse(std::vector<std::string> args) {
+    std::vector<char*> argv{const_cast<char*>("cacheforge-benchmark")};
+    for (auto& a : args) argv.push_back(a.data());
+    return LoadOptions::parse(static_cast<int>(argv.size()), argv.data());
+}
+
+}  // namespace
+
+TEST(LoadGeneratorTest, test_parse_options) {
+    auto o = parse({"-c", "8", "-P", "16", "-k", "1000", "-d", "10-100", "-z", "0.99",
+                    "-m", "get=3,set=1", "--json"});
+    EXPECT_EQ(o.connections, 8u);
+    EXPECT_EQ(o.pipeline, 16u);
+    EXPECT_EQ(o.keyspace, 1000u);
+    EXPECT_EQ(o.value_min, 10u);
+    EXPECT_EQ(o.value_max, 100u);
+    EXPECT_DOUBLE_EQ(o.zipf, 0.99);
+    ASSERT_EQ(o.mix.size(), 2u);
+    EXPECT_EQ(o.mix[0].first, "GET");
+    EXPECT_TRUE(o.json);
+
+    EXPECT_THROW(parse({"-c", "abc"}), std::invalid_argument);
+    EXPECT_THROW(parse({"--zipf", "1.5"}), std::invalid_argument);
+    EXPECT_THROW(parse({"-m", "FLUSHALL=1"}), std::invalid_argument);
+    EXPECT_THROW(parse({"--bogus", "1"}), std::invalid_argument);
+}
+
+TEST(LoadGeneratorTest, test_zipf_is_skewed_and_in_range) {
+    std::mt19937_64 rng(42);
+    ZipfGenerator zipf(1000, 0.99);
+    std::map<uint64_t, int> counts;
+    for (int i = 0; i < 100000; ++i) {
+        uint64_t v = zipf.next(rng);
+        ASSERT_LT(v, 1000u);
+        counts[v]++;
+    }
+    // Rank 0 dominates and the head is much hotter than the tail
+    EXPECT_GT(counts[0], counts[1]);
+    EXPECT_GT(counts[0], 100000 / 20);
+    EXPECT_LT(counts[999], counts[0] / 50);
+}
+
+TEST(LoadGeneratorTest, test_uniform_when_theta_zero) {
+    std::mt19937_64 rng(7);
+    ZipfGenerator uniform(10, 0.0);
+    std::vector<int> counts(10);
+    for (int i = 0; i < 10000; ++i) counts[uniform.next(rng)]++;
+    for (int c : counts) EXPECT_NEAR(c, 1000, 200);
+}
+
+TEST(LoadGeneratorTest, test_workload_respects_mix_and_sizes) {
+    LoadOptions o;
+    o.mix = {{"SET", 1}};
+    o.value_min = 5;
+    o.value_max = 9;
+    o.keyspace = 10;
+    WorkloadGenerator workload(o, 1);
+    for (int i = 0; i < 100; ++i) {
+        auto cmd = workload.next();
+        ASSERT_EQ(cmd.name, "SET");
+        ASSERT_EQ(cmd.args.size(), 2u);
+        EXPECT_GE(cmd.args[1].size(), 5u);
+        EXPECT_LE(cmd.args[1].size(), 9u);
+        // The request must survive the server's text parser unchanged
+        Parser parser;
+        std::string line = Parser::serialize_command(cmd);
+        auto parsed = parser.parse_text(line.substr(0, line.size() - 2));
+        ASSERT_TRUE(parsed.has_value());
+        EXPECT_EQ(parsed->args, cmd.args);
+    }
+}
+
+TEST(LoadGeneratorTest, test_reply_length_framing) {
+    EXPECT_EQ(Parser::reply_length("+OK\r\n", 5), 5u);
+    EXPECT_EQ(Parser::reply_length("+OK\r", 4), 0u);
+    EXPECT_EQ(Parser::reply_length("$3\r\nabc\r\n:1\r\n", 13), 9u);
+    EXPECT_EQ(Parser::reply_length("$3\r\nab", 6), 0u);
+    EXPECT_EQ(Parser::reply_length("$-1\r\n", 5), 5u);
+    std::string arr = Parser::serialize_nullable_array({std::string("a"), std::nullopt});
+    EXPECT_EQ(Parser::reply_length(arr.data(), arr.size()), arr.size());
+    EXPECT_EQ(Parser::reply_length(arr.data(), arr.size() - 1), 0u);
+    std::string push = Parser::serialize_push("invalidate", {"k"});
+    EXPECT_EQ(Parser::reply_length(push.data(), push.size()), push.size());
+    EXPECT_THROW(Parser::reply_length("?x\r\n", 4), std::runtime_error);
+}
+
+TEST(LoadGeneratorTest, test_omission_correction_backfills) {
+    LatencyHistogram h;
+    for (int i = 0; i < 99; ++i) h.record(1000);
+    h.record(100000);  // one 100us stall with a 1us expected interval
+
+    auto corrected = h.corrected_for_omission(1000);
+    // The stall hid ~99 requests that would have waited 1..99us
+    EXPECT_NEAR(static_cast<double>(corrected.count()), 198.0, 10.0);
+    EXPECT_GT(corrected.percentile(90), h.percentile(90));
+    EXPECT_EQ(corrected.max(), h.max());
+}
@@ -1,6 +1,7 @@
 #include <gtest/gtest.h>
 #include "protocol/parser.h"
 #include <cstring>
+#include <stdexcept>
 
 using namespace cacheforge;
 
@@ -127,3 +128,32 @@ TEST(ParserTest, test_serialize_integer) {
 TEST(ParserTest, test_serialize_null) {
     EXPECT_EQ(Parser::serialize_null(), "$-1\r\n");
 }
+
+TEST(ParserTest, test_serialize_raw_round_trip) {
+    Command cmd{"SET", {"key", std::string("a\0b\r\n", 5), ""}};
+    auto frame = Parser::serialize_raw(cmd);
+    auto* data = reinterpret_cast<const uint8_t*>(frame.data());
+    EXPECT_EQ(Parser::raw_frame_length(data, frame.size()), frame.size());
+
+    Parser parser;
+    auto parsed = parser.parse_raw(data, frame.size());
+    ASSERT_TRUE(parsed.has_value());
+    EXPECT_EQ(parsed->name, "SET");
+    EXPECT_EQ(parsed->args, cmd.args);
+
+    // Back-to-back frames are measured one at a time
+    auto two = frame + Parser::serialize_raw({"DEL", {"key"}});
+    EXPECT_EQ(Parser::raw_frame_length(reinterpret_cast<const uint8_t*>(two.data()), two.size()),
+              frame.size());
+}
+
+TEST(ParserTest, test_raw_frame_length_incomplete_and_oversized) {
+    auto frame = Parser::serialize_raw({"SET", {"key", std::string(100, 'v')}});
+    auto* data = reinterpret_cast<const uint8_t*>(frame.data());
+    for (size_t n = 0; n < frame.size(); ++n) EXPECT_EQ(Parser::raw_frame_length(data, n), 0u) << n;
+
+    // Lengths beyond the budget fail as soon as they are read
+    EXPECT_THROW(Parser::raw_frame_length(data, 30, 64), std::runtime_error);
+    uint8_t huge[8] = {0xff, 0xff, 0xff, 0x7f, 0, 0, 0, 0};
+    EXPECT_THROW(Parser::raw_frame_length(huge, sizeof(huge)), std::runtime_error);
+}
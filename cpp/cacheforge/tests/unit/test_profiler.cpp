@@ -0,0 +1,153 @@
+#include <gtest/gtest.h>
+#include "server/profiler.h"
+#include "server/command_handler.h"
+#include "storage/hashtable.h"
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <sys/time.h>
+#include <unistd.h>
+
+using namespace cacheforge;
+
+// Exported (unit_tests links with -rdynamic) so the profile can name it
+extern "C" __attribute__((noinline)) double profiler_test_burn(std::chrono::milliseconds cpu_time) {
+    volatile double x = 0;
+    auto deadline = std::clock() + cpu_time.count() * CLOCKS_PER_SEC / 1000;
+    while (std::clock() < deadline) {
+        for (int i = 0; i < 1000; ++i) x = x + std::sqrt(static_cast<double>(i));
+    }
+    return x;
+}
+
+namespace {
+
+std::string temp_dir(const std::string& name) {
+    auto dir = std::filesystem::temp_directory_path() /
+               ("cacheforge_" + name + "_" + std::to_string(::getpid()));
+    std::filesystem::remove_all(dir);
+    return dir.string();
+}
+
+// Folded stacks: "frame;frame weight" per line
+std::vector<std::pair<std::string, uint64_t>> read_folded(const std::string& path) {
+    std::vector<std::pair<std::string, uint64_t>> lines;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        auto space = line.rfind(' ');
+        EXPECT_NE(space, std::string::npos) << line;
+        if (space == std::string::npos) continue;
+        lines.emplace_back(line.substr(0, space), std::stoull(line.substr(space + 1)));
+    }
+    return lines;
+}
+
+std::string run(CommandHandler& handler, const std::string& line) {
+    Parser parser;
+    return handler.execute(*parser.parse_text(line));
+}
+
+}  // namespace
+
+TEST(ProfilerTest, test_size_classes_group_entries) {
+    HashTable ht(1000);
+    for (int i = 0; i < 10; ++i) ht.set("s" + std::to_string(i), Value(std::string("v")));
+    for (int i = 0; i < 5; ++i) ht.set("b" + std::to_string(i), Value(std::string(5000, 'x')));
+    ht.set("n", Value(int64_t{42}));
+
+    size_t strings = 0, big = 0, integers = 0;
+    for (const auto& c : ht.size_classes()) {
+        EXPECT_LE(c.bytes, c.entries * c.max_bytes);
+        EXPECT_GT(c.bytes, c.entries * c.max_bytes / 2);
+        if (c.type == Value::Type::String && c.max_bytes < 1024) strings += c.entries;
+        if (c.type == Value::Type::String && c.max_bytes == 8192) big += c.entries;
+        if (c.type == Value::Type::Integer) integers += c.entries;
+    }
+    EXPECT_EQ(strings, 10u);
+    EXPECT_EQ(big, 5u);
+    EXPECT_EQ(integers, 1u);
+}
+
+TEST(ProfilerTest, test_heap_profile_is_folded_and_weighted_by_bytes) {
+    auto dir = temp_dir("heap_profile");
+    HashTable ht(1000);
+    for (int i = 0; i < 100; ++i) ht.set("k" + std::to_string(i), Value(std::string(100, 'v')));
+    Profiler profiler(dir);
+    std::string path = profiler.write_heap(ht);
+    EXPECT_EQ(path.rfind(dir + "/heap_", 0), 0u);
+
+    uint64_t keyspace = 0;
+    for (const auto& [stack, bytes] : read_folded(path)) {
+        EXPECT_EQ(stack.rfind("heap;", 0), 0u) << stack;
+        if (stack.rfind("heap;keyspace;string;", 0) == 0) keyspace += bytes;
+    }
+    EXPECT_GE(keyspace, 100u * 200);
+    std::filesystem::remove_all(dir);
+}
+
+TEST(ProfilerTest, test_cpu_profile_samples_running_code) {
+    auto dir = temp_dir("cpu_profile");
+    Profiler profiler(dir);
+    EXPECT_FALSE(profiler.cpu_status().running);
+    EXPECT_THROW(profiler.stop_cpu(), std::runtime_error);
+    EXPECT_THROW(profiler.start_cpu(0), std::runtime_error);
+
+    profiler.start_cpu(500);
+    EXPECT_THROW(profiler.start_cpu(), std::runtime_error);
+    Profiler other(dir);
+    EXPECT_THROW(other.start_cpu(), std::runtime_error);
+    profiler_test_burn(std::chrono::milliseconds(400));
+    auto status = profiler.cpu_status();
+    EXPECT_TRUE(status.running);
+    EXPECT_EQ(status.hz, 500);
+    EXPECT_GT(status.samples, 20u);
+
+    std::string path = profiler.stop_cpu();
+    EXPECT_FALSE(profiler.cpu_status().running);
+    uint64_t total = 0, burning = 0;
+    for (const auto& [stack, count] : read_folded(path)) {
+        total += count;
+        if (stack.find("profiler_test_burn") != std::string::npos) burning += count;
+    }
+    EXPECT_GT(total, 20u);
+    EXPECT_GT(burning, total / 2);
+
+    // Stopped profiles can be restarted
+    profiler.start_cpu();
+    profiler.stop_cpu();
+
+    // The slowest rate arms a whole-second timer rather than an invalid one
+    profiler.start_cpu(1);
+    struct itimerval timer{};
+    ASSERT_EQ(getitimer(ITIMER_PROF, &timer), 0);
+    EXPECT_EQ(timer.it_interval.tv_sec, 1);
+    EXPECT_EQ(timer.it_interval.tv_usec, 0);
+    profiler.stop_cpu();
+    std::filesystem::remove_all(dir);
+}
+
+TEST(ProfilerTest, test_profile_command) {
+    auto dir = temp_dir("profile_command");
+    HashTable ht(100);
+    CommandHandler handler(ht);
+    EXPECT_EQ(run(handler, "PROFILE HEAP"), "-ERR profiling is not available\r\n");
+
+    Profiler profiler(dir);
+    handler.set_profiler(&profiler);
+    EXPECT_EQ(run(handler, "PROFILE CPU START 5000").rfind("-ERR sampling rate", 0), 0u);
+    EXPECT_EQ(run(handler, "PROFILE CPU STOP"), "-ERR no CPU profile is running\r\n");
+    EXPECT_EQ(run(handler, "PROFILE CPU START 200"), "+OK\r\n");
+    EXPECT_NE(run(handler, "PROFILE CPU STATUS").find("running:1\r\nhz:200\r\n"), std::string::npos);
+    std::string stopped = run(handler, "PROFILE CPU STOP");
+    ASSERT_EQ(stopped[0], '$');
+    EXPECT_NE(stopped.find(dir + "/cpu_"), std::string::npos);
+    EXPECT_NE(run(handler, "PROFILE HEAP").find(dir + "/heap_"), std::string::npos);
+    EXPECT_EQ(run(handler, "PROFILE NOPE").rfind("-ERR unknown subcommand", 0), 0u);
+    std::filesystem::remove_all(dir);
+}
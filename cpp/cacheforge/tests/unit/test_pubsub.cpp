@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+#include "server/pubsub.h"
+#include "server/command_handler.h"
+#include "storage/hashtable.h"
+#include <map>
+
+using namespace cacheforge;
+
+namespace {
+
+bool glob(const std::string& pattern, const std::string& s) {
+    return PubSub::glob_match(pattern.data(), pattern.size(), s.data(), s.size());
+}
+
+struct Recorder {
+    std::map<uint64_t, std::vector<PubSub::Message>> received;
+    PubSub::Deliver deliver() {
+        return [this](uint64_t id, const PubSub::Message& m) { received[id].push_back(m); };
+    }
+};
+
+}  // namespace
+
+TEST(PubSubTest, test_glob_match) {
+    EXPECT_TRUE(glob("news.*", "news.sports"));
+    EXPECT_TRUE(glob("news.*", "news."));
+    EXPECT_FALSE(glob("news.*", "news"));
+    EXPECT_TRUE(glob("h?llo", "hallo"));
+    EXPECT_FALSE(glob("h?llo", "hllo"));
+    EXPECT_TRUE(glob("h[ae]llo", "hello"));
+    EXPECT_FALSE(glob("h[^e]llo", "hello"));
+    EXPECT_TRUE(glob("h[a-c]llo", "hbllo"));
+    EXPECT_TRUE(glob("a\\*b", "a*b"));
+    EXPECT_FALSE(glob("a\\*b", "axb"));
+    EXPECT_TRUE(glob("*", ""));
+    EXPECT_TRUE(glob("**x*", "abxcd"));
+    EXPECT_TRUE(glob("*.[ab]*", "x.y.bz"));
+    EXPECT_TRUE(glob("a[bc", "ab"));  // an unterminated class ends the pattern
+    EXPECT_FALSE(glob("a[bc", "abc"));
+}
+
+TEST(PubSubTest, test_glob_match_many_stars_is_not_exponential) {
+    // Backtracking into every star would try ~C(64, 20) splits here
+    std::string pattern;
+    for (int i = 0; i < 20; ++i) pattern += "a*";
+    pattern += "b";
+    std::string channel(64, 'a');
+    EXPECT_FALSE(glob(pattern, channel));
+    EXPECT_TRUE(glob(pattern, channel + "b"));
+}
+
+TEST(PubSubTest, test_subscribe_counts_and_unsubscribe) {
+    PubSub ps;
+    EXPECT_EQ(ps.subscribe(1, "a"), 1u);
+    EXPECT_EQ(ps.subscribe(1, "a"), 1u);  // duplicate is a no-op
+    EXPECT_EQ(ps.subscribe(1, "b"), 2u);
+    EXPECT_EQ(ps.psubscribe(1, "c.*"), 3u);
+    EXPECT_EQ(ps.subscribe(2, "a"), 1u);
+    EXPECT_EQ(ps.num_subscribers("a"), 2u);
+    EXPECT_EQ(ps.num_patterns(), 1u);
+
+    EXPECT_EQ(ps.unsubscribe(1, "a"), 2u);
+    EXPECT_EQ(ps.punsubscribe(1, "c.*"), 1u);
+    EXPECT_EQ(ps.num_patterns(), 0u);
+    EXPECT_EQ(ps.active_channels(), (std::vector<std::string>{"a", "b"}));
+    EXPECT_EQ(ps.active_channels("b*"), (std::vector<std::string>{"b"}));
+
+    ps.forget_client(1);
+    ps.forget_client(2);
+    EXPECT_TRUE(ps.active_channels().empty());
+    EXPECT_TRUE(ps.channels_of(1).empty());
+}
+
+TEST(PubSubTest, test_publish_shares_one_buffer) {
+    PubSub ps;
+    for (uint64_t id = 1; id <= 100; ++id) ps.subscribe(id, "news");
+    Recorder rec;
+    EXPECT_EQ(ps.publish("news", "hello", rec.deliver()), 100u);
+    ASSERT_EQ(rec.received.size(), 100u);
+
+    const auto& first = rec.received.begin()->second.at(0);
+    EXPECT_EQ(*first, ">3\r\n$7\r\nmessage\r\n$4\r\nnews\r\n$5\r\nhello\r\n");
+    for (const auto& [id, msgs] : rec.received) {
+        ASSERT_EQ(msgs.size(), 1u);
+        EXPECT_EQ(msgs[0].get(), first.get());  // same allocation, not a copy
+    }
+    EXPECT_EQ(ps.publish("other", "x", rec.deliver()), 0u);
+}
+
+TEST(PubSubTest, test_pattern_trie_matching) {
+    PubSub ps;
+    ps.psubscribe(1, "news.*");
+    ps.psubscribe(2, "news.sp*");
+    ps.psubscribe(3, "*");
+    ps.psubscribe(4, "weather.*");
+    ps.psubscribe(5, "news.[st]*");
+    ps.subscribe(1, "news.sports");
+
+    Recorder rec;
+    // Channel subscription plus four matching patterns
+    EXPECT_EQ(ps.publish("news.sports", "goal", rec.deliver()), 5u);
+    EXPECT_EQ(rec.received[1].size(), 2u);
+    EXPECT_EQ(rec.received.count(4), 0u);
+    EXPECT_EQ(*rec.received[2][0],
+              ">4\r\n$8\r\npmessage\r\n$8\r\nnews.sp*\r\n$11\r\nnews.sports\r\n$4\r\ngoal\r\n");
+
+    EXPECT_EQ(ps.publish("news", "x", nullptr), 1u);  // only "*"
+    ps.forget_client(3);
+    EXPECT_EQ(ps.publish("news", "x", nullptr), 0u);
+    EXPECT_EQ(ps.num_patterns(), 4u);
+}
+
+TEST(PubSubTest, test_commands_through_handler) {
+    HashTable table;
+    CommandHandler handler(table);
+    std::map<uint64_t, std::vector<std::string>> pushed;
+    handler.set_push_callback([&](uint64_t id, const std::shared_ptr<const std::string>& m) {
+        pushed[id].push_back(*m);
+    });
+
+    ClientState sub{1};
+    ClientState pub{2};
+    EXPECT_EQ(handler.execute({"SUBSCRIBE", {"a", "b"}}, sub),
+              ">3\r\n$9\r\nsubscribe\r\n$1\r\na\r\n:1\r\n>3\r\n$9\r\nsubscribe\r\n$1\r\nb\r\n:2\r\n");
+    EXPECT_EQ(sub.subscriptions, 2u);
+    EXPECT_EQ(handler.execute({"PSUBSCRIBE", {"a*"}}, sub),
+              ">3\r\n$10\r\npsubscribe\r\n$2\r\na*\r\n:3\r\n");
+
+    EXPECT_EQ(handler.execute({"PUBLISH", {"a", "hi"}}, pub), ":2\r\n");
+    ASSERT_EQ(pushed[1].size(), 2u);
+    EXPECT_EQ(handler.execute({"PUBSUB", {"NUMSUB", "a", "zz"}}, pub),
+              "*4\r\n$1\r\na\r\n:1\r\n$2\r\nzz\r\n:0\r\n");
+    EXPECT_EQ(handler.execute({"PUBSUB", {"NUMPAT"}}, pub), ":1\r\n");
+
+    handler.execute({"UNSUBSCRIBE", {}}, sub);
+    EXPECT_EQ(sub.subscriptions, 1u);
+    EXPECT_EQ(handler.execute({"PUNSUBSCRIBE", {}}, sub),
+              ">3\r\n$12\r\npunsubscribe\r\n$2\r\na*\r\n:0\r\n");
+    EXPECT_EQ(handler.execute({"UNSUBSCRIBE", {}}, sub),
+              ">3\r\n$11\r\nunsubscribe\r\n$-1\r\n:0\r\n");
+    EXPECT_EQ(handler.execute({"PUBLISH", {"a", "hi"}}, pub), ":0\r\n");
+}
@@ -0,0 +1,141 @@
+#include <gtest/gtest.h>
+#include "server/slowlog.h"
+#include "server/latency_monitor.h"
+#include "server/command_handler.h"
+#include "protocol/parser.h"
+#include "storage/hashtable.h"
+#include <thread>
+#include <vector>
+
+using namespace cacheforge;
+
+TEST(SlowLogTest, test_threshold) {
+    SlowLog log(4, 100);
+    EXPECT_FALSE(log.is_slow(99));
+    EXPECT_TRUE(log.is_slow(100));
+    log.set_threshold_us(-1);
+    EXPECT_FALSE(log.is_slow(1000000));
+}
+
+TEST(SlowLogTest, test_ring_keeps_newest_first) {
+    SlowLog log(3, 0);
+    for (int i = 0; i < 5; ++i) {
+        log.record("GET", {"key" + std::to_string(i)}, "127.0.0.1:5000", 100 + i);
+    }
+    EXPECT_EQ(log.size(), 3u);
+
+    auto entries = log.entries(10);
+    ASSERT_EQ(entries.size(), 3u);
+    EXPECT_EQ(entries[0].id, 4u);
+    EXPECT_EQ(entries[0].args, (std::vector<std::string>{"GET", "key4"}));
+    EXPECT_EQ(entries[0].duration_us, 104u);
+    EXPECT_EQ(entries[0].client, "127.0.0.1:5000");
+    EXPECT_EQ(entries[2].id, 2u);
+
+    log.reset();
+    EXPECT_EQ(log.size(), 0u);
+    EXPECT_TRUE(log.entries(10).empty());
+}
+
+TEST(SlowLogTest, test_arguments_are_truncated) {
+    SlowLog log(4, 0);
+    std::vector<std::string> args(20, std::string(100, 'x'));
+    log.record("HSET", args, "", 1);
+
+    auto entries = log.entries(1);
+    ASSERT_EQ(entries.size(), 1u);
+    ASSERT_EQ(entries[0].args.size(), SlowLog::kMaxArgs);
+    EXPECT_EQ(entries[0].args[1].size(), SlowLog::kMaxArgLen);
+    EXPECT_EQ(entries[0].args.back(), "... (14 more arguments)");
+}
+
+TEST(SlowLogTest, test_concurrent_writers) {
+    SlowLog log(64, 0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&log, t]() {
+            for (int i = 0; i < 1000; ++i) {
+                log.record("SET", {"k" + std::to_string(t)}, "", static_cast<uint64_t>(i));
+            }
+        });
+    }
+    for (int i = 0; i < 100; ++i) {
+        for (auto& e : log.entries(64)) {
+            ASSERT_EQ(e.args.size(), 2u);
+            EXPECT_EQ(e.args[0], "SET");
+        }
+    }
+    for (auto& t : threads) t.join();
+    EXPECT_EQ(log.size(), 64u);
+}
+
+TEST(SlowLogTest, test_latency_monitor_tracks_events) {
+    LatencyMonitor monitor(0);
+    monitor.record("expire-cycle", 5000);
+    EXPECT_TRUE(monitor.latest().empty());  // disabled
+
+    monitor.set_threshold_us(100);
+    monitor.record("expire-cycle", 50);
+    monitor.record("expire-cycle", 300);
+    monitor.record("expire-cycle", 200);  // same second: keeps the worst
+    monitor.record("command", 150);
+
+    auto latest = monitor.latest();
+    ASSERT_EQ(latest.size(), 2u);
+    EXPECT_EQ(latest[1].event, "expire-cycle");
+    EXPECT_EQ(latest[1].max_us, 300u);
+    EXPECT_LE(monitor.history("expire-cycle").size(), 2u);
+
+    EXPECT_EQ(monitor.reset({"command"}), 1u);
+    EXPECT_EQ(monitor.latest().size(), 1u);
+}
+
+TEST(SlowLogTest, test_latency_scope_records_when_it_ends) {
+    LatencyMonitor monitor(1000);
+    {
+        LatencyMonitor::Scope timed(monitor, "snapshot-load");
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        EXPECT_TRUE(monitor.latest().empty());
+    }
+    auto latest = monitor.latest();
+    ASSERT_EQ(latest.size(), 1u);
+    EXPECT_EQ(latest[0].event, "snapshot-load");
+    EXPECT_GE(latest[0].max_us, 5000u);
+
+    // Under the threshold nothing is kept
+    { LatencyMonitor::Scope timed(monitor, "tiering-compact"); }
+    EXPECT_EQ(monitor.latest().size(), 1u);
+}
+
+TEST(SlowLogTest, test_every_command_reaches_slowlog_whatever_the_sample_rate) {
+    HashTable ht(100);
+    CommandHandler handler(ht);
+    handler.stats().set_latency_sample_rate(8);
+    handler.slowlog().set_threshold_us(0);
+    Parser parser;
+    for (int i = 0; i < 80; ++i) handler.execute(*parser.parse_text("SET k" + std::to_string(i) + " v"));
+    EXPECT_EQ(handler.slowlog().size(), 80u);
+}
+
+TEST(SlowLogTest, test_slowlog_commands) {
+    HashTable ht(100);
+    CommandHandler handler(ht);
+    handler.stats().set_latency_sample_rate(1);
+    handler.slowlog().set_threshold_us(0);
+
+    Parser parser;
+    ClientState client;
+    client.addr = "10.0.0.1:1234";
+    handler.execute(*parser.parse_text("SET k v"), client);
+    // Stop logging so the SLOWLOG calls below do not log themselves
+    handler.slowlog().set_threshold_us(-1);
+    EXPECT_EQ(handler.execute(*parser.parse_text("SLOWLOG LEN")), ":1\r\n");
+
+    std::string reply = handler.execute(*parser.parse_text("SLOWLOG GET 1"));
+    EXPECT_EQ(reply.rfind("*1\r\n*5\r\n:0\r\n", 0), 0u);
+    EXPECT_NE(reply.find("*3\r\n$3\r\nSET\r\n$1\r\nk\r\n$1\r\nv\r\n$13\r\n10.0.0.1:1234\r\n"),
+              std::string::npos);
+
+    EXPECT_EQ(handler.execute(*parser.parse_text("SLOWLOG RESET")), "+OK\r\n");
+    EXPECT_EQ(handler.execute(*parser.parse_text("SLOWLOG LEN")), ":0\r\n");
+}
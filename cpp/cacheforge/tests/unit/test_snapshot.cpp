@@ -1,5 +1,10 @@
 #include <gtest/gtest.h>
 #include "persistence/snapshot.h"
+#include "storage/hashtable.h"
+#include "storage/expiry.h"
+#include "data/hash_object.h"
+#include "data/sorted_set.h"
+#include <chrono>
 #include <filesystem>
 #include <fstream>
 #include <string>
@@ -121,3 +126,99 @@ TEST(SnapshotTest, test_save_snapshot_exception_safety) {
         << "save_snapshot uses raw new SnapshotWriter (leaks on exception). "
            "Use std::make_unique<SnapshotWriter>(...) instead.";
 }
+
+// ========== Parallel warm-restart load ==========
+
+TEST(SnapshotTest, test_load_into_matches_load_snapshot) {
+    std::string dir = "/tmp/cacheforge_test_load_into";
+    std::filesystem::remove_all(dir);
+    SnapshotManager sm(dir);
+
+    std::vector<SnapshotEntry> entries;
+    for (int i = 0; i < 20000; ++i) {
+        std::string key = "key:" + std::to_string(i);
+        if (i % 3 == 0) {
+            HashObject h;
+            h.set("field", std::to_string(i));
+            entries.push_back({key, Value(h), 0});
+        } else if (i % 3 == 1) {
+            SortedSet z;
+            z.add("member", i);
+            entries.push_back({key, Value(z), 0});
+        } else {
+            entries.push_back({key, Value("value" + std::to_string(i)), 0});
+        }
+    }
+    ASSERT_TRUE(sm.save_snapshot(entries));
+
+    HashTable table(100000);
+    LoadProgress progress;
+    ASSERT_TRUE(sm.load_into(table, nullptr, &progress, 4));
+    EXPECT_FALSE(progress.loading.load());
+    EXPECT_EQ(progress.loaded_keys.load(), 20000u);
+    EXPECT_EQ(progress.loaded_bytes.load(), progress.total_bytes.load());
+    ASSERT_EQ(table.size(), 20000u);
+    EXPECT_EQ(table.get("key:3")->as_hash().get("field"), "3");
+    EXPECT_EQ(table.get("key:4")->as_sorted_set().score("member"), 4.0);
+    EXPECT_EQ(table.get("key:5")->as_string(), "value5");
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST(SnapshotTest, test_load_into_counts_ttl_from_save_time) {
+    std::string dir = "/tmp/cacheforge_test_load_ttl";
+    std::filesystem::remove_all(dir);
+    {
+        SnapshotManager sm(dir);
+        std::vector<SnapshotEntry> entries = {
+            {"forever", Value("a"), 0}, {"gone", Value("b"), 60}, {"later", Value("c"), 500}};
+        ASSERT_TRUE(sm.save_snapshot(entries));
+    }
+    // Pretend the snapshot was saved 100 seconds ago
+    auto saved = std::chrono::duration_cast<std::chrono::seconds>(
+                     std::chrono::system_clock::now().time_since_epoch()).count() - 100;
+    for (const auto& file : std::filesystem::directory_iterator(dir)) {
+        std::filesystem::rename(file.path(), dir + "/snapshot_" + std::to_string(saved) + ".rdb");
+    }
+
+    SnapshotManager sm(dir);
+    HashTable table(100);
+    ExpiryManager expiry(table);
+    LoadProgress progress;
+    ASSERT_TRUE(sm.load_into(table, &expiry, &progress, 2));
+    EXPECT_EQ(progress.loaded_keys.load(), 2u);
+    EXPECT_EQ(progress.expired_keys.load(), 1u);
+    EXPECT_TRUE(table.contains("forever"));
+    EXPECT_FALSE(table.contains("gone"));
+    EXPECT_FALSE(table.expiry("forever").has_value());
+    auto ttl = expiry.get_ttl("later").count();
+    EXPECT_GE(ttl, 395);
+    EXPECT_LE(ttl, 400);
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST(SnapshotTest, test_load_into_stops_at_corrupt_record) {
+    std::string dir = "/tmp/cacheforge_test_load_corrupt";
+    std::filesystem::remove_all(dir);
+    SnapshotManager sm(dir);
+    std::vector<SnapshotEntry> entries = {{"a", Value("1"), 0}, {"b", Value("2"), 0}};
+    ASSERT_TRUE(sm.save_snapshot(entries));
+    {
+        std::ofstream out(sm.latest_snapshot_path(), std::ios::binary | std::ios::app);
+        size_t huge = static_cast<size_t>(1) << 40;
+        out.write(reinterpret_cast<const char*>(&huge), sizeof(huge));
+        out << "garbage";
+    }
+
+    HashTable table(100);
+    ASSERT_TRUE(sm.load_into(table, nullptr));
+    EXPECT_EQ(table.size(), 2u);
+
+    HashTable empty(100);
+    SnapshotManager none("/tmp/cacheforge_test_load_none");
+    EXPECT_FALSE(none.load_into(empty, nullptr));
+
+    std::filesystem::remove_all(dir);
+    std::filesystem::remove_all("/tmp/cacheforge_test_load_none");
+}
@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+#include "server/stats.h"
+#include "server/command_handler.h"
+#include "protocol/parser.h"
+#include "storage/hashtable.h"
+#include <thread>
+#include <vector>
+
+using namespace cacheforge;
+
+TEST(StatsTest, test_histogram_bucket_precision) {
+    for (uint64_t v : {0ULL, 7ULL, 8ULL, 100ULL, 12345ULL, 987654321ULL}) {
+        size_t b = LatencyHistogram::bucket_for(v);
+        uint64_t upper = LatencyHistogram::bucket_upper_bound(b);
+        EXPECT_GE(upper, v);
+        EXPECT_LE(upper, v + v / 8 + 1) << v;
+        EXPECT_EQ(LatencyHistogram::bucket_for(upper), b);
+    }
+    EXPECT_EQ(LatencyHistogram::bucket_for(UINT64_MAX), LatencyHistogram::kBuckets - 1);
+}
+
+TEST(StatsTest, test_histogram_percentiles) {
+    LatencyHistogram h;
+    for (uint64_t i = 1; i <= 1000; ++i) h.record(i * 1000);
+    EXPECT_EQ(h.count(), 1000u);
+    EXPECT_NEAR(static_cast<double>(h.percentile(50)), 500000.0, 500000.0 / 8);
+    EXPECT_NEAR(static_cast<double>(h.percentile(99)), 990000.0, 990000.0 / 8);
+}
+
+TEST(StatsTest, test_counters_aggregate_across_threads) {
+    Stats stats;
+    size_t get = stats.register_command("GET");
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&]() {
+            for (int i = 0; i < 1000; ++i) {
+                stats.add(Stats::kKeyspaceHits);
+                stats.record_call(get);
+                stats.record_latency(get, 500);
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+
+    auto snap = stats.snapshot();
+    EXPECT_EQ(snap.counters[Stats::kKeyspaceHits], 4000u);
+    ASSERT_EQ(snap.commands.size(), 1u);
+    EXPECT_EQ(snap.commands[0].name, "GET");
+    EXPECT_EQ(snap.commands[0].calls, 4000u);
+    EXPECT_EQ(snap.commands[0].latency.count(), 4000u);
+}
+
+TEST(StatsTest, test_latency_sampling) {
+    Stats stats;
+    stats.set_latency_sample_rate(4);
+    int sampled = 0;
+    for (int i = 0; i < 100; ++i) {
+        if (stats.sample_latency()) sampled++;
+    }
+    EXPECT_EQ(sampled, 25);
+
+    stats.set_enabled(false);
+    EXPECT_FALSE(stats.sample_latency());
+}
+
+TEST(StatsTest, test_info_reports_commands_and_hits) {
+    HashTable ht(100);
+    CommandHandler handler(ht);
+    handler.stats().set_latency_sample_rate(1);
+    Parser parser;
+
+    handler.execute(*parser.parse_text("SET k v"));
+    handler.execute(*parser.parse_text("GET k"));
+    handler.execute(*parser.parse_text("GET missing"));
+
+    std::string info = handler.execute(*parser.parse_text("INFO"));
+    EXPECT_NE(info.find("keyspace_hits:1\r\n"), std::string::npos);
+    EXPECT_NE(info.find("keyspace_misses:1\r\n"), std::string::npos);
+    EXPECT_NE(info.find("cmdstat_get:calls=2,"), std::string::npos);
+    EXPECT_NE(info.find("latency_percentiles_usec_set:"), std::string::npos);
+    EXPECT_NE(info.find("keys:1\r\n"), std::string::npos);
+
+    std::string stats_only = handler.execute(*parser.parse_text("INFO stats"));
+    EXPECT_EQ(stats_only.find("# Memory"), std::string::npos);
+    EXPECT_NE(stats_only.find("# Stats"), std::string::npos);
+}
@@ -0,0 +1,242 @@
+#include <gtest/gtest.h>
+#include "storage/tiering.h"
+#include "storage/value_log.h"
+#include "storage/hashtable.h"
+#include "server/command_handler.h"
+#include <filesystem>
+#include <string>
+#include <unistd.h>
+
+using namespace cacheforge;
+
+namespace {
+
+std::string temp_dir(const std::string& name) {
+    auto dir = std::filesystem::temp_directory_path() /
+               ("cacheforge_" + name + "_" + std::to_string(::getpid()));
+    std::filesystem::remove_all(dir);
+    return dir.string();
+}
+
+std::string payload(int i, size_t size = 1000) {
+    std::string s = "value-" + std::to_string(i) + "-";
+    s.resize(size, 'x');
+    return s;
+}
+
+}  // namespace
+
+TEST(TieringTest, test_value_log_append_read_release) {
+    auto dir = temp_dir("vlog");
+    {
+        ValueLog log(dir, 4096);
+        auto a = log.append(1, "hello");
+        auto b = log.append(2, std::string(3000, 'b'));
+        EXPECT_EQ(log.read(a), "hello");
+        EXPECT_EQ(log.read(b), std::string(3000, 'b'));
+        EXPECT_EQ(b.type, 2);
+        EXPECT_EQ(log.live_bytes(), 3005u);
+
+        // Does not fit the first segment, so the first one is sealed
+        auto c = log.append(0, std::string(2000, 'c'));
+        EXPECT_NE(c.segment, a.segment);
+        EXPECT_EQ(log.segment_count(), 2u);
+        EXPECT_EQ(log.read(a), "hello");  // sealed segments stay readable
+
+        // Larger than a segment: gets one of its own
+        auto big = log.append(0, std::string(10000, 'd'));
+        EXPECT_EQ(log.read(big).size(), 10000u);
+
+        EXPECT_TRUE(log.compaction_candidates(0.5).empty());
+        log.release(b);
+        auto candidates = log.compaction_candidates(0.5);
+        ASSERT_EQ(candidates.size(), 1u);
+        EXPECT_EQ(candidates[0], a.segment);
+        log.drop_segment(a.segment);
+        EXPECT_THROW(log.read(a), std::runtime_error);
+        EXPECT_EQ(log.read(c), std::string(2000, 'c'));
+    }
+    // Segment files go away with the log
+    EXPECT_TRUE(std::filesystem::is_empty(dir));
+    std::filesystem::remove_all(dir);
+}
+
+TEST(TieringTest, test_demoted_values_read_back_and_promote) {
+    auto dir = temp_dir("demote");
+    HashTable ht;
+    ValueLog log(dir, 1 << 20);
+    ht.set_value_log(&log, 2);
+
+    HashObject hash;
+    hash.set("f", "v");
+    ht.set("h", Value(std::move(hash)));
+    ht.set("s", Value(payload(1)));
+    uint64_t version = ht.version("s");
+    ASSERT_TRUE(ht.demote("s"));
+    ASSERT_TRUE(ht.demote("h"));
+    EXPECT_FALSE(ht.demote("s"));
+    EXPECT_FALSE(ht.demote("missing"));
+    EXPECT_EQ(ht.cold_count(), 2u);
+    EXPECT_FALSE(ht.resident_size("s").has_value());
+    EXPECT_EQ(ht.version("s"), version);  // moving tiers is not a write
+
+    // First read decodes from the log, the second promotes
+    EXPECT_EQ(ht.get("s")->as_string(), payload(1));
+    EXPECT_EQ(ht.cold_count(), 2u);
+    EXPECT_TRUE(ht.view("s", [](const Value& v) { EXPECT_EQ(v.as_string(), payload(1)); }));
+    EXPECT_EQ(ht.cold_count(), 1u);
+    EXPECT_EQ(ht.promotions(), 1u);
+    EXPECT_TRUE(ht.resident_size("s").has_value());
+
+    // Writes promote at once
+    ht.update("h", [](Value& v, bool created) {
+        EXPECT_FALSE(created);
+        EXPECT_EQ(*v.as_hash().get("f"), "v");
+        v.as_hash().set("g", "w");
+        return true;
+    });
+    EXPECT_EQ(ht.cold_count(), 0u);
+    EXPECT_EQ(log.live_bytes(), 0u);
+
+    // Overwrite and remove release the log record
+    ht.demote("s");
+    ht.set("s", Value("new"));
+    ht.demote("h");
+    ht.remove("h");
+    EXPECT_EQ(ht.cold_count(), 0u);
+    EXPECT_EQ(log.live_bytes(), 0u);
+    EXPECT_EQ(ht.get("s")->as_string(), "new");
+    std::filesystem::remove_all(dir);
+}
+
+TEST(TieringTest, test_budget_demotes_least_recently_used) {
+    TieringOptions options;
+    options.dir = temp_dir("budget");
+    options.memory_budget = 20 * 1100;
+    options.segment_bytes = 64 * 1024;
+    options.promote_after = 2;
+    HashTable ht;
+    TieredStorage tiers(ht, options);
+
+    for (int i = 0; i < 100; ++i) {
+        ht.set("k" + std::to_string(i), Value(payload(i)));
+        tiers.on_write("k" + std::to_string(i));
+    }
+    EXPECT_LE(tiers.resident_bytes(), options.memory_budget);
+    EXPECT_GE(ht.cold_count(), 80u);
+    EXPECT_EQ(ht.size(), 100u);
+    // The oldest keys went first, the newest are resident
+    EXPECT_FALSE(ht.resident_size("k0").has_value());
+    EXPECT_TRUE(ht.resident_size("k99").has_value());
+
+    // Every value is still readable, and a key read twice comes back
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_EQ(ht.get("k" + std::to_string(i))->as_string(), payload(i));
+    }
+    ht.get("k0");
+    tiers.on_read("k0");
+    EXPECT_TRUE(ht.resident_size("k0").has_value());
+    // The read itself never demotes; the periodic pass brings the table
+    // back under budget and keeps the key just read
+    EXPECT_GT(tiers.enforce_budget(), 0u);
+    EXPECT_TRUE(ht.resident_size("k0").has_value());
+    EXPECT_LE(tiers.resident_bytes(), options.memory_budget);
+    std::filesystem::remove_all(options.dir);
+}
+
+TEST(TieringTest, test_table_lru_follows_reads_and_writes) {
+    auto dir = temp_dir("lru");
+    ValueLog log(dir, 64 * 1024);
+    HashTable ht;
+    ht.set_value_log(&log, 0);
+    for (const char* key : {"a", "b", "c"}) ht.set(key, Value(payload(0)));
+    size_t resident = ht.resident_bytes();
+    EXPECT_EQ(resident, 3 * *ht.resident_size("a"));
+
+    // A read moves "a" to the front, so "b" is now the oldest
+    EXPECT_TRUE(ht.touch("a"));
+    ASSERT_TRUE(ht.demote_lru());
+    EXPECT_FALSE(ht.resident_size("b").has_value());
+    // A write does the same for "c", leaving "a" the oldest
+    ht.set("c", Value(payload(1)));
+    ASSERT_TRUE(ht.demote_lru());
+    EXPECT_FALSE(ht.resident_size("a").has_value());
+    EXPECT_TRUE(ht.resident_size("c").has_value());
+    EXPECT_EQ(ht.resident_bytes(), *ht.resident_size("c"));
+
+    // Removing the last resident key empties the LRU
+    ht.remove("c");
+    EXPECT_EQ(ht.resident_bytes(), 0u);
+    EXPECT_FALSE(ht.demote_lru());
+    std::filesystem::remove_all(dir);
+}
+
+TEST(TieringTest, test_read_key_outlives_later_writes) {
+    auto dir = temp_dir("touch");
+    ValueLog log(dir, 64 * 1024);
+    HashTable ht;
+    ht.set_value_log(&log, 0);
+    for (int i = 0; i < 20; ++i) ht.set("k" + std::to_string(i), Value(payload(i)));
+
+    // The read only stamps "k0"; demotion relinks it once it reaches its
+    // shard's tail and takes every other key first
+    EXPECT_TRUE(ht.touch("k0"));
+    for (int i = 0; i < 19; ++i) ASSERT_TRUE(ht.demote_lru());
+    EXPECT_TRUE(ht.resident_size("k0").has_value());
+    EXPECT_EQ(ht.cold_count(), 19u);
+    ASSERT_TRUE(ht.demote_lru());
+    EXPECT_FALSE(ht.resident_size("k0").has_value());
+    EXPECT_EQ(ht.get("k0")->as_string(), payload(0));
+    std::filesystem::remove_all(dir);
+}
+
+TEST(TieringTest, test_compaction_rewrites_live_records) {
+    TieringOptions options;
+    options.dir = temp_dir("compact");
+    options.memory_budget = 0;  // everything goes cold
+    options.segment_bytes = 16 * 1024;
+    options.promote_after = 0;
+    HashTable ht;
+    TieredStorage tiers(ht, options);
+
+    for (int i = 0; i < 200; ++i) {
+        ht.set("k" + std::to_string(i), Value(payload(i)));
+        tiers.on_write("k" + std::to_string(i));
+    }
+    EXPECT_EQ(ht.cold_count(), 200u);
+    size_t segments = tiers.log().segment_count();
+    size_t file_bytes = tiers.log().file_bytes();
+
+    // Kill most of the records, leaving a few live ones in every segment
+    for (int i = 0; i < 200; ++i) {
+        if (i % 10 != 0) ht.remove("k" + std::to_string(i));
+    }
+    size_t dropped = tiers.compact(segments);
+    EXPECT_GT(dropped, 0u);
+    EXPECT_LT(tiers.log().file_bytes(), file_bytes);
+    EXPECT_EQ(tiers.compactions(), dropped);
+    for (int i = 0; i < 200; i += 10) {
+        EXPECT_EQ(ht.get("k" + std::to_string(i))->as_string(), payload(i));
+    }
+    std::filesystem::remove_all(options.dir);
+}
+
+TEST(TieringTest, test_command_handler_reports_keys) {
+    TieringOptions options;
+    options.dir = temp_dir("handler");
+    options.memory_budget = 5 * 1100;
+    HashTable ht;
+    TieredStorage tiers(ht, options);
+    CommandHandler handler(ht);
+    handler.set_tiering(&tiers);
+
+    for (int i = 0; i < 50; ++i) {
+        handler.execute(Command{"SET", {"k" + std::to_string(i), payload(i)}});
+    }
+    EXPECT_GE(ht.cold_count(), 40u);
+    EXPECT_EQ(handler.execute(Command{"GET", {"k0"}}), Parser::serialize_string(payload(0)));
+    auto info = handler.execute(Command{"INFO", {"tiered"}});
+    EXPECT_NE(info.find("tiered_cold_keys:"), std::string::npos);
+    EXPECT_NE(info.find("tiered_demotions:"), std::string::npos);
+    std::filesystem::remove_all(options.dir);
+}
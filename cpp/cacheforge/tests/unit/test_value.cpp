@@ -132,3 +132,20 @@ TEST(ValueTest, test_memory_size) {
     Value v("test");
     EXPECT_GT(v.memory_size(), 0);
 }
+
+TEST(ValueTest, test_to_integer_parses_decimal_strings) {
+    EXPECT_EQ(Value("12345").to_integer(), 12345);
+    EXPECT_EQ(Value("-7").to_integer(), -7);
+    EXPECT_EQ(Value(int64_t(9)).to_integer(), 9);
+    EXPECT_FALSE(Value("").to_integer().has_value());
+    EXPECT_FALSE(Value("12 ").to_integer().has_value());
+    EXPECT_FALSE(Value("99999999999999999999").to_integer().has_value());
+    EXPECT_FALSE(Value(std::vector<std::string>{"1"}).to_integer().has_value());
+}
+
+TEST(ValueTest, test_to_double) {
+    EXPECT_EQ(Value("2.5").to_double(), 2.5);
+    EXPECT_EQ(Value(int64_t(3)).to_double(), 3.0);
+    EXPECT_FALSE(Value("nan").to_double().has_value());
+    EXPECT_FALSE(Value("1.0x").to_double().has_value());
+}